@@ -6,9 +6,17 @@
 #include <jni.h>
 
 #include <cstring>
-#include <map>
 #include <memory>
 #include <mutex>
+#include <vector>
+
+#include "webgpu_rend_completion.h"
+#include "webgpu_rend_device_setup.h"
+#include "webgpu_rend_handle_table.h"
+#include "webgpu_rend_present_queue.h"
+#include "webgpu_rend_readback.h"
+#include "webgpu_rend_swapchain_ring.h"
+#include "webgpu_rend_trace.h"
 
 #define LOG_TAG "WebgpuRend"
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
@@ -37,6 +45,7 @@ JNIEnv* GetEnv() {
 
 void PrintDeviceError(WGPUDevice const* device, WGPUErrorType type, WGPUStringView message, void* userdata1, void* userdata2) {
     LOGE("Dawn Error (%d): %.*s", type, (int)message.length, message.data);
+    webgpu_rend::TraceMessage("Dawn Error", std::string(message.data, message.length));
 }
 
 struct AndroidTextureObject {
@@ -51,14 +60,26 @@ struct AndroidTextureObject {
     wgpu::Texture working_texture = nullptr;
     wgpu::TextureView working_view = nullptr;
 
-    AndroidTextureObject(int w, int h) : width(w), height(h) {
-        JNIEnv* env = GetEnv();
-        handle = env->CallStaticIntMethod(g_plugin_class, g_create_texture_mid, w, h);
-        flutter_texture_id = env->CallStaticLongMethod(g_plugin_class, g_get_id_mid, handle);
+    // Swapchains only, working_texture and working_view are image 0. Each
+    // present copies the image into the surface, so it is free again as soon
+    // as the GPU finished.
+    std::unique_ptr<webgpu_rend::SwapchainRing> swapchain;
+    std::vector<wgpu::Texture> images;
+    std::vector<wgpu::TextureView> image_views;
+
+    webgpu_rend::PresentQueue present_queue;
+
+    AndroidTextureObject(int w, int h, uint32_t image_count = 0) : width(w), height(h) {
+        {
+            WEBGPU_REND_TRACE_SCOPE("JNI createTexture");
+            JNIEnv* env = GetEnv();
+            handle = env->CallStaticIntMethod(g_plugin_class, g_create_texture_mid, w, h);
+            flutter_texture_id = env->CallStaticLongMethod(g_plugin_class, g_get_id_mid, handle);
 
-        jobject jSurface = env->CallStaticObjectMethod(g_plugin_class, g_get_surface_mid, handle);
-        window = ANativeWindow_fromSurface(env, jSurface);
-        env->DeleteLocalRef(jSurface);
+            jobject jSurface = env->CallStaticObjectMethod(g_plugin_class, g_get_surface_mid, handle);
+            window = ANativeWindow_fromSurface(env, jSurface);
+            env->DeleteLocalRef(jSurface);
+        }
 
         WGPUSurfaceSourceAndroidNativeWindow androidDesc = {};
         androidDesc.chain.sType = WGPUSType_SurfaceSourceAndroidNativeWindow;
@@ -90,18 +111,89 @@ struct AndroidTextureObject {
                          wgpu::TextureUsage::CopySrc |
                          wgpu::TextureUsage::CopyDst;
 
-        working_texture = g_device.CreateTexture(&workDesc);
-        working_view = working_texture.CreateView();
+        if (image_count > 0) {
+            swapchain = std::make_unique<webgpu_rend::SwapchainRing>(image_count);
+            for (uint32_t i = 0; i < swapchain->ImageCount(); i++) {
+                images.push_back(g_device.CreateTexture(&workDesc));
+                image_views.push_back(images.back().CreateView());
+            }
+            working_texture = images[0];
+            working_view = image_views[0];
+        } else {
+            working_texture = g_device.CreateTexture(&workDesc);
+            working_view = working_texture.CreateView();
+        }
     }
 
     ~AndroidTextureObject() {
+        WEBGPU_REND_TRACE_SCOPE("JNI disposeTexture");
         JNIEnv* env = GetEnv();
         env->CallStaticVoidMethod(g_plugin_class, g_dispose_mid, handle);
         if (window) ANativeWindow_release(window);
     }
 };
 
-static std::map<void*, std::unique_ptr<AndroidTextureObject>> g_textures;
+// Lookups go through the handle table without locking, g_mutex only guards
+// the Dawn calls.
+static webgpu_rend::HandleTable<AndroidTextureObject> g_textures;
+
+static void ProcessEvents() {
+    wgpuInstanceProcessEvents(g_instance->Get());
+}
+
+// Work-done callback of PresentImage, lock-free as PresentQueue requires.
+static void OnFrameDone(void* t, uint64_t frame) {
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    if (!obj) return;
+    if (obj->swapchain) {
+        obj->swapchain->Completed();
+        obj->swapchain->Latch();
+    }
+    obj->present_queue.Complete(t, frame);
+}
+
+// Copies `image` into the surface and presents it. g_mutex must be held.
+static void PresentImage(AndroidTextureObject* obj, void* t, const wgpu::Texture& image) {
+    // Only blocks, on the oldest frame's future, if the GPU is a full
+    // max_frames_in_flight behind
+    obj->present_queue.WaitUntilReady(g_instance->Get(), t);
+
+    wgpu::SurfaceTexture surfaceTexture;
+    obj->surface.GetCurrentTexture(&surfaceTexture);
+
+    bool acquired = surfaceTexture.status == wgpu::SurfaceGetCurrentTextureStatus::SuccessOptimal ||
+                    surfaceTexture.status == wgpu::SurfaceGetCurrentTextureStatus::SuccessSuboptimal;
+    if (acquired) {
+        wgpu::CommandEncoder encoder = g_device.CreateCommandEncoder();
+
+        wgpu::TexelCopyTextureInfo src = {};
+        src.texture = image;
+
+        wgpu::TexelCopyTextureInfo dst = {};
+        dst.texture = surfaceTexture.texture;
+
+        wgpu::Extent3D copySize = {(uint32_t)obj->width, (uint32_t)obj->height, 1};
+
+        encoder.CopyTextureToTexture(&src, &dst, &copySize);
+
+        wgpu::CommandBuffer cmd = encoder.Finish();
+        g_queue.Submit(1, &cmd);
+    } else {
+        LOGE("Failed to get surface texture status: %d", (int)surfaceTexture.status);
+        webgpu_rend::TraceMessage("Surface acquire failed", std::to_string((int)surfaceTexture.status));
+    }
+
+    // Tracked even when the frame was dropped, so a swapchain image still
+    // comes back
+    uint64_t frame = obj->present_queue.Submit();
+    wgpu::Future done = g_queue.OnSubmittedWorkDone(
+        wgpu::CallbackMode::AllowSpontaneous,
+        [t, frame](wgpu::QueueWorkDoneStatus, wgpu::StringView) { OnFrameDone(t, frame); });
+    obj->present_queue.SetWorkDoneFuture(frame, {done.id});
+    webgpu_rend::WatchFuture({done.id});
+
+    if (acquired) obj->surface.Present();
+}
 
 // FFI Exports
 
@@ -114,6 +206,7 @@ extern "C" {
 #endif
 
 API_EXPORT void* webgpu_rend_get_proc_address(const char* procName) {
+    WEBGPU_REND_TRACE_FUNCTION();
     WGPUStringView view;
     view.data = procName;
     view.length = std::strlen(procName);
@@ -122,10 +215,11 @@ API_EXPORT void* webgpu_rend_get_proc_address(const char* procName) {
 }
 
 API_EXPORT void* webgpu_rend_init(void*) {
+    WEBGPU_REND_TRACE_FUNCTION();
     std::lock_guard<std::mutex> lock(g_mutex);
     if (g_device) return g_device.Get();
 
-    g_instance = std::make_unique<dawn::native::Instance>();
+    g_instance = webgpu_rend::CreateInstance();
 
     WGPURequestAdapterOptions options = {};
     options.backendType = WGPUBackendType_Vulkan;
@@ -137,7 +231,8 @@ API_EXPORT void* webgpu_rend_init(void*) {
     }
     dawn::native::Adapter adapter = adapters[0];
 
-    WGPUDeviceDescriptor deviceDesc = {};
+    webgpu_rend::DeviceSetup setup(adapter.Get());
+    WGPUDeviceDescriptor& deviceDesc = *setup.Descriptor();
     WGPUUncapturedErrorCallbackInfo errCb = {};
     errCb.callback = PrintDeviceError;
     deviceDesc.uncapturedErrorCallbackInfo = errCb;
@@ -145,18 +240,19 @@ API_EXPORT void* webgpu_rend_init(void*) {
     WGPUDevice cDevice = adapter.CreateDevice(&deviceDesc);
     g_device = wgpu::Device::Acquire(cDevice);
     g_queue = g_device.GetQueue();
+    webgpu_rend::StartCompletionThread(g_instance->Get(), g_device.Get());
+    webgpu_rend::StartReadbackEngine(g_device.Get(), g_queue.Get());
 
     return g_device.Get();
 }
 
 API_EXPORT void* webgpu_rend_create_texture(int32_t width, int32_t height) {
+    WEBGPU_REND_TRACE_FUNCTION();
     std::lock_guard<std::mutex> lock(g_mutex);
     if (!g_device) return nullptr;
     try {
         auto tex = std::make_unique<AndroidTextureObject>(width, height);
-        void* ptr = tex.get();
-        g_textures[ptr] = std::move(tex);
-        return ptr;
+        return webgpu_rend::HandleToPointer(g_textures.Insert(std::move(tex)));
     } catch (std::exception& e) {
         LOGE("Failed to create texture: %s", e.what());
         return nullptr;
@@ -164,58 +260,119 @@ API_EXPORT void* webgpu_rend_create_texture(int32_t width, int32_t height) {
 }
 
 API_EXPORT int64_t webgpu_rend_get_texture_id(void* t) {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    return g_textures.count(t) ? g_textures[t]->flutter_texture_id : -1;
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    return tex ? tex->flutter_texture_id : -1;
 }
 
 API_EXPORT void* webgpu_rend_get_wgpu_texture(void* t) {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    return g_textures.count(t) ? g_textures[t]->working_texture.Get() : nullptr;
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    return tex ? tex->working_texture.Get() : nullptr;
 }
 
 API_EXPORT void* webgpu_rend_get_wgpu_texture_view(void* t) {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    return g_textures.count(t) ? g_textures[t]->working_view.Get() : nullptr;
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    return tex ? tex->working_view.Get() : nullptr;
 }
 
 API_EXPORT void webgpu_rend_texture_begin_access(void* t) {}
 API_EXPORT void webgpu_rend_texture_end_access(void* t) {}
 
+// Swapchains present through webgpu_rend_swapchain_present_image
 API_EXPORT void webgpu_rend_present_texture(void* t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    if (!obj || obj->swapchain) return;
     std::lock_guard<std::mutex> lock(g_mutex);
-    if (!g_textures.count(t)) return;
-    auto& obj = g_textures[t];
+    PresentImage(obj.get(), t, obj->working_texture);
+}
 
-    wgpu::SurfaceTexture surfaceTexture;
-    obj->surface.GetCurrentTexture(&surfaceTexture);
+API_EXPORT void webgpu_rend_dispose_texture(void* t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::unique_ptr<AndroidTextureObject> tex = g_textures.Remove(webgpu_rend::HandleFromPointer(t));
+    std::lock_guard<std::mutex> lock(g_mutex);
+    tex.reset();
+}
 
-    if (surfaceTexture.status != wgpu::SurfaceGetCurrentTextureStatus::SuccessOptimal &&
-        surfaceTexture.status != wgpu::SurfaceGetCurrentTextureStatus::SuccessSuboptimal) {
-        LOGE("Failed to get surface texture status: %d", (int)surfaceTexture.status);
-        return;
-    }
+API_EXPORT void webgpu_rend_set_frame_ready_callback(WebgpuRendFrameReadyCallback callback) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    webgpu_rend::SetFrameReadyCallback(callback);
+}
 
-    wgpu::CommandEncoder encoder = g_device.CreateCommandEncoder();
+API_EXPORT void webgpu_rend_set_max_frames_in_flight(void* t, int32_t count) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    if (obj) obj->present_queue.SetMaxFramesInFlight(count > 0 ? count : 1);
+}
 
-    wgpu::TexelCopyTextureInfo src = {};
-    src.texture = obj->working_texture;
+API_EXPORT int32_t webgpu_rend_get_max_frames_in_flight(void* t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    return obj ? obj->present_queue.MaxFramesInFlight() : 0;
+}
 
-    wgpu::TexelCopyTextureInfo dst = {};
-    dst.texture = surfaceTexture.texture;
+API_EXPORT int32_t webgpu_rend_get_frames_in_flight(void* t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    return obj ? obj->present_queue.FramesInFlight() : 0;
+}
 
-    wgpu::Extent3D copySize = {(uint32_t)obj->width, (uint32_t)obj->height, 1};
+API_EXPORT int32_t webgpu_rend_process_events() {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_instance) ProcessEvents();
+    return webgpu_rend::TotalFramesInFlight();
+}
 
-    encoder.CopyTextureToTexture(&src, &dst, &copySize);
+API_EXPORT void* webgpu_rend_create_swapchain(int32_t width, int32_t height, int32_t count) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_device) return nullptr;
+    try {
+        auto tex = std::make_unique<AndroidTextureObject>(width, height,
+                                                          count > 0 ? count : webgpu_rend::kMinSwapchainImages);
+        return webgpu_rend::HandleToPointer(g_textures.Insert(std::move(tex)));
+    } catch (std::exception& e) {
+        LOGE("Failed to create swapchain: %s", e.what());
+        return nullptr;
+    }
+}
 
-    wgpu::CommandBuffer cmd = encoder.Finish();
-    g_queue.Submit(1, &cmd);
+API_EXPORT int32_t webgpu_rend_swapchain_get_image_count(void* t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    return obj && obj->swapchain ? obj->swapchain->ImageCount() : 0;
+}
 
-    obj->surface.Present();
+API_EXPORT int32_t webgpu_rend_swapchain_acquire_image(void* t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    return obj && obj->swapchain ? obj->swapchain->Acquire() : -1;
 }
 
-API_EXPORT void webgpu_rend_dispose_texture(void* t) {
+API_EXPORT void* webgpu_rend_swapchain_get_wgpu_texture(void* t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    if (!obj || image < 0 || image >= (int32_t)obj->images.size()) return nullptr;
+    return obj->images[image].Get();
+}
+
+API_EXPORT void* webgpu_rend_swapchain_get_wgpu_texture_view(void* t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    if (!obj || image < 0 || image >= (int32_t)obj->image_views.size()) return nullptr;
+    return obj->image_views[image].Get();
+}
+
+API_EXPORT void webgpu_rend_swapchain_present_image(void* t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto obj = g_textures.Acquire(webgpu_rend::HandleFromPointer(t));
+    if (!obj || !obj->swapchain) return;
     std::lock_guard<std::mutex> lock(g_mutex);
-    g_textures.erase(t);
+    if (!obj->swapchain->Present(image)) return;
+    PresentImage(obj.get(), t, obj->images[image]);
 }
 
 }  // extern "C"
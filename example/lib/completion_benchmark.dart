@@ -0,0 +1,89 @@
+import 'package:flutter/material.dart';
+import 'package:webgpu_rend/webgpu_rend.dart';
+import 'package:webgpu_rend/gpu_resources.dart';
+
+void main() async {
+  WidgetsFlutterBinding.ensureInitialized();
+  await WebgpuRend.instance.initialize();
+  runApp(const MaterialApp(home: CompletionBenchmark()));
+}
+
+/// Times buffer readbacks, a copy submitted and then mapped, with the
+/// native completion thread delivering the map callback against the isolate
+/// ticking the device until it arrives.
+class CompletionBenchmark extends StatefulWidget {
+  const CompletionBenchmark({super.key});
+  @override
+  State<CompletionBenchmark> createState() => _CompletionBenchmarkState();
+}
+
+class _CompletionBenchmarkState extends State<CompletionBenchmark> {
+  static const int kIterations = 500;
+  static const int kWarmup = 20;
+
+  final List<String> _results = [];
+  bool _running = false;
+
+  Future<void> _run() async {
+    setState(() {
+      _running = true;
+      _results.clear();
+    });
+    final buffer = GpuBuffer.create(
+      size: 4096,
+      usage: WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc,
+    );
+    final rend = WebgpuRend.instance;
+    final previous = rend.useCompletionThread;
+    for (final useThread in [false, true]) {
+      rend.useCompletionThread = useThread;
+      final result = await _measure(buffer);
+      setState(() => _results.add(
+          "${useThread ? 'Completion thread' : 'Polling'}: $result"));
+    }
+    rend.useCompletionThread = previous;
+    buffer.dispose();
+    setState(() => _running = false);
+  }
+
+  Future<String> _measure(GpuBuffer buffer) async {
+    final samples = <int>[];
+    final total = Stopwatch()..start();
+    for (int i = 0; i < kWarmup + kIterations; i++) {
+      final watch = Stopwatch()..start();
+      await buffer.mapRead();
+      if (i >= kWarmup) samples.add(watch.elapsedMicroseconds);
+    }
+    total.stop();
+    samples.sort();
+    final mean = samples.reduce((a, b) => a + b) / samples.length;
+    final p50 = samples[samples.length ~/ 2];
+    final p99 = samples[(samples.length * 99) ~/ 100];
+    final perSecond = (kWarmup + kIterations) * 1e6 / total.elapsedMicroseconds;
+    return "mean ${mean.toStringAsFixed(0)}us, p50 ${p50}us, p99 ${p99}us, "
+        "${perSecond.toStringAsFixed(0)} readbacks/s";
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    return Scaffold(
+      appBar: AppBar(title: const Text('Readback latency')),
+      body: Padding(
+        padding: const EdgeInsets.all(16),
+        child: Column(
+          crossAxisAlignment: CrossAxisAlignment.start,
+          children: [
+            Text("$kIterations readbacks per mode, after $kWarmup warm-up runs"),
+            const SizedBox(height: 12),
+            for (final result in _results) Text(result),
+            const SizedBox(height: 12),
+            ElevatedButton(
+              onPressed: _running ? null : _run,
+              child: Text(_running ? 'Running...' : 'Run'),
+            ),
+          ],
+        ),
+      ),
+    );
+  }
+}
@@ -223,6 +223,8 @@ class _CubeScreenState extends State<CubeScreen>
     if (mounted && _frameTimes.length % 30 == 0) setState(() {});
 
     _time = elapsed.inMilliseconds / 1000.0;
+    // Skip the tick rather than block in present() while the GPU catches up
+    if (canvasTexture!.framesInFlight >= canvasTexture!.maxFramesInFlight) return;
     _render();
   }
 
@@ -1,3 +1,4 @@
+import 'package:example/completion_benchmark.dart';
 import 'package:example/image.dart';
 import 'package:example/cube.dart';
 import 'package:example/object.dart';
@@ -39,6 +40,7 @@ class MenuScreen extends StatelessWidget {
           _buildItem(context, 'Simple Image', const SimpleImage()),
           _buildItem(context, 'Simple Object', const SimpleObject()),
           _buildItem(context, 'Simple Triangle', const RawWebGpuTriangle()),
+          _buildItem(context, 'Readback Latency', const CompletionBenchmark()),
         ],
       ),
     );
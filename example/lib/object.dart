@@ -1,8 +1,6 @@
 import 'dart:async';
-import 'dart:ffi';
 import 'dart:math';
 
-import 'package:ffi/ffi.dart';
 import 'package:flutter/material.dart';
 import 'package:flutter/scheduler.dart';
 import 'package:vector_math/vector_math.dart' as vm;
@@ -50,26 +48,8 @@ struct VertexOutput {
 }
 ''';
 
-class DrawUniforms {
-  final Pointer<Uint8> _ptr = calloc<Uint8>(80);
-  
-  void update(vm.Matrix4 mvp, Color color) {
-    final floatList = _ptr.cast<Float>();
-    
-    for (int i = 0; i < 16; i++) {
-      floatList[i] = mvp.storage[i];
-    }
-    
-    floatList[16] = color.red / 255.0;
-    floatList[17] = color.green / 255.0;
-    floatList[18] = color.blue / 255.0;
-    floatList[19] = 1.0;
-  }
-  
-  Pointer<Void> get ptr => _ptr.cast();
-  int get size => 80;
-  void dispose() => calloc.free(_ptr);
-}
+// mvp followed by color
+const int kDrawUniformsSize = 80;
 
 class OrbitCamera {
   double theta = 0.0; 
@@ -120,9 +100,14 @@ class _SwordViewerState extends State<SwordViewer> with SingleTickerProviderStat
   GpuRenderPipeline? pipeline;
   GpuBuffer? vertexBuffer, indexBuffer;
   
-  List<GpuBuffer> uniformBuffers = [];
-  List<WGPUBindGroup> bindGroups = [];
-  List<DrawUniforms> cpuUniforms = [];
+  // Every draw's uniforms, bound at a dynamic offset per draw
+  GpuUniformArena? uniforms;
+  GpuBindGroupLayout? uniformLayout;
+  GpuPipelineLayout? pipelineLayout;
+  // Every draw of the mesh, recorded once. The slots land at the same
+  // offsets every frame, so it only needs recording again when the arena
+  // replaces its buffer and the bind group with it.
+  GpuRenderBundle? bundle;
 
   MeshData? _mesh;
   Map<String, Color> _materials = {};
@@ -148,8 +133,18 @@ class _SwordViewerState extends State<SwordViewer> with SingleTickerProviderStat
     await _loadMaterials();
 
     // Pipeline Setup
+    uniformLayout = GpuBindGroupLayout.create([
+      GpuBindingLayoutEntry.uniformBuffer(
+        0,
+        WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
+        hasDynamicOffset: true,
+        minBindingSize: kDrawUniformsSize,
+      ),
+    ]);
+    pipelineLayout = GpuPipelineLayout.create([uniformLayout!]);
     final shader = GpuShader.create(kLitShader);
     pipeline = GpuRenderPipeline.create(
+      layout: pipelineLayout,
       vertexShader: shader,
       fragmentShader: shader,
       vertexEntryPoint: "vs_main",
@@ -179,16 +174,10 @@ class _SwordViewerState extends State<SwordViewer> with SingleTickerProviderStat
     );
     indexBuffer!.update(_mesh!.indices.buffer.asUint8List());
 
-    // Create Uniforms
-    for (var _ in _mesh!.groups) {
-      final uBuf = GpuBuffer.create(
-        size: 256, 
-        usage: WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
-      );
-      uniformBuffers.add(uBuf);
-      cpuUniforms.add(DrawUniforms());
-      bindGroups.add(pipeline!.createBindGroup(0, [uBuf]));
-    }
+    uniforms = GpuUniformArena(
+      capacity: _mesh!.groups.length * 256,
+      bindingSize: kDrawUniformsSize,
+    );
 
     setState(() => _isLoading = false);
     _ticker = createTicker((_) => _render())..start();
@@ -215,6 +204,26 @@ class _SwordViewerState extends State<SwordViewer> with SingleTickerProviderStat
     //final model = vm.Matrix4.identity()..translate(10.0, -5.0, 0.0);
     final mvp = proj * view * model;
 
+    // Pack every draw's uniforms and upload them with one write
+    final arena = uniforms!..reset();
+    final offsets = List<int>.filled(_mesh!.groups.length, 0);
+    for (int i = 0; i < _mesh!.groups.length; i++) {
+      final group = _mesh!.groups[i];
+
+      // Look up color in our map, or default to pink so we know it's missing
+      final color = _materials[group.materialName] ?? Colors.pinkAccent;
+
+      offsets[i] = arena.allocate();
+      final floats = arena.floats(offsets[i]);
+      floats.setAll(0, mvp.storage);
+      floats[16] = color.red / 255.0;
+      floats[17] = color.green / 255.0;
+      floats[18] = color.blue / 255.0;
+      floats[19] = 1.0;
+    }
+    arena.upload();
+    final bindGroup = uniformLayout!.createBindGroup([arena.binding]);
+
     canvasTex!.beginAccess();
     final encoder = CommandEncoder();
     final pass = encoder.beginRenderPass(
@@ -225,23 +234,23 @@ class _SwordViewerState extends State<SwordViewer> with SingleTickerProviderStat
       clearColor: const Color(0xFF101010),
     );
 
-    pass.bindPipeline(pipeline!);
-    pass.setVertexBuffer(0, vertexBuffer!);
-    pass.setIndexBuffer(indexBuffer!, WGPUIndexFormat.WGPUIndexFormat_Uint32);
-
-    for (int i = 0; i < _mesh!.groups.length; i++) {
-      final group = _mesh!.groups[i];
-      
-      // Look up color in our map, or default to pink so we know it's missing
-      final color = _materials[group.materialName] ?? Colors.pinkAccent;
-      
-      cpuUniforms[i].update(mvp, color);
-      uniformBuffers[i].updateRaw(cpuUniforms[i].ptr, cpuUniforms[i].size);
-
-      pass.setBindGroup(0, bindGroups[i]);
-      pass.drawIndexed(group.indexCount, 1, group.indexStart);
+    if (bundle == null || !bundle!.isValid) {
+      bundle = GpuRenderBundle.record((b) {
+        b.bindPipeline(pipeline!);
+        b.setVertexBuffer(0, vertexBuffer!);
+        b.setIndexBuffer(indexBuffer!, WGPUIndexFormat.WGPUIndexFormat_Uint32);
+
+        for (int i = 0; i < _mesh!.groups.length; i++) {
+          final group = _mesh!.groups[i];
+          b.setBindGroup(0, bindGroup, [offsets[i]]);
+          b.drawIndexed(group.indexCount, 1, group.indexStart);
+        }
+      },
+          depthFormat: WGPUTextureFormat.WGPUTextureFormat_Depth24Plus,
+          sampleCount: 4);
     }
 
+    pass.executeBundles([bundle!]);
     pass.end();
     encoder.submit();
     canvasTex!.endAccess();
@@ -251,17 +260,13 @@ class _SwordViewerState extends State<SwordViewer> with SingleTickerProviderStat
   @override
   void dispose() {
     _ticker.dispose();
-    for (var u in cpuUniforms) {
-      u.dispose();
-    }
+    uniforms?.dispose();
+    bundle?.dispose();
     
     /*
     disposing causes issues for some reason when re-entering..
     vertexBuffer?.dispose();
     indexBuffer?.dispose();
-    for(var b in uniformBuffers) {
-      b.dispose();
-    }
     
     canvasTex?.dispose();
     msaaTex?.dispose();
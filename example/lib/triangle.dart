@@ -88,7 +88,7 @@ class _RawWebGpuTriangleState extends State<RawWebGpuTriangle> with SingleTicker
       final shaderModule = _wgpu.wgpuDeviceCreateShaderModule(_device, shaderModuleDesc);
 
       // Pipeline Setup
-      final textureFormat = Platform.isAndroid
+      final textureFormat = Platform.isAndroid || Platform.isLinux
           ? WGPUTextureFormat.WGPUTextureFormat_RGBA8Unorm
           : WGPUTextureFormat.WGPUTextureFormat_BGRA8Unorm;
 
@@ -4,12 +4,14 @@ import 'dart:typed_data';
 import 'dart:io';
 import 'dart:ui';
 import 'package:ffi/ffi.dart';
+import 'package:flutter/scheduler.dart';
 import 'package:vector_math/vector_math.dart';
 import 'package:webgpu_rend/webgpu_rend.dart';
 
-WGPUTextureFormat get kPreferredTextureFormat => Platform.isAndroid
-    ? WGPUTextureFormat.WGPUTextureFormat_RGBA8Unorm
-    : WGPUTextureFormat.WGPUTextureFormat_BGRA8Unorm;
+WGPUTextureFormat get kPreferredTextureFormat =>
+    Platform.isAndroid || Platform.isLinux
+        ? WGPUTextureFormat.WGPUTextureFormat_RGBA8Unorm
+        : WGPUTextureFormat.WGPUTextureFormat_BGRA8Unorm;
 
 // Consider removing this in favor of arena
 class _Scratchpad {
@@ -18,11 +20,30 @@ class _Scratchpad {
   late final Pointer<WGPURenderPassColorAttachment> colorAttachment;
   late final Pointer<WGPURenderPassDepthStencilAttachment>
       depthStencilAttachment;
+  late final Pointer<WGPUComputePassDescriptor> computePassDesc;
+  late final Pointer<WGPUPassTimestampWrites> timestampWrites;
+  // WebGPU allows at most 8 dynamic uniform and 4 dynamic storage buffers
+  // per pipeline layout
+  static const int maxDynamicOffsets = 12;
+  late final Pointer<Uint32> dynamicOffsets;
 
   _Scratchpad._() {
     renderPassDesc = calloc<WGPURenderPassDescriptor>();
     colorAttachment = calloc<WGPURenderPassColorAttachment>();
     depthStencilAttachment = calloc<WGPURenderPassDepthStencilAttachment>();
+    computePassDesc = calloc<WGPUComputePassDescriptor>();
+    timestampWrites = calloc<WGPUPassTimestampWrites>();
+    dynamicOffsets = calloc<Uint32>(maxDynamicOffsets);
+  }
+
+  Pointer<Uint32> offsets(List<int> values) {
+    if (values.length > maxDynamicOffsets) {
+      throw ArgumentError("At most $maxDynamicOffsets dynamic offsets");
+    }
+    for (int i = 0; i < values.length; i++) {
+      dynamicOffsets[i] = values[i];
+    }
+    return dynamicOffsets;
   }
 }
 
@@ -73,6 +94,13 @@ class VertexBufferLayout {
     );
   }
 
+  String get _cacheKey => [
+        arrayStride,
+        stepMode.value,
+        for (final a in attributes)
+          '${a.format.value}:${a.offset}:${a.shaderLocation}',
+      ].join(',');
+
   static int _getSizeInBytes(WGPUVertexFormat format) {
     switch (format) {
       case WGPUVertexFormat.WGPUVertexFormat_Float32: return 4;
@@ -92,15 +120,30 @@ WGPUStringView _createStringView(Arena arena, String s) {
   return view.ref;
 }
 
+// Waits for the callback behind `future` to complete `completer`. The
+// completion thread delivers it when running, otherwise the device is ticked
+// from here once per event-loop turn.
+Future<T> _awaitCallback<T>(WGPUFuture future, Completer<T> completer) async {
+  if (!WebgpuRend.instance.watchFutureInternal(future)) {
+    final wgpu = WebgpuRend.instance.wgpu;
+    while (!completer.isCompleted) {
+      wgpu.wgpuDeviceTick(WebgpuRend.instance.device);
+      await Future.delayed(Duration.zero);
+    }
+  }
+  return completer.future;
+}
+
+// `bindings` maps resources to binding numbers, by default the index
 WGPUBindGroup _createBindGroupHelper(
-    WGPUBindGroupLayout layout, List<Object> resources) {
+    WGPUBindGroupLayout layout, List<Object> resources, [List<int>? bindings]) {
   final wgpu = WebgpuRend.instance.wgpu;
   return using((arena) {
     final bgEntries = arena<WGPUBindGroupEntry>(resources.length);
     for (int i = 0; i < resources.length; i++) {
       final r = resources[i];
       final bgEntry = bgEntries.elementAt(i);
-      bgEntry.ref.binding = i;
+      bgEntry.ref.binding = bindings != null ? bindings[i] : i;
       bgEntry.ref.buffer = nullptr;
       bgEntry.ref.textureView = nullptr;
       bgEntry.ref.sampler = nullptr;
@@ -108,6 +151,10 @@ WGPUBindGroup _createBindGroupHelper(
         bgEntry.ref.buffer = r.handle.cast();
         bgEntry.ref.size = r.size;
         bgEntry.ref.offset = 0;
+      } else if (r is GpuBufferBinding) {
+        bgEntry.ref.buffer = r.buffer.handle.cast();
+        bgEntry.ref.size = r.size;
+        bgEntry.ref.offset = r.offset;
       } else if (r is WGPUTextureView) {
         bgEntry.ref.textureView = r;
       } else if (r is GpuTexture) {
@@ -145,11 +192,13 @@ class GpuTexture implements Finalizable {
   final int width;
   final int height;
   final bool _isShared;
+  // Swapchain images belong to their GpuSwapchain
+  final bool _borrowed;
 
   bool _disposed = false;
 
   GpuTexture._(this._handle, this.textureId, this.texture, this.view,
-      this.width, this.height, this._isShared) {
+      this.width, this.height, this._isShared, [this._borrowed = false]) {
     if (_isShared) {
       _textureFinalizer.attach(this, _handle.cast(), detach: this);
     }
@@ -245,7 +294,36 @@ class GpuTexture implements Finalizable {
     WebgpuRend.instance.presentInternal(_handle);
   }
 
-  void uploadRect(Uint8List data, Rect rect) {
+  /// Frames presented from this texture that the GPU has not finished yet.
+  int get framesInFlight {
+    if (_disposed || !_isShared) return 0;
+    return WebgpuRend.instance.getFramesInFlightInternal(_handle);
+  }
+
+  /// How many frames may be in flight before [present] waits for the GPU.
+  /// Defaults to 2, clamped to 1-8. Lower values trade throughput for
+  /// latency.
+  int get maxFramesInFlight {
+    if (_disposed || !_isShared) return 0;
+    return WebgpuRend.instance.getMaxFramesInFlightInternal(_handle);
+  }
+
+  set maxFramesInFlight(int count) {
+    if (_disposed || !_isShared) return;
+    WebgpuRend.instance.setMaxFramesInFlightInternal(_handle, count);
+  }
+
+  /// Completes once another frame can be presented without blocking on the
+  /// GPU. Awaiting this before rendering keeps animations from piling up
+  /// frames when the GPU falls behind.
+  Future<void> get readyForNextFrame {
+    if (_disposed || !_isShared) return Future.value();
+    return WebgpuRend.instance.readyForNextFrameInternal(_handle);
+  }
+
+  /// With a [belt], the texels are copied once into its mapped memory and
+  /// land on the texture at its next [GpuStagingBelt.flush].
+  void uploadRect(Uint8List data, Rect rect, {GpuStagingBelt? belt}) {
     if (_disposed) return;
     final wgpu = WebgpuRend.instance.wgpu;
     final int x = rect.left.toInt();
@@ -259,6 +337,15 @@ class GpuTexture implements Finalizable {
           "Data size (${data.length}) does not match rect size ($w x $h x 4 = ${w * h * 4})");
     }
 
+    if (belt != null) {
+      final region = belt.writeTexture(this, x, y, w, h);
+      for (int row = 0; row < h; row++) {
+        region.bytes.setRange(row * region.bytesPerRow,
+            row * region.bytesPerRow + w * 4, data, row * w * 4);
+      }
+      return;
+    }
+
     beginAccess();
 
     using((arena) {
@@ -290,67 +377,78 @@ class GpuTexture implements Finalizable {
     endAccess();
   }
 
-  Future<Uint8List> download() async {
+  /// Copies the texture back to the CPU as tightly packed rows of texels.
+  ///
+  /// [x], [y], [width] and [height] pick a region of [mipLevel], a width or
+  /// height of 0 reaching to its edge. The copy goes through a pool of
+  /// readback buffers kept natively, so repeated downloads of one size do not
+  /// allocate, and the rows are copied straight into native memory that is
+  /// freed with the returned list.
+  Future<Uint8List> download(
+      {int x = 0,
+      int y = 0,
+      int width = 0,
+      int height = 0,
+      int mipLevel = 0}) async {
     if (_disposed) return Uint8List(0);
-    final wgpu = WebgpuRend.instance.wgpu;
-    wgpu.wgpuQueueSubmit(WebgpuRend.instance.queue, 0, nullptr);
-
-    final size = width * height * 4;
-    final int bytesPerRow = (width * 4 + 255) & ~255;
-    final int paddedSize = bytesPerRow * height;
-
-    final buffer = GpuBuffer.create(
-        size: paddedSize,
-        usage: WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst);
-
-    final encoder = CommandEncoder();
-    using((arena) {
-      final src = arena<WGPUTexelCopyTextureInfo>();
-      src.ref.texture = texture;
-      src.ref.mipLevel = 0;
-      src.ref.origin.x = 0;
-      src.ref.origin.y = 0;
-      src.ref.origin.z = 0;
-      src.ref.aspect = WGPUTextureAspect.WGPUTextureAspect_All;
-
-      final dst = arena<WGPUTexelCopyBufferInfo>();
-      dst.ref.buffer = buffer.handle.cast();
-      dst.ref.layout.offset = 0;
-      dst.ref.layout.bytesPerRow = bytesPerRow;
-      dst.ref.layout.rowsPerImage = height;
-
-      final copySize = arena<WGPUExtent3D>();
-      copySize.ref.width = width;
-      copySize.ref.height = height;
-      copySize.ref.depthOrArrayLayers = 1;
-
-      wgpu.wgpuCommandEncoderCopyTextureToBuffer(
-          encoder._handle, src, dst, copySize);
-    });
-
-    beginAccess();
-    encoder.submit();
-    endAccess();
+    return _readBack(x, y, width, height, mipLevel, null, 0);
+  }
 
-    final paddedData = await buffer.mapRead();
-    final compactData = Uint8List(size);
+  /// Like [download], but into [into], which must hold [capacity] bytes and
+  /// stays owned by the caller. Returns a view of the bytes written.
+  Future<Uint8List> downloadInto(Pointer<Uint8> into, int capacity,
+      {int x = 0,
+      int y = 0,
+      int width = 0,
+      int height = 0,
+      int mipLevel = 0}) async {
+    if (_disposed) return Uint8List(0);
+    return _readBack(x, y, width, height, mipLevel, into, capacity);
+  }
 
-    for (int y = 0; y < height; y++) {
-      final srcOffset = y * bytesPerRow;
-      final dstOffset = y * (width * 4);
-      for (int i = 0; i < (width * 4); i++) {
-        compactData[dstOffset + i] = paddedData[srcOffset + i];
+  Future<Uint8List> _readBack(int x, int y, int width, int height,
+      int mipLevel, Pointer<Uint8>? into, int capacity) async {
+    final sw = WebgpuRend.instance;
+    final future = calloc<WGPUFuture>();
+    final rowBytesPtr = calloc<Uint32>();
+    try {
+      beginAccess();
+      final id = sw.readbackBeginInternal(texture.cast(), mipLevel, x, y,
+          width, height, future.cast(), rowBytesPtr);
+      endAccess();
+      if (id == 0) {
+        throw ArgumentError("Cannot read back this region of the texture");
+      }
+      final mapped =
+          await _awaitCallback(future.ref, sw.readbackCompleterInternal(id));
+
+      final levelHeight = this.height >> mipLevel;
+      final rows =
+          height != 0 ? height : (levelHeight > 0 ? levelHeight : 1) - y;
+      final size = rowBytesPtr.value * rows;
+      if (!mapped || (into != null && capacity < size)) {
+        sw.readbackFinishInternal(id, nullptr, 0);
+        if (!mapped) throw StateError("Texture readback failed");
+        throw ArgumentError("Readback of $size bytes exceeds $capacity");
       }
+      if (into != null) {
+        sw.readbackFinishInternal(id, into, 0);
+        return into.asTypedList(size);
+      }
+      final bytes = malloc<Uint8>(size);
+      sw.readbackFinishInternal(id, bytes, 0);
+      return bytes.asTypedList(size, finalizer: malloc.nativeFree);
+    } finally {
+      calloc.free(future);
+      calloc.free(rowBytesPtr);
     }
-
-    buffer.dispose();
-    return compactData;
   }
 
   void dispose() {
-    if (_disposed) return;
+    if (_disposed || _borrowed) return;
     _disposed = true;
     final wgpu = WebgpuRend.instance.wgpu;
+    GpuBindGroupCache._invalidate(view.address);
     wgpu.wgpuTextureViewRelease(view);
     if (_isShared) {
       _textureFinalizer.detach(this);
@@ -361,6 +459,111 @@ class GpuTexture implements Finalizable {
   }
 }
 
+/// Several images behind one Flutter texture, so the next frame can be
+/// rendered while the compositor still shows the last one. Render into the
+/// image from [acquireNextImage], then [present] it; Flutter switches to it
+/// once the GPU finished drawing.
+class GpuSwapchain implements Finalizable {
+  final Pointer<Void> _handle;
+  final int textureId;
+  final int width;
+  final int height;
+
+  /// Owned by the swapchain, do not dispose them.
+  final List<GpuTexture> images;
+
+  bool _disposed = false;
+
+  GpuSwapchain._(
+      this._handle, this.textureId, this.width, this.height, this.images) {
+    _textureFinalizer.attach(this, _handle.cast(), detach: this);
+  }
+
+  /// [imageCount] is clamped to 2-4. Three lets the app, the GPU and the
+  /// compositor each work on their own image.
+  static GpuSwapchain create(
+      {required int width, required int height, int imageCount = 3}) {
+    final sw = WebgpuRend.instance;
+    final handle = sw.createSwapchainInternal(width, height, imageCount);
+    if (handle == nullptr) throw "Failed to create swapchain";
+
+    final id = sw.getTextureIdInternal(handle);
+    final count = sw.swapchainGetImageCountInternal(handle);
+    final images = List.generate(count, (i) {
+      final texture = sw.swapchainGetTextureInternal(handle, i);
+      final view = sw.swapchainGetViewInternal(handle, i);
+      return GpuTexture._(handle, id, texture.cast(), view.cast(), width,
+          height, false, true);
+    });
+    return GpuSwapchain._(handle, id, width, height, images);
+  }
+
+  /// An image nobody is using, or null while the GPU and compositor still
+  /// hold all of them.
+  GpuTexture? tryAcquireNextImage() {
+    if (_disposed) return null;
+    final image =
+        WebgpuRend.instance.swapchainAcquireImageInternal(_handle);
+    return image >= 0 ? images[image] : null;
+  }
+
+  /// Waits for an image to come free.
+  Future<GpuTexture> acquireNextImage() async {
+    final sw = WebgpuRend.instance;
+    while (true) {
+      if (_disposed) throw StateError("Swapchain was disposed");
+      final image = tryAcquireNextImage();
+      if (image != null) return image;
+      if (sw.getFramesInFlightInternal(_handle) > 0) {
+        // Finishing a frame frees the image it replaces
+        await sw.frameDoneInternal(_handle);
+      } else {
+        // The rest are held by the compositor, which lets go of one when it
+        // latches the newest frame
+        await SchedulerBinding.instance.endOfFrame;
+      }
+    }
+  }
+
+  /// Queues an acquired [image] for display.
+  void present(GpuTexture image) {
+    if (_disposed) return;
+    final index = images.indexOf(image);
+    if (index < 0) throw ArgumentError("Image is not from this swapchain");
+    WebgpuRend.instance.swapchainPresentImageInternal(_handle, index);
+  }
+
+  /// See [GpuTexture.framesInFlight].
+  int get framesInFlight => _disposed
+      ? 0
+      : WebgpuRend.instance.getFramesInFlightInternal(_handle);
+
+  /// See [GpuTexture.maxFramesInFlight].
+  int get maxFramesInFlight => _disposed
+      ? 0
+      : WebgpuRend.instance.getMaxFramesInFlightInternal(_handle);
+
+  set maxFramesInFlight(int count) {
+    if (_disposed) return;
+    WebgpuRend.instance.setMaxFramesInFlightInternal(_handle, count);
+  }
+
+  /// See [GpuTexture.readyForNextFrame].
+  Future<void> get readyForNextFrame => _disposed
+      ? Future.value()
+      : WebgpuRend.instance.readyForNextFrameInternal(_handle);
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    for (final image in images) {
+      GpuBindGroupCache._invalidate(image.view.address);
+    }
+    _textureFinalizer.detach(this);
+    WebgpuRend.instance.disposeTextureInternal(_handle);
+  }
+}
+
 class GpuBuffer extends GpuResource {
   final int size;
   final int usage;
@@ -382,7 +585,13 @@ class GpuBuffer extends GpuResource {
     });
   }
 
-  void update(Uint8List data) {
+  /// With a [belt], see [GpuStagingBelt], the data is copied once instead of
+  /// twice. The same goes for [updateRawOffset].
+  void update(Uint8List data, {GpuStagingBelt? belt}) {
+    if (belt != null) {
+      belt.writeBuffer(this, 0, data.length).setAll(0, data);
+      return;
+    }
     using((arena) {
       final ptr = arena<Uint8>(data.length);
       ptr.asTypedList(data.length).setAll(0, data);
@@ -395,7 +604,12 @@ class GpuBuffer extends GpuResource {
         WebgpuRend.instance.queue, handle.cast(), 0, data, dataSize);
   }
 
-  void updateRawOffset(Uint8List data, int bufferOffset) {
+  void updateRawOffset(Uint8List data, int bufferOffset,
+      {GpuStagingBelt? belt}) {
+    if (belt != null) {
+      belt.writeBuffer(this, bufferOffset, data.length).setAll(0, data);
+      return;
+    }
     using((arena) {
       final ptr = arena<Uint8>(data.length);
       ptr.asTypedList(data.length).setAll(0, data);
@@ -457,20 +671,20 @@ class GpuBuffer extends GpuResource {
         completer.completeError("Map Async Failed: $status");
       }
     });
-    using((arena) {
+    final future = using((arena) {
       final callbackInfo = arena<WGPUBufferMapCallbackInfo>();
       callbackInfo.ref.mode =
           WGPUCallbackMode.WGPUCallbackMode_AllowSpontaneous;
       callbackInfo.ref.callback = callback.nativeFunction;
       callbackInfo.ref.userdata1 = nullptr;
-      wgpu.wgpuBufferMapAsync(
+      return wgpu.wgpuBufferMapAsync(
           bufferHandle, WGPUMapMode_Read, 0, size, callbackInfo.ref);
     });
-    while (!completer.isCompleted) {
-      wgpu.wgpuDeviceTick(WebgpuRend.instance.device);
-      await Future.delayed(Duration.zero);
+    try {
+      await _awaitCallback(future, completer);
+    } finally {
+      callback.close();
     }
-    callback.close();
     final ptr = wgpu.wgpuBufferGetConstMappedRange(bufferHandle, 0, size);
     final result = Uint8List.fromList(ptr.cast<Uint8>().asTypedList(size));
     wgpu.wgpuBufferUnmap(bufferHandle);
@@ -478,10 +692,22 @@ class GpuBuffer extends GpuResource {
   }
 
   void dispose() {
+    GpuBindGroupCache._invalidate(handle.address);
+    GpuRenderBundle._invalidate(handle.address);
     WebgpuRend.instance.wgpu.wgpuBufferRelease(handle.cast());
   }
 }
 
+/// A range of a [GpuBuffer] to bind, for uniforms packed into one buffer or
+/// bindings with a dynamic offset, where [size] is the window the offset
+/// moves.
+class GpuBufferBinding {
+  final GpuBuffer buffer;
+  final int offset;
+  final int size;
+  const GpuBufferBinding(this.buffer, {this.offset = 0, required this.size});
+}
+
 class GpuSampler extends GpuResource {
   GpuSampler._(super.handle);
 
@@ -514,273 +740,1001 @@ class GpuSampler extends GpuResource {
     });
   }
 
-  void dispose() => WebgpuRend.instance.wgpu.wgpuSamplerRelease(handle.cast());
+  void dispose() {
+    GpuBindGroupCache._invalidate(handle.address);
+    WebgpuRend.instance.wgpu.wgpuSamplerRelease(handle.cast());
+  }
 }
 
-class GpuShader extends GpuResource {
-  GpuShader._(super.handle);
-  static GpuShader create(String source) {
+/// One binding of a [GpuBindGroupLayout].
+class GpuBindingLayoutEntry {
+  final int binding;
+  // WGPUShaderStage_* bits
+  final int visibility;
+  final WGPUBufferBindingType bufferType;
+  final bool hasDynamicOffset;
+  final int minBindingSize;
+  final WGPUTextureSampleType textureSampleType;
+  final WGPUTextureViewDimension viewDimension;
+  final WGPUSamplerBindingType samplerType;
+
+  const GpuBindingLayoutEntry._(
+    this.binding,
+    this.visibility, {
+    this.bufferType = WGPUBufferBindingType.WGPUBufferBindingType_BindingNotUsed,
+    this.hasDynamicOffset = false,
+    this.minBindingSize = 0,
+    this.textureSampleType =
+        WGPUTextureSampleType.WGPUTextureSampleType_BindingNotUsed,
+    this.viewDimension =
+        WGPUTextureViewDimension.WGPUTextureViewDimension_Undefined,
+    this.samplerType =
+        WGPUSamplerBindingType.WGPUSamplerBindingType_BindingNotUsed,
+  });
+
+  factory GpuBindingLayoutEntry.uniformBuffer(int binding, int visibility,
+          {bool hasDynamicOffset = false, int minBindingSize = 0}) =>
+      GpuBindingLayoutEntry._(binding, visibility,
+          bufferType: WGPUBufferBindingType.WGPUBufferBindingType_Uniform,
+          hasDynamicOffset: hasDynamicOffset,
+          minBindingSize: minBindingSize);
+
+  factory GpuBindingLayoutEntry.storageBuffer(int binding, int visibility,
+          {bool readOnly = false,
+          bool hasDynamicOffset = false,
+          int minBindingSize = 0}) =>
+      GpuBindingLayoutEntry._(binding, visibility,
+          bufferType: readOnly
+              ? WGPUBufferBindingType.WGPUBufferBindingType_ReadOnlyStorage
+              : WGPUBufferBindingType.WGPUBufferBindingType_Storage,
+          hasDynamicOffset: hasDynamicOffset,
+          minBindingSize: minBindingSize);
+
+  factory GpuBindingLayoutEntry.texture(int binding, int visibility,
+          {WGPUTextureSampleType sampleType =
+              WGPUTextureSampleType.WGPUTextureSampleType_Float,
+          WGPUTextureViewDimension viewDimension =
+              WGPUTextureViewDimension.WGPUTextureViewDimension_2D}) =>
+      GpuBindingLayoutEntry._(binding, visibility,
+          textureSampleType: sampleType, viewDimension: viewDimension);
+
+  factory GpuBindingLayoutEntry.sampler(int binding, int visibility,
+          {WGPUSamplerBindingType type =
+              WGPUSamplerBindingType.WGPUSamplerBindingType_Filtering}) =>
+      GpuBindingLayoutEntry._(binding, visibility, samplerType: type);
+}
+
+/// The shape of a bind group, declared once and shared by every pipeline
+/// created with a [GpuPipelineLayout] that contains it. Bind groups made
+/// from it work with all of those pipelines, unlike the groups of a
+/// pipeline without a layout, which Dawn only accepts for that pipeline.
+class GpuBindGroupLayout extends GpuResource {
+  final List<GpuBindingLayoutEntry> entries;
+  bool _disposed = false;
+  GpuBindGroupLayout._(super.handle, this.entries);
+
+  static GpuBindGroupLayout create(List<GpuBindingLayoutEntry> entries) {
     final wgpu = WebgpuRend.instance.wgpu;
     return using((arena) {
-      final wgslDesc = arena<WGPUShaderSourceWGSL>();
-      wgslDesc.ref.chain.sType = WGPUSType.WGPUSType_ShaderSourceWGSL;
-      wgslDesc.ref.chain.next = nullptr;
-      wgslDesc.ref.code = _createStringView(arena, source);
-      final desc = arena<WGPUShaderModuleDescriptor>();
-      desc.ref.nextInChain = wgslDesc.cast();
+      final nativeEntries = arena<WGPUBindGroupLayoutEntry>(entries.length);
+      for (int i = 0; i < entries.length; i++) {
+        final e = entries[i];
+        final entry = nativeEntries.elementAt(i).ref;
+        entry.binding = e.binding;
+        entry.visibility = e.visibility;
+        entry.buffer.type = e.bufferType;
+        entry.buffer.hasDynamicOffset = e.hasDynamicOffset ? 1 : 0;
+        entry.buffer.minBindingSize = e.minBindingSize;
+        entry.texture.sampleType = e.textureSampleType;
+        entry.texture.viewDimension = e.viewDimension;
+        entry.sampler.type = e.samplerType;
+      }
+      final desc = arena<WGPUBindGroupLayoutDescriptor>();
+      desc.ref.nextInChain = nullptr;
       desc.ref.label.data = nullptr;
       desc.ref.label.length = 0;
-      final handle =
-          wgpu.wgpuDeviceCreateShaderModule(WebgpuRend.instance.device, desc);
-      return GpuShader._(handle.cast());
+      desc.ref.entryCount = entries.length;
+      desc.ref.entries = nativeEntries;
+      final handle = wgpu.wgpuDeviceCreateBindGroupLayout(
+          WebgpuRend.instance.device, desc);
+      return GpuBindGroupLayout._(handle.cast(), List.unmodifiable(entries));
     });
   }
 
-  void dispose() =>
-      WebgpuRend.instance.wgpu.wgpuShaderModuleRelease(handle.cast());
+  /// A group binding `resources[i]` to `entries[i]`, from
+  /// [GpuBindGroupCache] when the same resources were bound before.
+  WGPUBindGroup createBindGroup(List<Object> resources) {
+    if (resources.length != entries.length) {
+      throw ArgumentError(
+          "Expected ${entries.length} resources, got ${resources.length}");
+    }
+    return GpuBindGroupCache._get(handle.cast(), resources,
+        [for (final e in entries) e.binding]);
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    GpuBindGroupCache._invalidate(handle.address);
+    WebgpuRend.instance.wgpu.wgpuBindGroupLayoutRelease(handle.cast());
+  }
 }
 
-class GpuRenderPipeline extends GpuResource {
-  GpuRenderPipeline._(super.handle);
+/// The bind group layouts of a pipeline, by group index. Pipelines created
+/// with the same layouts can share bind groups, so switching between them
+/// needs no new `setBindGroup` calls for the groups they have in common.
+class GpuPipelineLayout extends GpuResource {
+  final List<GpuBindGroupLayout> bindGroupLayouts;
+  // Identifies the layout in pipeline cache keys
+  final int _id;
+  GpuPipelineLayout._(super.handle, this.bindGroupLayouts, this._id);
 
-  static GpuRenderPipeline create({
-    required GpuShader vertexShader,
-    required GpuShader fragmentShader,
-    required List<VertexBufferLayout> bufferLayouts,
-    BlendMode blendMode = BlendMode.opaque, 
-    bool enableDepth = false,
-    WGPUTextureFormat depthFormat =
-        WGPUTextureFormat.WGPUTextureFormat_Depth24Plus,
-    String vertexEntryPoint = "main",
-    String fragmentEntryPoint = "main",
-    int sampleCount = 1,
-    WGPUTextureFormat? targetFormat,
-    WGPUPrimitiveTopology topology =
-        WGPUPrimitiveTopology.WGPUPrimitiveTopology_TriangleStrip,
-    WGPUCullMode cullMode = WGPUCullMode.WGPUCullMode_None,
-    WGPUFrontFace frontFace = WGPUFrontFace.WGPUFrontFace_CCW,
-  }) {
+  static GpuPipelineLayout create(List<GpuBindGroupLayout> bindGroupLayouts) {
     final wgpu = WebgpuRend.instance.wgpu;
-    final format = targetFormat ?? kPreferredTextureFormat;
-
     return using((arena) {
-      // Vertex State Setup
-      final vertexState = arena<WGPUVertexState>();
-      vertexState.ref.module = vertexShader.handle.cast();
-      vertexState.ref.entryPoint = _createStringView(arena, vertexEntryPoint);
-      vertexState.ref.constantCount = 0;
-
-      if (bufferLayouts.isNotEmpty) {
-        final layouts = arena<WGPUVertexBufferLayout>(bufferLayouts.length);
-        int totalAttrs = 0;
-        for (var l in bufferLayouts) {
-          totalAttrs += l.attributes.length;
-        }
-        final attrs = arena<WGPUVertexAttribute>(totalAttrs);
-
-        int attrIdx = 0;
-
-        for (int i = 0; i < bufferLayouts.length; i++) {
-          final def = bufferLayouts[i];
-          final layout = layouts.elementAt(i);
-          layout.ref.arrayStride = def.arrayStride;
-          layout.ref.stepMode = def.stepMode;
-          layout.ref.attributeCount = def.attributes.length;
-          layout.ref.attributes = attrs.elementAt(attrIdx);
-
-          for (int j = 0; j < def.attributes.length; j++) {
-            final dartAttr = def.attributes[j];
-            final nativeAttr = attrs.elementAt(attrIdx + j);
-            nativeAttr.ref.format = dartAttr.format;
-            nativeAttr.ref.offset = dartAttr.offset;
-            nativeAttr.ref.shaderLocation = dartAttr.shaderLocation;
-          }
-          attrIdx += def.attributes.length;
-        }
-        vertexState.ref.bufferCount = bufferLayouts.length;
-        vertexState.ref.buffers = layouts;
-      } else {
-        vertexState.ref.bufferCount = 0;
-        vertexState.ref.buffers = nullptr;
+      final layouts = arena<WGPUBindGroupLayout>(bindGroupLayouts.length);
+      for (int i = 0; i < bindGroupLayouts.length; i++) {
+        layouts[i] = bindGroupLayouts[i].handle.cast();
       }
+      final desc = arena<WGPUPipelineLayoutDescriptor>();
+      desc.ref.nextInChain = nullptr;
+      desc.ref.label.data = nullptr;
+      desc.ref.label.length = 0;
+      desc.ref.bindGroupLayoutCount = bindGroupLayouts.length;
+      desc.ref.bindGroupLayouts = layouts;
+      desc.ref.immediateSize = 0;
+      final handle = wgpu.wgpuDeviceCreatePipelineLayout(
+          WebgpuRend.instance.device, desc);
+      return GpuPipelineLayout._(handle.cast(),
+          List.unmodifiable(bindGroupLayouts), GpuPipelineCache._newId());
+    });
+  }
 
-      // Fragment State Setup
-      final fragmentState = arena<WGPUFragmentState>();
-      fragmentState.ref.module = fragmentShader.handle.cast();
-      fragmentState.ref.entryPoint = _createStringView(arena, fragmentEntryPoint);
-      fragmentState.ref.constantCount = 0;
-      fragmentState.ref.targetCount = 1;
+  void dispose() =>
+      WebgpuRend.instance.wgpu.wgpuPipelineLayoutRelease(handle.cast());
+}
 
-      final target = arena<WGPUColorTargetState>();
-      target.ref.format = format;
-      target.ref.writeMask = WGPUColorWriteMask_All;
+/// Bind groups by layout and the identity of the resources bound, so a
+/// material that is drawn every frame gets its group built once.
+///
+/// `createBindGroup` on a layout or pipeline returns the cached group; the
+/// cache owns it, do not release it. A group stays valid until one of its
+/// resources or its layout is disposed, [clear] is called, or it is the
+/// least recently used beyond [maxEntries]. Fetching the group again each
+/// frame is a map lookup, holding on to it across those events is not safe.
+class GpuBindGroupCache {
+  static bool enabled = true;
+  static int maxEntries = 4096;
+
+  static int _hits = 0;
+  static int _misses = 0;
+  // Insertion order doubles as recency order, hits are moved to the end
+  static final Map<_BindGroupKey, _CachedBindGroup> _entries = {};
+  // Native address of each layout and resource to the keys of the groups
+  // using it
+  static final Map<int, Set<_BindGroupKey>> _byObject = {};
+
+  static int get hits => _hits;
+  static int get misses => _misses;
+  static int get length => _entries.length;
+
+  static void clear() {
+    for (final entry in _entries.values) {
+      entry.release();
+    }
+    _entries.clear();
+    _byObject.clear();
+  }
 
-      if (blendMode == BlendMode.opaque) {
-        target.ref.blend = nullptr;
-      } else {
-        final blend = arena<WGPUBlendState>();
-        
-        // Default assignments
-        var srcFactorColor = WGPUBlendFactor.WGPUBlendFactor_One;
-        var dstFactorColor = WGPUBlendFactor.WGPUBlendFactor_Zero;
-        var opColor = WGPUBlendOperation.WGPUBlendOperation_Add;
-        
-        var srcFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_One;
-        var dstFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_Zero;
-        var opAlpha = WGPUBlendOperation.WGPUBlendOperation_Add;
-
-        switch (blendMode) {
-          case BlendMode.alpha:
-            // Final = (Src * SrcAlpha) + (Dst * (1 - SrcAlpha))
-            srcFactorColor = WGPUBlendFactor.WGPUBlendFactor_SrcAlpha;
-            dstFactorColor = WGPUBlendFactor.WGPUBlendFactor_OneMinusSrcAlpha;
-            srcFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_One;
-            dstFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_OneMinusSrcAlpha;
-            break;
-
-          case BlendMode.add:
-            // Final = Src + Dst
-            srcFactorColor = WGPUBlendFactor.WGPUBlendFactor_One;
-            dstFactorColor = WGPUBlendFactor.WGPUBlendFactor_One;
-            srcFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_One;
-            dstFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_One;
-            break;
-
-          case BlendMode.max:
-            // Final = Max(Src, Dst) - Factors are ignored in Max/Min
-            opColor = WGPUBlendOperation.WGPUBlendOperation_Max;
-            opAlpha = WGPUBlendOperation.WGPUBlendOperation_Max;
-            break;
-
-          case BlendMode.min:
-            // Final = Min(Src, Dst)
-            opColor = WGPUBlendOperation.WGPUBlendOperation_Min;
-            opAlpha = WGPUBlendOperation.WGPUBlendOperation_Min;
-            break;
-
-          case BlendMode.erase:
-            // Final = Dst * (1 - SrcAlpha)
-            srcFactorColor = WGPUBlendFactor.WGPUBlendFactor_Zero;
-            dstFactorColor = WGPUBlendFactor.WGPUBlendFactor_OneMinusSrcAlpha;
-            srcFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_Zero;
-            dstFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_OneMinusSrcAlpha;
-            break;
-            
-          case BlendMode.opaque:
-            break; // Handled above
-        }
+  static void resetStats() {
+    _hits = 0;
+    _misses = 0;
+  }
 
-        blend.ref.color.srcFactor = srcFactorColor;
-        blend.ref.color.dstFactor = dstFactorColor;
-        blend.ref.color.operation = opColor;
-        blend.ref.alpha.srcFactor = srcFactorAlpha;
-        blend.ref.alpha.dstFactor = dstFactorAlpha;
-        blend.ref.alpha.operation = opAlpha;
-        
-        target.ref.blend = blend;
+  static WGPUBindGroup _get(
+      WGPUBindGroupLayout layout, List<Object> resources, List<int>? bindings) {
+    final wgpu = WebgpuRend.instance.wgpu;
+    if (!enabled) {
+      return _createBindGroupHelper(layout, resources, bindings);
+    }
+    // Four words per resource: binding, address, then offset and size for
+    // buffer bindings or -1 for whole resources
+    final words = List<int>.filled(1 + 4 * resources.length, -1);
+    words[0] = layout.address;
+    for (int i = 0; i < resources.length; i++) {
+      final r = resources[i];
+      final at = 1 + 4 * i;
+      words[at] = bindings != null ? bindings[i] : i;
+      if (r is GpuBufferBinding) {
+        words[at + 1] = r.buffer.handle.address;
+        words[at + 2] = r.offset;
+        words[at + 3] = r.size;
+      } else {
+        words[at + 1] = _resourceAddress(r);
       }
+    }
+    final key = _BindGroupKey(words);
+    final cached = _entries.remove(key);
+    if (cached != null) {
+      _hits++;
+      _entries[key] = cached;
+      return cached.group;
+    }
+    _misses++;
+    final group = _createBindGroupHelper(layout, resources, bindings);
+    // Holding the layout keeps its address from being reused by another
+    // layout while the key refers to it. The group holds its resources.
+    wgpu.wgpuBindGroupLayoutAddRef(layout);
+    final objects = <int>[layout.address];
+    for (int at = 2; at < words.length; at += 4) {
+      objects.add(words[at]);
+    }
+    final entry = _CachedBindGroup(group, layout, objects);
+    _entries[key] = entry;
+    for (final object in objects) {
+      (_byObject[object] ??= {}).add(key);
+    }
+    while (_entries.length > maxEntries) {
+      _remove(_entries.keys.first);
+    }
+    return group;
+  }
 
-      fragmentState.ref.targets = target;
+  static int _resourceAddress(Object r) {
+    if (r is GpuBuffer) return r.handle.address;
+    if (r is GpuTexture) return r.view.address;
+    if (r is WGPUTextureView) return r.address;
+    if (r is GpuSampler) return r.handle.address;
+    throw "Unsupported resource type: $r";
+  }
 
-      // Pipeline Descriptor
-      final desc = arena<WGPURenderPipelineDescriptor>();
-      desc.ref.label.data = nullptr;
-      desc.ref.label.length = 0;
-      desc.ref.layout = nullptr;
-      desc.ref.vertex = vertexState.ref;
-      desc.ref.fragment = fragmentState;
-
-      desc.ref.primitive.topology = topology;
-      desc.ref.primitive.stripIndexFormat = WGPUIndexFormat.WGPUIndexFormat_Undefined;
-      desc.ref.primitive.frontFace = frontFace;
-      desc.ref.primitive.cullMode = cullMode;
-
-      if (enableDepth) {
-        final ds = arena<WGPUDepthStencilState>();
-        ds.ref.format = depthFormat;
-        ds.ref.depthWriteEnabled = WGPUOptionalBool.WGPUOptionalBool_True;
-        ds.ref.depthCompare = WGPUCompareFunction.WGPUCompareFunction_Less;
-        ds.ref.stencilReadMask = 0;
-        ds.ref.stencilWriteMask = 0;
-        desc.ref.depthStencil = ds;
+  static void _remove(_BindGroupKey key) {
+    final entry = _entries.remove(key);
+    if (entry == null) return;
+    for (final object in entry.objects) {
+      final keys = _byObject[object];
+      if (keys == null) continue;
+      keys.remove(key);
+      if (keys.isEmpty) _byObject.remove(object);
+    }
+    entry.release();
+  }
+
+  // Drops the groups using the object at `address`, called when it is
+  // disposed
+  static void _invalidate(int address) {
+    final keys = _byObject.remove(address);
+    if (keys == null) return;
+    for (final key in keys.toList()) {
+      _remove(key);
+    }
+  }
+}
+
+// Layout and resource words of a bind group, hashed once up front
+class _BindGroupKey {
+  final List<int> words;
+  @override
+  final int hashCode;
+  _BindGroupKey(this.words) : hashCode = Object.hashAll(words);
+
+  @override
+  bool operator ==(Object other) {
+    if (other is! _BindGroupKey || other.hashCode != hashCode) return false;
+    final otherWords = other.words;
+    if (otherWords.length != words.length) return false;
+    for (int i = 0; i < words.length; i++) {
+      if (otherWords[i] != words[i]) return false;
+    }
+    return true;
+  }
+}
+
+class _CachedBindGroup {
+  final WGPUBindGroup group;
+  final WGPUBindGroupLayout layout;
+  final List<int> objects;
+  _CachedBindGroup(this.group, this.layout, this.objects);
+
+  void release() {
+    final wgpu = WebgpuRend.instance.wgpu;
+    GpuRenderBundle._invalidate(group.address);
+    wgpu.wgpuBindGroupRelease(group);
+    wgpu.wgpuBindGroupLayoutRelease(layout);
+  }
+}
+
+/// In-process cache of shader modules and pipelines.
+///
+/// [GpuShader.create], [GpuRenderPipeline.create] and
+/// [GpuComputePipeline.create] look here first, keyed by everything that
+/// goes into the descriptor, so entering the same screen twice compiles
+/// nothing the second time. The cache holds its own reference to each
+/// object, disposing what `create` returned only drops the caller's. The
+/// least recently used entries are released beyond [maxEntries].
+///
+/// Compiled code also survives restarts when [WebgpuRend.initialize] is
+/// given a cache directory, see [blobCacheStats].
+class GpuPipelineCache {
+  static bool enabled = true;
+  static int maxEntries = 256;
+
+  static int _hits = 0;
+  static int _misses = 0;
+  static int _nextId = 1;
+  // Insertion order doubles as recency order, hits are moved to the end
+  static final Map<String, _CachedObject> _entries = {};
+
+  static int get hits => _hits;
+  static int get misses => _misses;
+  static int get length => _entries.length;
+
+  /// Hits, misses and stores of the persistent cache.
+  static ({int hits, int misses, int stores}) get blobCacheStats =>
+      WebgpuRend.instance.blobCacheStats;
+
+  /// Releases the cache's references. Objects still held elsewhere stay
+  /// valid.
+  static void clear() {
+    for (final entry in _entries.values) {
+      entry.release(entry.handle);
+    }
+    _entries.clear();
+  }
+
+  static void resetStats() {
+    _hits = 0;
+    _misses = 0;
+  }
+
+  /// Compiles every [RenderPipelineDescriptor] and
+  /// [ComputePipelineDescriptor] in [descriptors] concurrently, so the
+  /// `create` calls that follow, for example on entering a screen, find
+  /// them here. Completes once all of them are compiled and fails with the
+  /// first error.
+  static Future<void> warmUp(Iterable<Object> descriptors) async {
+    final futures = <Future<GpuResource>>[];
+    final keys = <String>{};
+    for (final descriptor in descriptors) {
+      if (descriptor is RenderPipelineDescriptor) {
+        if (!keys.add(descriptor._cacheKey)) continue;
+        futures.add(GpuRenderPipeline.fromDescriptorAsync(descriptor));
+      } else if (descriptor is ComputePipelineDescriptor) {
+        if (!keys.add(descriptor._cacheKey)) continue;
+        futures.add(GpuComputePipeline.fromDescriptorAsync(descriptor));
       } else {
-        desc.ref.depthStencil = nullptr;
+        throw ArgumentError("Unsupported descriptor: $descriptor");
       }
+    }
+    // The cache keeps its own reference
+    final pipelines =
+        await Future.wait(futures, cleanUp: _disposePipeline);
+    pipelines.forEach(_disposePipeline);
+  }
 
-      desc.ref.multisample.count = sampleCount;
-      desc.ref.multisample.mask = 0xFFFFFFFF;
-      desc.ref.multisample.alphaToCoverageEnabled = 0;
+  static void _disposePipeline(GpuResource pipeline) {
+    if (pipeline is GpuRenderPipeline) pipeline.dispose();
+    if (pipeline is GpuComputePipeline) pipeline.dispose();
+  }
 
-      final handle = wgpu.wgpuDeviceCreateRenderPipeline(WebgpuRend.instance.device, desc);
-      return GpuRenderPipeline._(handle.cast());
-    });
+  static int _newId() => _nextId++;
+
+  static bool _contains(String key) => _entries.containsKey(key);
+
+  static _CachedObject? _lookup(String key) {
+    if (!enabled) return null;
+    final entry = _entries.remove(key);
+    if (entry == null) {
+      _misses++;
+      return null;
+    }
+    _hits++;
+    _entries[key] = entry;
+    return entry;
   }
 
-  WGPUBindGroup createBindGroup(int index, List<Object> resources) {
-    final layout = WebgpuRend.instance.wgpu
-        .wgpuRenderPipelineGetBindGroupLayout(handle.cast(), index);
-    final group = _createBindGroupHelper(layout, resources);
-    WebgpuRend.instance.wgpu.wgpuBindGroupLayoutRelease(layout);
-    return group;
+  // `handle` must carry a reference for the cache
+  static void _insert(String key, _CachedObject entry) {
+    if (!enabled) {
+      entry.release(entry.handle);
+      return;
+    }
+    _entries[key] = entry;
+    while (_entries.length > maxEntries) {
+      final oldest = _entries.keys.first;
+      final evicted = _entries.remove(oldest)!;
+      evicted.release(evicted.handle);
+    }
   }
+}
 
-  void dispose() => WebgpuRend.instance.wgpu.wgpuRenderPipelineRelease(handle.cast());
+class _CachedObject {
+  final Pointer<Void> handle;
+  final int id;
+  final void Function(Pointer<Void>) release;
+  _CachedObject(this.handle, this.id, this.release);
 }
 
-class GpuComputePipeline extends GpuResource {
-  GpuComputePipeline._(super.handle);
-  static GpuComputePipeline create(GpuShader shader,
-      {String entryPoint = "main"}) {
+class GpuShader extends GpuResource {
+  // Identifies the module in pipeline cache keys, shared by every GpuShader
+  // returned for the same cached module
+  final int _id;
+  GpuShader._(super.handle, this._id);
+  static GpuShader create(String source) {
     final wgpu = WebgpuRend.instance.wgpu;
-    return using((arena) {
-      final desc = arena<WGPUComputePipelineDescriptor>();
+    final key = 's|$source';
+    final cached = GpuPipelineCache._lookup(key);
+    if (cached != null) {
+      wgpu.wgpuShaderModuleAddRef(cached.handle.cast());
+      return GpuShader._(cached.handle, cached.id);
+    }
+    final shader = using((arena) {
+      final wgslDesc = arena<WGPUShaderSourceWGSL>();
+      wgslDesc.ref.chain.sType = WGPUSType.WGPUSType_ShaderSourceWGSL;
+      wgslDesc.ref.chain.next = nullptr;
+      wgslDesc.ref.code = _createStringView(arena, source);
+      final desc = arena<WGPUShaderModuleDescriptor>();
+      desc.ref.nextInChain = wgslDesc.cast();
       desc.ref.label.data = nullptr;
       desc.ref.label.length = 0;
-      desc.ref.layout = nullptr;
-      desc.ref.compute.module = shader.handle.cast();
-      desc.ref.compute.entryPoint = _createStringView(arena, entryPoint);
-      desc.ref.compute.constantCount = 0;
-      final handle = wgpu.wgpuDeviceCreateComputePipeline(
-          WebgpuRend.instance.device, desc);
-      return GpuComputePipeline._(handle.cast());
+      final handle =
+          wgpu.wgpuDeviceCreateShaderModule(WebgpuRend.instance.device, desc);
+      return GpuShader._(handle.cast(), GpuPipelineCache._newId());
     });
-  }
-
-  WGPUBindGroup createBindGroup(int index, List<Object> resources) {
-    final layout = WebgpuRend.instance.wgpu
-        .wgpuComputePipelineGetBindGroupLayout(handle.cast(), index);
-    final group = _createBindGroupHelper(layout, resources);
-    WebgpuRend.instance.wgpu.wgpuBindGroupLayoutRelease(layout);
-    return group;
+    wgpu.wgpuShaderModuleAddRef(shader.handle.cast());
+    GpuPipelineCache._insert(
+        key,
+        _CachedObject(shader.handle, shader._id,
+            (h) => wgpu.wgpuShaderModuleRelease(h.cast())));
+    return shader;
   }
 
   void dispose() =>
-      WebgpuRend.instance.wgpu.wgpuComputePipelineRelease(handle.cast());
+      WebgpuRend.instance.wgpu.wgpuShaderModuleRelease(handle.cast());
 }
 
-class CommandEncoder {
-  final WGPUCommandEncoder _handle;
-  final WebGpuBindings _wgpu = WebgpuRend.instance.wgpu;
-  CommandEncoder()
-      : _handle = WebgpuRend.instance.wgpu.wgpuDeviceCreateCommandEncoder(
-            WebgpuRend.instance.device, nullptr);
+/// Everything [GpuRenderPipeline.create] takes, so pipelines can be
+/// described up front and compiled in a batch by
+/// [GpuPipelineCache.warmUp].
+class RenderPipelineDescriptor {
+  final GpuShader vertexShader;
+  final GpuShader fragmentShader;
+  final List<VertexBufferLayout> bufferLayouts;
+  final BlendMode blendMode;
+  final bool enableDepth;
+  final WGPUTextureFormat depthFormat;
+  final String vertexEntryPoint;
+  final String fragmentEntryPoint;
+  final int sampleCount;
+  final WGPUTextureFormat? targetFormat;
+  final WGPUPrimitiveTopology topology;
+  final WGPUCullMode cullMode;
+  final WGPUFrontFace frontFace;
+  // Without one Dawn derives the layout from the shaders
+  final GpuPipelineLayout? layout;
+
+  RenderPipelineDescriptor({
+    required this.vertexShader,
+    required this.fragmentShader,
+    required this.bufferLayouts,
+    this.blendMode = BlendMode.opaque,
+    this.enableDepth = false,
+    this.depthFormat =
+        WGPUTextureFormat.WGPUTextureFormat_Depth24Plus,
+    this.vertexEntryPoint = "main",
+    this.fragmentEntryPoint = "main",
+    this.sampleCount = 1,
+    this.targetFormat,
+    this.topology =
+        WGPUPrimitiveTopology.WGPUPrimitiveTopology_TriangleStrip,
+    this.cullMode = WGPUCullMode.WGPUCullMode_None,
+    this.frontFace = WGPUFrontFace.WGPUFrontFace_CCW,
+    this.layout,
+  });
 
-  void copyTextureToTexture(
-      {required GpuTexture from, required GpuTexture to}) {
-    using((arena) {
-      final srcInfo = arena<WGPUTexelCopyTextureInfo>();
-      srcInfo.ref.texture = from.texture;
-      srcInfo.ref.mipLevel = 0;
-      srcInfo.ref.origin = (arena<WGPUOrigin3D>()
-            ..ref.x = 0
-            ..ref.y = 0
-            ..ref.z = 0)
-          .ref;
-      srcInfo.ref.aspect = WGPUTextureAspect.WGPUTextureAspect_All;
-      final dstInfo = arena<WGPUTexelCopyTextureInfo>();
-      dstInfo.ref.texture = to.texture;
-      dstInfo.ref.mipLevel = 0;
-      dstInfo.ref.origin = (arena<WGPUOrigin3D>()
+  String get _cacheKey => [
+        'r',
+        vertexShader._id,
+        fragmentShader._id,
+        vertexEntryPoint,
+        fragmentEntryPoint,
+        for (final layout in bufferLayouts) layout._cacheKey,
+        blendMode.index,
+        enableDepth ? depthFormat.value : 0,
+        sampleCount,
+        (targetFormat ?? kPreferredTextureFormat).value,
+        topology.value,
+        cullMode.value,
+        frontFace.value,
+        layout?._id ?? 0,
+      ].join('|');
+
+  Pointer<WGPURenderPipelineDescriptor> _toNative(Arena arena) {
+    final format = targetFormat ?? kPreferredTextureFormat;
+
+    // Vertex State Setup
+    final vertexState = arena<WGPUVertexState>();
+    vertexState.ref.module = vertexShader.handle.cast();
+    vertexState.ref.entryPoint = _createStringView(arena, vertexEntryPoint);
+    vertexState.ref.constantCount = 0;
+
+    if (bufferLayouts.isNotEmpty) {
+      final layouts = arena<WGPUVertexBufferLayout>(bufferLayouts.length);
+      int totalAttrs = 0;
+      for (var l in bufferLayouts) {
+        totalAttrs += l.attributes.length;
+      }
+      final attrs = arena<WGPUVertexAttribute>(totalAttrs);
+
+      int attrIdx = 0;
+
+      for (int i = 0; i < bufferLayouts.length; i++) {
+        final def = bufferLayouts[i];
+        final layout = layouts.elementAt(i);
+        layout.ref.arrayStride = def.arrayStride;
+        layout.ref.stepMode = def.stepMode;
+        layout.ref.attributeCount = def.attributes.length;
+        layout.ref.attributes = attrs.elementAt(attrIdx);
+
+        for (int j = 0; j < def.attributes.length; j++) {
+          final dartAttr = def.attributes[j];
+          final nativeAttr = attrs.elementAt(attrIdx + j);
+          nativeAttr.ref.format = dartAttr.format;
+          nativeAttr.ref.offset = dartAttr.offset;
+          nativeAttr.ref.shaderLocation = dartAttr.shaderLocation;
+        }
+        attrIdx += def.attributes.length;
+      }
+      vertexState.ref.bufferCount = bufferLayouts.length;
+      vertexState.ref.buffers = layouts;
+    } else {
+      vertexState.ref.bufferCount = 0;
+      vertexState.ref.buffers = nullptr;
+    }
+
+    // Fragment State Setup
+    final fragmentState = arena<WGPUFragmentState>();
+    fragmentState.ref.module = fragmentShader.handle.cast();
+    fragmentState.ref.entryPoint = _createStringView(arena, fragmentEntryPoint);
+    fragmentState.ref.constantCount = 0;
+    fragmentState.ref.targetCount = 1;
+
+    final target = arena<WGPUColorTargetState>();
+    target.ref.format = format;
+    target.ref.writeMask = WGPUColorWriteMask_All;
+
+    if (blendMode == BlendMode.opaque) {
+      target.ref.blend = nullptr;
+    } else {
+      final blend = arena<WGPUBlendState>();
+      
+      // Default assignments
+      var srcFactorColor = WGPUBlendFactor.WGPUBlendFactor_One;
+      var dstFactorColor = WGPUBlendFactor.WGPUBlendFactor_Zero;
+      var opColor = WGPUBlendOperation.WGPUBlendOperation_Add;
+      
+      var srcFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_One;
+      var dstFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_Zero;
+      var opAlpha = WGPUBlendOperation.WGPUBlendOperation_Add;
+
+      switch (blendMode) {
+        case BlendMode.alpha:
+          // Final = (Src * SrcAlpha) + (Dst * (1 - SrcAlpha))
+          srcFactorColor = WGPUBlendFactor.WGPUBlendFactor_SrcAlpha;
+          dstFactorColor = WGPUBlendFactor.WGPUBlendFactor_OneMinusSrcAlpha;
+          srcFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_One;
+          dstFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_OneMinusSrcAlpha;
+          break;
+
+        case BlendMode.add:
+          // Final = Src + Dst
+          srcFactorColor = WGPUBlendFactor.WGPUBlendFactor_One;
+          dstFactorColor = WGPUBlendFactor.WGPUBlendFactor_One;
+          srcFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_One;
+          dstFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_One;
+          break;
+
+        case BlendMode.max:
+          // Final = Max(Src, Dst) - Factors are ignored in Max/Min
+          opColor = WGPUBlendOperation.WGPUBlendOperation_Max;
+          opAlpha = WGPUBlendOperation.WGPUBlendOperation_Max;
+          break;
+
+        case BlendMode.min:
+          // Final = Min(Src, Dst)
+          opColor = WGPUBlendOperation.WGPUBlendOperation_Min;
+          opAlpha = WGPUBlendOperation.WGPUBlendOperation_Min;
+          break;
+
+        case BlendMode.erase:
+          // Final = Dst * (1 - SrcAlpha)
+          srcFactorColor = WGPUBlendFactor.WGPUBlendFactor_Zero;
+          dstFactorColor = WGPUBlendFactor.WGPUBlendFactor_OneMinusSrcAlpha;
+          srcFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_Zero;
+          dstFactorAlpha = WGPUBlendFactor.WGPUBlendFactor_OneMinusSrcAlpha;
+          break;
+          
+        case BlendMode.opaque:
+          break; // Handled above
+      }
+
+      blend.ref.color.srcFactor = srcFactorColor;
+      blend.ref.color.dstFactor = dstFactorColor;
+      blend.ref.color.operation = opColor;
+      blend.ref.alpha.srcFactor = srcFactorAlpha;
+      blend.ref.alpha.dstFactor = dstFactorAlpha;
+      blend.ref.alpha.operation = opAlpha;
+      
+      target.ref.blend = blend;
+    }
+
+    fragmentState.ref.targets = target;
+
+    // Pipeline Descriptor
+    final desc = arena<WGPURenderPipelineDescriptor>();
+    desc.ref.label.data = nullptr;
+    desc.ref.label.length = 0;
+    desc.ref.layout = layout?.handle.cast() ?? nullptr;
+    desc.ref.vertex = vertexState.ref;
+    desc.ref.fragment = fragmentState;
+
+    desc.ref.primitive.topology = topology;
+    desc.ref.primitive.stripIndexFormat = WGPUIndexFormat.WGPUIndexFormat_Undefined;
+    desc.ref.primitive.frontFace = frontFace;
+    desc.ref.primitive.cullMode = cullMode;
+
+    if (enableDepth) {
+      final ds = arena<WGPUDepthStencilState>();
+      ds.ref.format = depthFormat;
+      ds.ref.depthWriteEnabled = WGPUOptionalBool.WGPUOptionalBool_True;
+      ds.ref.depthCompare = WGPUCompareFunction.WGPUCompareFunction_Less;
+      ds.ref.stencilReadMask = 0;
+      ds.ref.stencilWriteMask = 0;
+      desc.ref.depthStencil = ds;
+    } else {
+      desc.ref.depthStencil = nullptr;
+    }
+
+    desc.ref.multisample.count = sampleCount;
+    desc.ref.multisample.mask = 0xFFFFFFFF;
+    desc.ref.multisample.alphaToCoverageEnabled = 0;
+
+    return desc;
+  }
+}
+
+/// Everything [GpuComputePipeline.create] takes, see
+/// [RenderPipelineDescriptor].
+class ComputePipelineDescriptor {
+  final GpuShader shader;
+  final String entryPoint;
+  final GpuPipelineLayout? layout;
+
+  ComputePipelineDescriptor(this.shader,
+      {this.entryPoint = "main", this.layout});
+
+  String get _cacheKey =>
+      'c|${shader._id}|$entryPoint|${layout?._id ?? 0}';
+
+  Pointer<WGPUComputePipelineDescriptor> _toNative(Arena arena) {
+    final desc = arena<WGPUComputePipelineDescriptor>();
+    desc.ref.label.data = nullptr;
+    desc.ref.label.length = 0;
+    desc.ref.layout = layout?.handle.cast() ?? nullptr;
+    desc.ref.compute.module = shader.handle.cast();
+    desc.ref.compute.entryPoint = _createStringView(arena, entryPoint);
+    desc.ref.compute.constantCount = 0;
+    return desc;
+  }
+}
+
+class GpuRenderPipeline extends GpuResource {
+  /// Null if the layout was derived from the shaders.
+  final GpuPipelineLayout? layout;
+  // Derived layouts already fetched, by group index
+  final Map<int, WGPUBindGroupLayout> _autoLayouts = {};
+  GpuRenderPipeline._(super.handle, this.layout);
+
+  static GpuRenderPipeline create({
+    required GpuShader vertexShader,
+    required GpuShader fragmentShader,
+    required List<VertexBufferLayout> bufferLayouts,
+    BlendMode blendMode = BlendMode.opaque, 
+    bool enableDepth = false,
+    WGPUTextureFormat depthFormat =
+        WGPUTextureFormat.WGPUTextureFormat_Depth24Plus,
+    String vertexEntryPoint = "main",
+    String fragmentEntryPoint = "main",
+    int sampleCount = 1,
+    WGPUTextureFormat? targetFormat,
+    WGPUPrimitiveTopology topology =
+        WGPUPrimitiveTopology.WGPUPrimitiveTopology_TriangleStrip,
+    WGPUCullMode cullMode = WGPUCullMode.WGPUCullMode_None,
+    WGPUFrontFace frontFace = WGPUFrontFace.WGPUFrontFace_CCW,
+    GpuPipelineLayout? layout,
+  }) {
+    return fromDescriptor(RenderPipelineDescriptor(
+        vertexShader: vertexShader,
+        fragmentShader: fragmentShader,
+        bufferLayouts: bufferLayouts,
+        blendMode: blendMode,
+        enableDepth: enableDepth,
+        depthFormat: depthFormat,
+        vertexEntryPoint: vertexEntryPoint,
+        fragmentEntryPoint: fragmentEntryPoint,
+        sampleCount: sampleCount,
+        targetFormat: targetFormat,
+        topology: topology,
+        cullMode: cullMode,
+        frontFace: frontFace,
+        layout: layout,
+    ));
+  }
+
+  /// Compiles without blocking the isolate, see [fromDescriptorAsync].
+  static Future<GpuRenderPipeline> createAsync({
+    required GpuShader vertexShader,
+    required GpuShader fragmentShader,
+    required List<VertexBufferLayout> bufferLayouts,
+    BlendMode blendMode = BlendMode.opaque, 
+    bool enableDepth = false,
+    WGPUTextureFormat depthFormat =
+        WGPUTextureFormat.WGPUTextureFormat_Depth24Plus,
+    String vertexEntryPoint = "main",
+    String fragmentEntryPoint = "main",
+    int sampleCount = 1,
+    WGPUTextureFormat? targetFormat,
+    WGPUPrimitiveTopology topology =
+        WGPUPrimitiveTopology.WGPUPrimitiveTopology_TriangleStrip,
+    WGPUCullMode cullMode = WGPUCullMode.WGPUCullMode_None,
+    WGPUFrontFace frontFace = WGPUFrontFace.WGPUFrontFace_CCW,
+    GpuPipelineLayout? layout,
+  }) {
+    return fromDescriptorAsync(RenderPipelineDescriptor(
+        vertexShader: vertexShader,
+        fragmentShader: fragmentShader,
+        bufferLayouts: bufferLayouts,
+        blendMode: blendMode,
+        enableDepth: enableDepth,
+        depthFormat: depthFormat,
+        vertexEntryPoint: vertexEntryPoint,
+        fragmentEntryPoint: fragmentEntryPoint,
+        sampleCount: sampleCount,
+        targetFormat: targetFormat,
+        topology: topology,
+        cullMode: cullMode,
+        frontFace: frontFace,
+        layout: layout,
+    ));
+  }
+
+  static GpuRenderPipeline fromDescriptor(RenderPipelineDescriptor descriptor) {
+    final wgpu = WebgpuRend.instance.wgpu;
+    final key = descriptor._cacheKey;
+    final cached = GpuPipelineCache._lookup(key);
+    if (cached != null) {
+      wgpu.wgpuRenderPipelineAddRef(cached.handle.cast());
+      return GpuRenderPipeline._(cached.handle, descriptor.layout);
+    }
+    final handle = using((arena) => wgpu.wgpuDeviceCreateRenderPipeline(
+        WebgpuRend.instance.device, descriptor._toNative(arena)));
+    _cache(key, handle);
+    return GpuRenderPipeline._(handle.cast(), descriptor.layout);
+  }
+
+  /// Dawn compiles the pipeline on a worker thread and the future completes
+  /// from its callback, so nothing on the isolate waits for the compiler.
+  static Future<GpuRenderPipeline> fromDescriptorAsync(
+      RenderPipelineDescriptor descriptor) async {
+    final wgpu = WebgpuRend.instance.wgpu;
+    final key = descriptor._cacheKey;
+    final cached = GpuPipelineCache._lookup(key);
+    if (cached != null) {
+      wgpu.wgpuRenderPipelineAddRef(cached.handle.cast());
+      return GpuRenderPipeline._(cached.handle, descriptor.layout);
+    }
+    final completer = Completer<WGPURenderPipeline>();
+    late final NativeCallable<WGPUCreateRenderPipelineAsyncCallbackFunction>
+        callback;
+    callback = NativeCallable<
+            WGPUCreateRenderPipelineAsyncCallbackFunction>.listener(
+        (int status, WGPURenderPipeline pipeline, WGPUStringView message,
+            Pointer<Void> u1, Pointer<Void> u2) {
+      callback.close();
+      // The message is gone by the time a listener runs, only the status
+      // is left to report
+      if (status ==
+          WGPUCreatePipelineAsyncStatus.WGPUCreatePipelineAsyncStatus_Success
+              .value) {
+        completer.complete(pipeline);
+      } else {
+        completer.completeError(StateError(
+            "Render pipeline creation failed: ${WGPUCreatePipelineAsyncStatus.fromValue(status)}"));
+      }
+    });
+    final future = using((arena) {
+      final callbackInfo = arena<WGPUCreateRenderPipelineAsyncCallbackInfo>();
+      callbackInfo.ref.nextInChain = nullptr;
+      callbackInfo.ref.mode =
+          WGPUCallbackMode.WGPUCallbackMode_AllowSpontaneous;
+      callbackInfo.ref.callback = callback.nativeFunction;
+      callbackInfo.ref.userdata1 = nullptr;
+      callbackInfo.ref.userdata2 = nullptr;
+      return wgpu.wgpuDeviceCreateRenderPipelineAsync(
+          WebgpuRend.instance.device,
+          descriptor._toNative(arena),
+          callbackInfo.ref);
+    });
+    final handle = await _awaitCallback(future, completer);
+    _cache(key, handle);
+    return GpuRenderPipeline._(handle.cast(), descriptor.layout);
+  }
+
+  // Gives the cache a reference of its own, unless a concurrent async
+  // creation of the same pipeline got there first
+  static void _cache(String key, WGPURenderPipeline handle) {
+    if (GpuPipelineCache._contains(key)) return;
+    final wgpu = WebgpuRend.instance.wgpu;
+    wgpu.wgpuRenderPipelineAddRef(handle);
+    GpuPipelineCache._insert(
+        key,
+        _CachedObject(handle.cast(), GpuPipelineCache._newId(),
+            (h) => wgpu.wgpuRenderPipelineRelease(h.cast())));
+  }
+
+  /// Binds `resources[i]` to binding `i` of group [index], or to the
+  /// bindings of the [layout] entries in order. The group comes from
+  /// [GpuBindGroupCache], which owns it.
+  WGPUBindGroup createBindGroup(int index, List<Object> resources) {
+    final explicit = layout;
+    if (explicit != null) {
+      return explicit.bindGroupLayouts[index].createBindGroup(resources);
+    }
+    final groupLayout = _autoLayouts[index] ??= WebgpuRend.instance.wgpu
+        .wgpuRenderPipelineGetBindGroupLayout(handle.cast(), index);
+    return GpuBindGroupCache._get(groupLayout, resources, null);
+  }
+
+  void dispose() {
+    final wgpu = WebgpuRend.instance.wgpu;
+    _autoLayouts.values.forEach(wgpu.wgpuBindGroupLayoutRelease);
+    _autoLayouts.clear();
+    wgpu.wgpuRenderPipelineRelease(handle.cast());
+  }
+}
+
+class GpuComputePipeline extends GpuResource {
+  /// Null if the layout was derived from the shader.
+  final GpuPipelineLayout? layout;
+  final Map<int, WGPUBindGroupLayout> _autoLayouts = {};
+  GpuComputePipeline._(super.handle, this.layout);
+  static GpuComputePipeline create(GpuShader shader,
+      {String entryPoint = "main", GpuPipelineLayout? layout}) {
+    return fromDescriptor(ComputePipelineDescriptor(shader,
+        entryPoint: entryPoint, layout: layout));
+  }
+
+  /// Compiles without blocking the isolate, see
+  /// [GpuRenderPipeline.fromDescriptorAsync].
+  static Future<GpuComputePipeline> createAsync(GpuShader shader,
+      {String entryPoint = "main", GpuPipelineLayout? layout}) {
+    return fromDescriptorAsync(ComputePipelineDescriptor(shader,
+        entryPoint: entryPoint, layout: layout));
+  }
+
+  static GpuComputePipeline fromDescriptor(
+      ComputePipelineDescriptor descriptor) {
+    final wgpu = WebgpuRend.instance.wgpu;
+    final key = descriptor._cacheKey;
+    final cached = GpuPipelineCache._lookup(key);
+    if (cached != null) {
+      wgpu.wgpuComputePipelineAddRef(cached.handle.cast());
+      return GpuComputePipeline._(cached.handle, descriptor.layout);
+    }
+    final handle = using((arena) => wgpu.wgpuDeviceCreateComputePipeline(
+        WebgpuRend.instance.device, descriptor._toNative(arena)));
+    _cache(key, handle);
+    return GpuComputePipeline._(handle.cast(), descriptor.layout);
+  }
+
+  static Future<GpuComputePipeline> fromDescriptorAsync(
+      ComputePipelineDescriptor descriptor) async {
+    final wgpu = WebgpuRend.instance.wgpu;
+    final key = descriptor._cacheKey;
+    final cached = GpuPipelineCache._lookup(key);
+    if (cached != null) {
+      wgpu.wgpuComputePipelineAddRef(cached.handle.cast());
+      return GpuComputePipeline._(cached.handle, descriptor.layout);
+    }
+    final completer = Completer<WGPUComputePipeline>();
+    late final NativeCallable<WGPUCreateComputePipelineAsyncCallbackFunction>
+        callback;
+    callback = NativeCallable<
+            WGPUCreateComputePipelineAsyncCallbackFunction>.listener(
+        (int status, WGPUComputePipeline pipeline, WGPUStringView message,
+            Pointer<Void> u1, Pointer<Void> u2) {
+      callback.close();
+      if (status ==
+          WGPUCreatePipelineAsyncStatus.WGPUCreatePipelineAsyncStatus_Success
+              .value) {
+        completer.complete(pipeline);
+      } else {
+        completer.completeError(StateError(
+            "Compute pipeline creation failed: ${WGPUCreatePipelineAsyncStatus.fromValue(status)}"));
+      }
+    });
+    final future = using((arena) {
+      final callbackInfo = arena<WGPUCreateComputePipelineAsyncCallbackInfo>();
+      callbackInfo.ref.nextInChain = nullptr;
+      callbackInfo.ref.mode =
+          WGPUCallbackMode.WGPUCallbackMode_AllowSpontaneous;
+      callbackInfo.ref.callback = callback.nativeFunction;
+      callbackInfo.ref.userdata1 = nullptr;
+      callbackInfo.ref.userdata2 = nullptr;
+      return wgpu.wgpuDeviceCreateComputePipelineAsync(
+          WebgpuRend.instance.device,
+          descriptor._toNative(arena),
+          callbackInfo.ref);
+    });
+    final handle = await _awaitCallback(future, completer);
+    _cache(key, handle);
+    return GpuComputePipeline._(handle.cast(), descriptor.layout);
+  }
+
+  static void _cache(String key, WGPUComputePipeline handle) {
+    if (GpuPipelineCache._contains(key)) return;
+    final wgpu = WebgpuRend.instance.wgpu;
+    wgpu.wgpuComputePipelineAddRef(handle);
+    GpuPipelineCache._insert(
+        key,
+        _CachedObject(handle.cast(), GpuPipelineCache._newId(),
+            (h) => wgpu.wgpuComputePipelineRelease(h.cast())));
+  }
+
+  /// See [GpuRenderPipeline.createBindGroup].
+  WGPUBindGroup createBindGroup(int index, List<Object> resources) {
+    final explicit = layout;
+    if (explicit != null) {
+      return explicit.bindGroupLayouts[index].createBindGroup(resources);
+    }
+    final groupLayout = _autoLayouts[index] ??= WebgpuRend.instance.wgpu
+        .wgpuComputePipelineGetBindGroupLayout(handle.cast(), index);
+    return GpuBindGroupCache._get(groupLayout, resources, null);
+  }
+
+  void dispose() {
+    final wgpu = WebgpuRend.instance.wgpu;
+    _autoLayouts.values.forEach(wgpu.wgpuBindGroupLayoutRelease);
+    _autoLayouts.clear();
+    wgpu.wgpuComputePipelineRelease(handle.cast());
+  }
+}
+
+class CommandEncoder {
+  final WGPUCommandEncoder _handle;
+  final WebGpuBindings _wgpu = WebgpuRend.instance.wgpu;
+  // Profiler frames recorded into this encoder, resolved on submit
+  final List<_ProfilerFrame> _profilerFrames = [];
+  CommandEncoder()
+      : _handle = WebgpuRend.instance.wgpu.wgpuDeviceCreateCommandEncoder(
+            WebgpuRend.instance.device, nullptr);
+
+  void copyTextureToTexture(
+      {required GpuTexture from, required GpuTexture to}) {
+    using((arena) {
+      final srcInfo = arena<WGPUTexelCopyTextureInfo>();
+      srcInfo.ref.texture = from.texture;
+      srcInfo.ref.mipLevel = 0;
+      srcInfo.ref.origin = (arena<WGPUOrigin3D>()
+            ..ref.x = 0
+            ..ref.y = 0
+            ..ref.z = 0)
+          .ref;
+      srcInfo.ref.aspect = WGPUTextureAspect.WGPUTextureAspect_All;
+      final dstInfo = arena<WGPUTexelCopyTextureInfo>();
+      dstInfo.ref.texture = to.texture;
+      dstInfo.ref.mipLevel = 0;
+      dstInfo.ref.origin = (arena<WGPUOrigin3D>()
             ..ref.x = 0
             ..ref.y = 0
             ..ref.z = 0)
@@ -795,6 +1749,7 @@ class CommandEncoder {
     });
   }
 
+  /// With a [profiler], the pass is timed on the GPU under [label].
   RenderPassEncoder beginRenderPass(
     GpuTexture texture, {
     Color? clearColor,
@@ -803,6 +1758,8 @@ class CommandEncoder {
     GpuTexture? depthTexture,
     WGPULoadOp loadOp = WGPULoadOp.WGPULoadOp_Load,
     WGPUStoreOp storeOp = WGPUStoreOp.WGPUStoreOp_Store,
+    GpuProfiler? profiler,
+    String? label,
   }) {
     final scratch = _Scratchpad.instance;
     final colorAttr = scratch.colorAttachment;
@@ -850,19 +1807,37 @@ class CommandEncoder {
       desc.ref.depthStencilAttachment = nullptr;
     }
 
-    desc.ref.timestampWrites = nullptr;
+    desc.ref.timestampWrites = profiler != null && label != null
+        ? profiler._timestampWrites(this, label)
+        : nullptr;
     desc.ref.occlusionQuerySet = nullptr;
     final passHandle = _wgpu.wgpuCommandEncoderBeginRenderPass(_handle, desc);
     return RenderPassEncoder(passHandle);
   }
 
-  ComputePassEncoder beginComputePass() {
-    final passHandle =
-        _wgpu.wgpuCommandEncoderBeginComputePass(_handle, nullptr);
+  /// With a [profiler], the pass is timed on the GPU under [label].
+  ComputePassEncoder beginComputePass({GpuProfiler? profiler, String? label}) {
+    final writes = profiler != null && label != null
+        ? profiler._timestampWrites(this, label)
+        : nullptr;
+    if (writes == nullptr) {
+      final passHandle =
+          _wgpu.wgpuCommandEncoderBeginComputePass(_handle, nullptr);
+      return ComputePassEncoder(passHandle);
+    }
+    final desc = _Scratchpad.instance.computePassDesc;
+    desc.ref.nextInChain = nullptr;
+    desc.ref.label.data = nullptr;
+    desc.ref.label.length = 0;
+    desc.ref.timestampWrites = writes;
+    final passHandle = _wgpu.wgpuCommandEncoderBeginComputePass(_handle, desc);
     return ComputePassEncoder(passHandle);
   }
 
   void submit() {
+    for (final frame in _profilerFrames) {
+      frame.resolve(_handle);
+    }
     final cmdBuf = _wgpu.wgpuCommandEncoderFinish(_handle, nullptr);
     using((arena) {
       final ptr = arena<Pointer<Void>>();
@@ -872,6 +1847,10 @@ class CommandEncoder {
 
     _wgpu.wgpuCommandBufferRelease(cmdBuf);
     _wgpu.wgpuCommandEncoderRelease(_handle);
+    for (final frame in _profilerFrames) {
+      frame.readBack();
+    }
+    _profilerFrames.clear();
 
   }
 }
@@ -884,8 +1863,16 @@ class RenderPassEncoder {
     _wgpu.wgpuRenderPassEncoderSetPipeline(_handle, pipeline.handle.cast());
   }
 
-  void setBindGroup(int index, WGPUBindGroup group) {
-    _wgpu.wgpuRenderPassEncoderSetBindGroup(_handle, index, group, 0, nullptr);
+  /// [dynamicOffsets] are in binding order, one per dynamic binding.
+  void setBindGroup(int index, WGPUBindGroup group,
+      [List<int>? dynamicOffsets]) {
+    if (dynamicOffsets == null || dynamicOffsets.isEmpty) {
+      _wgpu.wgpuRenderPassEncoderSetBindGroup(
+          _handle, index, group, 0, nullptr);
+      return;
+    }
+    _wgpu.wgpuRenderPassEncoderSetBindGroup(_handle, index, group,
+        dynamicOffsets.length, _Scratchpad.instance.offsets(dynamicOffsets));
   }
 
   void setVertexBuffer(int slot, GpuBuffer buffer) {
@@ -907,9 +1894,385 @@ class RenderPassEncoder {
   void drawIndexed(int indexCount, [int instanceCount = 1, int firstIndex = 0, int baseVertex = 0, int firstInstance = 0]) {
     _wgpu.wgpuRenderPassEncoderDrawIndexed(_handle, indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
   }
+
+  /// Issues everything recorded into [commands] with a single native call.
+  void executeCommands(GpuCommandList commands) {
+    if (commands._disposed) throw StateError("Command list was disposed");
+    if (commands._length == 0) return;
+    final executed = WebgpuRend.instance.executeCommandsInternal(
+        _handle.cast(),
+        commands._words,
+        commands._length,
+        commands._handles,
+        commands._handleIndex.length);
+    if (executed < 0) throw StateError("Malformed command list");
+  }
+
+  /// Replays [bundles] in order. Throws if one was invalidated, check
+  /// [GpuRenderBundle.isValid] and record it again first.
+  void executeBundles(List<GpuRenderBundle> bundles) {
+    if (bundles.isEmpty) return;
+    using((arena) {
+      final handles = arena<WGPURenderBundle>(bundles.length);
+      for (int i = 0; i < bundles.length; i++) {
+        final bundle = bundles[i];
+        if (!bundle.isValid) {
+          throw StateError("Render bundle was invalidated or disposed");
+        }
+        handles[i] = bundle.handle.cast();
+      }
+      _wgpu.wgpuRenderPassEncoderExecuteBundles(
+          _handle, bundles.length, handles);
+    });
+  }
+
   void end() => _wgpu.wgpuRenderPassEncoderEnd(_handle);
 }
 
+/// Render pass commands recorded into native memory and issued by
+/// [RenderPassEncoder.executeCommands] in one FFI call, where calling the
+/// encoder directly crosses into native code once per command. Worth it for
+/// passes with thousands of draws.
+///
+/// Each command is an opcode and its operands as 32-bit words, objects are
+/// indices into a handle table recorded alongside. Nothing is retained, so a
+/// list can be replayed every frame for as long as the pipelines, buffers
+/// and bind groups it references stay alive. Bind groups from
+/// [GpuBindGroupCache] may be replaced, re-record after fetching them.
+class GpuCommandList {
+  // CommandOp in src/webgpu_rend_command_stream.h
+  static const int _opSetPipeline = 1;
+  static const int _opSetBindGroup = 2;
+  static const int _opSetVertexBuffer = 3;
+  static const int _opSetIndexBuffer = 4;
+  static const int _opDraw = 5;
+  static const int _opDrawIndexed = 6;
+  static const int _opSetViewport = 7;
+  static const int _opSetScissorRect = 8;
+
+  Pointer<Uint32> _words;
+  Uint32List _wordList;
+  Float32List _floatList;
+  int _length = 0;
+  Pointer<Pointer<Void>> _handles;
+  int _handleCapacity;
+  // Handle address to its index in _handles
+  final Map<int, int> _handleIndex = {};
+  int _commandCount = 0;
+  bool _disposed = false;
+
+  GpuCommandList._(this._words, int words, this._handles, this._handleCapacity)
+      : _wordList = _words.asTypedList(words),
+        _floatList = _words.cast<Float>().asTypedList(words);
+
+  /// Starts out with room for [initialWords] words, growing as needed.
+  factory GpuCommandList({int initialWords = 4096}) {
+    final words = initialWords < 64 ? 64 : initialWords;
+    return GpuCommandList._(
+        malloc<Uint32>(words), words, malloc<Pointer<Void>>(64), 64);
+  }
+
+  int get commandCount => _commandCount;
+  int get lengthInBytes => _length * 4;
+
+  /// The recorded stream, valid until the next command or [reset].
+  Uint8List get bytes => _words.cast<Uint8>().asTypedList(_length * 4);
+
+  /// Drops every command, keeping the memory for the next recording.
+  void reset() {
+    _length = 0;
+    _commandCount = 0;
+    _handleIndex.clear();
+  }
+
+  void bindPipeline(GpuRenderPipeline pipeline) {
+    _reserve(2);
+    _wordList[_length++] = _opSetPipeline;
+    _wordList[_length++] = _handle(pipeline.handle);
+    _commandCount++;
+  }
+
+  /// See [RenderPassEncoder.setBindGroup].
+  void setBindGroup(int index, WGPUBindGroup group,
+      [List<int>? dynamicOffsets]) {
+    final count = dynamicOffsets?.length ?? 0;
+    if (count > _Scratchpad.maxDynamicOffsets) {
+      throw ArgumentError(
+          "At most ${_Scratchpad.maxDynamicOffsets} dynamic offsets");
+    }
+    _reserve(4 + count);
+    _wordList[_length++] = _opSetBindGroup;
+    _wordList[_length++] = index;
+    _wordList[_length++] = _handle(group.cast());
+    _wordList[_length++] = count;
+    for (int i = 0; i < count; i++) {
+      _wordList[_length++] = dynamicOffsets![i];
+    }
+    _commandCount++;
+  }
+
+  /// A [size] of 0 binds the rest of the buffer.
+  void setVertexBuffer(int slot, GpuBuffer buffer,
+      [int offset = 0, int size = 0]) {
+    _reserve(7);
+    _wordList[_length++] = _opSetVertexBuffer;
+    _wordList[_length++] = slot;
+    _wordList[_length++] = _handle(buffer.handle);
+    _write64(offset);
+    _write64(size == 0 ? buffer.size - offset : size);
+    _commandCount++;
+  }
+
+  /// A [size] of 0 binds the rest of the buffer.
+  void setIndexBuffer(GpuBuffer buffer, WGPUIndexFormat format,
+      [int offset = 0, int size = 0]) {
+    _reserve(7);
+    _wordList[_length++] = _opSetIndexBuffer;
+    _wordList[_length++] = _handle(buffer.handle);
+    _wordList[_length++] = format.value;
+    _write64(offset);
+    _write64(size == 0 ? buffer.size - offset : size);
+    _commandCount++;
+  }
+
+  void draw(int vertexCount,
+      [int instanceCount = 1, int firstVertex = 0, int firstInstance = 0]) {
+    _reserve(5);
+    _wordList[_length++] = _opDraw;
+    _wordList[_length++] = vertexCount;
+    _wordList[_length++] = instanceCount;
+    _wordList[_length++] = firstVertex;
+    _wordList[_length++] = firstInstance;
+    _commandCount++;
+  }
+
+  void drawIndexed(int indexCount,
+      [int instanceCount = 1,
+      int firstIndex = 0,
+      int baseVertex = 0,
+      int firstInstance = 0]) {
+    _reserve(6);
+    _wordList[_length++] = _opDrawIndexed;
+    _wordList[_length++] = indexCount;
+    _wordList[_length++] = instanceCount;
+    _wordList[_length++] = firstIndex;
+    // Negative base vertices keep their two's complement bits
+    _wordList[_length++] = baseVertex;
+    _wordList[_length++] = firstInstance;
+    _commandCount++;
+  }
+
+  void setViewport(double x, double y, double width, double height,
+      [double minDepth = 0.0, double maxDepth = 1.0]) {
+    _reserve(7);
+    _wordList[_length++] = _opSetViewport;
+    _floatList[_length++] = x;
+    _floatList[_length++] = y;
+    _floatList[_length++] = width;
+    _floatList[_length++] = height;
+    _floatList[_length++] = minDepth;
+    _floatList[_length++] = maxDepth;
+    _commandCount++;
+  }
+
+  void setScissorRect(int x, int y, int width, int height) {
+    _reserve(5);
+    _wordList[_length++] = _opSetScissorRect;
+    _wordList[_length++] = x;
+    _wordList[_length++] = y;
+    _wordList[_length++] = width;
+    _wordList[_length++] = height;
+    _commandCount++;
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    malloc.free(_words);
+    malloc.free(_handles);
+  }
+
+  void _write64(int value) {
+    _wordList[_length++] = value & 0xFFFFFFFF;
+    _wordList[_length++] = value >> 32;
+  }
+
+  int _handle(Pointer<Void> handle) {
+    final existing = _handleIndex[handle.address];
+    if (existing != null) return existing;
+    final index = _handleIndex.length;
+    if (index == _handleCapacity) {
+      final grown = malloc<Pointer<Void>>(_handleCapacity * 2);
+      for (int i = 0; i < index; i++) {
+        grown[i] = _handles[i];
+      }
+      malloc.free(_handles);
+      _handles = grown;
+      _handleCapacity *= 2;
+    }
+    _handles[index] = handle;
+    _handleIndex[handle.address] = index;
+    return index;
+  }
+
+  void _reserve(int words) {
+    if (_disposed) throw StateError("Command list was disposed");
+    if (_length + words <= _wordList.length) return;
+    int capacity = _wordList.length * 2;
+    while (capacity < _length + words) {
+      capacity *= 2;
+    }
+    final grown = malloc<Uint32>(capacity);
+    grown.asTypedList(capacity).setRange(0, _length, _wordList);
+    malloc.free(_words);
+    _words = grown;
+    _wordList = grown.asTypedList(capacity);
+    _floatList = grown.cast<Float>().asTypedList(capacity);
+  }
+}
+
+/// Draws recorded once and replayed by [RenderPassEncoder.executeBundles]
+/// for next to no CPU cost, for content that stays the same from frame to
+/// frame. Uniforms can still change: bind them with dynamic offsets or
+/// rewrite the buffers the bundle reads.
+///
+/// A bundle is invalidated, and its handle released, once a buffer it binds
+/// is disposed or a bind group it uses leaves [GpuBindGroupCache], which
+/// happens when one of the group's resources is disposed. Re-record it when
+/// [isValid] turns false. Bind groups created with the cache disabled are
+/// not tracked.
+class GpuRenderBundle extends GpuResource {
+  // Native addresses of the buffers and bind groups it was recorded with
+  final Set<int> _objects;
+  bool _valid = true;
+
+  // Native address of each referenced object to the bundles using it
+  static final Map<int, Set<GpuRenderBundle>> _byObject = {};
+
+  GpuRenderBundle._(super.handle, this._objects) {
+    for (final object in _objects) {
+      (_byObject[object] ??= {}).add(this);
+    }
+  }
+
+  /// Records the draws of [body]. The formats and [sampleCount] must match
+  /// the passes the bundle is executed in, the color format defaults to
+  /// [kPreferredTextureFormat] and [depthFormat] is needed when the pass
+  /// has a depth attachment.
+  static GpuRenderBundle record(void Function(RenderBundleEncoder) body,
+      {WGPUTextureFormat? colorFormat,
+      WGPUTextureFormat? depthFormat,
+      int sampleCount = 1}) {
+    final wgpu = WebgpuRend.instance.wgpu;
+    final encoder = using((arena) {
+      final formats = arena<UnsignedInt>();
+      formats.value = (colorFormat ?? kPreferredTextureFormat).value;
+      final desc = arena<WGPURenderBundleEncoderDescriptor>();
+      desc.ref.nextInChain = nullptr;
+      desc.ref.label.data = nullptr;
+      desc.ref.label.length = 0;
+      desc.ref.colorFormatCount = 1;
+      desc.ref.colorFormats = formats;
+      desc.ref.depthStencilFormat =
+          depthFormat ?? WGPUTextureFormat.WGPUTextureFormat_Undefined;
+      desc.ref.sampleCount = sampleCount;
+      desc.ref.depthReadOnly = 0;
+      desc.ref.stencilReadOnly = 0;
+      return RenderBundleEncoder._(
+          wgpu.wgpuDeviceCreateRenderBundleEncoder(
+              WebgpuRend.instance.device, desc));
+    });
+    try {
+      body(encoder);
+    } catch (_) {
+      wgpu.wgpuRenderBundleEncoderRelease(encoder._handle);
+      rethrow;
+    }
+    final bundle = wgpu.wgpuRenderBundleEncoderFinish(encoder._handle, nullptr);
+    wgpu.wgpuRenderBundleEncoderRelease(encoder._handle);
+    return GpuRenderBundle._(bundle.cast(), encoder._objects);
+  }
+
+  bool get isValid => _valid;
+
+  void dispose() {
+    if (!_valid) return;
+    _valid = false;
+    for (final object in _objects) {
+      final bundles = _byObject[object];
+      if (bundles == null) continue;
+      bundles.remove(this);
+      if (bundles.isEmpty) _byObject.remove(object);
+    }
+    WebgpuRend.instance.wgpu.wgpuRenderBundleRelease(handle.cast());
+  }
+
+  // Drops the bundles using the object at `address`, called when it is
+  // disposed or released by the bind group cache
+  static void _invalidate(int address) {
+    final bundles = _byObject[address];
+    if (bundles == null) return;
+    for (final bundle in bundles.toList()) {
+      bundle.dispose();
+    }
+  }
+}
+
+/// Records a [GpuRenderBundle], see [GpuRenderBundle.record]. Takes the
+/// same calls as [RenderPassEncoder].
+class RenderBundleEncoder {
+  final WGPURenderBundleEncoder _handle;
+  final WebGpuBindings _wgpu = WebgpuRend.instance.wgpu;
+  final Set<int> _objects = {};
+  RenderBundleEncoder._(this._handle);
+
+  void bindPipeline(GpuRenderPipeline pipeline) {
+    _wgpu.wgpuRenderBundleEncoderSetPipeline(_handle, pipeline.handle.cast());
+  }
+
+  /// See [RenderPassEncoder.setBindGroup]. The offsets are baked into the
+  /// bundle.
+  void setBindGroup(int index, WGPUBindGroup group,
+      [List<int>? dynamicOffsets]) {
+    _objects.add(group.address);
+    if (dynamicOffsets == null || dynamicOffsets.isEmpty) {
+      _wgpu.wgpuRenderBundleEncoderSetBindGroup(
+          _handle, index, group, 0, nullptr);
+      return;
+    }
+    _wgpu.wgpuRenderBundleEncoderSetBindGroup(_handle, index, group,
+        dynamicOffsets.length, _Scratchpad.instance.offsets(dynamicOffsets));
+  }
+
+  void setVertexBuffer(int slot, GpuBuffer buffer) {
+    _objects.add(buffer.handle.address);
+    _wgpu.wgpuRenderBundleEncoderSetVertexBuffer(
+        _handle, slot, buffer.handle.cast(), 0, buffer.size);
+  }
+
+  void setIndexBuffer(GpuBuffer buffer, WGPUIndexFormat format,
+      [int offset = 0, int size = 0]) {
+    _objects.add(buffer.handle.address);
+    final effectiveSize = size == 0 ? buffer.size - offset : size;
+    _wgpu.wgpuRenderBundleEncoderSetIndexBuffer(
+        _handle, buffer.handle.cast(), format, offset, effectiveSize);
+  }
+
+  void draw(int vertexCount) =>
+      _wgpu.wgpuRenderBundleEncoderDraw(_handle, vertexCount, 1, 0, 0);
+  void drawInstanced(int vertexCount, int instanceCount) => _wgpu
+      .wgpuRenderBundleEncoderDraw(_handle, vertexCount, instanceCount, 0, 0);
+
+  void drawIndexed(int indexCount,
+      [int instanceCount = 1,
+      int firstIndex = 0,
+      int baseVertex = 0,
+      int firstInstance = 0]) {
+    _wgpu.wgpuRenderBundleEncoderDrawIndexed(_handle, indexCount,
+        instanceCount, firstIndex, baseVertex, firstInstance);
+  }
+}
+
 class ComputePassEncoder {
   final WGPUComputePassEncoder _handle;
   final WebGpuBindings _wgpu = WebgpuRend.instance.wgpu;
@@ -918,8 +2281,16 @@ class ComputePassEncoder {
     _wgpu.wgpuComputePassEncoderSetPipeline(_handle, pipeline.handle.cast());
   }
 
-  void setBindGroup(int index, WGPUBindGroup group) {
-    _wgpu.wgpuComputePassEncoderSetBindGroup(_handle, index, group, 0, nullptr);
+  /// See [RenderPassEncoder.setBindGroup].
+  void setBindGroup(int index, WGPUBindGroup group,
+      [List<int>? dynamicOffsets]) {
+    if (dynamicOffsets == null || dynamicOffsets.isEmpty) {
+      _wgpu.wgpuComputePassEncoderSetBindGroup(
+          _handle, index, group, 0, nullptr);
+      return;
+    }
+    _wgpu.wgpuComputePassEncoderSetBindGroup(_handle, index, group,
+        dynamicOffsets.length, _Scratchpad.instance.offsets(dynamicOffsets));
   }
 
   void dispatch(int x, [int y = 1, int z = 1]) =>
@@ -927,6 +2298,738 @@ class ComputePassEncoder {
   void end() => _wgpu.wgpuComputePassEncoderEnd(_handle);
 }
 
+/// Where [GpuStagingBelt.writeTexture] wants the texels: rows of the
+/// region start [bytesPerRow] apart.
+class GpuStagingRegion {
+  final Uint8List bytes;
+  final int bytesPerRow;
+  const GpuStagingRegion(this.bytes, this.bytesPerRow);
+}
+
+class _StagingChunk {
+  final WGPUBuffer buffer;
+  final int size;
+  // Pooled chunks are mapped again once the GPU is done with them, one-off
+  // ones are released after their submit
+  final bool pooled;
+  // Mapped memory, null while the GPU owns the chunk
+  Uint8List? memory;
+  int used = 0;
+  _StagingChunk(this.buffer, this.size, this.pooled, this.memory);
+}
+
+/// Uploads without the extra copies of `wgpuQueueWriteBuffer`.
+///
+/// Data is written straight into large mapped buffers ("chunks"), and
+/// [flush] submits copies from them to the destination buffers and textures.
+/// After the GPU signals that submit done, its chunks are mapped again and
+/// reused, so steady streaming allocates nothing. Call [flush] once per
+/// frame, before submitting the commands that read the uploaded data.
+///
+/// The views returned by [writeBuffer] and [writeTexture] point into mapped
+/// memory and must not be touched after [flush]. When every chunk is still
+/// in use by the GPU and [maxChunks] are allocated, the upload gets a
+/// buffer of its own and counts as a stall; [stalls] growing means
+/// [chunkSize] or [maxChunks] is too small for the frame's uploads.
+class GpuStagingBelt {
+  final int chunkSize;
+  final int maxChunks;
+
+  final List<_StagingChunk> _chunks = [];
+  final List<_StagingChunk> _free = [];
+  // Mapped chunks written since the last flush
+  final List<_StagingChunk> _active = [];
+  // Chunks of each flush until the GPU is done with them
+  final Map<int, List<_StagingChunk>> _inFlight = {};
+  // Shared textures written since the last flush, accessed around its submit
+  final Set<GpuTexture> _textures = {};
+  WGPUCommandEncoder _encoder = nullptr;
+  late final NativeCallable<WGPUQueueWorkDoneCallbackFunction> _workDoneCallback;
+  late final NativeCallable<WGPUBufferMapCallbackFunction> _mapCallback;
+  int _flushSerial = 0;
+  // Work-done and map callbacks Dawn still owes us
+  int _pendingCallbacks = 0;
+  int _frameBytes = 0;
+  int _lastFrameBytes = 0;
+  int _totalBytes = 0;
+  int _frames = 0;
+  int _stalls = 0;
+  bool _disposed = false;
+
+  GpuStagingBelt({this.chunkSize = 1 << 20, this.maxChunks = 16}) {
+    _workDoneCallback =
+        NativeCallable<WGPUQueueWorkDoneCallbackFunction>.listener(_onWorkDone);
+    _mapCallback =
+        NativeCallable<WGPUBufferMapCallbackFunction>.listener(_onMapped);
+  }
+
+  /// Bytes uploaded by the last [flush].
+  int get lastFrameBytes => _lastFrameBytes;
+
+  /// Average bytes per [flush] since the belt was created.
+  double get averageFrameBytes => _frames == 0 ? 0 : _totalBytes / _frames;
+
+  int get totalBytes => _totalBytes;
+
+  /// Uploads that found every chunk in use, see [GpuStagingBelt].
+  int get stalls => _stalls;
+
+  /// Pooled chunks allocated so far.
+  int get chunkCount => _chunks.length;
+
+  /// Memory to write [size] bytes of [buffer] from [offset] into. Both must
+  /// be multiples of 4.
+  Uint8List writeBuffer(GpuBuffer buffer, int offset, int size) {
+    if (offset % 4 != 0 || size % 4 != 0) {
+      throw ArgumentError("Offset and size must be multiples of 4");
+    }
+    final (chunk, chunkOffset) = _allocate(size, 4);
+    _wgpu.wgpuCommandEncoderCopyBufferToBuffer(
+        _encoderForFrame(), chunk.buffer, chunkOffset, buffer.handle.cast(),
+        offset, size);
+    return Uint8List.sublistView(chunk.memory!, chunkOffset, chunkOffset + size);
+  }
+
+  /// Memory to write an RGBA8 region of [texture] into, see
+  /// [GpuStagingRegion].
+  GpuStagingRegion writeTexture(
+      GpuTexture texture, int x, int y, int width, int height) {
+    // Texel copies need rows aligned to 256 bytes
+    final bytesPerRow = (width * 4 + 255) & ~255;
+    final size = bytesPerRow * height;
+    final (chunk, chunkOffset) = _allocate(size, 256);
+    using((arena) {
+      final source = arena<WGPUTexelCopyBufferInfo>();
+      source.ref.buffer = chunk.buffer;
+      source.ref.layout.offset = chunkOffset;
+      source.ref.layout.bytesPerRow = bytesPerRow;
+      source.ref.layout.rowsPerImage = height;
+      final destination = arena<WGPUTexelCopyTextureInfo>();
+      destination.ref.texture = texture.texture;
+      destination.ref.mipLevel = 0;
+      destination.ref.origin.x = x;
+      destination.ref.origin.y = y;
+      destination.ref.origin.z = 0;
+      destination.ref.aspect = WGPUTextureAspect.WGPUTextureAspect_All;
+      final extent = arena<WGPUExtent3D>();
+      extent.ref.width = width;
+      extent.ref.height = height;
+      extent.ref.depthOrArrayLayers = 1;
+      _wgpu.wgpuCommandEncoderCopyBufferToTexture(
+          _encoderForFrame(), source, destination, extent);
+    });
+    _textures.add(texture);
+    return GpuStagingRegion(
+        Uint8List.sublistView(chunk.memory!, chunkOffset, chunkOffset + size),
+        bytesPerRow);
+  }
+
+  /// Submits the copies recorded since the last flush.
+  void flush() {
+    _lastFrameBytes = _frameBytes;
+    _totalBytes += _frameBytes;
+    _frameBytes = 0;
+    _frames++;
+    if (_encoder == nullptr) return;
+
+    for (final chunk in _active) {
+      chunk.memory = null;
+      _wgpu.wgpuBufferUnmap(chunk.buffer);
+    }
+    for (final texture in _textures) {
+      texture.beginAccess();
+    }
+    final cmdBuf = _wgpu.wgpuCommandEncoderFinish(_encoder, nullptr);
+    using((arena) {
+      final ptr = arena<Pointer<Void>>();
+      ptr.value = cmdBuf.cast();
+      _wgpu.wgpuQueueSubmit(WebgpuRend.instance.queue, 1, ptr.cast());
+    });
+    _wgpu.wgpuCommandBufferRelease(cmdBuf);
+    _wgpu.wgpuCommandEncoderRelease(_encoder);
+    _encoder = nullptr;
+    for (final texture in _textures) {
+      texture.endAccess();
+    }
+    _textures.clear();
+
+    final pooled = <_StagingChunk>[];
+    for (final chunk in _active) {
+      // The submit holds its own reference to one-off chunks
+      if (chunk.pooled) {
+        pooled.add(chunk);
+      } else {
+        _wgpu.wgpuBufferRelease(chunk.buffer);
+      }
+    }
+    _active.clear();
+    if (pooled.isEmpty) return;
+    final serial = _flushSerial++;
+    _inFlight[serial] = pooled;
+    _pendingCallbacks++;
+    final future = using((arena) {
+      final callbackInfo = arena<WGPUQueueWorkDoneCallbackInfo>();
+      callbackInfo.ref.nextInChain = nullptr;
+      callbackInfo.ref.mode =
+          WGPUCallbackMode.WGPUCallbackMode_AllowSpontaneous;
+      callbackInfo.ref.callback = _workDoneCallback.nativeFunction;
+      callbackInfo.ref.userdata1 = Pointer.fromAddress(serial);
+      callbackInfo.ref.userdata2 = nullptr;
+      return _wgpu.wgpuQueueOnSubmittedWorkDone(
+          WebgpuRend.instance.queue, callbackInfo.ref);
+    });
+    WebgpuRend.instance.watchFutureInternal(future);
+  }
+
+  /// Releases the chunks. Copies recorded since the last [flush] are
+  /// dropped.
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    if (_encoder != nullptr) {
+      _wgpu.wgpuCommandEncoderRelease(_encoder);
+      _encoder = nullptr;
+    }
+    _textures.clear();
+    for (final chunk in _active) {
+      if (!chunk.pooled) _wgpu.wgpuBufferRelease(chunk.buffer);
+    }
+    _active.clear();
+    _free.clear();
+    // Chunks the GPU still holds are unmapped, they are released as their
+    // callbacks return
+    for (final chunk in _chunks) {
+      if (chunk.memory != null) _wgpu.wgpuBufferRelease(chunk.buffer);
+    }
+    _closeCallbacksIfIdle();
+  }
+
+  WebGpuBindings get _wgpu => WebgpuRend.instance.wgpu;
+
+  WGPUCommandEncoder _encoderForFrame() {
+    if (_encoder == nullptr) {
+      _encoder = _wgpu.wgpuDeviceCreateCommandEncoder(
+          WebgpuRend.instance.device, nullptr);
+    }
+    return _encoder;
+  }
+
+  // A chunk and offset with `size` mapped bytes free at `alignment`
+  (_StagingChunk, int) _allocate(int size, int alignment) {
+    if (_disposed) throw StateError("Staging belt was disposed");
+    _frameBytes += size;
+    if (_active.isNotEmpty) {
+      final chunk = _active.last;
+      final offset = (chunk.used + alignment - 1) & ~(alignment - 1);
+      if (offset + size <= chunk.size) {
+        chunk.used = offset + size;
+        return (chunk, offset);
+      }
+    }
+    final index = _free.indexWhere((c) => c.size >= size);
+    _StagingChunk chunk;
+    if (index >= 0) {
+      chunk = _free.removeAt(index);
+    } else if (_chunks.length < maxChunks) {
+      chunk = _createChunk(size > chunkSize ? size : chunkSize, true);
+      _chunks.add(chunk);
+    } else {
+      _stalls++;
+      // Without the completion thread, recycled chunks only come back
+      // through processed events; deliver them for later uploads
+      if (!WebgpuRend.instance.useCompletionThread) {
+        WebgpuRend.instance.processEventsInternal();
+      }
+      chunk = _createChunk(size, false);
+    }
+    chunk.used = size;
+    _active.add(chunk);
+    return (chunk, 0);
+  }
+
+  _StagingChunk _createChunk(int size, bool pooled) {
+    final alignedSize = (size + 3) & ~3;
+    return using((arena) {
+      final desc = arena<WGPUBufferDescriptor>();
+      desc.ref.nextInChain = nullptr;
+      desc.ref.label.data = nullptr;
+      desc.ref.label.length = 0;
+      desc.ref.size = alignedSize;
+      desc.ref.usage = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc;
+      desc.ref.mappedAtCreation = 1;
+      final buffer =
+          _wgpu.wgpuDeviceCreateBuffer(WebgpuRend.instance.device, desc);
+      final memory = _wgpu
+          .wgpuBufferGetMappedRange(buffer, 0, alignedSize)
+          .cast<Uint8>()
+          .asTypedList(alignedSize);
+      return _StagingChunk(buffer, alignedSize, pooled, memory);
+    });
+  }
+
+  void _onWorkDone(
+      int status, WGPUStringView message, Pointer<Void> u1, Pointer<Void> u2) {
+    _pendingCallbacks--;
+    final chunks = _inFlight.remove(u1.address) ?? const [];
+    for (final chunk in chunks) {
+      if (_disposed) {
+        _wgpu.wgpuBufferRelease(chunk.buffer);
+        continue;
+      }
+      _pendingCallbacks++;
+      final future = using((arena) {
+        final callbackInfo = arena<WGPUBufferMapCallbackInfo>();
+        callbackInfo.ref.nextInChain = nullptr;
+        callbackInfo.ref.mode =
+            WGPUCallbackMode.WGPUCallbackMode_AllowSpontaneous;
+        callbackInfo.ref.callback = _mapCallback.nativeFunction;
+        callbackInfo.ref.userdata1 =
+            Pointer.fromAddress(_chunks.indexOf(chunk));
+        callbackInfo.ref.userdata2 = nullptr;
+        return _wgpu.wgpuBufferMapAsync(
+            chunk.buffer, WGPUMapMode_Write, 0, chunk.size, callbackInfo.ref);
+      });
+      WebgpuRend.instance.watchFutureInternal(future);
+    }
+    _closeCallbacksIfIdle();
+  }
+
+  void _onMapped(
+      int status, WGPUStringView message, Pointer<Void> u1, Pointer<Void> u2) {
+    _pendingCallbacks--;
+    final chunk = _chunks[u1.address];
+    if (_disposed) {
+      _wgpu.wgpuBufferRelease(chunk.buffer);
+    } else if (status == WGPUMapAsyncStatus.WGPUMapAsyncStatus_Success.value) {
+      chunk.memory = _wgpu
+          .wgpuBufferGetMappedRange(chunk.buffer, 0, chunk.size)
+          .cast<Uint8>()
+          .asTypedList(chunk.size);
+      _free.add(chunk);
+    }
+    // A chunk that failed to map stays out of the pool, the device is lost
+    _closeCallbacksIfIdle();
+  }
+
+  void _closeCallbacksIfIdle() {
+    if (!_disposed || _pendingCallbacks > 0) return;
+    _workDoneCallback.close();
+    _mapCallback.close();
+  }
+}
+
+/// Packs the uniforms of many draws into one buffer, uploaded with a single
+/// write per frame and bound through dynamic offsets.
+///
+/// Each frame: [reset], [allocate] a slot per draw and write its uniforms
+/// through [bytes], then [upload]. Every draw binds the same group, created
+/// from [binding] on a layout entry with `hasDynamicOffset: true`, and
+/// passes its slot's offset to `setBindGroup`. Slots are aligned to the
+/// device's minUniformBufferOffsetAlignment.
+///
+/// When a frame needs more than [capacity], the buffer is replaced by a
+/// larger one on [upload], which drops the bind groups of the old one; get
+/// the group after [upload] to pick up the new buffer. Views from [bytes] and
+/// [floats] stay valid until the next [reset], growing included.
+class GpuUniformArena {
+  /// Bytes a draw sees through the binding, the largest slot size.
+  final int bindingSize;
+  final int alignment;
+
+  GpuBuffer _buffer;
+  Pointer<Uint8> _memory;
+  int _capacity;
+  int _used = 0;
+  bool _disposed = false;
+  // Memory outgrown this frame, with the bytes in use when it was replaced.
+  // Slots allocated before a growth stay where they were, so views handed
+  // out for them keep working, and upload gathers them. Freed by reset.
+  final List<(Pointer<Uint8>, int)> _retired = [];
+
+  GpuUniformArena._(this.bindingSize, this.alignment, this._buffer,
+      this._memory, this._capacity);
+
+  factory GpuUniformArena({int capacity = 64 * 1024, int bindingSize = 256}) {
+    if (capacity < bindingSize) capacity = bindingSize;
+    final alignment = using((arena) {
+      final limits = arena<WGPULimits>();
+      limits.ref.nextInChain = nullptr;
+      final status = WebgpuRend.instance.wgpu
+          .wgpuDeviceGetLimits(WebgpuRend.instance.device, limits);
+      // 256 is the largest alignment WebGPU allows a device to require
+      return status == WGPUStatus.WGPUStatus_Success
+          ? limits.ref.minUniformBufferOffsetAlignment
+          : 256;
+    });
+    return GpuUniformArena._(bindingSize, alignment, _createBuffer(capacity),
+        calloc<Uint8>(capacity), capacity);
+  }
+
+  static GpuBuffer _createBuffer(int size) => GpuBuffer.create(
+      size: size, usage: WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst);
+
+  int get capacity => _capacity;
+
+  /// Bytes allocated this frame, including alignment padding.
+  int get used => _used;
+
+  GpuBuffer get buffer => _buffer;
+
+  /// The window every slot is seen through, offset by `setBindGroup`.
+  GpuBufferBinding get binding => GpuBufferBinding(_buffer, size: bindingSize);
+
+  /// Starts a new frame. Slots of the last one may be overwritten and views
+  /// of them are invalid.
+  void reset() {
+    _freeRetired();
+    _used = 0;
+  }
+
+  /// A slot of [size] bytes, at most [bindingSize]. Returns its offset, the
+  /// dynamic offset to bind it with.
+  int allocate([int? size]) {
+    final slotSize = size ?? bindingSize;
+    if (slotSize > bindingSize) {
+      throw ArgumentError("Slot of $slotSize bytes exceeds the binding size");
+    }
+    final offset = (_used + alignment - 1) & ~(alignment - 1);
+    // The binding window must fit behind the last slot as well
+    final end = offset + bindingSize;
+    if (end > _capacity) _grow(end);
+    _used = offset + slotSize;
+    return offset;
+  }
+
+  /// CPU memory of the slot at [offset], written by [upload].
+  Uint8List bytes(int offset, [int? size]) =>
+      _slotMemory(offset).elementAt(offset).asTypedList(size ?? bindingSize);
+
+  /// Float view of the slot at [offset], for matrices and vectors.
+  Float32List floats(int offset, [int? size]) => _slotMemory(offset)
+      .elementAt(offset)
+      .cast<Float>()
+      .asTypedList((size ?? bindingSize) ~/ 4);
+
+  /// Writes every slot of this frame to the GPU buffer in one go.
+  void upload() {
+    if (_disposed || _used == 0) return;
+    if (_buffer.size < _capacity) {
+      _buffer.dispose();
+      _buffer = _createBuffer(_capacity);
+    }
+    // Slots from before a growth still live in the memory they started in
+    var start = 0;
+    for (final (memory, used) in _retired) {
+      _memory
+          .elementAt(start)
+          .asTypedList(used - start)
+          .setAll(0, memory.elementAt(start).asTypedList(used - start));
+      start = used;
+    }
+    // Buffer writes must be a multiple of 4 bytes
+    final size = (_used + 3) & ~3;
+    WebgpuRend.instance.wgpu.wgpuQueueWriteBuffer(
+        WebgpuRend.instance.queue, _buffer.handle.cast(), 0, _memory.cast(),
+        size);
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    _buffer.dispose();
+    _freeRetired();
+    calloc.free(_memory);
+  }
+
+  // The oldest memory that held a slot at `offset` when it was outgrown
+  Pointer<Uint8> _slotMemory(int offset) {
+    for (final (memory, used) in _retired) {
+      if (offset < used) return memory;
+    }
+    return _memory;
+  }
+
+  void _freeRetired() {
+    for (final (memory, _) in _retired) {
+      calloc.free(memory);
+    }
+    _retired.clear();
+  }
+
+  void _grow(int required) {
+    var capacity = _capacity * 2;
+    while (capacity < required) {
+      capacity *= 2;
+    }
+    if (_used > 0) {
+      _retired.add((_memory, _used));
+    } else {
+      calloc.free(_memory);
+    }
+    _memory = calloc<Uint8>(capacity);
+    _capacity = capacity;
+  }
+}
+
+/// Rolling GPU time of one profiled pass label, in milliseconds.
+class GpuProfilerStats {
+  final String label;
+
+  /// Samples the numbers below are computed from, at most the window size.
+  final int samples;
+  final double minMs;
+  final double avgMs;
+  final double p99Ms;
+  final double lastMs;
+
+  const GpuProfilerStats(
+      this.label, this.samples, this.minMs, this.avgMs, this.p99Ms, this.lastMs);
+
+  @override
+  String toString() => "$label: min ${minMs.toStringAsFixed(3)} ms, "
+      "avg ${avgMs.toStringAsFixed(3)} ms, p99 ${p99Ms.toStringAsFixed(3)} ms";
+}
+
+// Fixed-size window of the most recent samples of one label
+class _SampleWindow {
+  final Float64List _values;
+  int _count = 0;
+  int _next = 0;
+  double last = 0;
+
+  _SampleWindow(int size) : _values = Float64List(size);
+
+  void add(double value) {
+    _values[_next] = value;
+    _next = (_next + 1) % _values.length;
+    if (_count < _values.length) _count++;
+    last = value;
+  }
+
+  GpuProfilerStats stats(String label) {
+    if (_count == 0) return GpuProfilerStats(label, 0, 0, 0, 0, 0);
+    final sorted = Float64List.fromList(_values.sublist(0, _count))..sort();
+    double sum = 0;
+    for (final v in sorted) {
+      sum += v;
+    }
+    final p99 = sorted[((_count - 1) * 0.99).ceil()];
+    return GpuProfilerStats(
+        label, _count, sorted.first, sum / _count, p99, last);
+  }
+}
+
+enum _ProfilerFrameState { idle, recording, mapping }
+
+// One slot of the readback ring: the timestamps of every labeled pass of one
+// submit, resolved into a buffer that is mapped once the GPU is done with it.
+class _ProfilerFrame {
+  final GpuProfiler _profiler;
+  final WGPUQuerySet _querySet;
+  final WGPUBuffer _resolveBuffer;
+  final WGPUBuffer _readbackBuffer;
+  final List<String> labels = [];
+  late final NativeCallable<WGPUBufferMapCallbackFunction> _mapCallback;
+  _ProfilerFrameState state = _ProfilerFrameState.idle;
+
+  _ProfilerFrame(this._profiler, this._querySet, this._resolveBuffer,
+      this._readbackBuffer) {
+    _mapCallback = NativeCallable<WGPUBufferMapCallbackFunction>.listener(
+        _onMapped);
+  }
+
+  int get _byteSize => labels.length * 2 * 8;
+
+  void resolve(WGPUCommandEncoder encoder) {
+    if (labels.isEmpty) return;
+    final wgpu = WebgpuRend.instance.wgpu;
+    wgpu.wgpuCommandEncoderResolveQuerySet(
+        encoder, _querySet, 0, labels.length * 2, _resolveBuffer, 0);
+    wgpu.wgpuCommandEncoderCopyBufferToBuffer(
+        encoder, _resolveBuffer, 0, _readbackBuffer, 0, _byteSize);
+  }
+
+  void readBack() {
+    if (labels.isEmpty) {
+      state = _ProfilerFrameState.idle;
+      return;
+    }
+    state = _ProfilerFrameState.mapping;
+    final future = using((arena) {
+      final callbackInfo = arena<WGPUBufferMapCallbackInfo>();
+      callbackInfo.ref.nextInChain = nullptr;
+      callbackInfo.ref.mode =
+          WGPUCallbackMode.WGPUCallbackMode_AllowSpontaneous;
+      callbackInfo.ref.callback = _mapCallback.nativeFunction;
+      callbackInfo.ref.userdata1 = nullptr;
+      callbackInfo.ref.userdata2 = nullptr;
+      return WebgpuRend.instance.wgpu.wgpuBufferMapAsync(
+          _readbackBuffer, WGPUMapMode_Read, 0, _byteSize, callbackInfo.ref);
+    });
+    WebgpuRend.instance.watchFutureInternal(future);
+  }
+
+  void _onMapped(
+      int status, WGPUStringView msg, Pointer<Void> u1, Pointer<Void> u2) {
+    final wgpu = WebgpuRend.instance.wgpu;
+    if (status == WGPUMapAsyncStatus.WGPUMapAsyncStatus_Success.value &&
+        !_profiler._disposed) {
+      final ticks = wgpu
+          .wgpuBufferGetConstMappedRange(_readbackBuffer, 0, _byteSize)
+          .cast<Uint64>()
+          .asTypedList(labels.length * 2);
+      for (int i = 0; i < labels.length; i++) {
+        final begin = ticks[2 * i];
+        final end = ticks[2 * i + 1];
+        // Some drivers report zeros or go backwards across power states
+        if (begin == 0 || end < begin) continue;
+        _profiler._addSample(labels[i], (end - begin) / 1e6);
+      }
+      wgpu.wgpuBufferUnmap(_readbackBuffer);
+    }
+    labels.clear();
+    state = _ProfilerFrameState.idle;
+    if (_profiler._disposed) release();
+  }
+
+  void release() {
+    final wgpu = WebgpuRend.instance.wgpu;
+    _mapCallback.close();
+    wgpu.wgpuQuerySetRelease(_querySet);
+    wgpu.wgpuBufferRelease(_resolveBuffer);
+    wgpu.wgpuBufferRelease(_readbackBuffer);
+  }
+}
+
+/// Measures how long labeled passes take on the GPU.
+///
+/// Pass the profiler and a label to [CommandEncoder.beginRenderPass] or
+/// [CommandEncoder.beginComputePass]. The timestamps of every submit go into
+/// a ring of [latency] + 1 readback buffers and are read once the GPU is done
+/// with them, so results trail rendering by [latency] submits and reading
+/// them never waits for the GPU. When the ring is full, or a submit has more
+/// than [maxPassesPerFrame] labeled passes, the extra passes simply are not
+/// timed.
+///
+/// Needs the TimestampQuery feature, which the device requests whenever the
+/// adapter has it; without it [isSupported] is false and profiling is a no-op.
+class GpuProfiler {
+  final int maxPassesPerFrame;
+  final int latency;
+
+  /// How many of the latest samples per label [stats] covers.
+  final int window;
+
+  final List<_ProfilerFrame> _frames = [];
+  final Map<String, _SampleWindow> _samples = {};
+  int _nextFrame = 0;
+  int _droppedPasses = 0;
+  bool _disposed = false;
+
+  GpuProfiler({this.maxPassesPerFrame = 16, this.latency = 3, this.window = 120}) {
+    if (!isSupported) return;
+    final wgpu = WebgpuRend.instance.wgpu;
+    final device = WebgpuRend.instance.device;
+    final byteSize = maxPassesPerFrame * 2 * 8;
+    using((arena) {
+      final queryDesc = arena<WGPUQuerySetDescriptor>();
+      queryDesc.ref.nextInChain = nullptr;
+      queryDesc.ref.label.data = nullptr;
+      queryDesc.ref.label.length = 0;
+      queryDesc.ref.type = WGPUQueryType.WGPUQueryType_Timestamp;
+      queryDesc.ref.count = maxPassesPerFrame * 2;
+      final bufferDesc = arena<WGPUBufferDescriptor>();
+      bufferDesc.ref.nextInChain = nullptr;
+      bufferDesc.ref.label.data = nullptr;
+      bufferDesc.ref.label.length = 0;
+      bufferDesc.ref.size = byteSize;
+      bufferDesc.ref.mappedAtCreation = 0;
+      for (int i = 0; i <= latency; i++) {
+        final querySet = wgpu.wgpuDeviceCreateQuerySet(device, queryDesc);
+        bufferDesc.ref.usage =
+            WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc;
+        final resolve = wgpu.wgpuDeviceCreateBuffer(device, bufferDesc);
+        bufferDesc.ref.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+        final readback = wgpu.wgpuDeviceCreateBuffer(device, bufferDesc);
+        _frames.add(_ProfilerFrame(this, querySet, resolve, readback));
+      }
+    });
+  }
+
+  bool get isSupported =>
+      WebgpuRend.instance.wgpu.wgpuDeviceHasFeature(WebgpuRend.instance.device,
+          WGPUFeatureName.WGPUFeatureName_TimestampQuery) !=
+      0;
+
+  /// Labeled passes that went untimed, because every readback buffer was
+  /// still waiting on the GPU or the submit had too many of them. Raising
+  /// [latency] helps if this keeps growing.
+  int get droppedPasses => _droppedPasses;
+
+  /// Labels that have samples so far.
+  Iterable<String> get labels => _samples.keys;
+
+  /// Rolling stats of [label], or null if it was never measured.
+  GpuProfilerStats? statsFor(String label) => _samples[label]?.stats(label);
+
+  /// Rolling stats of every label measured so far.
+  List<GpuProfilerStats> get stats =>
+      [for (final e in _samples.entries) e.value.stats(e.key)];
+
+  /// Forgets every sample.
+  void reset() => _samples.clear();
+
+  void _addSample(String label, double ms) {
+    _samples.putIfAbsent(label, () => _SampleWindow(window)).add(ms);
+  }
+
+  // Timestamp writes for the next pass of `encoder`, or null if it cannot be
+  // timed. Points into the scratchpad, so it is only valid until the pass
+  // begins.
+  Pointer<WGPUPassTimestampWrites> _timestampWrites(
+      CommandEncoder encoder, String label) {
+    if (_disposed || _frames.isEmpty) return nullptr;
+    _ProfilerFrame? frame;
+    for (final f in encoder._profilerFrames) {
+      if (f._profiler == this) frame = f;
+    }
+    if (frame == null) {
+      final next = _frames[_nextFrame];
+      if (next.state != _ProfilerFrameState.idle) {
+        // Let Dawn deliver finished maps for the next submit, but do not wait
+        WebgpuRend.instance.processEventsInternal();
+        _droppedPasses++;
+        return nullptr;
+      }
+      _nextFrame = (_nextFrame + 1) % _frames.length;
+      frame = next..state = _ProfilerFrameState.recording;
+      encoder._profilerFrames.add(frame);
+    }
+    if (frame.labels.length >= maxPassesPerFrame) {
+      _droppedPasses++;
+      return nullptr;
+    }
+    final index = frame.labels.length;
+    frame.labels.add(label);
+    final writes = _Scratchpad.instance.timestampWrites;
+    writes.ref.nextInChain = nullptr;
+    writes.ref.querySet = frame._querySet;
+    writes.ref.beginningOfPassWriteIndex = index * 2;
+    writes.ref.endOfPassWriteIndex = index * 2 + 1;
+    return writes;
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    for (final frame in _frames) {
+      // Frames still mapping release themselves once the map completes
+      if (frame.state != _ProfilerFrameState.mapping) frame.release();
+    }
+    _frames.clear();
+  }
+}
+
 enum BlendMode {
   /// No blending. Replaces destination pixels.
   opaque,
@@ -1,8 +1,11 @@
 import 'dart:convert';
+import 'dart:ffi';
+import 'dart:isolate';
 import 'dart:typed_data';
 import 'dart:ui';
+import 'package:ffi/ffi.dart';
 import 'package:flutter/services.dart' show rootBundle;
-import 'package:vector_math/vector_math.dart' as vm;
+import 'package:webgpu_rend/webgpu_rend.dart';
 
 class MeshGroup {
   final String materialName;
@@ -21,81 +24,153 @@ class MeshData {
   MeshData(this.vertices, this.indices, this.groups, this.mtlLibName);
 }
 
+/// Loads Wavefront OBJ meshes through the native parser.
+///
+/// The file is parsed on a background isolate, split into line ranges that
+/// are parsed on several threads at once, so even large meshes neither block
+/// the UI nor go through a Dart string. The vertex and index lists of the
+/// returned [MeshData] point into the parser's output and free it once both
+/// are garbage collected.
+///
+/// Faces are fan-triangulated. Vertices are deduplicated on their position
+/// and normal, texture coordinates are skipped; corners without a normal get
+/// (0, 1, 0).
 class ObjLoader {
-  static Future<MeshData> load(String assetPath) async {
-    final String content = await rootBundle.loadString(assetPath);
-    
-    final List<vm.Vector3> rawPos = [];
-    final List<vm.Vector3> rawNorm = [];
-    final Map<String, int> uniqueVertices = {};
-    
-    final List<double> finalVertexBuffer = [];
-    final List<int> finalIndices = [];
-    final List<MeshGroup> groups = [];
-
-    String currentMaterial = "default";
-    String? mtlLibName;
-    int groupStartIndex = 0;
-
-    LineSplitter.split(content).forEach((line) {
-      line = line.trim();
-      if (line.isEmpty || line.startsWith('#')) return;
-
-      final parts = line.split(RegExp(r'\s+'));
-      final type = parts[0];
+  static final Pointer<Void> Function(Pointer<Utf8>, int) _parseFile = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Pointer<Void> Function(Pointer<Utf8>, Int32)>>(
+          'webgpu_rend_obj_parse_file')
+      .asFunction();
+  static final Pointer<Void> Function(Pointer<Uint8>, int, int) _parseBytes =
+      WebgpuRend.instance.dylib
+          .lookup<
+              NativeFunction<
+                  Pointer<Void> Function(
+                      Pointer<Uint8>, Int64, Int32)>>('webgpu_rend_obj_parse_bytes')
+          .asFunction();
+  static final Pointer<Utf8> Function(Pointer<Void>) _getError = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Pointer<Utf8> Function(Pointer<Void>)>>(
+          'webgpu_rend_mesh_get_error')
+      .asFunction();
+  static final Pointer<Float> Function(Pointer<Void>, Pointer<Int64>)
+      _getVertices = WebgpuRend.instance.dylib
+          .lookup<
+              NativeFunction<
+                  Pointer<Float> Function(Pointer<Void>,
+                      Pointer<Int64>)>>('webgpu_rend_mesh_get_vertices')
+          .asFunction();
+  static final Pointer<Uint32> Function(Pointer<Void>, Pointer<Int64>)
+      _getIndices = WebgpuRend.instance.dylib
+          .lookup<
+              NativeFunction<
+                  Pointer<Uint32> Function(Pointer<Void>,
+                      Pointer<Int64>)>>('webgpu_rend_mesh_get_indices')
+          .asFunction();
+  static final int Function(Pointer<Void>) _getGroupCount = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Int32 Function(Pointer<Void>)>>(
+          'webgpu_rend_mesh_get_group_count')
+      .asFunction();
+  static final Pointer<Utf8> Function(
+          Pointer<Void>, int, Pointer<Int64>, Pointer<Int64>) _getGroup =
+      WebgpuRend.instance.dylib
+          .lookup<
+              NativeFunction<
+                  Pointer<Utf8> Function(Pointer<Void>, Int32, Pointer<Int64>,
+                      Pointer<Int64>)>>('webgpu_rend_mesh_get_group')
+          .asFunction();
+  static final Pointer<Utf8> Function(Pointer<Void>) _getMtllib = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Pointer<Utf8> Function(Pointer<Void>)>>(
+          'webgpu_rend_mesh_get_mtllib')
+      .asFunction();
+  static final void Function(Pointer<Void>) _retain = WebgpuRend.instance.dylib
+      .lookup<NativeFunction<Void Function(Pointer<Void>)>>(
+          'webgpu_rend_mesh_retain')
+      .asFunction();
+  static final Pointer<NativeFinalizerFunction> _releasePtr = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFinalizerFunction>('webgpu_rend_mesh_release');
+  static final void Function(Pointer<Void>) _release =
+      _releasePtr.asFunction();
+
+  /// Loads the OBJ asset at [assetPath], parsing on up to [threads] threads
+  /// (0 for one per core). Throws a [FormatException] if a face refers to a
+  /// vertex or normal the file does not define.
+  static Future<MeshData> load(String assetPath, {int threads = 0}) async {
+    final data = await rootBundle.load(assetPath);
+    final length = data.lengthInBytes;
+    final bytes = malloc<Uint8>(length > 0 ? length : 1);
+    try {
+      bytes
+          .asTypedList(length)
+          .setAll(0, data.buffer.asUint8List(data.offsetInBytes, length));
+      final mesh = await _parseInIsolate(bytes.address, length, threads);
+      return _toMeshData(Pointer<Void>.fromAddress(mesh));
+    } finally {
+      malloc.free(bytes);
+    }
+  }
 
-      if (type == 'v') {
-        rawPos.add(vm.Vector3(double.parse(parts[1]), double.parse(parts[2]), double.parse(parts[3])));
-      } else if (type == 'vn') {
-        rawNorm.add(vm.Vector3(double.parse(parts[1]), double.parse(parts[2]), double.parse(parts[3])));
-      } else if (type == 'mtllib') {
-        mtlLibName = parts[1];
-      } else if (type == 'usemtl') {
-        if (finalIndices.length > groupStartIndex) {
-          groups.add(MeshGroup(currentMaterial, groupStartIndex, finalIndices.length - groupStartIndex));
-        }
-        currentMaterial = parts[1];
-        groupStartIndex = finalIndices.length;
-      } else if (type == 'f') {
-        final List<String> faceVerts = parts.sublist(1);
-        for (int i = 1; i < faceVerts.length - 1; i++) {
-          _processVertex(faceVerts[0], uniqueVertices, finalVertexBuffer, finalIndices, rawPos, rawNorm);
-          _processVertex(faceVerts[i], uniqueVertices, finalVertexBuffer, finalIndices, rawPos, rawNorm);
-          _processVertex(faceVerts[i + 1], uniqueVertices, finalVertexBuffer, finalIndices, rawPos, rawNorm);
-        }
+  /// Like [load] for a file on disk, which the parser maps into memory
+  /// instead of reading it.
+  static Future<MeshData> loadFile(String path, {int threads = 0}) async {
+    final mesh = await Isolate.run(() {
+      final pathPtr = path.toNativeUtf8();
+      try {
+        return _parseFile(pathPtr, threads).address;
+      } finally {
+        malloc.free(pathPtr);
       }
     });
-
-    if (finalIndices.length > groupStartIndex) {
-      groups.add(MeshGroup(currentMaterial, groupStartIndex, finalIndices.length - groupStartIndex));
-    }
-
-    return MeshData(Float32List.fromList(finalVertexBuffer), Uint32List.fromList(finalIndices), groups, mtlLibName);
+    return _toMeshData(Pointer<Void>.fromAddress(mesh));
   }
 
-  static void _processVertex(String faceToken, Map<String, int> cache, List<double> buffer, List<int> indices, List<vm.Vector3> positions, List<vm.Vector3> normals) {
-    if (cache.containsKey(faceToken)) {
-      indices.add(cache[faceToken]!);
-      return;
+  // Kept apart from load so the closure sent to the isolate captures nothing
+  // but these ints
+  static Future<int> _parseInIsolate(int address, int length, int threads) =>
+      Isolate.run(() =>
+          _parseBytes(Pointer<Uint8>.fromAddress(address), length, threads)
+              .address);
+
+  // Wraps the native mesh in place, each list holds a reference to it
+  static MeshData _toMeshData(Pointer<Void> mesh) {
+    final error = _getError(mesh);
+    if (error != nullptr) {
+      final message = error.toDartString();
+      _release(mesh);
+      throw FormatException(message);
     }
-    final newIndex = cache.length;
-    cache[faceToken] = newIndex;
-    indices.add(newIndex);
-
-    final parts = faceToken.split('/');
-
-    //position
-    final pIdx = int.parse(parts[0]) - 1;
-    final pos = positions[pIdx];
-    buffer.add(pos.x); buffer.add(pos.y); buffer.add(pos.z);
-
-    //normal
-    if (parts.length > 2 && parts[2].isNotEmpty) {
-      final nIdx = int.parse(parts[2]) - 1;
-      final norm = normals[nIdx];
-      buffer.add(norm.x); buffer.add(norm.y); buffer.add(norm.z);
-    } else {
-      buffer.add(0.0); buffer.add(1.0); buffer.add(0.0);
+    final start = malloc<Int64>(2);
+    final count = start + 1;
+    try {
+      final vertexPtr = _getVertices(mesh, count);
+      Float32List vertices = Float32List(0);
+      if (count.value > 0) {
+        _retain(mesh);
+        vertices = vertexPtr.asTypedList(count.value,
+            finalizer: _releasePtr, token: mesh);
+      }
+      final indexPtr = _getIndices(mesh, count);
+      Uint32List indices = Uint32List(0);
+      if (count.value > 0) {
+        _retain(mesh);
+        indices = indexPtr.asTypedList(count.value,
+            finalizer: _releasePtr, token: mesh);
+      }
+      final groups = <MeshGroup>[];
+      final groupCount = _getGroupCount(mesh);
+      for (int i = 0; i < groupCount; i++) {
+        final name = _getGroup(mesh, i, start, count);
+        groups.add(MeshGroup(name.toDartString(), start.value, count.value));
+      }
+      final mtllib = _getMtllib(mesh);
+      return MeshData(vertices, indices, groups,
+          mtllib == nullptr ? null : mtllib.toDartString());
+    } finally {
+      malloc.free(start);
+      _release(mesh);
     }
   }
 }
@@ -0,0 +1,630 @@
+import 'dart:ffi';
+import 'dart:typed_data';
+import 'dart:ui';
+
+import 'package:ffi/ffi.dart';
+
+import 'package:flutter/services.dart';
+import 'package:vector_math/vector_math.dart' as vm;
+import 'package:webgpu_rend/obj_load.dart';
+import 'package:webgpu_rend/webgpu_rend.dart';
+
+/// How [SwPixelBuffer.draw] combines source pixels with the frame. Indices
+/// match the native `SwBlitMode`.
+enum SwBlitMode {
+  /// Overwrite the destination.
+  copy,
+
+  /// Overwrite the destination with BGRA source pixels.
+  swizzle,
+
+  /// Overwrite the destination with straight-alpha source pixels,
+  /// premultiplying them on the way.
+  premultiply,
+
+  /// Composite premultiplied source pixels over the destination.
+  blend,
+}
+
+/// Pixel layout returned by [SwPixelBuffer.getPixels]. Indices match the
+/// native `SwReadFormat`.
+enum SwReadFormat {
+  rgba,
+  bgra,
+
+  /// Alpha dropped, 3 bytes per pixel.
+  rgb,
+}
+
+/// How an [SwLayer] is combined with the layers below it. Indices match the
+/// native `SwLayerBlend`.
+enum SwLayerBlend {
+  /// Premultiplied source-over.
+  over,
+
+  /// Replaces the layers below. With an opacity below 1 it fades between
+  /// the two instead.
+  source,
+
+  /// Adds to the layers below, saturating.
+  add,
+
+  /// Multiplies with the layers below.
+  multiply,
+}
+
+/// Which triangles [SwPixelBuffer.drawMesh] skips. Counter-clockwise
+/// triangles face front, as in the GPU pipelines.
+enum SwCullMode { none, front, back }
+
+/// A mesh copied into native memory once, so it can be drawn every frame by
+/// the software rasterizer without copying it again.
+class SwMesh {
+  final Pointer<Float> _vertices;
+  final Pointer<Uint32> _indices;
+  final int vertexCount;
+  final int indexCount;
+  final List<MeshGroup> groups;
+  bool _disposed = false;
+
+  SwMesh._(this._vertices, this._indices, this.vertexCount, this.indexCount,
+      this.groups);
+
+  /// Vertices use the interleaved position/normal layout of [ObjLoader].
+  factory SwMesh.fromMeshData(MeshData mesh) {
+    final vertices = malloc<Float>(mesh.vertices.length);
+    vertices.asTypedList(mesh.vertices.length).setAll(0, mesh.vertices);
+    final indices = malloc<Uint32>(mesh.indices.length);
+    indices.asTypedList(mesh.indices.length).setAll(0, mesh.indices);
+    return SwMesh._(vertices, indices, mesh.vertices.length ~/ 6,
+        mesh.indices.length, mesh.groups);
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    malloc.free(_vertices);
+    malloc.free(_indices);
+  }
+}
+
+/// A CPU-side texture on Linux, backed by the native `SwPixelBuffer`.
+///
+/// Pixels are RGBA8888. Use [beginFrame] to write straight into native memory
+/// and [invalidate] to hand the frame to Flutter; neither goes through the
+/// method channel codec.
+///
+/// [draw], [fill] and [getPixels] go through the method channel and land on
+/// the platform thread some time after they are called, while [beginFrame],
+/// [invalidate], [clear3D], [drawMesh] and [compose] run immediately. To keep
+/// the two in order, the immediate calls throw a [StateError] while a [draw]
+/// or [fill] is still in flight: await those first.
+class SwPixelBuffer {
+  static const MethodChannel _channel =
+      MethodChannel('com.funguscow/webgpu_rend');
+
+  static final Pointer<Uint8> Function(int) _getPixelBuffer = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Pointer<Uint8> Function(Int64)>>(
+          'webgpu_rend_get_pixel_buffer')
+      .asFunction();
+  static final void Function(int) _invalidateTexture = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Void Function(Int64)>>(
+          'webgpu_rend_invalidate_texture')
+      .asFunction();
+  static final void Function(int, Pointer<Int32>, int) _invalidateTextureRects =
+      WebgpuRend.instance.dylib
+          .lookup<NativeFunction<Void Function(Int64, Pointer<Int32>, Int32)>>(
+              'webgpu_rend_invalidate_texture_rects')
+          .asFunction();
+  static final int Function(int, Pointer<Int32>, int) _getTextureDamage =
+      WebgpuRend.instance.dylib
+          .lookup<NativeFunction<Int32 Function(Int64, Pointer<Int32>, Int32)>>(
+              'webgpu_rend_get_texture_damage')
+          .asFunction();
+
+  static final void Function(int, int, double) _rasterClear = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Void Function(Int64, Uint32, Float)>>(
+          'webgpu_rend_raster_clear')
+      .asFunction();
+  static final void Function(int, Pointer<Float>, int, Pointer<Uint32>, int,
+          Pointer<Float>, int, int) _rasterDrawMesh =
+      WebgpuRend.instance.dylib
+          .lookup<
+              NativeFunction<
+                  Void Function(Int64, Pointer<Float>, Int64, Pointer<Uint32>,
+                      Int64, Pointer<Float>, Uint32, Int32)>>(
+              'webgpu_rend_raster_draw_mesh')
+          .asFunction();
+
+  /// Upper bound on the rects the native side keeps per frame. Larger damage
+  /// lists are merged into fewer, bigger rects.
+  static const int maxDamageRects = 8;
+
+  final int textureId;
+  final int width;
+  final int height;
+  bool _disposed = false;
+  // draw and fill calls the platform thread has not answered yet
+  int _pendingWrites = 0;
+
+  SwPixelBuffer._(this.textureId, this.width, this.height);
+
+  void _checkNoPendingWrites() {
+    if (_pendingWrites > 0) {
+      throw StateError(
+          "Await draw() and fill() before writing the frame directly");
+    }
+  }
+
+  Future<void> _write(String method, Map<String, Object> arguments) async {
+    _pendingWrites++;
+    try {
+      await _channel.invokeMethod(method, arguments);
+    } finally {
+      _pendingWrites--;
+    }
+  }
+
+  static Future<SwPixelBuffer> create(
+      {required int width, required int height}) async {
+    final id = await _channel
+        .invokeMethod<int>('init', {'width': width, 'height': height});
+    if (id == null) throw "Failed to create pixel buffer";
+    return SwPixelBuffer._(id, width, height);
+  }
+
+  /// Returns a view of the native frame currently being drawn.
+  ///
+  /// The view is only valid until the next [invalidate]; call this again for
+  /// every frame.
+  Uint8List beginFrame() {
+    if (_disposed) throw StateError("SwPixelBuffer has been disposed");
+    _checkNoPendingWrites();
+    final ptr = _getPixelBuffer(textureId);
+    if (ptr == nullptr) throw "Texture $textureId is not registered";
+    return ptr.asTypedList(width * height * 4);
+  }
+
+  /// Publishes the frame written through [beginFrame] or [draw].
+  ///
+  /// Passing [damage] limits what is carried over into the next frame to
+  /// those rects, which is much cheaper than a full frame copy when little
+  /// changed. Pixels written through [beginFrame] outside of [damage] may be
+  /// lost. Without it, the whole frame is treated as changed unless the frame
+  /// was only written through [draw].
+  void invalidate({List<Rect>? damage}) {
+    if (_disposed) return;
+    _checkNoPendingWrites();
+    if (damage == null || damage.isEmpty) {
+      _invalidateTexture(textureId);
+      return;
+    }
+    final rects = malloc<Int32>(damage.length * 4);
+    try {
+      for (int i = 0; i < damage.length; i++) {
+        final rect = damage[i];
+        final left = rect.left.floor();
+        final top = rect.top.floor();
+        rects[4 * i] = left;
+        rects[4 * i + 1] = top;
+        rects[4 * i + 2] = rect.right.ceil() - left;
+        rects[4 * i + 3] = rect.bottom.ceil() - top;
+      }
+      _invalidateTextureRects(textureId, rects, damage.length);
+    } finally {
+      malloc.free(rects);
+    }
+  }
+
+  /// Returns the rects that changed in the most recently published frame.
+  List<Rect> getDamage() {
+    if (_disposed) return const [];
+    final rects = malloc<Int32>(maxDamageRects * 4);
+    try {
+      final count = _getTextureDamage(textureId, rects, maxDamageRects);
+      return [
+        for (int i = 0; i < count; i++)
+          Rect.fromLTWH(
+              rects[4 * i].toDouble(),
+              rects[4 * i + 1].toDouble(),
+              rects[4 * i + 2].toDouble(),
+              rects[4 * i + 3].toDouble()),
+      ];
+    } finally {
+      malloc.free(rects);
+    }
+  }
+
+  /// Copies [pixels] into a sub-rectangle through the method channel.
+  ///
+  /// [pixels] holds a [srcWidth] x [srcHeight] image, which defaults to the
+  /// destination size. A different source size is stretched to fit using
+  /// nearest neighbour sampling.
+  Future<void> draw(Uint8List pixels,
+      {int x = 0,
+      int y = 0,
+      int? width,
+      int? height,
+      int? srcWidth,
+      int? srcHeight,
+      SwBlitMode mode = SwBlitMode.copy}) {
+    width ??= this.width;
+    height ??= this.height;
+    return _write('draw', {
+      'texture': textureId,
+      'pixels': pixels,
+      'x': x,
+      'y': y,
+      'width': width,
+      'height': height,
+      'src_width': srcWidth ?? width,
+      'src_height': srcHeight ?? height,
+      'mode': mode.index,
+    });
+  }
+
+  /// Fills a sub-rectangle with a single 0xAARRGGBB color.
+  Future<void> fill(int argb, {int x = 0, int y = 0, int? width, int? height}) {
+    return _write('fill', {
+      'texture': textureId,
+      'color': argb,
+      'x': x,
+      'y': y,
+      'width': width ?? this.width,
+      'height': height ?? this.height,
+    });
+  }
+
+  /// Clears the frame to a 0xAARRGGBB color and resets the depth buffer used
+  /// by [drawMesh].
+  void clear3D(int argb, {double depth = 1.0}) {
+    if (_disposed) return;
+    _checkNoPendingWrites();
+    _rasterClear(textureId, argb, depth);
+  }
+
+  /// Rasterizes [mesh] on the CPU with simple diffuse lighting, using every
+  /// core. [mvp] maps to WebGPU clip space, like the matrices passed to the
+  /// GPU pipelines. Draws only [group] if given.
+  void drawMesh(SwMesh mesh, vm.Matrix4 mvp, int argb,
+      {MeshGroup? group, SwCullMode cullMode = SwCullMode.back}) {
+    if (_disposed || mesh._disposed) return;
+    _checkNoPendingWrites();
+    final indexStart = group?.indexStart ?? 0;
+    final indexCount = group?.indexCount ?? mesh.indexCount;
+    final matrix = malloc<Float>(16);
+    try {
+      matrix.asTypedList(16).setAll(0, mvp.storage);
+      _rasterDrawMesh(textureId, mesh._vertices, mesh.vertexCount,
+          mesh._indices + indexStart, indexCount, matrix, argb, cullMode.index);
+    } finally {
+      malloc.free(matrix);
+    }
+  }
+
+  /// Reads back the newest contents, or a rect of them.
+  ///
+  /// The output can be converted to another [format] and downscaled to
+  /// [dstWidth] x [dstHeight] (box filtered, never larger than the rect).
+  Future<Uint8List> getPixels(
+      {int x = 0,
+      int y = 0,
+      int? width,
+      int? height,
+      int? dstWidth,
+      int? dstHeight,
+      SwReadFormat format = SwReadFormat.rgba}) async {
+    final pixels = await _channel.invokeMethod<Uint8List>('get_pixels',
+        _readArguments(x, y, width, height, dstWidth, dstHeight, format));
+    return pixels ?? Uint8List(0);
+  }
+
+  /// Same as [getPixels], but the conversion and scaling run on a native
+  /// worker thread instead of blocking the platform thread. Prefer this for
+  /// thumbnails and screenshots of large buffers.
+  Future<Uint8List> getPixelsAsync(
+      {int x = 0,
+      int y = 0,
+      int? width,
+      int? height,
+      int? dstWidth,
+      int? dstHeight,
+      SwReadFormat format = SwReadFormat.rgba}) async {
+    final pixels = await _channel.invokeMethod<Uint8List>('get_pixels_async',
+        _readArguments(x, y, width, height, dstWidth, dstHeight, format));
+    return pixels ?? Uint8List(0);
+  }
+
+  Map<String, Object> _readArguments(int x, int y, int? width, int? height,
+      int? dstWidth, int? dstHeight, SwReadFormat format) {
+    width ??= this.width - x;
+    height ??= this.height - y;
+    return {
+      'texture': textureId,
+      'x': x,
+      'y': y,
+      'width': width,
+      'height': height,
+      'dst_width': dstWidth ?? width,
+      'dst_height': dstHeight ?? height,
+      'format': format.index,
+    };
+  }
+
+  /// Adds a [width] x [height] layer to this buffer's layer stack, above all
+  /// existing layers.
+  ///
+  /// Once a buffer has layers, [compose] owns its contents: anything drawn
+  /// into it directly is overwritten wherever a layer changes.
+  SwLayer createLayer(int width, int height) {
+    if (_disposed) throw StateError("SwPixelBuffer has been disposed");
+    final id = SwLayer._create(textureId, width, height);
+    if (id < 0) throw "Failed to create a ${width}x$height layer";
+    return SwLayer._(this, id, width, height);
+  }
+
+  /// Redraws the parts of the layer stack that changed since the last call
+  /// on top of a 0xAARRGGBB [background], and presents the result.
+  ///
+  /// Returns the number of rects that were redrawn; when nothing changed
+  /// this is 0 and no frame is presented.
+  int compose({int background = 0}) {
+    if (_disposed) return 0;
+    _checkNoPendingWrites();
+    return SwLayer._compose(textureId, background);
+  }
+
+  /// Releases the texture and its frames.
+  ///
+  /// The frames are freed as soon as the platform thread handles the call,
+  /// so any view returned by [beginFrame] must not be touched after this.
+  Future<void> dispose() async {
+    if (_disposed) return;
+    _disposed = true;
+    await _channel.invokeMethod('dispose', {'texture': textureId});
+  }
+}
+
+/// One layer of an [SwPixelBuffer]'s layer stack, see
+/// [SwPixelBuffer.createLayer].
+///
+/// Layers are composited natively into their buffer, so a HUD made of several
+/// layers still costs a single Flutter texture and a single upload per frame.
+class SwLayer {
+  static final int Function(int, int, int) _create = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Int32 Function(Int64, Int32, Int32)>>(
+          'webgpu_rend_layer_create')
+      .asFunction();
+  static final void Function(int, int) _dispose = WebgpuRend.instance.dylib
+      .lookup<NativeFunction<Void Function(Int64, Int32)>>(
+          'webgpu_rend_layer_dispose')
+      .asFunction();
+  static final Pointer<Uint8> Function(int, int) _getPixels = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Pointer<Uint8> Function(Int64, Int32)>>(
+          'webgpu_rend_layer_get_pixels')
+      .asFunction();
+  static final void Function(int, int, int, int, int, int) _markDirty =
+      WebgpuRend.instance.dylib
+          .lookup<
+              NativeFunction<
+                  Void Function(Int64, Int32, Int32, Int32, Int32,
+                      Int32)>>('webgpu_rend_layer_mark_dirty')
+          .asFunction();
+  static final void Function(int, int, int, int, int, int, int, int)
+      _setProperties = WebgpuRend.instance.dylib
+          .lookup<
+              NativeFunction<
+                  Void Function(Int64, Int32, Int32, Int32, Int32, Int32,
+                      Int32, Int32)>>('webgpu_rend_layer_set_properties')
+          .asFunction();
+  static final int Function(int, int) _compose = WebgpuRend.instance.dylib
+      .lookup<NativeFunction<Int32 Function(Int64, Uint32)>>(
+          'webgpu_rend_compose')
+      .asFunction();
+
+  final SwPixelBuffer buffer;
+  final int id;
+  final int width;
+  final int height;
+  int _x = 0;
+  int _y = 0;
+  double _opacity = 1.0;
+  SwLayerBlend _blend = SwLayerBlend.over;
+  bool _visible = true;
+  int _zOrder = 0;
+  bool _disposed = false;
+
+  SwLayer._(this.buffer, this.id, this.width, this.height);
+
+  /// Premultiplied RGBA pixels of the layer, written in place.
+  ///
+  /// Changes only show up after [markDirty] and [SwPixelBuffer.compose].
+  Uint8List get pixels {
+    if (_disposed) throw StateError("SwLayer has been disposed");
+    final ptr = _getPixels(buffer.textureId, id);
+    if (ptr == nullptr) throw "Layer $id is not registered";
+    return ptr.asTypedList(width * height * 4);
+  }
+
+  /// Marks [rect] (in layer coordinates), or the whole layer, as changed so
+  /// the next [SwPixelBuffer.compose] redraws it.
+  void markDirty([Rect? rect]) {
+    if (_disposed) return;
+    if (rect == null) {
+      _markDirty(buffer.textureId, id, 0, 0, 0, 0);
+      return;
+    }
+    final left = rect.left.floor();
+    final top = rect.top.floor();
+    _markDirty(buffer.textureId, id, left, top, rect.right.ceil() - left,
+        rect.bottom.ceil() - top);
+  }
+
+  /// Position of the layer's top left corner in the buffer, in whole pixels.
+  Offset get offset => Offset(_x.toDouble(), _y.toDouble());
+  set offset(Offset value) {
+    _x = value.dx.round();
+    _y = value.dy.round();
+    _apply();
+  }
+
+  double get opacity => _opacity;
+  set opacity(double value) {
+    _opacity = value.clamp(0.0, 1.0);
+    _apply();
+  }
+
+  SwLayerBlend get blendMode => _blend;
+  set blendMode(SwLayerBlend value) {
+    _blend = value;
+    _apply();
+  }
+
+  bool get visible => _visible;
+  set visible(bool value) {
+    _visible = value;
+    _apply();
+  }
+
+  /// Layers with a higher z-order are drawn on top. Layers with the same
+  /// z-order stack in creation order.
+  int get zOrder => _zOrder;
+  set zOrder(int value) {
+    _zOrder = value;
+    _apply();
+  }
+
+  void _apply() {
+    if (_disposed) return;
+    _setProperties(buffer.textureId, id, _x, _y, (_opacity * 255).round(),
+        _blend.index, _visible ? 1 : 0, _zOrder);
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    _dispose(buffer.textureId, id);
+  }
+}
+
+/// Records draws, fills and copies across any number of [SwPixelBuffer]s and
+/// runs them all in a single platform channel message.
+///
+/// Invalidates are applied once per texture after the whole batch ran, so a
+/// texture can be drawn into from several places and still only present once.
+class SwBatch {
+  static const MethodChannel _channel =
+      MethodChannel('com.funguscow/webgpu_rend');
+
+  // Must match SwBatchOpcode in sw_batch.h
+  static const int _opDraw = 1;
+  static const int _opFill = 2;
+  static const int _opCopy = 3;
+  static const int _opInvalidate = 4;
+
+  final BytesBuilder _bytes = BytesBuilder(copy: false);
+  int _count = 0;
+
+  /// Number of commands recorded so far.
+  int get length => _count;
+
+  bool get isEmpty => _count == 0;
+
+  void _record(int opcode, ByteData payload, [Uint8List? pixels]) {
+    final payloadSize = payload.lengthInBytes + (pixels?.length ?? 0);
+    final header = ByteData(8)
+      ..setUint32(0, opcode, Endian.little)
+      ..setUint32(4, payloadSize, Endian.little);
+    _bytes.add(header.buffer.asUint8List());
+    _bytes.add(payload.buffer.asUint8List());
+    if (pixels != null) _bytes.add(pixels);
+    _count++;
+  }
+
+  /// Same as [SwPixelBuffer.draw].
+  void draw(SwPixelBuffer target, Uint8List pixels,
+      {int x = 0,
+      int y = 0,
+      int? width,
+      int? height,
+      int? srcWidth,
+      int? srcHeight,
+      SwBlitMode mode = SwBlitMode.copy}) {
+    width ??= target.width;
+    height ??= target.height;
+    srcWidth ??= width;
+    srcHeight ??= height;
+    final bytes = srcWidth * srcHeight * 4;
+    if (pixels.length < bytes) {
+      throw ArgumentError("Pixel data is smaller than the source rect");
+    }
+    final payload = ByteData(36)
+      ..setInt64(0, target.textureId, Endian.little)
+      ..setInt32(8, x, Endian.little)
+      ..setInt32(12, y, Endian.little)
+      ..setInt32(16, width, Endian.little)
+      ..setInt32(20, height, Endian.little)
+      ..setInt32(24, srcWidth, Endian.little)
+      ..setInt32(28, srcHeight, Endian.little)
+      ..setInt32(32, mode.index, Endian.little);
+    _record(_opDraw, payload, Uint8List.sublistView(pixels, 0, bytes));
+  }
+
+  /// Same as [SwPixelBuffer.fill].
+  void fill(SwPixelBuffer target, int argb,
+      {int x = 0, int y = 0, int? width, int? height}) {
+    final payload = ByteData(28)
+      ..setInt64(0, target.textureId, Endian.little)
+      ..setInt32(8, x, Endian.little)
+      ..setInt32(12, y, Endian.little)
+      ..setInt32(16, width ?? target.width, Endian.little)
+      ..setInt32(20, height ?? target.height, Endian.little)
+      ..setUint32(24, argb, Endian.little);
+    _record(_opFill, payload);
+  }
+
+  /// Copies a rect of the newest contents of [source] into [target], which
+  /// may be the same buffer.
+  void copy(SwPixelBuffer source, SwPixelBuffer target,
+      {int srcX = 0,
+      int srcY = 0,
+      int dstX = 0,
+      int dstY = 0,
+      required int width,
+      required int height,
+      SwBlitMode mode = SwBlitMode.copy}) {
+    final payload = ByteData(44)
+      ..setInt64(0, source.textureId, Endian.little)
+      ..setInt64(8, target.textureId, Endian.little)
+      ..setInt32(16, srcX, Endian.little)
+      ..setInt32(20, srcY, Endian.little)
+      ..setInt32(24, dstX, Endian.little)
+      ..setInt32(28, dstY, Endian.little)
+      ..setInt32(32, width, Endian.little)
+      ..setInt32(36, height, Endian.little)
+      ..setInt32(40, mode.index, Endian.little);
+    _record(_opCopy, payload);
+  }
+
+  /// Presents [target] once the batch finished.
+  void invalidate(SwPixelBuffer target) {
+    final payload = ByteData(8)..setInt64(0, target.textureId, Endian.little);
+    _record(_opInvalidate, payload);
+  }
+
+  /// Sends everything recorded so far and clears the batch. Completes with
+  /// the number of commands run.
+  Future<int> submit() async {
+    if (_count == 0) return 0;
+    final commands = _bytes.takeBytes();
+    _count = 0;
+    final executed = await _channel
+        .invokeMethod<int>('submit_batch', {'commands': commands});
+    return executed ?? 0;
+  }
+}
@@ -0,0 +1,108 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+
+import 'package:ffi/ffi.dart';
+import 'package:webgpu_rend/webgpu_rend.dart';
+
+/// Captures what the native layer is doing as a Chrome trace.
+///
+/// Between [start] and [stop] every `webgpu_rend_*` call, and the waits for
+/// the GPU inside them, is recorded per thread; Dawn errors show up as
+/// instant events. Spans timed with [span] or [spanAsync] land on a "Dart"
+/// track of the same trace, on the same clock. Load the output of [dumpJson]
+/// in chrome://tracing or ui.perfetto.dev.
+class WebgpuRendTrace {
+  static final void Function() _start = WebgpuRend.instance.dylib
+      .lookup<NativeFunction<Void Function()>>('webgpu_rend_trace_start')
+      .asFunction();
+  static final void Function() _stop = WebgpuRend.instance.dylib
+      .lookup<NativeFunction<Void Function()>>('webgpu_rend_trace_stop')
+      .asFunction();
+  static final int Function() _nowUs = WebgpuRend.instance.dylib
+      .lookup<NativeFunction<Int64 Function()>>('webgpu_rend_trace_now_us')
+      .asFunction();
+  static final void Function(Pointer<Utf8>, int, int) _addSpan = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Void Function(Pointer<Utf8>, Int64, Int64)>>(
+          'webgpu_rend_trace_add_span')
+      .asFunction();
+  static final int Function(Pointer<Uint8>, int) _dumpJson = WebgpuRend
+      .instance.dylib
+      .lookup<NativeFunction<Int64 Function(Pointer<Uint8>, Int64)>>(
+          'webgpu_rend_trace_dump_json')
+      .asFunction();
+
+  static bool _capturing = false;
+
+  static bool get isCapturing => _capturing;
+
+  /// Starts a new capture, dropping the previous one.
+  static void start() {
+    _capturing = true;
+    _start();
+  }
+
+  static void stop() {
+    _capturing = false;
+    _stop();
+  }
+
+  /// Records [name] from [startUs] for [durationUs], both on the native
+  /// trace clock (see [nowUs]).
+  static void addSpan(String name, int startUs, int durationUs) {
+    if (!_capturing) return;
+    final namePtr = name.toNativeUtf8();
+    _addSpan(namePtr, startUs, durationUs);
+    malloc.free(namePtr);
+  }
+
+  /// Microseconds on the clock native events are stamped with.
+  static int nowUs() => _nowUs();
+
+  /// Runs [body], recording it as a span while capturing.
+  static T span<T>(String name, T Function() body) {
+    if (!_capturing) return body();
+    final start = _nowUs();
+    try {
+      return body();
+    } finally {
+      addSpan(name, start, _nowUs() - start);
+    }
+  }
+
+  /// Like [span], the span lasts until the returned future completes.
+  static Future<T> spanAsync<T>(String name, Future<T> Function() body) async {
+    if (!_capturing) return body();
+    final start = _nowUs();
+    try {
+      return await body();
+    } finally {
+      addSpan(name, start, _nowUs() - start);
+    }
+  }
+
+  /// The capture as Chrome trace_event JSON. Stop the capture first to get
+  /// every event.
+  static String dumpJson() {
+    int size = _dumpJson(nullptr, 0);
+    while (true) {
+      final buffer = malloc<Uint8>(size);
+      try {
+        final written = _dumpJson(buffer, size);
+        // Threads kept recording since it was sized, try again
+        if (written > size) {
+          size = written;
+          continue;
+        }
+        return utf8.decode(buffer.asTypedList(written));
+      } finally {
+        malloc.free(buffer);
+      }
+    }
+  }
+
+  /// Writes [dumpJson] to [path].
+  static Future<void> dumpToFile(String path) =>
+      File(path).writeAsString(dumpJson());
+}
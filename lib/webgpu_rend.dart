@@ -1,3 +1,4 @@
+import 'dart:async';
 import 'dart:ffi';
 import 'dart:io';
 import 'package:ffi/ffi.dart';
@@ -19,6 +20,55 @@ class WebgpuRend {
   late final void Function(Pointer<Void>) _endAccess;
   late final void Function(Pointer<Void>) _present;
   late final void Function(Pointer<Void>) _disposeTexture;
+  late final void Function(
+          Pointer<NativeFunction<Void Function(Pointer<Void>, Uint64)>>)
+      _setFrameReadyCallback;
+  late final void Function(Pointer<Void>, int) _setMaxFramesInFlight;
+  late final int Function(Pointer<Void>) _getMaxFramesInFlight;
+  late final int Function(Pointer<Void>) _getFramesInFlight;
+  late final int Function() _processEvents;
+  late final Pointer<Void> Function(int w, int h, int count) _createSwapchain;
+  late final int Function(Pointer<Void>) _swapchainGetImageCount;
+  late final int Function(Pointer<Void>) _swapchainAcquireImage;
+  late final Pointer<Void> Function(Pointer<Void>, int) _swapchainGetTexture;
+  late final Pointer<Void> Function(Pointer<Void>, int) _swapchainGetView;
+  late final void Function(Pointer<Void>, int) _swapchainPresentImage;
+  late final void Function(Pointer<Utf8>) _setCacheDirectory;
+  late final void Function(Pointer<Int64>, Pointer<Int64>, Pointer<Int64>)
+      _getBlobCacheStats;
+  late final int Function(int) _completionWatch;
+  late final int Function() _completionThreadRunning;
+  late final void Function(Pointer<Int64>, Pointer<Int64>)
+      _getCompletionStats;
+  late final void Function(
+          Pointer<NativeFunction<Void Function(Uint64, Int32)>>)
+      _setReadbackCallback;
+  late final int Function(Pointer<Void>, int, int, int, int, int,
+      Pointer<Uint64>, Pointer<Uint32>) _readbackBegin;
+  late final int Function(int, Pointer<Uint8>, int) _readbackFinish;
+  late final void Function() _readbackTrim;
+  late final void Function(Pointer<Int64>, Pointer<Int64>, Pointer<Int64>)
+      _getReadbackStats;
+  late final int Function(
+          Pointer<Void>, Pointer<Uint32>, int, Pointer<Pointer<Void>>, int)
+      _executeCommands;
+
+  /// Whether the callbacks of buffer maps, work-done notifications and async
+  /// pipeline creation are driven by the native completion thread. Without
+  /// it, awaiting a readback ticks the device from the isolate until the
+  /// callback arrives.
+  bool useCompletionThread = true;
+
+  // Completers waiting for a texture, keyed by handle address, to be able to
+  // take another frame. Completed by the frame ready callback.
+  final Map<int, List<Completer<void>>> _frameWaiters = {};
+  NativeCallable<Void Function(Pointer<Void>, Uint64)>? _frameReadyCallable;
+  // Texture readbacks waiting for their buffer to map, keyed by id
+  final Map<int, Completer<bool>> _readbackWaiters = {};
+  NativeCallable<Void Function(Uint64, Int32)>? _readbackCallable;
+  // Set when the device has no completion thread, see _tickFrames
+  bool _ticksFrames = false;
+  bool _ticking = false;
 
   // Raw pointer for NativeFinalizer
   late final Pointer<NativeFunction<Void Function(Pointer<Void>)>>
@@ -35,6 +85,8 @@ class WebgpuRend {
       dylib = DynamicLibrary.open('webgpu_rend_plugin.dll');
     } else if (Platform.isAndroid) {
       dylib = DynamicLibrary.open('libwebgpu_rend_android.so');
+    } else if (Platform.isLinux) {
+      dylib = DynamicLibrary.open('libwebgpu_rend_plugin.so');
     } else {
       throw "Unsupported Platform: ${Platform.operatingSystem}";
     }
@@ -73,6 +125,115 @@ class WebgpuRend {
             'webgpu_rend_dispose_texture');
     _disposeTexture = _disposeTexturePtr.asFunction();
 
+    _setFrameReadyCallback = dylib
+        .lookup<
+                NativeFunction<
+                    Void Function(
+                        Pointer<
+                            NativeFunction<
+                                Void Function(Pointer<Void>, Uint64)>>)>>(
+            'webgpu_rend_set_frame_ready_callback')
+        .asFunction();
+    _setMaxFramesInFlight = dylib
+        .lookup<NativeFunction<Void Function(Pointer<Void>, Int32)>>(
+            'webgpu_rend_set_max_frames_in_flight')
+        .asFunction();
+    _getMaxFramesInFlight = dylib
+        .lookup<NativeFunction<Int32 Function(Pointer<Void>)>>(
+            'webgpu_rend_get_max_frames_in_flight')
+        .asFunction();
+    _getFramesInFlight = dylib
+        .lookup<NativeFunction<Int32 Function(Pointer<Void>)>>(
+            'webgpu_rend_get_frames_in_flight')
+        .asFunction();
+    _processEvents = dylib
+        .lookup<NativeFunction<Int32 Function()>>('webgpu_rend_process_events')
+        .asFunction();
+
+    _createSwapchain = dylib
+        .lookup<NativeFunction<Pointer<Void> Function(Int32, Int32, Int32)>>(
+            'webgpu_rend_create_swapchain')
+        .asFunction();
+    _swapchainGetImageCount = dylib
+        .lookup<NativeFunction<Int32 Function(Pointer<Void>)>>(
+            'webgpu_rend_swapchain_get_image_count')
+        .asFunction();
+    _swapchainAcquireImage = dylib
+        .lookup<NativeFunction<Int32 Function(Pointer<Void>)>>(
+            'webgpu_rend_swapchain_acquire_image')
+        .asFunction();
+    _swapchainGetTexture = dylib
+        .lookup<NativeFunction<Pointer<Void> Function(Pointer<Void>, Int32)>>(
+            'webgpu_rend_swapchain_get_wgpu_texture')
+        .asFunction();
+    _swapchainGetView = dylib
+        .lookup<NativeFunction<Pointer<Void> Function(Pointer<Void>, Int32)>>(
+            'webgpu_rend_swapchain_get_wgpu_texture_view')
+        .asFunction();
+    _swapchainPresentImage = dylib
+        .lookup<NativeFunction<Void Function(Pointer<Void>, Int32)>>(
+            'webgpu_rend_swapchain_present_image')
+        .asFunction();
+
+    _setCacheDirectory = dylib
+        .lookup<NativeFunction<Void Function(Pointer<Utf8>)>>(
+            'webgpu_rend_set_cache_directory')
+        .asFunction();
+    _getBlobCacheStats = dylib
+        .lookup<
+                NativeFunction<
+                    Void Function(
+                        Pointer<Int64>, Pointer<Int64>, Pointer<Int64>)>>(
+            'webgpu_rend_get_blob_cache_stats')
+        .asFunction();
+    _completionWatch = dylib
+        .lookup<NativeFunction<Int32 Function(Uint64)>>(
+            'webgpu_rend_completion_watch')
+        .asFunction();
+    _completionThreadRunning = dylib
+        .lookup<NativeFunction<Int32 Function()>>(
+            'webgpu_rend_completion_thread_running')
+        .asFunction();
+    _getCompletionStats = dylib
+        .lookup<NativeFunction<Void Function(Pointer<Int64>, Pointer<Int64>)>>(
+            'webgpu_rend_get_completion_stats')
+        .asFunction();
+    _setReadbackCallback = dylib
+        .lookup<
+                NativeFunction<
+                    Void Function(
+                        Pointer<NativeFunction<Void Function(Uint64, Int32)>>)>>(
+            'webgpu_rend_set_readback_callback')
+        .asFunction();
+    _readbackBegin = dylib
+        .lookup<
+            NativeFunction<
+                Uint64 Function(Pointer<Void>, Uint32, Uint32, Uint32, Uint32,
+                    Uint32, Pointer<Uint64>, Pointer<Uint32>)>>(
+            'webgpu_rend_readback_begin')
+        .asFunction();
+    _readbackFinish = dylib
+        .lookup<NativeFunction<Int64 Function(Uint64, Pointer<Uint8>, Uint32)>>(
+            'webgpu_rend_readback_finish')
+        .asFunction();
+    _readbackTrim = dylib
+        .lookup<NativeFunction<Void Function()>>('webgpu_rend_readback_trim')
+        .asFunction();
+    _getReadbackStats = dylib
+        .lookup<
+                NativeFunction<
+                    Void Function(
+                        Pointer<Int64>, Pointer<Int64>, Pointer<Int64>)>>(
+            'webgpu_rend_get_readback_stats')
+        .asFunction();
+    _executeCommands = dylib
+        .lookup<
+            NativeFunction<
+                Int64 Function(Pointer<Void>, Pointer<Uint32>, Int64,
+                    Pointer<Pointer<Void>>, Int64)>>(
+            'webgpu_rend_execute_commands')
+        .asFunction();
+
     _init = dylib
         .lookup<NativeFunction<Pointer<Void> Function(Pointer<Void>)>>(
             'webgpu_rend_init')
@@ -94,10 +255,70 @@ class WebgpuRend {
     return ptr.cast();
   }
 
-  Future<void> initialize() async {
+  /// With a [cacheDirectory], compiled shaders and pipelines are kept there
+  /// and reused by later runs, which mostly skips shader compilation on
+  /// startup. Use an app-private directory, for example from
+  /// path_provider's getApplicationSupportDirectory.
+  Future<void> initialize({String? cacheDirectory}) async {
+    if (cacheDirectory != null) {
+      final pathPtr = cacheDirectory.toNativeUtf8();
+      _setCacheDirectory(pathPtr);
+      malloc.free(pathPtr);
+    }
     final rawDevicePtr = _init(nullptr);
     device = rawDevicePtr.cast();
     queue = wgpu.wgpuDeviceGetQueue(device);
+    _ticksFrames = _completionThreadRunning() == 0;
+
+    _frameReadyCallable ??=
+        NativeCallable<Void Function(Pointer<Void>, Uint64)>.listener(
+            _onFrameReady);
+    _setFrameReadyCallback(_frameReadyCallable!.nativeFunction);
+    _readbackCallable ??=
+        NativeCallable<Void Function(Uint64, Int32)>.listener(_onReadback);
+    _setReadbackCallback(_readbackCallable!.nativeFunction);
+  }
+
+  void _onFrameReady(Pointer<Void> handle, int serial) {
+    final waiters = _frameWaiters.remove(handle.address);
+    if (waiters == null) return;
+    for (final waiter in waiters) {
+      waiter.complete();
+    }
+  }
+
+  void _onReadback(int id, int status) {
+    _readbackWaiters.remove(id)?.complete(status != 0);
+  }
+
+  // The completion thread delivers finished frames through the frame ready
+  // callback. Without it nothing does, so the device is ticked once per
+  // event-loop turn until no frame is left in flight, like _awaitCallback
+  // does for single operations. Windows only hands a frame to Flutter once
+  // it finished, so this has to run after every present.
+  Future<void> _tickFrames() async {
+    if (!_ticksFrames || _ticking) return;
+    _ticking = true;
+    while (_processEvents() > 0) {
+      await Future.delayed(Duration.zero);
+    }
+    _ticking = false;
+  }
+
+  Future<void> readyForNextFrameInternal(Pointer<Void> handle) {
+    if (_getFramesInFlight(handle) < _getMaxFramesInFlight(handle)) {
+      return Future.value();
+    }
+    return frameDoneInternal(handle);
+  }
+
+  // Completes once the GPU finished the next frame of `handle`, or it was
+  // disposed. Only call it while a frame is in flight.
+  Future<void> frameDoneInternal(Pointer<Void> handle) {
+    final completer = Completer<void>();
+    _frameWaiters.putIfAbsent(handle.address, () => []).add(completer);
+    _tickFrames();
+    return completer.future;
   }
 
   Pointer<Void> createTextureInternal(int w, int h) => _createTexture(w, h);
@@ -108,8 +329,104 @@ class WebgpuRend {
       _getWgpuTexture(handle);
   void beginAccessInternal(Pointer<Void> handle) => _beginAccess(handle);
   void endAccessInternal(Pointer<Void> handle) => _endAccess(handle);
-  void presentInternal(Pointer<Void> handle) => _present(handle);
-  void disposeTextureInternal(Pointer<Void> handle) => _disposeTexture(handle);
+  void presentInternal(Pointer<Void> handle) {
+    _present(handle);
+    _tickFrames();
+  }
+
+  void disposeTextureInternal(Pointer<Void> handle) {
+    _disposeTexture(handle);
+    // Nothing will complete for this texture anymore
+    _onFrameReady(handle, 0);
+  }
+
+  int getFramesInFlightInternal(Pointer<Void> handle) =>
+      _getFramesInFlight(handle);
+  int getMaxFramesInFlightInternal(Pointer<Void> handle) =>
+      _getMaxFramesInFlight(handle);
+  void setMaxFramesInFlightInternal(Pointer<Void> handle, int count) =>
+      _setMaxFramesInFlight(handle, count);
+  int processEventsInternal() => _processEvents();
+
+  Pointer<Void> createSwapchainInternal(int w, int h, int count) =>
+      _createSwapchain(w, h, count);
+  int swapchainGetImageCountInternal(Pointer<Void> handle) =>
+      _swapchainGetImageCount(handle);
+  int swapchainAcquireImageInternal(Pointer<Void> handle) =>
+      _swapchainAcquireImage(handle);
+  Pointer<Void> swapchainGetTextureInternal(Pointer<Void> handle, int image) =>
+      _swapchainGetTexture(handle, image);
+  Pointer<Void> swapchainGetViewInternal(Pointer<Void> handle, int image) =>
+      _swapchainGetView(handle, image);
+  void swapchainPresentImageInternal(Pointer<Void> handle, int image) {
+    _swapchainPresentImage(handle, image);
+    _tickFrames();
+  }
+
+  /// Hits, misses and stores of the on-disk cache set up by [initialize].
+  ({int hits, int misses, int stores}) get blobCacheStats {
+    return using((arena) {
+      final hits = arena<Int64>();
+      final misses = arena<Int64>();
+      final stores = arena<Int64>();
+      _getBlobCacheStats(hits, misses, stores);
+      return (hits: hits.value, misses: misses.value, stores: stores.value);
+    });
+  }
+
+  /// Operations the completion thread finished and the ones it still waits
+  /// on.
+  ({int completed, int pending}) get completionStats {
+    return using((arena) {
+      final completed = arena<Int64>();
+      final pending = arena<Int64>();
+      _getCompletionStats(completed, pending);
+      return (completed: completed.value, pending: pending.value);
+    });
+  }
+
+  /// Readbacks served from pooled buffers, buffers the readback pool had to
+  /// create and the bytes its idle buffers hold.
+  ({int reused, int created, int pooledBytes}) get readbackStats {
+    return using((arena) {
+      final reused = arena<Int64>();
+      final created = arena<Int64>();
+      final pooledBytes = arena<Int64>();
+      _getReadbackStats(reused, created, pooledBytes);
+      return (
+        reused: reused.value,
+        created: created.value,
+        pooledBytes: pooledBytes.value
+      );
+    });
+  }
+
+  /// Releases the idle buffers of the readback pool, for example after a
+  /// burst of large screenshots.
+  void trimReadbackPool() => _readbackTrim();
+
+  // See webgpu_rend_readback_begin, returns 0 if the region cannot be read
+  int readbackBeginInternal(Pointer<Void> texture, int mipLevel, int x, int y,
+          int width, int height, Pointer<Uint64> futureId,
+          Pointer<Uint32> rowBytes) =>
+      _readbackBegin(
+          texture, mipLevel, x, y, width, height, futureId, rowBytes);
+  // Completes with whether the buffer of readback `id` mapped
+  Completer<bool> readbackCompleterInternal(int id) =>
+      _readbackWaiters[id] = Completer<bool>();
+  int readbackFinishInternal(int id, Pointer<Uint8> dst, int dstRowBytes) =>
+      _readbackFinish(id, dst, dstRowBytes);
+
+  // See webgpu_rend_execute_commands, -1 if the stream is malformed
+  int executeCommandsInternal(Pointer<Void> pass, Pointer<Uint32> words,
+          int wordCount, Pointer<Pointer<Void>> handles, int handleCount) =>
+      _executeCommands(pass, words, wordCount, handles, handleCount);
+
+  // Hands the callback behind `future` to the completion thread. False if
+  // it is off or missing, then the caller has to process events itself.
+  bool watchFutureInternal(WGPUFuture future) =>
+      useCompletionThread && _completionWatch(future.id) != 0;
+
   Pointer<NativeFunction<Void Function(Pointer<Void>)>> get disposeTexturePtr =>
       _disposeTexturePtr;
 }
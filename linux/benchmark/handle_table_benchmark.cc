@@ -0,0 +1,145 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+// Looks up texture handles from several threads at once, comparing the
+// HandleTable the backends use with the std::map and global mutex it
+// replaced. The table should cost the same per lookup whatever the texture
+// and thread counts, the map gets slower with both.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "webgpu_rend_handle_table.h"
+
+using webgpu_rend::HandleTable;
+
+namespace {
+
+struct Texture {
+  int64_t texture_id;
+};
+
+constexpr int kLookupsPerThread = 1 << 20;
+
+// The old backend code: lock, find, read a field
+class MapTable {
+ public:
+  void* Insert(std::unique_ptr<Texture> texture) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    void* handle = texture.get();
+    textures_[handle] = std::move(texture);
+    return handle;
+  }
+
+  int64_t GetTextureId(void* handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = textures_.find(handle);
+    return it != textures_.end() ? it->second->texture_id : -1;
+  }
+
+ private:
+  std::map<void*, std::unique_ptr<Texture>> textures_;
+  std::mutex mutex_;
+};
+
+// Runs `threads` callers doing kLookupsPerThread lookups each over a shuffled
+// handle sequence. Returns core-nanoseconds per lookup: wall time times the
+// cores in use, over all lookups, so a structure that scales stays flat even
+// with more callers than cores.
+template <typename Lookup>
+double Run(int threads, const std::vector<void*>& handles, Lookup lookup) {
+  std::vector<std::vector<void*>> sequences(threads);
+  for (int t = 0; t < threads; t++) {
+    std::mt19937 rng(t + 1);
+    std::uniform_int_distribution<size_t> pick(0, handles.size() - 1);
+    sequences[t].resize(kLookupsPerThread);
+    for (void*& handle : sequences[t]) handle = handles[pick(rng)];
+  }
+
+  std::atomic<int> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<int64_t> sums(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      int64_t sum = 0;
+      for (void* handle : sequences[t]) sum += lookup(handle);
+      sums[t] = sum;
+    });
+  }
+  while (ready.load() != threads) {
+  }
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (std::thread& worker : workers) worker.join();
+  double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  for (int t = 0; t < threads; t++) {
+    if (sums[t] < 0) printf("stale handle looked up\n");
+  }
+  int cores = std::min(threads, (int)std::max(1u, std::thread::hardware_concurrency()));
+  return elapsed * cores / ((double)threads * kLookupsPerThread);
+}
+
+}  // namespace
+
+int main() {
+  // Past the core count too, callers preempted inside the map's lock are
+  // what hurts it most
+  int max_threads = (int)std::max(4u, std::thread::hardware_concurrency());
+  std::vector<int> thread_counts;
+  for (int threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+  thread_counts.push_back(max_threads);
+
+  printf("%8s %8s %12s %12s\n", "textures", "threads", "map ns", "table ns");
+  for (int count : {1, 16, 256, 4096}) {
+    MapTable map;
+    HandleTable<Texture> table;
+    std::vector<void*> map_handles, table_handles;
+    for (int i = 0; i < count; i++) {
+      map_handles.push_back(map.Insert(std::make_unique<Texture>(Texture{i})));
+      table_handles.push_back(webgpu_rend::HandleToPointer(table.Insert(std::make_unique<Texture>(Texture{i}))));
+    }
+    // Churn the table's freelist so handles carry real generations
+    for (int i = 0; i < count; i++) {
+      uint64_t handle = webgpu_rend::HandleFromPointer(table_handles[i]);
+      std::unique_ptr<Texture> texture = table.Remove(handle);
+      table_handles[i] = webgpu_rend::HandleToPointer(table.Insert(std::move(texture)));
+    }
+
+    for (int threads : thread_counts) {
+      double map_ns = Run(threads, map_handles, [&](void* handle) { return map.GetTextureId(handle); });
+      double table_ns = Run(threads, table_handles, [&](void* handle) {
+        auto texture = table.Acquire(webgpu_rend::HandleFromPointer(handle));
+        return texture ? texture->texture_id : -1;
+      });
+      printf("%8d %8d %12.1f %12.1f\n", count, threads, map_ns, table_ns);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,205 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+// Parses a generated OBJ (a grid of quads with normals and a material change
+// every few rows) with the native parser at several thread counts, against a
+// port of the Dart ObjLoader it replaced: split into lines and tokens, parse
+// with strtod, dedup through a map keyed on the face token. Checks every run
+// produces the same mesh as the port.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "webgpu_rend_obj_parser.h"
+
+using webgpu_rend::ObjMesh;
+
+namespace {
+
+constexpr int kGridSize = 700;
+constexpr int kRowsPerMaterial = 50;
+constexpr int kRuns = 3;
+
+std::string GenerateObj() {
+  std::string obj = "# generated\nmtllib grid.mtl\n";
+  char line[128];
+  for (int y = 0; y < kGridSize; y++) {
+    for (int x = 0; x < kGridSize; x++) {
+      float h = static_cast<float>((x * 7 + y * 13) % 101) / 101.0f;
+      snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x / 10.0f, h, y / -10.0f);
+      obj += line;
+      snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", 0.1f * h, 0.99f, -0.1f * h);
+      obj += line;
+    }
+  }
+  for (int y = 0; y + 1 < kGridSize; y++) {
+    if (y % kRowsPerMaterial == 0) {
+      snprintf(line, sizeof(line), "usemtl material_%d\n", y / kRowsPerMaterial);
+      obj += line;
+    }
+    for (int x = 0; x + 1 < kGridSize; x++) {
+      int a = y * kGridSize + x + 1;
+      int b = a + 1;
+      int c = a + kGridSize + 1;
+      int d = a + kGridSize;
+      snprintf(line, sizeof(line), "f %d//%d %d//%d %d//%d %d//%d\n", a, a, b, b, c, c, d, d);
+      obj += line;
+    }
+  }
+  return obj;
+}
+
+std::vector<std::string> SplitWhitespace(const std::string& line) {
+  std::vector<std::string> parts;
+  size_t i = 0;
+  while (i < line.size()) {
+    while (i < line.size() && isspace(static_cast<unsigned char>(line[i]))) i++;
+    size_t start = i;
+    while (i < line.size() && !isspace(static_cast<unsigned char>(line[i]))) i++;
+    if (i > start) parts.push_back(line.substr(start, i - start));
+  }
+  return parts;
+}
+
+// The Dart loader, line by line
+void ParseBaseline(const std::string& obj, ObjMesh* mesh) {
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::unordered_map<std::string, uint32_t> unique;
+  std::string material = "default";
+  uint64_t group_start = 0;
+
+  auto add_corner = [&](const std::string& token) {
+    auto it = unique.find(token);
+    if (it != unique.end()) {
+      mesh->indices.push_back(it->second);
+      return;
+    }
+    uint32_t index = static_cast<uint32_t>(unique.size());
+    unique.emplace(token, index);
+    mesh->indices.push_back(index);
+    size_t slash = token.find('/');
+    long p = strtol(token.c_str(), nullptr, 10) - 1;
+    mesh->vertices.insert(mesh->vertices.end(), &positions[p * 3], &positions[p * 3 + 3]);
+    size_t second = slash == std::string::npos ? slash : token.find('/', slash + 1);
+    if (second != std::string::npos && second + 1 < token.size()) {
+      long n = strtol(token.c_str() + second + 1, nullptr, 10) - 1;
+      mesh->vertices.insert(mesh->vertices.end(), &normals[n * 3], &normals[n * 3 + 3]);
+    } else {
+      mesh->vertices.insert(mesh->vertices.end(), {0.0f, 1.0f, 0.0f});
+    }
+  };
+
+  size_t pos = 0;
+  while (pos < obj.size()) {
+    size_t end = obj.find('\n', pos);
+    if (end == std::string::npos) end = obj.size();
+    std::vector<std::string> parts = SplitWhitespace(obj.substr(pos, end - pos));
+    pos = end + 1;
+    if (parts.empty() || parts[0][0] == '#') continue;
+    if (parts[0] == "v") {
+      for (int i = 1; i <= 3; i++) positions.push_back(strtof(parts[i].c_str(), nullptr));
+    } else if (parts[0] == "vn") {
+      for (int i = 1; i <= 3; i++) normals.push_back(strtof(parts[i].c_str(), nullptr));
+    } else if (parts[0] == "mtllib") {
+      mesh->mtllib = parts[1];
+      mesh->has_mtllib = true;
+    } else if (parts[0] == "usemtl") {
+      if (mesh->indices.size() > group_start) {
+        mesh->groups.push_back({material, group_start, mesh->indices.size() - group_start});
+      }
+      material = parts[1];
+      group_start = mesh->indices.size();
+    } else if (parts[0] == "f") {
+      for (size_t i = 2; i + 1 < parts.size(); i++) {
+        add_corner(parts[1]);
+        add_corner(parts[i]);
+        add_corner(parts[i + 1]);
+      }
+    }
+  }
+  if (mesh->indices.size() > group_start) {
+    mesh->groups.push_back({material, group_start, mesh->indices.size() - group_start});
+  }
+}
+
+bool SameMesh(const ObjMesh& a, const ObjMesh& b) {
+  if (a.vertices != b.vertices || a.indices != b.indices || a.mtllib != b.mtllib ||
+      a.groups.size() != b.groups.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.groups.size(); i++) {
+    if (a.groups[i].material != b.groups[i].material || a.groups[i].index_start != b.groups[i].index_start ||
+        a.groups[i].index_count != b.groups[i].index_count) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Parse>
+double BestMs(Parse parse) {
+  double best = 1e30;
+  for (int run = 0; run < kRuns; run++) {
+    auto start = std::chrono::steady_clock::now();
+    parse();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+}  // namespace
+
+int main() {
+  std::string obj = GenerateObj();
+  printf("%.1f MB of OBJ, %d vertices\n", obj.size() / 1e6, kGridSize * kGridSize);
+
+  ObjMesh reference;
+  double baseline_ms = BestMs([&] {
+    reference.vertices.clear();
+    reference.indices.clear();
+    reference.groups.clear();
+    ParseBaseline(obj, &reference);
+  });
+  printf("%-12s %9.1f ms %8.1f MB/s\n", "baseline", baseline_ms, obj.size() / 1e3 / baseline_ms);
+
+  bool ok = true;
+  uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+  for (uint32_t threads = 1; threads <= std::min(cores, webgpu_rend::kMaxObjParserThreads); threads *= 2) {
+    std::unique_ptr<ObjMesh> mesh;
+    double ms = BestMs([&] {
+      mesh = std::make_unique<ObjMesh>();
+      webgpu_rend::ParseObj(obj.data(), obj.size(), threads, mesh.get());
+    });
+    bool same = mesh->error.empty() && SameMesh(*mesh, reference);
+    char label[32];
+    snprintf(label, sizeof(label), "%u thread%s", threads, threads == 1 ? "" : "s");
+    printf("%-12s %9.1f ms %8.1f MB/s %6.1fx%s\n", label, ms, obj.size() / 1e3 / ms, baseline_ms / ms,
+           same ? "" : "  MISMATCH");
+    ok = ok && same;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+
+#include <flutter_linux/flutter_linux.h>
+
+G_DEFINE_TYPE(FlPixelBufferTexture, fl_pixel_buffer_texture, G_TYPE_OBJECT)
+
+static void fl_pixel_buffer_texture_class_init(FlPixelBufferTextureClass* klass) {}
+
+static void fl_pixel_buffer_texture_init(FlPixelBufferTexture* texture) {}
+
+int64_t fl_texture_get_id(FlTexture* texture) {
+  return (int64_t)(intptr_t)texture;
+}
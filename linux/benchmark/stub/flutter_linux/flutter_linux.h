@@ -0,0 +1,54 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+
+// Just enough of the Flutter Linux embedder for sw_pixel_buffer.cc to build
+// and run without an engine. Layouts match flutter_linux so SwPixelBuffer
+// derives from the stub exactly as it does from the real texture type.
+
+#ifndef BENCHMARK_STUB_FLUTTER_LINUX_H_
+#define BENCHMARK_STUB_FLUTTER_LINUX_H_
+
+#include <cstdint>
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FlTexture FlTexture;
+
+typedef struct _FlPixelBufferTexture {
+  GObject parent_instance;
+} FlPixelBufferTexture;
+
+typedef struct _FlPixelBufferTextureClass {
+  GObjectClass parent_class;
+  gboolean (*copy_pixels)(FlPixelBufferTexture* texture, const uint8_t** buffer, uint32_t* width, uint32_t* height,
+                          GError** error);
+} FlPixelBufferTextureClass;
+
+GType fl_pixel_buffer_texture_get_type();
+
+#define FL_TEXTURE(obj) ((FlTexture*)(obj))
+#define FL_PIXEL_BUFFER_TEXTURE_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS((obj), fl_pixel_buffer_texture_get_type(), FlPixelBufferTextureClass))
+
+// Like the engine, the id is the texture's address.
+int64_t fl_texture_get_id(FlTexture* texture);
+
+G_END_DECLS
+
+#endif //BENCHMARK_STUB_FLUTTER_LINUX_H_
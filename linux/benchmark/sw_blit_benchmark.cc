@@ -0,0 +1,140 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+// Reports throughput of every SwBlitKernels variant the CPU supports, after
+// checking each one against the scalar reference.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "include/webgpu_rend/sw_blit.h"
+
+struct FrameSize {
+  const char* name;
+  int64_t width;
+  int64_t height;
+};
+
+static const FrameSize kFrameSizes[] = {
+    {"720p", 1280, 720},
+    {"1080p", 1920, 1080},
+    {"4k", 3840, 2160},
+};
+
+static const char* kModeNames[SW_BLIT_MODE_COUNT] = {"copy", "swizzle", "premultiply", "blend"};
+
+// Runs `body` until at least 200ms have passed and returns seconds per call.
+template <typename F>
+static double TimeIt(F body) {
+  using Clock = std::chrono::steady_clock;
+  body();  // warm up caches and page in the buffers
+  int64_t iterations = 0;
+  Clock::time_point start = Clock::now();
+  Clock::duration elapsed;
+  do {
+    body();
+    iterations++;
+    elapsed = Clock::now() - start;
+  } while (elapsed < std::chrono::milliseconds(200));
+  return std::chrono::duration<double>(elapsed).count() / iterations;
+}
+
+// Every kernel must match the scalar one bit for bit, including the tails
+// that do not fill a whole vector.
+static bool Verify(const SwBlitKernels* kernels, const std::vector<uint8_t>& src, const std::vector<uint8_t>& dst) {
+  const SwBlitKernels* reference = sw_blit_get_kernels_for(SW_BLIT_ISA_SCALAR);
+  const int64_t counts[] = {1, 3, 7, 15, 16, 17, 33, 1000};
+  for (int64_t count : counts) {
+    for (int mode = 0; mode < SW_BLIT_MODE_COUNT; mode++) {
+      std::vector<uint8_t> expected(dst.begin(), dst.begin() + 4 * count);
+      std::vector<uint8_t> actual = expected;
+      reference->rows[mode](expected.data(), src.data(), count);
+      kernels->rows[mode](actual.data(), src.data(), count);
+      if (expected != actual) {
+        fprintf(stderr, "%s %s differs from scalar for %lld pixels\n", kernels->name, kModeNames[mode], (long long)count);
+        return false;
+      }
+    }
+    std::vector<uint8_t> expected(4 * count), actual(4 * count);
+    reference->fill(expected.data(), 0x80402010u, count);
+    kernels->fill(actual.data(), 0x80402010u, count);
+    if (expected != actual) {
+      fprintf(stderr, "%s fill differs from scalar for %lld pixels\n", kernels->name, (long long)count);
+      return false;
+    }
+    uint32_t step = (uint32_t)(1.37 * 65536);
+    reference->scale(expected.data(), src.data(), count, step / 2, step);
+    kernels->scale(actual.data(), src.data(), count, step / 2, step);
+    if (expected != actual) {
+      fprintf(stderr, "%s scale differs from scalar for %lld pixels\n", kernels->name, (long long)count);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void Report(const char* isa, const char* kernel, const FrameSize& size, double seconds) {
+  double bytes = 4.0 * size.width * size.height;
+  printf("%-8s %-12s %-6s %8.3f ms %8.2f GB/s\n", isa, kernel, size.name, seconds * 1e3, bytes / seconds / 1e9);
+}
+
+int main() {
+  const FrameSize& largest = kFrameSizes[sizeof(kFrameSizes) / sizeof(kFrameSizes[0]) - 1];
+  size_t bytes = 4 * largest.width * largest.height;
+  // Source pixels are valid premultiplied RGBA so blending never saturates.
+  std::vector<uint8_t> src(bytes), dst(bytes), scratch(bytes);
+  std::mt19937 rng(1234);
+  for (size_t i = 0; i < bytes; i += 4) {
+    uint8_t a = rng() & 0xFF;
+    for (int c = 0; c < 3; c++) src[i + c] = a == 0 ? 0 : rng() % (a + 1);
+    src[i + 3] = a;
+    for (int c = 0; c < 4; c++) dst[i + c] = rng() & 0xFF;
+  }
+
+  printf("selected: %s\n", sw_blit_get_kernels()->name);
+  int failures = 0;
+  for (int isa = 0; isa < SW_BLIT_ISA_COUNT; isa++) {
+    const SwBlitKernels* kernels = sw_blit_get_kernels_for((SwBlitIsa)isa);
+    if (kernels == nullptr) continue;
+    if (!Verify(kernels, src, dst)) {
+      failures++;
+      continue;
+    }
+    for (const FrameSize& size : kFrameSizes) {
+      int64_t count = size.width * size.height;
+      for (int mode = 0; mode < SW_BLIT_MODE_COUNT; mode++) {
+        double seconds = TimeIt([&] { kernels->rows[mode](scratch.data(), src.data(), count); });
+        Report(kernels->name, kModeNames[mode], size, seconds);
+      }
+      double seconds = TimeIt([&] { kernels->fill(scratch.data(), 0xFF000000u, count); });
+      Report(kernels->name, "fill", size, seconds);
+      // Upscale from half resolution, one row at a time like draw_scaled
+      uint32_t step = 1 << 15;
+      seconds = TimeIt([&] {
+        for (int64_t y = 0; y < size.height; y++) {
+          kernels->scale(scratch.data() + 4 * y * size.width, src.data() + 4 * (y / 2) * (size.width / 2), size.width,
+                         step / 2, step);
+        }
+      });
+      Report(kernels->name, "scale", size, seconds);
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
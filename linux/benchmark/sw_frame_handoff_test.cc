@@ -0,0 +1,159 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+// Checks the triple buffer handoff SwPixelBuffer uses between the producer
+// and the raster thread. Needs neither GTK nor Flutter. Exits nonzero on the
+// first failure.
+//
+//   sw_frame_handoff_test [stress seconds]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "include/webgpu_rend/sw_frame_handoff.h"
+
+// Pixels per frame, enough that a torn frame shows up as mixed serials
+static const int kFrameWords = 4096;
+
+// back, front and the index in `ready` always name three different frames.
+static bool VerifyIndices(SwFrameHandoff* handoff, const char* step) {
+  int ready = handoff->ready.load() & SW_FRAME_HANDOFF_INDEX_MASK;
+  int seen = (1 << handoff->back) | (1 << handoff->front) | (1 << ready);
+  if (seen != (1 << SW_FRAME_HANDOFF_COUNT) - 1) {
+    fprintf(stderr, "%s: back %d, front %d, ready %d are not distinct\n", step, handoff->back, handoff->front, ready);
+    return false;
+  }
+  return true;
+}
+
+// Single threaded sequences with a known outcome.
+static bool VerifySequence() {
+  SwFrameHandoff handoff;
+  sw_frame_handoff_init(&handoff);
+  if (!VerifyIndices(&handoff, "init")) return false;
+  if (sw_frame_handoff_acquire(&handoff)) {
+    fprintf(stderr, "acquire before any publish got a frame\n");
+    return false;
+  }
+
+  int drawn = handoff.back;
+  if (sw_frame_handoff_publish(&handoff)) {
+    fprintf(stderr, "first publish reported a drop\n");
+    return false;
+  }
+  if (!VerifyIndices(&handoff, "publish")) return false;
+  if (!sw_frame_handoff_acquire(&handoff) || handoff.front != drawn) {
+    fprintf(stderr, "acquire did not pick up the published frame\n");
+    return false;
+  }
+  if (sw_frame_handoff_acquire(&handoff)) {
+    fprintf(stderr, "second acquire got a frame without a publish\n");
+    return false;
+  }
+
+  // Two publishes in a row drop the first, the consumer gets the second.
+  sw_frame_handoff_publish(&handoff);
+  drawn = handoff.back;
+  if (!sw_frame_handoff_publish(&handoff)) {
+    fprintf(stderr, "publish over an unseen frame did not report a drop\n");
+    return false;
+  }
+  if (!VerifyIndices(&handoff, "drop")) return false;
+  if (!sw_frame_handoff_acquire(&handoff) || handoff.front != drawn) {
+    fprintf(stderr, "acquire after a drop did not get the newest frame\n");
+    return false;
+  }
+  return VerifyIndices(&handoff, "acquire");
+}
+
+// The producer stamps every word of its back frame with the publish serial
+// while the consumer keeps acquiring. The consumer must only ever see whole
+// frames, never go back in time, and every publish must be either seen or
+// reported dropped.
+static bool VerifyThreaded(double seconds) {
+  std::vector<std::vector<uint64_t>> frames(SW_FRAME_HANDOFF_COUNT, std::vector<uint64_t>(kFrameWords, 0));
+  SwFrameHandoff handoff;
+  sw_frame_handoff_init(&handoff);
+  std::atomic<bool> done(false);
+  std::atomic<bool> failed(false);
+  uint64_t published = 0;
+  uint64_t dropped = 0;
+
+  std::thread producer([&] {
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end && !failed.load(std::memory_order_relaxed)) {
+      published++;
+      std::vector<uint64_t>& frame = frames[handoff.back];
+      for (uint64_t& word : frame) word = published;
+      if (sw_frame_handoff_publish(&handoff)) dropped++;
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint64_t seen = 0;
+  uint64_t last = 0;
+  auto consume = [&] {
+    if (!sw_frame_handoff_acquire(&handoff)) return true;
+    const std::vector<uint64_t>& frame = frames[handoff.front];
+    uint64_t serial = frame[0];
+    for (int i = 1; i < kFrameWords; i++) {
+      if (frame[i] != serial) {
+        fprintf(stderr, "frame %d is torn: word 0 is from publish %llu, word %d from %llu\n", handoff.front,
+                (unsigned long long)serial, i, (unsigned long long)frame[i]);
+        return false;
+      }
+    }
+    if (serial <= last) {
+      fprintf(stderr, "publish %llu seen after publish %llu\n", (unsigned long long)serial, (unsigned long long)last);
+      return false;
+    }
+    last = serial;
+    seen++;
+    return true;
+  };
+  while (!done.load(std::memory_order_acquire)) {
+    if (!consume()) {
+      failed.store(true);
+      break;
+    }
+  }
+  producer.join();
+  if (failed.load()) return false;
+  // Pick up whatever the producer published last
+  if (!consume()) return false;
+  if (!VerifyIndices(&handoff, "stress")) return false;
+
+  if (last != published || seen + dropped != published) {
+    fprintf(stderr, "published %llu, seen %llu, dropped %llu, last seen %llu\n", (unsigned long long)published,
+            (unsigned long long)seen, (unsigned long long)dropped, (unsigned long long)last);
+    return false;
+  }
+  printf("published %llu, seen %llu, dropped %llu\n", (unsigned long long)published, (unsigned long long)seen,
+         (unsigned long long)dropped);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+  if (!VerifySequence()) return 1;
+  if (!VerifyThreaded(seconds)) return 1;
+  return 0;
+}
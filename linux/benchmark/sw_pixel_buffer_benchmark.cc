@@ -0,0 +1,318 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+
+// Measures the SwPixelBuffer path the plugin drives for every frame and
+// prints the results as one JSON object, so runs can be diffed for
+// regressions. Builds sw_pixel_buffer.cc against the stub FlPixelBufferTexture
+// in stub/, no Flutter engine is needed.
+//
+// Also runs a producer and a consumer thread against one buffer at the same
+// time and fails if the consumer ever sees a torn or out of order frame.
+//
+//   sw_pixel_buffer_benchmark [stress seconds]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <flutter_linux/flutter_linux.h>
+#include <glib.h>
+
+#include "include/webgpu_rend/sw_pixel_buffer.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Runs `body` until at least 200ms have passed and returns nanoseconds per call.
+template <typename F>
+static double TimeIt(F body) {
+  body();  // warm up caches and page in the buffers
+  int64_t iterations = 0;
+  Clock::time_point start = Clock::now();
+  Clock::duration elapsed;
+  do {
+    body();
+    iterations++;
+    elapsed = Clock::now() - start;
+  } while (elapsed < std::chrono::milliseconds(200));
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+// Sorts `samples` in place.
+static void PrintLatency(const char* name, std::vector<double>& samples, bool last) {
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (double sample : samples) total += sample;
+  printf("    \"%s\": {\"samples\": %zu, \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f}%s\n", name,
+         samples.size(), total / samples.size(), samples[samples.size() / 2], samples[samples.size() * 99 / 100],
+         samples.back(), last ? "" : ",");
+}
+
+struct DrawCase {
+  int64_t width;
+  int64_t height;
+  // Destination x, so rows start off a 16 byte boundary unless it is a
+  // multiple of 4.
+  int64_t x;
+  // Bytes the source pointer is moved off its 64 byte aligned allocation.
+  int64_t src_offset;
+};
+
+static const int64_t kFrameWidth = 1920;
+static const int64_t kFrameHeight = 1080;
+
+static const DrawCase kDrawCases[] = {
+    {16, 16, 0, 0},     {16, 16, 1, 4},     {64, 64, 0, 0},      {64, 64, 1, 0},       {64, 64, 3, 4},
+    {256, 256, 0, 0},   {256, 256, 1, 0},   {256, 256, 3, 4},    {1024, 1024, 0, 0},   {1024, 1024, 1, 4},
+    {1920, 64, 0, 0},   {1919, 64, 1, 4},   {1920, 1080, 0, 0},  {1920, 1080, 0, 4},
+};
+
+static void BenchmarkDrawRect(SwPixelBuffer* buffer) {
+  // One spare cache line so every source offset stays in bounds
+  std::vector<uint8_t> storage(4 * kFrameWidth * kFrameHeight + 128);
+  uint8_t* aligned = (uint8_t*)(((uintptr_t)storage.data() + 63) & ~(uintptr_t)63);
+  for (size_t i = 0; i < 4 * kFrameWidth * kFrameHeight; i++) aligned[i] = (uint8_t)(i * 7);
+
+  printf("  \"draw_rect\": [\n");
+  size_t count = sizeof(kDrawCases) / sizeof(kDrawCases[0]);
+  for (size_t i = 0; i < count; i++) {
+    const DrawCase& c = kDrawCases[i];
+    const uint8_t* src = aligned + c.src_offset;
+    double ns = TimeIt([&] { sw_pixel_buffer_draw_rect(buffer, src, c.x, 0, c.width, c.height); });
+    double bytes = 4.0 * c.width * c.height;
+    printf("    {\"width\": %" PRId64 ", \"height\": %" PRId64 ", \"x\": %" PRId64 ", \"src_offset\": %" PRId64
+           ", \"ns\": %.1f, \"gb_per_s\": %.3f}%s\n",
+           c.width, c.height, c.x, c.src_offset, ns, bytes / ns, i + 1 < count ? "," : "");
+  }
+  printf("  ],\n");
+}
+
+// Calls copy_pixels through the class the way the engine does, once right
+// after a publish and once with nothing new to pick up.
+static void BenchmarkCopyPixels(SwPixelBuffer* buffer) {
+  FlPixelBufferTextureClass* klass = FL_PIXEL_BUFFER_TEXTURE_GET_CLASS(buffer);
+  FlPixelBufferTexture* texture = &buffer->parent_instance;
+  const int samples = 100000;
+  std::vector<double> fresh, reused;
+  fresh.reserve(samples);
+  reused.reserve(samples);
+  const uint8_t* pixels;
+  uint32_t width, height;
+  for (int i = 0; i < samples; i++) {
+    sw_pixel_buffer_fill_rect(buffer, (uint32_t)i, 0, 0, 1, 1);
+    sw_pixel_buffer_publish(buffer);
+    Clock::time_point start = Clock::now();
+    klass->copy_pixels(texture, &pixels, &width, &height, nullptr);
+    Clock::time_point middle = Clock::now();
+    klass->copy_pixels(texture, &pixels, &width, &height, nullptr);
+    Clock::time_point end = Clock::now();
+    fresh.push_back(std::chrono::duration<double, std::nano>(middle - start).count());
+    reused.push_back(std::chrono::duration<double, std::nano>(end - middle).count());
+  }
+  // Both include one steady_clock read
+  std::vector<double> clock;
+  clock.reserve(samples);
+  for (int i = 0; i < samples; i++) {
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = Clock::now();
+    clock.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  printf("  \"copy_pixels\": {\n");
+  PrintLatency("fresh", fresh, false);
+  PrintLatency("reused", reused, false);
+  PrintLatency("clock_overhead", clock, true);
+  printf("  },\n");
+}
+
+// Mirrors webgpu_rend_plugin_handle_method_call: the async table is checked
+// first, then `methods`, and the handler looks its texture up by id. The
+// plugin itself needs the engine's method channel, so the tables are rebuilt
+// here with the same names, hash functions and texture table.
+typedef void* (*MethodCallback)(GHashTable* textures, int64_t texture_id);
+
+static void* LookupTexture(GHashTable* textures, int64_t texture_id) {
+  return g_hash_table_lookup(textures, (gpointer)texture_id);
+}
+
+static void* ReadAsync(GHashTable* textures, int64_t texture_id) {
+  return nullptr;
+}
+
+static const char* kMethodNames[] = {"init",         "dispose",    "draw",     "fill",         "invalidate",
+                                     "submit_batch", "get_pixels", "get_size", "list_textures"};
+
+static void BenchmarkDispatch(SwPixelBuffer* buffer) {
+  GHashTable* methods = g_hash_table_new(g_str_hash, g_str_equal);
+  for (const char* name : kMethodNames) {
+    g_hash_table_insert(methods, (gpointer)name, (gpointer)LookupTexture);
+  }
+  GHashTable* async_methods = g_hash_table_new(g_str_hash, g_str_equal);
+  g_hash_table_insert(async_methods, (gpointer) "get_pixels_async", (gpointer)ReadAsync);
+  GHashTable* textures = g_hash_table_new(g_direct_hash, g_direct_equal);
+  int64_t texture_id = sw_pixel_buffer_get_id(buffer);
+  g_hash_table_insert(textures, (gpointer)texture_id, buffer);
+
+  // Method names arrive freshly decoded from the codec, never as the
+  // interned keys
+  std::vector<std::string> names(kMethodNames, kMethodNames + sizeof(kMethodNames) / sizeof(kMethodNames[0]));
+  std::string unknown = "not_a_method";
+  std::atomic<uintptr_t> sink{0};
+  auto dispatch = [&](const char* method) {
+    MethodCallback async_func = (MethodCallback)g_hash_table_lookup(async_methods, method);
+    MethodCallback func = (MethodCallback)g_hash_table_lookup(methods, method);
+    void* result = nullptr;
+    if (async_func != nullptr) {
+      result = async_func(textures, texture_id);
+    } else if (func != nullptr) {
+      result = func(textures, texture_id);
+    }
+    sink.fetch_add((uintptr_t)result, std::memory_order_relaxed);
+  };
+
+  double draw_ns = TimeIt([&] { dispatch(names[2].c_str()); });
+  double mixed_ns = TimeIt([&] {
+                      for (const std::string& name : names) dispatch(name.c_str());
+                    }) /
+                    names.size();
+  double missing_ns = TimeIt([&] { dispatch(unknown.c_str()); });
+  printf("  \"dispatch\": {\"draw_ns\": %.1f, \"all_methods_ns\": %.1f, \"not_implemented_ns\": %.1f},\n", draw_ns,
+         mixed_ns, missing_ns);
+
+  g_hash_table_destroy(textures);
+  g_hash_table_destroy(async_methods);
+  g_hash_table_destroy(methods);
+}
+
+// sw_pixel_buffer_new against the g_new0 calls it makes for its frames. Large
+// allocations come straight from mmap, so the first draw also pays for
+// faulting the pages in.
+static void BenchmarkInit() {
+  static const int64_t sizes[][2] = {{64, 64}, {256, 256}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+  size_t count = sizeof(sizes) / sizeof(sizes[0]);
+  printf("  \"init\": [\n");
+  for (size_t i = 0; i < count; i++) {
+    int64_t width = sizes[i][0], height = sizes[i][1];
+    double new_ns = TimeIt([&] { sw_pixel_buffer_dispose(sw_pixel_buffer_new(width, height)); });
+    double g_new0_ns = TimeIt([&] {
+      uint8_t* frames[SW_PIXEL_BUFFER_FRAME_COUNT];
+      for (uint8_t*& frame : frames) frame = g_new0(uint8_t, width * height * 4);
+      for (uint8_t* frame : frames) g_free(frame);
+    });
+    double first_fill_ns = TimeIt([&] {
+      SwPixelBuffer* buffer = sw_pixel_buffer_new(width, height);
+      sw_pixel_buffer_fill_rect(buffer, 0xFF000000u, 0, 0, width, height);
+      sw_pixel_buffer_dispose(buffer);
+    });
+    printf("    {\"width\": %" PRId64 ", \"height\": %" PRId64
+           ", \"new_ns\": %.1f, \"g_new0_ns\": %.1f, \"new_and_first_fill_ns\": %.1f}%s\n",
+           width, height, new_ns, g_new0_ns, first_fill_ns, i + 1 < count ? "," : "");
+  }
+  printf("  ],\n");
+}
+
+// The producer fills one of kStressBands horizontal bands per frame with the
+// frame number, so every other band has to be carried over from earlier
+// frames by the damage catch-up. Given the newest frame number F found in a
+// frame, the consumer knows exactly what each band must hold.
+static const int64_t kStressSize = 256;
+static const int kStressBands = 4;
+
+static uint32_t ExpectedBand(uint32_t frame, int band) {
+  uint32_t age = (uint32_t)((frame % kStressBands + kStressBands - band) % kStressBands);
+  return frame > age ? frame - age : 0;
+}
+
+static bool StressTest(double seconds) {
+  SwPixelBuffer* buffer = sw_pixel_buffer_new(kStressSize, kStressSize);
+  FlPixelBufferTextureClass* klass = FL_PIXEL_BUFFER_TEXTURE_GET_CLASS(buffer);
+  const int64_t band_height = kStressSize / kStressBands;
+  std::atomic<bool> done{false};
+
+  std::thread producer([&] {
+    for (uint32_t frame = 1; !done.load(std::memory_order_relaxed); frame++) {
+      int band = frame % kStressBands;
+      sw_pixel_buffer_fill_rect(buffer, frame, 0, band * band_height, kStressSize, band_height);
+      sw_pixel_buffer_publish(buffer);
+    }
+  });
+
+  uint64_t consumed = 0, torn = 0, regressed = 0;
+  uint32_t last_frame = 0;
+  Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+  while (Clock::now() < end) {
+    const uint8_t* pixels;
+    uint32_t width, height;
+    klass->copy_pixels(&buffer->parent_instance, &pixels, &width, &height, nullptr);
+    consumed++;
+    const uint32_t* words = (const uint32_t*)pixels;
+    uint32_t frame = 0;
+    for (int band = 0; band < kStressBands; band++) {
+      frame = std::max(frame, words[band * band_height * kStressSize]);
+    }
+    if (frame < last_frame) regressed++;
+    last_frame = frame;
+    bool ok = true;
+    for (int band = 0; band < kStressBands && ok; band++) {
+      uint32_t expected = ExpectedBand(frame, band);
+      const uint32_t* row = words + band * band_height * kStressSize;
+      for (int64_t i = 0; i < band_height * kStressSize; i++) {
+        if (row[i] != expected) {
+          ok = false;
+          break;
+        }
+      }
+    }
+    if (!ok) torn++;
+  }
+  done.store(true);
+  producer.join();
+
+  printf("  \"stress\": {\"seconds\": %.2f, \"published\": %" PRIu64 ", \"consumed\": %" PRIu64
+         ", \"dropped\": %" PRIu64 ", \"reused\": %" PRIu64 ", \"torn\": %" PRIu64 ", \"out_of_order\": %" PRIu64 "}\n",
+         seconds, buffer->published_frames.load(), consumed, buffer->dropped_frames.load(),
+         buffer->reused_frames.load(), torn, regressed);
+  sw_pixel_buffer_dispose(buffer);
+  return torn == 0 && regressed == 0;
+}
+
+// SwPixelBuffer logs on dispose, which would end up in the JSON
+static void DiscardPrint(const gchar* message) {}
+
+int main(int argc, char** argv) {
+  double stress_seconds = argc > 1 ? atof(argv[1]) : 2.0;
+  g_set_print_handler(DiscardPrint);
+
+  printf("{\n");
+  printf("  \"blit_kernels\": \"%s\",\n", sw_blit_get_kernels()->name);
+  printf("  \"frame\": {\"width\": %" PRId64 ", \"height\": %" PRId64 "},\n", kFrameWidth, kFrameHeight);
+  SwPixelBuffer* buffer = sw_pixel_buffer_new(kFrameWidth, kFrameHeight);
+  BenchmarkDrawRect(buffer);
+  BenchmarkCopyPixels(buffer);
+  BenchmarkDispatch(buffer);
+  sw_pixel_buffer_dispose(buffer);
+  BenchmarkInit();
+  bool ok = StressTest(stress_seconds);
+  printf("}\n");
+  return ok ? 0 : 1;
+}
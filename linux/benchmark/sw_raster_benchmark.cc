@@ -0,0 +1,122 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+// Renders a field of lit spheres at 1080p with growing worker counts, to show
+// how the tiled rasterizer scales with cores.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "include/webgpu_rend/sw_rasterizer.h"
+
+// UV sphere in the interleaved position/normal layout ObjLoader produces
+static void AddSphere(std::vector<float>& vertices, std::vector<uint32_t>& indices, float cx, float cy, float cz, float radius, int segments) {
+  uint32_t base = (uint32_t)(vertices.size() / 6);
+  for (int ring = 0; ring <= segments; ring++) {
+    float theta = (float)M_PI * ring / segments;
+    for (int seg = 0; seg <= segments; seg++) {
+      float phi = 2.0f * (float)M_PI * seg / segments;
+      float nx = std::sin(theta) * std::cos(phi);
+      float ny = std::cos(theta);
+      float nz = std::sin(theta) * std::sin(phi);
+      vertices.insert(vertices.end(), {cx + radius * nx, cy + radius * ny, cz + radius * nz, nx, ny, nz});
+    }
+  }
+  for (int ring = 0; ring < segments; ring++) {
+    for (int seg = 0; seg < segments; seg++) {
+      uint32_t a = base + ring * (segments + 1) + seg;
+      uint32_t b = a + segments + 1;
+      indices.insert(indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+    }
+  }
+}
+
+// Column-major perspective for WebGPU's 0..1 depth range, looking down -z
+static void Perspective(float* m, float fov_y, float aspect, float near, float far) {
+  float f = 1.0f / std::tan(fov_y / 2);
+  for (int i = 0; i < 16; i++) m[i] = 0;
+  m[0] = f / aspect;
+  m[5] = f;
+  m[10] = far / (near - far);
+  m[11] = -1;
+  m[14] = near * far / (near - far);
+}
+
+int main(int argc, char** argv) {
+  const int32_t width = 1920, height = 1080;
+  std::vector<float> vertices;
+  std::vector<uint32_t> indices;
+  for (int y = -4; y <= 4; y++) {
+    for (int x = -7; x <= 7; x++) {
+      AddSphere(vertices, indices, x * 1.1f, y * 1.1f, -12.0f, 0.5f, 48);
+    }
+  }
+
+  std::vector<uint8_t> pixels(4 * width * height);
+  std::vector<float> depth(width * height);
+  SwRasterTarget target = {pixels.data(), 4 * width, depth.data(), width, height};
+
+  SwMeshDraw draw = {};
+  draw.vertices = vertices.data();
+  draw.vertex_count = (int64_t)(vertices.size() / 6);
+  draw.indices = indices.data();
+  draw.index_count = (int64_t)indices.size();
+  Perspective(draw.mvp, 0.9f, (float)width / height, 0.1f, 100.0f);
+  draw.color = 0xFF3080E0u;
+  draw.light_dir[0] = draw.light_dir[1] = draw.light_dir[2] = 0.57735027f;
+  draw.ambient = 0.3f;
+  draw.cull_mode = SW_CULL_BACK;
+  int64_t triangles = draw.index_count / 3;
+  printf("%lld triangles at %dx%d\n", (long long)triangles, width, height);
+
+  // Defaults to the core count, pass a number to try oversubscribing
+  int cores = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+  double single = 0;
+  for (int threads = 1; threads <= cores; threads = threads * 2 > cores && threads < cores ? cores : threads * 2) {
+    SwThreadPool* pool = sw_thread_pool_new(threads);
+    SwRasterizer* rasterizer = sw_rasterizer_new(pool);
+    using Clock = std::chrono::steady_clock;
+    int frames = 0;
+    Clock::time_point start = Clock::now();
+    Clock::duration elapsed;
+    do {
+      sw_rasterizer_clear(rasterizer, &target, 0xFF000000u, 1.0f);
+      sw_rasterizer_draw(rasterizer, &target, &draw);
+      frames++;
+      elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(500) || frames < 3);
+    double ms = std::chrono::duration<double, std::milli>(elapsed).count() / frames;
+    if (threads == 1) single = ms;
+    printf("%3d threads %8.2f ms/frame %8.1f Mtri/s %6.2fx\n", threads, ms, triangles / ms / 1e3, single / ms);
+    if (threads == cores && argc > 2) {
+      // Second argument dumps the last frame as a PPM, for eyeballing
+      FILE* file = fopen(argv[2], "wb");
+      if (file != nullptr) {
+        fprintf(file, "P6 %d %d 255\n", width, height);
+        for (int64_t i = 0; i < (int64_t)width * height; i++) fwrite(&pixels[4 * i], 1, 3, file);
+        fclose(file);
+      }
+    }
+    sw_rasterizer_free(rasterizer);
+    sw_thread_pool_free(pool);
+  }
+  return 0;
+}
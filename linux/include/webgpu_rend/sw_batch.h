@@ -0,0 +1,64 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef INCLUDE_SW_BATCH_H_
+#define INCLUDE_SW_BATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sw_pixel_buffer.h"
+
+// Decoder for the "submit_batch" method, which runs many draws across many
+// textures in a single platform channel message.
+//
+// A batch is a sequence of little-endian records, each starting with
+//   uint32 opcode, uint32 payload_size
+// followed by payload_size bytes. payload_size is always a multiple of 4, so
+// every record starts 4-byte aligned. Records with an unknown opcode are
+// skipped. Colors are 0xAARRGGBB, modes are SwBlitMode.
+typedef enum {
+  // int64 texture, int32 x, y, width, height, src_width, src_height, mode,
+  // then src_width * src_height RGBA pixels. The source is stretched to the
+  // destination rect when the sizes differ.
+  SW_BATCH_DRAW = 1,
+  // int64 texture, int32 x, y, width, height, uint32 color
+  SW_BATCH_FILL = 2,
+  // int64 src_texture, int64 dst_texture, int32 src_x, src_y, dst_x, dst_y,
+  // width, height, mode. Reads the newest contents of the source, which may be
+  // the destination itself.
+  SW_BATCH_COPY = 3,
+  // int64 texture. Invalidates are collected and applied once per texture
+  // after the whole batch ran.
+  SW_BATCH_INVALIDATE = 4,
+} SwBatchOpcode;
+
+typedef SwPixelBuffer* (*SwBatchLookup)(void* user_data, int64_t texture_id);
+
+typedef struct {
+  // Records run, including skipped unknown ones
+  int32_t executed;
+  // nullptr on success, otherwise why record `executed` was rejected
+  const char* error;
+} SwBatchResult;
+
+// Runs every record in order, stopping at the first malformed one. Textures
+// to invalidate are appended, once each, to `invalidated`, including those
+// requested before a failure.
+bool sw_batch_execute(const uint8_t* commands, size_t length, SwBatchLookup lookup, void* user_data,
+                      GPtrArray* invalidated, SwBatchResult* result);
+
+#endif //INCLUDE_SW_BATCH_H_
@@ -0,0 +1,76 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef INCLUDE_SW_BLIT_H_
+#define INCLUDE_SW_BLIT_H_
+
+#include <cstdint>
+#include <cstring>
+
+// Row kernels for SwPixelBuffer. Every kernel works on `count` 4-byte pixels
+// and exists in a scalar version and, where the target has them, SSE4.1, AVX2
+// and NEON versions. All versions produce bit-identical results.
+//
+// Blending uses premultiplied alpha, as FlPixelBufferTexture expects, and
+// divides by 255 with exact rounding.
+
+typedef enum {
+  // dst = src
+  SW_BLIT_COPY = 0,
+  // dst = src with the R and B channels swapped (BGRA source)
+  SW_BLIT_SWIZZLE,
+  // dst = src with color channels multiplied by alpha (straight alpha source)
+  SW_BLIT_PREMULTIPLY,
+  // dst = src + dst * (1 - src.a) (premultiplied source over)
+  SW_BLIT_BLEND,
+  SW_BLIT_MODE_COUNT,
+} SwBlitMode;
+
+typedef enum {
+  SW_BLIT_ISA_SCALAR = 0,
+  SW_BLIT_ISA_SSE41,
+  SW_BLIT_ISA_AVX2,
+  SW_BLIT_ISA_NEON,
+  SW_BLIT_ISA_COUNT,
+} SwBlitIsa;
+
+typedef void (*SwBlitRowFunc)(uint8_t* dst, const uint8_t* src, int64_t count);
+
+typedef struct {
+  const char* name;
+  SwBlitRowFunc rows[SW_BLIT_MODE_COUNT];
+  // Writes `color` (RGBA, in memory order) `count` times.
+  void (*fill)(uint8_t* dst, uint32_t color, int64_t count);
+  // Nearest neighbour resample: dst[i] = src[(x0 + i * step) >> 16].
+  void (*scale)(uint8_t* dst, const uint8_t* src, int64_t count, uint32_t x0, uint32_t step);
+} SwBlitKernels;
+
+// Colors come from Dart as 0xAARRGGBB like dart:ui Color, kernels take RGBA
+// bytes packed in memory order.
+static inline uint32_t sw_blit_argb_to_rgba(uint32_t argb) {
+  uint8_t rgba[4] = {(uint8_t)(argb >> 16), (uint8_t)(argb >> 8), (uint8_t)argb, (uint8_t)(argb >> 24)};
+  uint32_t color;
+  memcpy(&color, rgba, 4);
+  return color;
+}
+
+// Best kernels for the CPU this is running on, picked once on first use.
+const SwBlitKernels* sw_blit_get_kernels();
+// Kernels for a specific instruction set, or nullptr if this build or CPU
+// does not support it.
+const SwBlitKernels* sw_blit_get_kernels_for(SwBlitIsa isa);
+
+#endif //INCLUDE_SW_BLIT_H_
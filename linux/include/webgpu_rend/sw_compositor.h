@@ -0,0 +1,84 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+
+#ifndef INCLUDE_SW_COMPOSITOR_H_
+#define INCLUDE_SW_COMPOSITOR_H_
+
+#include <cstdint>
+
+#include "sw_damage_region.h"
+#include "sw_thread_pool.h"
+
+// Stack of software layers flattened into one frame, so an overlay UI needs a
+// single Flutter texture instead of one per layer. Each layer owns its pixels
+// (premultiplied RGBA, tightly packed) and has an offset, opacity, blend mode
+// and z-order.
+//
+// Changes are tracked as damage in frame coordinates. sw_compositor_compose
+// only redraws the damaged rects, from every layer that overlaps them, and
+// splits the work into horizontal bands across the pool.
+
+typedef enum {
+  // Premultiplied source-over
+  SW_LAYER_BLEND_OVER = 0,
+  // Replaces whatever is below
+  SW_LAYER_BLEND_SOURCE,
+  // Saturating sum, for glows and highlights
+  SW_LAYER_BLEND_ADD,
+  // Premultiplied multiply: src * dst + src * (1 - dst.a) + dst * (1 - src.a)
+  SW_LAYER_BLEND_MULTIPLY,
+  SW_LAYER_BLEND_COUNT,
+} SwLayerBlend;
+
+typedef struct {
+  // Position of the layer's top left pixel in the frame, may be negative
+  int32_t x;
+  int32_t y;
+  // 0 hides the layer, 255 draws it as is
+  uint8_t opacity;
+  SwLayerBlend blend;
+  bool visible;
+  // Higher is drawn later. Layers with the same z keep creation order.
+  int32_t z;
+} SwLayerProperties;
+
+typedef struct _SwCompositor SwCompositor;
+
+// The pool is borrowed and must outlive the compositor.
+SwCompositor* sw_compositor_new(SwThreadPool* pool, int32_t width, int32_t height);
+void sw_compositor_free(SwCompositor* compositor);
+// Returns a positive layer id, or -1 if the size is invalid. New layers are
+// transparent, at the origin, fully opaque, OVER and at z 0, above every
+// existing layer with the same z.
+int32_t sw_compositor_add_layer(SwCompositor* compositor, int32_t width, int32_t height);
+void sw_compositor_remove_layer(SwCompositor* compositor, int32_t layer);
+// Stable until the layer is removed. Nothing written here shows up until it
+// is marked with sw_compositor_mark_dirty.
+uint8_t* sw_compositor_get_layer_pixels(SwCompositor* compositor, int32_t layer);
+bool sw_compositor_get_layer_properties(SwCompositor* compositor, int32_t layer, SwLayerProperties* properties);
+// Damages both where the layer was and where it ends up, if anything changed.
+bool sw_compositor_set_layer_properties(SwCompositor* compositor, int32_t layer, const SwLayerProperties* properties);
+// Marks a rect in layer coordinates as changed. A non-positive width or height
+// marks the whole layer.
+void sw_compositor_mark_dirty(SwCompositor* compositor, int32_t layer, int32_t x, int32_t y, int32_t width, int32_t height);
+// Redraws the damaged parts of the frame, starting from `background` (RGBA in
+// memory order, premultiplied). `pixels` must hold what the last compose
+// produced outside of the damage. Returns the rects that were redrawn, empty
+// if nothing changed, and clears the damage.
+SwDamageRegion sw_compositor_compose(SwCompositor* compositor, uint8_t* pixels, int64_t stride, uint32_t background);
+
+#endif //INCLUDE_SW_COMPOSITOR_H_
@@ -0,0 +1,46 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef INCLUDE_SW_DAMAGE_REGION_H_
+#define INCLUDE_SW_DAMAGE_REGION_H_
+
+#include <cstdint>
+
+typedef struct {
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+} SwRect;
+
+// Upper bound on rects kept per region. Past this, the two rects whose union
+// wastes the least area are merged, so a region never costs more than a few
+// row copies no matter how many small draws went into it.
+#define SW_DAMAGE_MAX_RECTS 8
+
+typedef struct {
+  SwRect rects[SW_DAMAGE_MAX_RECTS];
+  int count;
+} SwDamageRegion;
+
+void sw_damage_region_clear(SwDamageRegion* region);
+// Adds a rect, clipped to a bounds_width x bounds_height surface.
+void sw_damage_region_add(SwDamageRegion* region, SwRect rect, int32_t bounds_width, int32_t bounds_height);
+void sw_damage_region_add_region(SwDamageRegion* region, const SwDamageRegion* other, int32_t bounds_width, int32_t bounds_height);
+bool sw_damage_region_covers(const SwDamageRegion* region, int32_t bounds_width, int32_t bounds_height);
+int64_t sw_damage_region_area(const SwDamageRegion* region);
+
+#endif //INCLUDE_SW_DAMAGE_REGION_H_
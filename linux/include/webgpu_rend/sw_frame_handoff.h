@@ -0,0 +1,62 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef INCLUDE_SW_FRAME_HANDOFF_H_
+#define INCLUDE_SW_FRAME_HANDOFF_H_
+
+#include <atomic>
+
+// Lock-free triple buffer index exchange. The producer owns `back`, the
+// consumer owns `front`, and the two trade frames through `ready`, so the
+// consumer never reads a frame that is still being drawn. Kept apart from
+// SwPixelBuffer so it can be tested without GTK.
+#define SW_FRAME_HANDOFF_COUNT 3
+// Set on `ready` when it holds a frame the consumer has not picked up yet.
+#define SW_FRAME_HANDOFF_FRESH 0x4
+#define SW_FRAME_HANDOFF_INDEX_MASK 0x3
+
+typedef struct {
+  int back;
+  int front;
+  std::atomic<int> ready;
+} SwFrameHandoff;
+
+inline void sw_frame_handoff_init(SwFrameHandoff* handoff) {
+  handoff->back = 0;
+  handoff->ready.store(1);
+  handoff->front = 2;
+}
+
+// Producer side. Hands `back` to the consumer and takes the free frame in its
+// place. Returns true if the frame it replaced was never picked up.
+inline bool sw_frame_handoff_publish(SwFrameHandoff* handoff) {
+  int ready = handoff->ready.exchange(handoff->back | SW_FRAME_HANDOFF_FRESH, std::memory_order_acq_rel);
+  handoff->back = ready & SW_FRAME_HANDOFF_INDEX_MASK;
+  return (ready & SW_FRAME_HANDOFF_FRESH) != 0;
+}
+
+// Consumer side. Swaps `front` for the newest published frame. Returns false,
+// leaving `front` alone, if nothing was published since the last call.
+inline bool sw_frame_handoff_acquire(SwFrameHandoff* handoff) {
+  if (!(handoff->ready.load(std::memory_order_relaxed) & SW_FRAME_HANDOFF_FRESH)) return false;
+  // If the producer published again since the load above we simply get that
+  // frame instead.
+  int ready = handoff->ready.exchange(handoff->front, std::memory_order_acq_rel);
+  handoff->front = ready & SW_FRAME_HANDOFF_INDEX_MASK;
+  return true;
+}
+
+#endif //INCLUDE_SW_FRAME_HANDOFF_H_
@@ -0,0 +1,113 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef INCLUDE_SW_PIXEL_BUFFER_H_
+#define INCLUDE_SW_PIXEL_BUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+#include "sw_blit.h"
+#include "sw_compositor.h"
+#include "sw_damage_region.h"
+#include "sw_frame_handoff.h"
+
+// Frames are triple buffered so the raster thread never reads a frame that is
+// still being drawn. The producer (draw_rect/publish) owns `handoff.back` and
+// the raster thread (copy_pixels) owns `handoff.front`, see sw_frame_handoff.h.
+#define SW_PIXEL_BUFFER_FRAME_COUNT SW_FRAME_HANDOFF_COUNT
+// Number of past publishes whose damage is remembered. A back frame older
+// than this is brought up to date with a full copy instead.
+#define SW_PIXEL_BUFFER_DAMAGE_HISTORY 4
+
+typedef struct _SwPixelBuffer { // extends FlPixelBufferTexture
+  FlPixelBufferTexture parent_instance;
+  uint8_t* frames[SW_PIXEL_BUFFER_FRAME_COUNT];
+  // Always frames[handoff.back], the frame currently being drawn.
+  uint8_t* buffer;
+  SwFrameHandoff handoff;
+  // Most recently published frame, and whether `buffer` still has to be
+  // brought up to date with it before it can be drawn into.
+  int latest;
+  gboolean back_stale;
+  // Damage drawn into the back frame since the last publish.
+  SwDamageRegion damage;
+  // Damage of each publish, indexed by publish serial. frame_serial records
+  // the publish each frame last took part in, so the rows a stale back frame
+  // is missing are the union of everything published after it.
+  SwDamageRegion damage_history[SW_PIXEL_BUFFER_DAMAGE_HISTORY];
+  uint64_t publish_serial;
+  uint64_t frame_serial[SW_PIXEL_BUFFER_FRAME_COUNT];
+  int64_t width;
+  int64_t height;
+  // Depth for sw_rasterizer, allocated by the first 3D draw. Shared by all
+  // frames, since every frame is drawn on top of the previous one.
+  float* depth;
+  // Layer stack, created by the first layer added. Composed into the back
+  // frame by the plugin, see sw_compositor.h.
+  SwCompositor* compositor;
+  // Frames published before the raster thread saw the previous one.
+  std::atomic<uint64_t> dropped_frames;
+  // copy_pixels calls that had no new frame and handed out the old one.
+  std::atomic<uint64_t> reused_frames;
+  std::atomic<uint64_t> published_frames;
+} SwPixelBuffer;
+
+typedef struct { // extends FlPixelBufferTextureClass
+  FlPixelBufferTextureClass parent_class;
+} SwPixelBufferClass;
+
+SwPixelBuffer* sw_pixel_buffer_new(int64_t width, int64_t height);
+void sw_pixel_buffer_dispose(SwPixelBuffer* buffer);
+void sw_pixel_buffer_draw_rect(SwPixelBuffer* buffer, const uint8_t* pixels, int64_t x, int64_t y, int64_t width, int64_t height);
+// Same as sw_pixel_buffer_draw_rect, but source rows are `stride` bytes apart
+// (e.g. a GPU readback buffer padded to 256 bytes per row).
+void sw_pixel_buffer_draw_rect_strided(SwPixelBuffer* buffer, const uint8_t* pixels, int64_t stride, int64_t x, int64_t y, int64_t width, int64_t height);
+// Draws through one of the blit kernels, see SwBlitMode. Rects are clipped to
+// the frame.
+void sw_pixel_buffer_draw_rect_mode(SwPixelBuffer* buffer, const uint8_t* pixels, int64_t stride, int64_t x, int64_t y, int64_t width, int64_t height, SwBlitMode mode);
+// Draws a src_width x src_height image stretched to fill the destination rect,
+// sampling the nearest source pixel. Sources wider or taller than 65535 pixels
+// are rejected.
+void sw_pixel_buffer_draw_scaled(SwPixelBuffer* buffer, const uint8_t* pixels, int64_t stride, int64_t src_width, int64_t src_height, int64_t x, int64_t y, int64_t width, int64_t height, SwBlitMode mode);
+// Fills a rect with a single RGBA color, given in memory order.
+void sw_pixel_buffer_fill_rect(SwPixelBuffer* buffer, uint32_t color, int64_t x, int64_t y, int64_t width, int64_t height);
+// Marks a rect of the back frame as changed. draw_rect does this itself, it is
+// only needed for pixels written through sw_pixel_buffer_begin_frame.
+void sw_pixel_buffer_add_damage(SwPixelBuffer* buffer, int64_t x, int64_t y, int64_t width, int64_t height);
+// Hands the frame drawn so far to the raster thread. If no damage was
+// recorded the whole frame is assumed to have changed. Drawing continues on top
+// of the published contents. Producer calls must not race each other, but may
+// run concurrently with copy_pixels.
+void sw_pixel_buffer_publish(SwPixelBuffer* buffer);
+// Returns the frame being drawn, up to date with the last publish, for
+// callers that write pixels directly. The pointer changes on every publish.
+uint8_t* sw_pixel_buffer_begin_frame(SwPixelBuffer* buffer);
+// Damage of the most recently published frame.
+const SwDamageRegion* sw_pixel_buffer_get_damage(SwPixelBuffer* buffer);
+// Newest complete contents from the producer's point of view, i.e. the frame
+// being drawn or, if nothing was drawn since the last publish, that frame.
+const uint8_t* sw_pixel_buffer_peek(SwPixelBuffer* buffer);
+
+// Only valid once the buffer has been registered with a texture registrar.
+inline int64_t sw_pixel_buffer_get_id(SwPixelBuffer* buffer) {
+  return fl_texture_get_id(FL_TEXTURE(buffer));
+}
+
+#endif //INCLUDE_SW_PIXEL_BUFFER_H_
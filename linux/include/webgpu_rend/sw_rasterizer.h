@@ -0,0 +1,78 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef INCLUDE_SW_RASTERIZER_H_
+#define INCLUDE_SW_RASTERIZER_H_
+
+#include <cstdint>
+
+#include "sw_damage_region.h"
+#include "sw_thread_pool.h"
+
+// Tile-parallel triangle rasterizer for drawing meshes into a SwPixelBuffer
+// without a GPU. Triangles are binned into SW_RASTER_TILE_SIZE square tiles
+// and every tile is shaded by one worker, so no two threads ever touch the
+// same pixel.
+//
+// Conventions follow WebGPU, so the same matrices work for both paths: clip
+// space z runs from 0 to w, counter-clockwise triangles face front, depth is
+// tested with "less".
+#define SW_RASTER_TILE_SIZE 64
+
+typedef struct {
+  // RGBA, `stride` bytes per row
+  uint8_t* pixels;
+  int64_t stride;
+  // width * height floats
+  float* depth;
+  int32_t width;
+  int32_t height;
+} SwRasterTarget;
+
+typedef enum {
+  SW_CULL_NONE = 0,
+  SW_CULL_FRONT,
+  SW_CULL_BACK,
+} SwCullMode;
+
+typedef struct {
+  // Interleaved position.xyz, normal.xyz per vertex, as produced by ObjLoader
+  const float* vertices;
+  int64_t vertex_count;
+  const uint32_t* indices;
+  int64_t index_count;
+  // Column-major, like vector_math's Matrix4.storage
+  float mvp[16];
+  // RGBA, in memory order
+  uint32_t color;
+  // Gouraud shaded: color * (max(dot(normal, light_dir), 0) + ambient). The
+  // light direction must be normalized.
+  float light_dir[3];
+  float ambient;
+  SwCullMode cull_mode;
+} SwMeshDraw;
+
+typedef struct _SwRasterizer SwRasterizer;
+
+// The pool is borrowed and must outlive the rasterizer.
+SwRasterizer* sw_rasterizer_new(SwThreadPool* pool);
+void sw_rasterizer_free(SwRasterizer* rasterizer);
+void sw_rasterizer_clear(SwRasterizer* rasterizer, const SwRasterTarget* target, uint32_t color, float depth);
+// Returns the bounds of the pixels the draw may have touched, empty if the
+// mesh was entirely culled or off screen.
+SwRect sw_rasterizer_draw(SwRasterizer* rasterizer, const SwRasterTarget* target, const SwMeshDraw* draw);
+
+#endif //INCLUDE_SW_RASTERIZER_H_
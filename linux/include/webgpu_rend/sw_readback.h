@@ -0,0 +1,55 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef INCLUDE_SW_READBACK_H_
+#define INCLUDE_SW_READBACK_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Cropping, format conversion and downscaling for get_pixels. Pure pixel
+// work, so the async variant can run it off the platform thread.
+
+typedef enum {
+  SW_READ_RGBA = 0,
+  SW_READ_BGRA,
+  // Alpha dropped, 3 bytes per pixel
+  SW_READ_RGB,
+  SW_READ_FORMAT_COUNT,
+} SwReadFormat;
+
+typedef struct {
+  // Source rect within the frame
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+  // Output size, at most the source size. Each output pixel is the average
+  // of the source pixels it covers.
+  int32_t dst_width;
+  int32_t dst_height;
+  SwReadFormat format;
+} SwReadRegion;
+
+// Clips the source rect to the frame, shrinking the output size by the same
+// proportion. Returns false if nothing is left or the output would be larger
+// than the source.
+bool sw_read_region_clip(SwReadRegion* region, int64_t frame_width, int64_t frame_height);
+size_t sw_read_output_size(const SwReadRegion* region);
+// `src` points at the top-left pixel of the region, rows `stride` bytes apart.
+void sw_read_pixels(const uint8_t* src, int64_t stride, const SwReadRegion* region, uint8_t* out);
+
+#endif //INCLUDE_SW_READBACK_H_
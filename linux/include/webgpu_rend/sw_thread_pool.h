@@ -0,0 +1,39 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef INCLUDE_SW_THREAD_POOL_H_
+#define INCLUDE_SW_THREAD_POOL_H_
+
+#include <cstdint>
+
+// Fixed set of worker threads for splitting software rendering work across
+// cores. The thread calling sw_thread_pool_run works too, as worker 0.
+typedef struct _SwThreadPool SwThreadPool;
+
+// `worker` is in [0, sw_thread_pool_get_size), so tasks can index per-worker
+// scratch space without locking.
+typedef void (*SwThreadPoolTask)(void* data, int64_t task, int worker);
+
+// thread_count <= 0 uses one worker per core.
+SwThreadPool* sw_thread_pool_new(int thread_count);
+void sw_thread_pool_free(SwThreadPool* pool);
+int sw_thread_pool_get_size(SwThreadPool* pool);
+// Runs task(data, i, worker) for every i in [0, task_count) and returns once
+// all of them finished. Tasks are handed out in order but finish in any order.
+// Calls from different threads are serialized.
+void sw_thread_pool_run(SwThreadPool* pool, int64_t task_count, SwThreadPoolTask task, void* data);
+
+#endif //INCLUDE_SW_THREAD_POOL_H_
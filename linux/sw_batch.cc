@@ -0,0 +1,180 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#include "include/webgpu_rend/sw_batch.h"
+
+#include <cstring>
+
+#include "include/webgpu_rend/sw_blit.h"
+
+typedef struct {
+  const uint8_t* data;
+  size_t remaining;
+} SwBatchReader;
+
+static bool sw_batch_read(SwBatchReader* reader, void* dst, size_t size) {
+  if (reader->remaining < size) return false;
+  memcpy(dst, reader->data, size);
+  reader->data += size;
+  reader->remaining -= size;
+  return true;
+}
+
+static bool sw_batch_read_i32s(SwBatchReader* reader, int32_t* dst, int count) {
+  return sw_batch_read(reader, dst, sizeof(int32_t) * count);
+}
+
+static bool sw_batch_valid_mode(int32_t mode) {
+  return mode >= 0 && mode < SW_BLIT_MODE_COUNT;
+}
+
+static const char* sw_batch_draw(SwBatchReader* payload, SwBatchLookup lookup, void* user_data) {
+  int64_t texture;
+  int32_t args[7];
+  if (!sw_batch_read(payload, &texture, sizeof(texture)) || !sw_batch_read_i32s(payload, args, 7)) {
+    return "Truncated draw";
+  }
+  int32_t x = args[0], y = args[1], width = args[2], height = args[3];
+  int32_t src_width = args[4], src_height = args[5], mode = args[6];
+  if (width <= 0 || height <= 0 || src_width <= 0 || src_height <= 0 || !sw_batch_valid_mode(mode)) {
+    return "Invalid draw rect or mode";
+  }
+  size_t bytes = (size_t)src_width * src_height * 4;
+  if (payload->remaining < bytes) return "Draw is missing pixel data";
+  SwPixelBuffer* buffer = lookup(user_data, texture);
+  if (buffer == nullptr) return "Texture ID is not registered";
+  if (src_width == width && src_height == height) {
+    sw_pixel_buffer_draw_rect_mode(buffer, payload->data, 4 * src_width, x, y, width, height, (SwBlitMode)mode);
+  } else {
+    sw_pixel_buffer_draw_scaled(buffer, payload->data, 4 * src_width, src_width, src_height, x, y, width, height,
+                                (SwBlitMode)mode);
+  }
+  return nullptr;
+}
+
+static const char* sw_batch_fill(SwBatchReader* payload, SwBatchLookup lookup, void* user_data) {
+  int64_t texture;
+  int32_t args[4];
+  uint32_t argb;
+  if (!sw_batch_read(payload, &texture, sizeof(texture)) || !sw_batch_read_i32s(payload, args, 4) ||
+      !sw_batch_read(payload, &argb, sizeof(argb))) {
+    return "Truncated fill";
+  }
+  SwPixelBuffer* buffer = lookup(user_data, texture);
+  if (buffer == nullptr) return "Texture ID is not registered";
+  sw_pixel_buffer_fill_rect(buffer, sw_blit_argb_to_rgba(argb), args[0], args[1], args[2], args[3]);
+  return nullptr;
+}
+
+static const char* sw_batch_copy(SwBatchReader* payload, SwBatchLookup lookup, void* user_data) {
+  int64_t textures[2];
+  int32_t args[7];
+  if (!sw_batch_read(payload, textures, sizeof(textures)) || !sw_batch_read_i32s(payload, args, 7)) {
+    return "Truncated copy";
+  }
+  int32_t src_x = args[0], src_y = args[1], dst_x = args[2], dst_y = args[3];
+  int32_t width = args[4], height = args[5], mode = args[6];
+  if (!sw_batch_valid_mode(mode)) return "Invalid copy mode";
+  SwPixelBuffer* src = lookup(user_data, textures[0]);
+  SwPixelBuffer* dst = lookup(user_data, textures[1]);
+  if (src == nullptr || dst == nullptr) return "Texture ID is not registered";
+
+  // Clip against the source, shifting the destination along with it
+  if (src_x < 0) {
+    width += src_x;
+    dst_x -= src_x;
+    src_x = 0;
+  }
+  if (src_y < 0) {
+    height += src_y;
+    dst_y -= src_y;
+    src_y = 0;
+  }
+  width = MIN(width, (int32_t)src->width - src_x);
+  height = MIN(height, (int32_t)src->height - src_y);
+  if (width <= 0 || height <= 0) return nullptr;
+
+  int64_t stride = 4 * src->width;
+  const uint8_t* pixels = sw_pixel_buffer_peek(src) + src_y * stride + 4 * src_x;
+  if (src != dst) {
+    sw_pixel_buffer_draw_rect_mode(dst, pixels, stride, dst_x, dst_y, width, height, (SwBlitMode)mode);
+    return nullptr;
+  }
+  // Source and destination may overlap, and drawing may also bring the back
+  // frame up to date underneath `pixels`. Go through a copy.
+  uint8_t* scratch = g_new(uint8_t, (size_t)width * height * 4);
+  for (int32_t row = 0; row < height; row++) {
+    memcpy(scratch + (size_t)row * width * 4, pixels + row * stride, (size_t)width * 4);
+  }
+  sw_pixel_buffer_draw_rect_mode(dst, scratch, 4 * width, dst_x, dst_y, width, height, (SwBlitMode)mode);
+  g_free(scratch);
+  return nullptr;
+}
+
+static const char* sw_batch_invalidate(SwBatchReader* payload, SwBatchLookup lookup, void* user_data,
+                                       GPtrArray* invalidated) {
+  int64_t texture;
+  if (!sw_batch_read(payload, &texture, sizeof(texture))) return "Truncated invalidate";
+  SwPixelBuffer* buffer = lookup(user_data, texture);
+  if (buffer == nullptr) return "Texture ID is not registered";
+  for (guint i = 0; i < invalidated->len; i++) {
+    if (g_ptr_array_index(invalidated, i) == buffer) return nullptr;
+  }
+  g_ptr_array_add(invalidated, buffer);
+  return nullptr;
+}
+
+bool sw_batch_execute(const uint8_t* commands, size_t length, SwBatchLookup lookup, void* user_data,
+                      GPtrArray* invalidated, SwBatchResult* result) {
+  SwBatchReader reader = {commands, length};
+  result->executed = 0;
+  result->error = nullptr;
+  while (reader.remaining > 0) {
+    uint32_t header[2];
+    if (!sw_batch_read(&reader, header, sizeof(header))) {
+      result->error = "Truncated record header";
+      return false;
+    }
+    uint32_t opcode = header[0], size = header[1];
+    if (size % 4 != 0 || size > reader.remaining) {
+      result->error = "Record size is misaligned or past the end of the batch";
+      return false;
+    }
+    SwBatchReader payload = {reader.data, size};
+    reader.data += size;
+    reader.remaining -= size;
+
+    switch (opcode) {
+      case SW_BATCH_DRAW:
+        result->error = sw_batch_draw(&payload, lookup, user_data);
+        break;
+      case SW_BATCH_FILL:
+        result->error = sw_batch_fill(&payload, lookup, user_data);
+        break;
+      case SW_BATCH_COPY:
+        result->error = sw_batch_copy(&payload, lookup, user_data);
+        break;
+      case SW_BATCH_INVALIDATE:
+        result->error = sw_batch_invalidate(&payload, lookup, user_data, invalidated);
+        break;
+      default:
+        break;
+    }
+    if (result->error != nullptr) return false;
+    result->executed++;
+  }
+  return true;
+}
@@ -0,0 +1,112 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#include "include/webgpu_rend/sw_blit.h"
+
+#include <cstring>
+
+#include "sw_blit_kernels.h"
+
+void sw_blit_scalar_copy(uint8_t* dst, const uint8_t* src, int64_t count) {
+  memmove(dst, src, 4 * count);
+}
+
+void sw_blit_scalar_swizzle(uint8_t* dst, const uint8_t* src, int64_t count) {
+  for (int64_t i = 0; i < count; i++) {
+    uint8_t r = src[4 * i];
+    dst[4 * i] = src[4 * i + 2];
+    dst[4 * i + 1] = src[4 * i + 1];
+    dst[4 * i + 2] = r;
+    dst[4 * i + 3] = src[4 * i + 3];
+  }
+}
+
+void sw_blit_scalar_premultiply(uint8_t* dst, const uint8_t* src, int64_t count) {
+  for (int64_t i = 0; i < count; i++) {
+    uint32_t a = src[4 * i + 3];
+    dst[4 * i] = sw_blit_div255(src[4 * i] * a);
+    dst[4 * i + 1] = sw_blit_div255(src[4 * i + 1] * a);
+    dst[4 * i + 2] = sw_blit_div255(src[4 * i + 2] * a);
+    dst[4 * i + 3] = a;
+  }
+}
+
+void sw_blit_scalar_blend(uint8_t* dst, const uint8_t* src, int64_t count) {
+  for (int64_t i = 0; i < count; i++) {
+    uint32_t inv = 255 - src[4 * i + 3];
+    for (int c = 0; c < 4; c++) {
+      // Saturate like the SIMD versions, the sum only overflows for sources
+      // that are not actually premultiplied.
+      uint32_t v = src[4 * i + c] + sw_blit_div255(dst[4 * i + c] * inv);
+      dst[4 * i + c] = v > 255 ? 255 : v;
+    }
+  }
+}
+
+void sw_blit_scalar_fill(uint8_t* dst, uint32_t color, int64_t count) {
+  for (int64_t i = 0; i < count; i++) {
+    memcpy(dst + 4 * i, &color, 4);
+  }
+}
+
+void sw_blit_scalar_scale(uint8_t* dst, const uint8_t* src, int64_t count, uint32_t x0, uint32_t step) {
+  uint32_t x = x0;
+  for (int64_t i = 0; i < count; i++) {
+    memcpy(dst + 4 * i, src + 4 * (x >> 16), 4);
+    x += step;
+  }
+}
+
+const SwBlitKernels sw_blit_scalar_kernels = {
+    "scalar",
+    {sw_blit_scalar_copy, sw_blit_scalar_swizzle, sw_blit_scalar_premultiply, sw_blit_scalar_blend},
+    sw_blit_scalar_fill,
+    sw_blit_scalar_scale,
+};
+
+const SwBlitKernels* sw_blit_get_kernels_for(SwBlitIsa isa) {
+  switch (isa) {
+    case SW_BLIT_ISA_SCALAR:
+      return &sw_blit_scalar_kernels;
+#if defined(SW_BLIT_HAVE_X86)
+    case SW_BLIT_ISA_SSE41:
+      return __builtin_cpu_supports("sse4.1") ? &sw_blit_sse41_kernels : nullptr;
+    case SW_BLIT_ISA_AVX2:
+      return __builtin_cpu_supports("avx2") ? &sw_blit_avx2_kernels : nullptr;
+#endif
+#if defined(SW_BLIT_HAVE_NEON)
+    case SW_BLIT_ISA_NEON:
+      // Part of the baseline on AArch64, nothing to detect.
+      return &sw_blit_neon_kernels;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+static const SwBlitKernels* sw_blit_select_kernels() {
+  static const SwBlitIsa preferred[] = {SW_BLIT_ISA_AVX2, SW_BLIT_ISA_NEON, SW_BLIT_ISA_SSE41};
+  for (SwBlitIsa isa : preferred) {
+    const SwBlitKernels* kernels = sw_blit_get_kernels_for(isa);
+    if (kernels != nullptr) return kernels;
+  }
+  return &sw_blit_scalar_kernels;
+}
+
+const SwBlitKernels* sw_blit_get_kernels() {
+  static const SwBlitKernels* kernels = sw_blit_select_kernels();
+  return kernels;
+}
@@ -0,0 +1,41 @@
+#    Copyright 2022 Google LLC
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#    https://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+
+# Adds the SwPixelBuffer blit kernels to a target. Shared by the plugin and
+# the standalone benchmark in benchmark/.
+#
+# Each SIMD variant lives in its own translation unit compiled with just the
+# flags it needs; sw_blit.cc picks one at runtime, so the binary still runs on
+# CPUs without AVX2 or SSE4.1.
+set(SW_BLIT_DIR "${CMAKE_CURRENT_LIST_DIR}")
+
+function(sw_blit_add_sources TARGET)
+  target_sources(${TARGET} PRIVATE
+    "${SW_BLIT_DIR}/include/webgpu_rend/sw_blit.h"
+    "${SW_BLIT_DIR}/sw_blit_kernels.h"
+    "${SW_BLIT_DIR}/sw_blit.cc"
+  )
+  if(CMAKE_SYSTEM_PROCESSOR MATCHES "^(x86_64|AMD64|amd64|i.86)$")
+    target_sources(${TARGET} PRIVATE
+      "${SW_BLIT_DIR}/sw_blit_sse41.cc"
+      "${SW_BLIT_DIR}/sw_blit_avx2.cc"
+    )
+    set_source_files_properties("${SW_BLIT_DIR}/sw_blit_sse41.cc" PROPERTIES COMPILE_OPTIONS "-msse4.1")
+    set_source_files_properties("${SW_BLIT_DIR}/sw_blit_avx2.cc" PROPERTIES COMPILE_OPTIONS "-mavx2")
+    target_compile_definitions(${TARGET} PRIVATE SW_BLIT_HAVE_X86)
+  elseif(CMAKE_SYSTEM_PROCESSOR MATCHES "^(aarch64|arm64)$")
+    target_sources(${TARGET} PRIVATE "${SW_BLIT_DIR}/sw_blit_neon.cc")
+    target_compile_definitions(${TARGET} PRIVATE SW_BLIT_HAVE_NEON)
+  endif()
+endfunction()
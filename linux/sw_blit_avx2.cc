@@ -0,0 +1,111 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+// Compiled with -mavx2. Only reached after sw_blit_get_kernels_for has checked
+// the CPU supports it.
+
+#include "sw_blit_kernels.h"
+
+#if defined(SW_BLIT_HAVE_X86)
+
+#include <immintrin.h>
+
+static inline __m256i sw_blit_avx2_div255(__m256i x) {
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+static inline __m256i sw_blit_avx2_alpha(__m256i px) {
+  return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static void sw_blit_avx2_swizzle(uint8_t* dst, const uint8_t* src, int64_t count) {
+  const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+    _mm256_storeu_si256((__m256i*)(dst + 4 * i), _mm256_shuffle_epi8(v, mask));
+  }
+  sw_blit_scalar_swizzle(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static inline __m256i sw_blit_avx2_premultiply_half(__m256i px) {
+  __m256i scaled = sw_blit_avx2_div255(_mm256_mullo_epi16(px, sw_blit_avx2_alpha(px)));
+  return _mm256_blend_epi16(scaled, px, 0x88);
+}
+
+// unpack and pack both work within 128-bit lanes, so pixel order survives the
+// round trip without any cross-lane permutes.
+static void sw_blit_avx2_premultiply(uint8_t* dst, const uint8_t* src, int64_t count) {
+  const __m256i zero = _mm256_setzero_si256();
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+    __m256i lo = sw_blit_avx2_premultiply_half(_mm256_unpacklo_epi8(v, zero));
+    __m256i hi = sw_blit_avx2_premultiply_half(_mm256_unpackhi_epi8(v, zero));
+    _mm256_storeu_si256((__m256i*)(dst + 4 * i), _mm256_packus_epi16(lo, hi));
+  }
+  sw_blit_scalar_premultiply(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static void sw_blit_avx2_blend(uint8_t* dst, const uint8_t* src, int64_t count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(255);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i s = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+    __m256i d = _mm256_loadu_si256((const __m256i*)(dst + 4 * i));
+    __m256i inv_lo = _mm256_sub_epi16(ones, sw_blit_avx2_alpha(_mm256_unpacklo_epi8(s, zero)));
+    __m256i inv_hi = _mm256_sub_epi16(ones, sw_blit_avx2_alpha(_mm256_unpackhi_epi8(s, zero)));
+    __m256i lo = sw_blit_avx2_div255(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv_lo));
+    __m256i hi = sw_blit_avx2_div255(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv_hi));
+    _mm256_storeu_si256((__m256i*)(dst + 4 * i), _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+  }
+  sw_blit_scalar_blend(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static void sw_blit_avx2_fill(uint8_t* dst, uint32_t color, int64_t count) {
+  const __m256i v = _mm256_set1_epi32((int)color);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_si256((__m256i*)(dst + 4 * i), v);
+  }
+  sw_blit_scalar_fill(dst + 4 * i, color, count - i);
+}
+
+static void sw_blit_avx2_scale(uint8_t* dst, const uint8_t* src, int64_t count, uint32_t x0, uint32_t step) {
+  __m256i x = _mm256_add_epi32(_mm256_set1_epi32((int)x0),
+                               _mm256_mullo_epi32(_mm256_set1_epi32((int)step), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+  const __m256i advance = _mm256_set1_epi32((int)(step * 8));
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i index = _mm256_srli_epi32(x, 16);
+    __m256i v = _mm256_i32gather_epi32((const int*)src, index, 4);
+    _mm256_storeu_si256((__m256i*)(dst + 4 * i), v);
+    x = _mm256_add_epi32(x, advance);
+  }
+  sw_blit_scalar_scale(dst + 4 * i, src, count - i, x0 + (uint32_t)i * step, step);
+}
+
+const SwBlitKernels sw_blit_avx2_kernels = {
+    "avx2",
+    {sw_blit_scalar_copy, sw_blit_avx2_swizzle, sw_blit_avx2_premultiply, sw_blit_avx2_blend},
+    sw_blit_avx2_fill,
+    sw_blit_avx2_scale,
+};
+
+#endif  // SW_BLIT_HAVE_X86
@@ -0,0 +1,51 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#ifndef SW_BLIT_KERNELS_H_
+#define SW_BLIT_KERNELS_H_
+
+#include <cstdint>
+
+#include "include/webgpu_rend/sw_blit.h"
+
+// Shared between the per-ISA translation units. Each of those is compiled with
+// its own target flags, so nothing in here may be inlined across them except
+// the plain C helpers below.
+
+// x / 255 rounded to nearest, exact for x in [0, 255 * 255]. The SIMD kernels
+// use the same shift-and-add form in 16-bit lanes.
+static inline uint32_t sw_blit_div255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+void sw_blit_scalar_copy(uint8_t* dst, const uint8_t* src, int64_t count);
+void sw_blit_scalar_swizzle(uint8_t* dst, const uint8_t* src, int64_t count);
+void sw_blit_scalar_premultiply(uint8_t* dst, const uint8_t* src, int64_t count);
+void sw_blit_scalar_blend(uint8_t* dst, const uint8_t* src, int64_t count);
+void sw_blit_scalar_fill(uint8_t* dst, uint32_t color, int64_t count);
+void sw_blit_scalar_scale(uint8_t* dst, const uint8_t* src, int64_t count, uint32_t x0, uint32_t step);
+
+extern const SwBlitKernels sw_blit_scalar_kernels;
+#if defined(SW_BLIT_HAVE_X86)
+extern const SwBlitKernels sw_blit_sse41_kernels;
+extern const SwBlitKernels sw_blit_avx2_kernels;
+#endif
+#if defined(SW_BLIT_HAVE_NEON)
+extern const SwBlitKernels sw_blit_neon_kernels;
+#endif
+
+#endif //SW_BLIT_KERNELS_H_
@@ -0,0 +1,92 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#include "sw_blit_kernels.h"
+
+#if defined(SW_BLIT_HAVE_NEON)
+
+#include <arm_neon.h>
+
+static inline uint8x8_t sw_blit_neon_div255(uint16x8_t x) {
+  x = vaddq_u16(x, vdupq_n_u16(128));
+  return vshrn_n_u16(vaddq_u16(x, vshrq_n_u16(x, 8)), 8);
+}
+
+static inline uint8x16_t sw_blit_neon_mul255(uint8x16_t a, uint8x16_t b) {
+  uint8x8_t lo = sw_blit_neon_div255(vmull_u8(vget_low_u8(a), vget_low_u8(b)));
+  uint8x8_t hi = sw_blit_neon_div255(vmull_u8(vget_high_u8(a), vget_high_u8(b)));
+  return vcombine_u8(lo, hi);
+}
+
+// vld4/vst4 split 16 pixels into one register per channel, which makes every
+// kernel here a plain per-channel loop.
+
+static void sw_blit_neon_swizzle(uint8_t* dst, const uint8_t* src, int64_t count) {
+  int64_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t px = vld4q_u8(src + 4 * i);
+    uint8x16_t r = px.val[0];
+    px.val[0] = px.val[2];
+    px.val[2] = r;
+    vst4q_u8(dst + 4 * i, px);
+  }
+  sw_blit_scalar_swizzle(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static void sw_blit_neon_premultiply(uint8_t* dst, const uint8_t* src, int64_t count) {
+  int64_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t px = vld4q_u8(src + 4 * i);
+    for (int c = 0; c < 3; c++) {
+      px.val[c] = sw_blit_neon_mul255(px.val[c], px.val[3]);
+    }
+    vst4q_u8(dst + 4 * i, px);
+  }
+  sw_blit_scalar_premultiply(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static void sw_blit_neon_blend(uint8_t* dst, const uint8_t* src, int64_t count) {
+  int64_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t s = vld4q_u8(src + 4 * i);
+    uint8x16x4_t d = vld4q_u8(dst + 4 * i);
+    uint8x16_t inv = vmvnq_u8(s.val[3]);
+    for (int c = 0; c < 4; c++) {
+      d.val[c] = vqaddq_u8(s.val[c], sw_blit_neon_mul255(d.val[c], inv));
+    }
+    vst4q_u8(dst + 4 * i, d);
+  }
+  sw_blit_scalar_blend(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static void sw_blit_neon_fill(uint8_t* dst, uint32_t color, int64_t count) {
+  const uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(color));
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1q_u8(dst + 4 * i, v);
+  }
+  sw_blit_scalar_fill(dst + 4 * i, color, count - i);
+}
+
+// NEON has no gather, scaling stays scalar.
+const SwBlitKernels sw_blit_neon_kernels = {
+    "neon",
+    {sw_blit_scalar_copy, sw_blit_neon_swizzle, sw_blit_neon_premultiply, sw_blit_neon_blend},
+    sw_blit_neon_fill,
+    sw_blit_scalar_scale,
+};
+
+#endif  // SW_BLIT_HAVE_NEON
@@ -0,0 +1,98 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+// Compiled with -msse4.1. Only reached after sw_blit_get_kernels_for has
+// checked the CPU supports it.
+
+#include "sw_blit_kernels.h"
+
+#if defined(SW_BLIT_HAVE_X86)
+
+#include <immintrin.h>
+
+static inline __m128i sw_blit_sse41_div255(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Alpha of each of the two pixels in a 16-bit-per-channel vector, broadcast to
+// all four of its channels.
+static inline __m128i sw_blit_sse41_alpha(__m128i px) {
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static void sw_blit_sse41_swizzle(uint8_t* dst, const uint8_t* src, int64_t count) {
+  const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+    _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_shuffle_epi8(v, mask));
+  }
+  sw_blit_scalar_swizzle(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static inline __m128i sw_blit_sse41_premultiply_half(__m128i px) {
+  __m128i scaled = sw_blit_sse41_div255(_mm_mullo_epi16(px, sw_blit_sse41_alpha(px)));
+  // Keep the original alpha channel
+  return _mm_blend_epi16(scaled, px, 0x88);
+}
+
+static void sw_blit_sse41_premultiply(uint8_t* dst, const uint8_t* src, int64_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+    __m128i lo = sw_blit_sse41_premultiply_half(_mm_unpacklo_epi8(v, zero));
+    __m128i hi = sw_blit_sse41_premultiply_half(_mm_unpackhi_epi8(v, zero));
+    _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_packus_epi16(lo, hi));
+  }
+  sw_blit_scalar_premultiply(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static void sw_blit_sse41_blend(uint8_t* dst, const uint8_t* src, int64_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(255);
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + 4 * i));
+    __m128i inv_lo = _mm_sub_epi16(ones, sw_blit_sse41_alpha(_mm_unpacklo_epi8(s, zero)));
+    __m128i inv_hi = _mm_sub_epi16(ones, sw_blit_sse41_alpha(_mm_unpackhi_epi8(s, zero)));
+    __m128i lo = sw_blit_sse41_div255(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv_lo));
+    __m128i hi = sw_blit_sse41_div255(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv_hi));
+    _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+  }
+  sw_blit_scalar_blend(dst + 4 * i, src + 4 * i, count - i);
+}
+
+static void sw_blit_sse41_fill(uint8_t* dst, uint32_t color, int64_t count) {
+  const __m128i v = _mm_set1_epi32((int)color);
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_si128((__m128i*)(dst + 4 * i), v);
+  }
+  sw_blit_scalar_fill(dst + 4 * i, color, count - i);
+}
+
+// No gather before AVX2, the scalar loop is as good as it gets.
+const SwBlitKernels sw_blit_sse41_kernels = {
+    "sse4.1",
+    {sw_blit_scalar_copy, sw_blit_sse41_swizzle, sw_blit_sse41_premultiply, sw_blit_sse41_blend},
+    sw_blit_sse41_fill,
+    sw_blit_scalar_scale,
+};
+
+#endif  // SW_BLIT_HAVE_X86
@@ -0,0 +1,332 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+
+#include "include/webgpu_rend/sw_compositor.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "include/webgpu_rend/sw_blit.h"
+#include "sw_blit_kernels.h"
+
+// Rows per compose task. Small enough that a single damaged rect still
+// spreads over every worker, large enough to amortize the per-task setup.
+#define SW_COMPOSITOR_BAND_ROWS 32
+
+typedef struct {
+  int32_t id;
+  int32_t width;
+  int32_t height;
+  std::vector<uint8_t> pixels;
+  SwLayerProperties properties;
+} SwLayer;
+
+struct _SwCompositor {
+  SwThreadPool* pool;
+  int32_t width;
+  int32_t height;
+  int32_t next_id;
+  // Sorted by z, then id, i.e. in drawing order
+  std::vector<SwLayer*> layers;
+  SwDamageRegion damage;
+  uint32_t background;
+  // Visible layers in drawing order, rebuilt by every compose
+  std::vector<const SwLayer*> drawn;
+  // One row per worker for layers that are not fully opaque
+  std::vector<std::vector<uint8_t>> scratch;
+};
+
+typedef struct {
+  SwCompositor* compositor;
+  const SwDamageRegion* damage;
+  uint8_t* pixels;
+  int64_t stride;
+  int32_t min_y;
+} SwComposeJob;
+
+static SwLayer* sw_compositor_find(SwCompositor* compositor, int32_t id) {
+  for (SwLayer* layer : compositor->layers) {
+    if (layer->id == id) return layer;
+  }
+  return nullptr;
+}
+
+static bool sw_compositor_layer_shows(const SwLayer* layer) {
+  return layer->properties.visible && layer->properties.opacity > 0;
+}
+
+static void sw_compositor_damage_layer(SwCompositor* compositor, const SwLayer* layer) {
+  if (!sw_compositor_layer_shows(layer)) return;
+  sw_damage_region_add(&compositor->damage,
+                       {layer->properties.x, layer->properties.y, layer->width, layer->height}, compositor->width,
+                       compositor->height);
+}
+
+static void sw_compositor_sort(SwCompositor* compositor) {
+  std::sort(compositor->layers.begin(), compositor->layers.end(), [](const SwLayer* a, const SwLayer* b) {
+    if (a->properties.z != b->properties.z) return a->properties.z < b->properties.z;
+    return a->id < b->id;
+  });
+}
+
+SwCompositor* sw_compositor_new(SwThreadPool* pool, int32_t width, int32_t height) {
+  SwCompositor* compositor = new SwCompositor();
+  compositor->pool = pool;
+  compositor->width = width;
+  compositor->height = height;
+  compositor->next_id = 1;
+  compositor->background = 0;
+  sw_damage_region_clear(&compositor->damage);
+  sw_damage_region_add(&compositor->damage, {0, 0, width, height}, width, height);
+  compositor->scratch.resize(sw_thread_pool_get_size(pool), std::vector<uint8_t>(4 * (size_t)width));
+  return compositor;
+}
+
+void sw_compositor_free(SwCompositor* compositor) {
+  for (SwLayer* layer : compositor->layers) delete layer;
+  delete compositor;
+}
+
+int32_t sw_compositor_add_layer(SwCompositor* compositor, int32_t width, int32_t height) {
+  if (width <= 0 || height <= 0) return -1;
+  SwLayer* layer = new SwLayer();
+  layer->id = compositor->next_id++;
+  layer->width = width;
+  layer->height = height;
+  layer->pixels.resize(4 * (size_t)width * height);
+  layer->properties = {0, 0, 255, SW_LAYER_BLEND_OVER, true, 0};
+  // Transparent, so there is nothing to damage yet
+  compositor->layers.push_back(layer);
+  sw_compositor_sort(compositor);
+  return layer->id;
+}
+
+void sw_compositor_remove_layer(SwCompositor* compositor, int32_t id) {
+  auto it = std::find_if(compositor->layers.begin(), compositor->layers.end(),
+                         [id](const SwLayer* layer) { return layer->id == id; });
+  if (it == compositor->layers.end()) return;
+  sw_compositor_damage_layer(compositor, *it);
+  delete *it;
+  compositor->layers.erase(it);
+}
+
+uint8_t* sw_compositor_get_layer_pixels(SwCompositor* compositor, int32_t id) {
+  SwLayer* layer = sw_compositor_find(compositor, id);
+  return layer != nullptr ? layer->pixels.data() : nullptr;
+}
+
+bool sw_compositor_get_layer_properties(SwCompositor* compositor, int32_t id, SwLayerProperties* properties) {
+  SwLayer* layer = sw_compositor_find(compositor, id);
+  if (layer == nullptr) return false;
+  *properties = layer->properties;
+  return true;
+}
+
+bool sw_compositor_set_layer_properties(SwCompositor* compositor, int32_t id, const SwLayerProperties* properties) {
+  SwLayer* layer = sw_compositor_find(compositor, id);
+  if (layer == nullptr || properties->blend < 0 || properties->blend >= SW_LAYER_BLEND_COUNT) return false;
+  const SwLayerProperties& old = layer->properties;
+  if (old.x == properties->x && old.y == properties->y && old.opacity == properties->opacity &&
+      old.blend == properties->blend && old.visible == properties->visible && old.z == properties->z) {
+    return true;
+  }
+  bool reorder = old.z != properties->z;
+  sw_compositor_damage_layer(compositor, layer);
+  layer->properties = *properties;
+  sw_compositor_damage_layer(compositor, layer);
+  if (reorder) sw_compositor_sort(compositor);
+  return true;
+}
+
+void sw_compositor_mark_dirty(SwCompositor* compositor, int32_t id, int32_t x, int32_t y, int32_t width, int32_t height) {
+  SwLayer* layer = sw_compositor_find(compositor, id);
+  if (layer == nullptr || !sw_compositor_layer_shows(layer)) return;
+  if (width <= 0 || height <= 0) {
+    x = 0;
+    y = 0;
+    width = layer->width;
+    height = layer->height;
+  }
+  // Clip to the layer first, pixels outside of it are never drawn
+  int32_t x0 = std::max(x, 0), y0 = std::max(y, 0);
+  int32_t x1 = std::min(x + width, layer->width), y1 = std::min(y + height, layer->height);
+  if (x0 >= x1 || y0 >= y1) return;
+  sw_damage_region_add(&compositor->damage,
+                       {layer->properties.x + x0, layer->properties.y + y0, x1 - x0, y1 - y0}, compositor->width,
+                       compositor->height);
+}
+
+static void sw_compositor_add(uint8_t* dst, const uint8_t* src, int64_t count) {
+  for (int64_t i = 0; i < 4 * count; i++) {
+    uint32_t v = dst[i] + src[i];
+    dst[i] = v > 255 ? 255 : v;
+  }
+}
+
+static void sw_compositor_multiply(uint8_t* dst, const uint8_t* src, int64_t count) {
+  for (int64_t i = 0; i < count; i++) {
+    uint32_t inv_sa = 255 - src[4 * i + 3];
+    uint32_t inv_da = 255 - dst[4 * i + 3];
+    for (int c = 0; c < 4; c++) {
+      uint32_t s = src[4 * i + c], d = dst[4 * i + c];
+      dst[4 * i + c] = sw_blit_div255(s * d + s * inv_da + d * inv_sa);
+    }
+  }
+}
+
+// dst = src * opacity + dst * (1 - opacity), for SOURCE layers that are
+// partially transparent. `src` is already scaled by opacity.
+static void sw_compositor_fade(uint8_t* dst, const uint8_t* src, int64_t count, uint32_t opacity) {
+  uint32_t inv = 255 - opacity;
+  for (int64_t i = 0; i < 4 * count; i++) {
+    dst[i] = src[i] + sw_blit_div255(dst[i] * inv);
+  }
+}
+
+static void sw_compositor_blend_row(uint8_t* dst, const uint8_t* src, int64_t count, const SwLayerProperties* properties,
+                                    uint8_t* scratch) {
+  const SwBlitKernels* kernels = sw_blit_get_kernels();
+  uint32_t opacity = properties->opacity;
+  if (opacity != 255) {
+    for (int64_t i = 0; i < 4 * count; i++) {
+      scratch[i] = sw_blit_div255(src[i] * opacity);
+    }
+    src = scratch;
+  }
+  switch (properties->blend) {
+    case SW_LAYER_BLEND_OVER:
+      kernels->rows[SW_BLIT_BLEND](dst, src, count);
+      break;
+    case SW_LAYER_BLEND_SOURCE:
+      if (opacity == 255) {
+        kernels->rows[SW_BLIT_COPY](dst, src, count);
+      } else {
+        sw_compositor_fade(dst, src, count, opacity);
+      }
+      break;
+    case SW_LAYER_BLEND_ADD:
+      sw_compositor_add(dst, src, count);
+      break;
+    case SW_LAYER_BLEND_MULTIPLY:
+      sw_compositor_multiply(dst, src, count);
+      break;
+    default:
+      break;
+  }
+}
+
+// Damage rects may overlap, so each row is first turned into disjoint spans.
+// Bands never share rows, which is what lets them run in parallel.
+typedef struct {
+  int32_t x0, x1;
+} SwSpan;
+
+static int sw_compositor_row_spans(const SwDamageRegion* damage, int32_t y, SwSpan* spans) {
+  int count = 0;
+  for (int i = 0; i < damage->count; i++) {
+    const SwRect& rect = damage->rects[i];
+    if (y < rect.y || y >= rect.y + rect.height) continue;
+    spans[count++] = {rect.x, rect.x + rect.width};
+  }
+  std::sort(spans, spans + count, [](const SwSpan& a, const SwSpan& b) { return a.x0 < b.x0; });
+  int merged = 0;
+  for (int i = 0; i < count; i++) {
+    if (merged > 0 && spans[i].x0 <= spans[merged - 1].x1) {
+      spans[merged - 1].x1 = std::max(spans[merged - 1].x1, spans[i].x1);
+    } else {
+      spans[merged++] = spans[i];
+    }
+  }
+  return merged;
+}
+
+static void sw_compositor_compose_span(SwCompositor* compositor, uint8_t* row, int32_t y, int32_t x0, int32_t x1,
+                                       uint8_t* scratch) {
+  const std::vector<const SwLayer*>& drawn = compositor->drawn;
+  // Everything below an opaque SOURCE layer covering the whole span is
+  // hidden, so start from that layer instead of the background.
+  int first = (int)drawn.size() - 1;
+  for (; first >= 0; first--) {
+    const SwLayer* layer = drawn[first];
+    const SwLayerProperties& p = layer->properties;
+    if (p.blend == SW_LAYER_BLEND_SOURCE && p.opacity == 255 && p.x <= x0 && p.x + layer->width >= x1 && p.y <= y &&
+        p.y + layer->height > y) {
+      break;
+    }
+  }
+  if (first < 0) {
+    sw_blit_get_kernels()->fill(row + 4 * (int64_t)x0, compositor->background, x1 - x0);
+    first = 0;
+  }
+  for (size_t i = first; i < drawn.size(); i++) {
+    const SwLayer* layer = drawn[i];
+    int32_t ly = y - layer->properties.y;
+    if (ly < 0 || ly >= layer->height) continue;
+    int32_t lx0 = std::max(x0, layer->properties.x);
+    int32_t lx1 = std::min(x1, layer->properties.x + layer->width);
+    if (lx0 >= lx1) continue;
+    const uint8_t* src = layer->pixels.data() + 4 * ((int64_t)ly * layer->width + (lx0 - layer->properties.x));
+    sw_compositor_blend_row(row + 4 * (int64_t)lx0, src, lx1 - lx0, &layer->properties, scratch);
+  }
+}
+
+static void sw_compositor_band_task(void* data, int64_t task, int worker) {
+  SwComposeJob* job = (SwComposeJob*)data;
+  SwCompositor* compositor = job->compositor;
+  uint8_t* scratch = compositor->scratch[worker].data();
+  int32_t y0 = job->min_y + (int32_t)task * SW_COMPOSITOR_BAND_ROWS;
+  int32_t y1 = std::min(y0 + SW_COMPOSITOR_BAND_ROWS, compositor->height);
+  SwSpan spans[SW_DAMAGE_MAX_RECTS];
+  for (int32_t y = y0; y < y1; y++) {
+    int count = sw_compositor_row_spans(job->damage, y, spans);
+    uint8_t* row = job->pixels + y * job->stride;
+    for (int i = 0; i < count; i++) {
+      sw_compositor_compose_span(compositor, row, y, spans[i].x0, spans[i].x1, scratch);
+    }
+  }
+}
+
+SwDamageRegion sw_compositor_compose(SwCompositor* compositor, uint8_t* pixels, int64_t stride, uint32_t background) {
+  if (background != compositor->background) {
+    compositor->background = background;
+    sw_damage_region_add(&compositor->damage, {0, 0, compositor->width, compositor->height}, compositor->width,
+                         compositor->height);
+  }
+  SwDamageRegion damage = compositor->damage;
+  sw_damage_region_clear(&compositor->damage);
+  if (damage.count == 0) return damage;
+
+  compositor->drawn.clear();
+  for (const SwLayer* layer : compositor->layers) {
+    if (sw_compositor_layer_shows(layer)) compositor->drawn.push_back(layer);
+  }
+
+  SwComposeJob job = {};
+  job.compositor = compositor;
+  job.damage = &damage;
+  job.pixels = pixels;
+  job.stride = stride;
+  job.min_y = compositor->height;
+  int32_t max_y = 0;
+  for (int i = 0; i < damage.count; i++) {
+    job.min_y = std::min(job.min_y, damage.rects[i].y);
+    max_y = std::max(max_y, damage.rects[i].y + damage.rects[i].height);
+  }
+  int64_t bands = (max_y - job.min_y + SW_COMPOSITOR_BAND_ROWS - 1) / SW_COMPOSITOR_BAND_ROWS;
+  sw_thread_pool_run(compositor->pool, bands, sw_compositor_band_task, &job);
+  return damage;
+}
@@ -0,0 +1,115 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#include "include/webgpu_rend/sw_damage_region.h"
+
+#include <algorithm>
+
+static int64_t rect_area(const SwRect& r) {
+  return (int64_t)r.width * r.height;
+}
+
+static bool rect_contains(const SwRect& outer, const SwRect& inner) {
+  return inner.x >= outer.x && inner.y >= outer.y &&
+         inner.x + inner.width <= outer.x + outer.width &&
+         inner.y + inner.height <= outer.y + outer.height;
+}
+
+static SwRect rect_union(const SwRect& a, const SwRect& b) {
+  int32_t x0 = std::min(a.x, b.x);
+  int32_t y0 = std::min(a.y, b.y);
+  int32_t x1 = std::max(a.x + a.width, b.x + b.width);
+  int32_t y1 = std::max(a.y + a.height, b.y + b.height);
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
+void sw_damage_region_clear(SwDamageRegion* region) {
+  region->count = 0;
+}
+
+void sw_damage_region_add(SwDamageRegion* region, SwRect rect, int32_t bounds_width, int32_t bounds_height) {
+  int32_t x0 = std::max(rect.x, 0);
+  int32_t y0 = std::max(rect.y, 0);
+  int32_t x1 = std::min(rect.x + rect.width, bounds_width);
+  int32_t y1 = std::min(rect.y + rect.height, bounds_height);
+  if (x1 <= x0 || y1 <= y0) return;
+  SwRect clipped = {x0, y0, x1 - x0, y1 - y0};
+
+  // Drop rects the new one swallows, bail out if it is already covered
+  int kept = 0;
+  for (int i = 0; i < region->count; i++) {
+    if (rect_contains(region->rects[i], clipped)) return;
+    if (!rect_contains(clipped, region->rects[i])) {
+      region->rects[kept++] = region->rects[i];
+    }
+  }
+  region->count = kept;
+
+  if (region->count < SW_DAMAGE_MAX_RECTS) {
+    region->rects[region->count++] = clipped;
+    return;
+  }
+
+  // Full: merge whichever pair (including the new rect) wastes the least
+  // area when replaced by its bounding box.
+  SwRect candidates[SW_DAMAGE_MAX_RECTS + 1];
+  std::copy(region->rects, region->rects + SW_DAMAGE_MAX_RECTS, candidates);
+  candidates[SW_DAMAGE_MAX_RECTS] = clipped;
+  int best_a = 0, best_b = 1;
+  int64_t best_waste = INT64_MAX;
+  for (int a = 0; a <= SW_DAMAGE_MAX_RECTS; a++) {
+    for (int b = a + 1; b <= SW_DAMAGE_MAX_RECTS; b++) {
+      int64_t waste = rect_area(rect_union(candidates[a], candidates[b])) -
+                      rect_area(candidates[a]) - rect_area(candidates[b]);
+      if (waste < best_waste) {
+        best_waste = waste;
+        best_a = a;
+        best_b = b;
+      }
+    }
+  }
+  SwRect merged = rect_union(candidates[best_a], candidates[best_b]);
+  region->count = 0;
+  for (int i = 0; i <= SW_DAMAGE_MAX_RECTS; i++) {
+    if (i != best_a && i != best_b) {
+      region->rects[region->count++] = candidates[i];
+    }
+  }
+  // The merged rect may now contain others, re-add it through the normal path
+  sw_damage_region_add(region, merged, bounds_width, bounds_height);
+}
+
+void sw_damage_region_add_region(SwDamageRegion* region, const SwDamageRegion* other, int32_t bounds_width, int32_t bounds_height) {
+  for (int i = 0; i < other->count; i++) {
+    sw_damage_region_add(region, other->rects[i], bounds_width, bounds_height);
+  }
+}
+
+bool sw_damage_region_covers(const SwDamageRegion* region, int32_t bounds_width, int32_t bounds_height) {
+  SwRect bounds = {0, 0, bounds_width, bounds_height};
+  for (int i = 0; i < region->count; i++) {
+    if (rect_contains(region->rects[i], bounds)) return true;
+  }
+  return false;
+}
+
+int64_t sw_damage_region_area(const SwDamageRegion* region) {
+  int64_t area = 0;
+  for (int i = 0; i < region->count; i++) {
+    area += rect_area(region->rects[i]);
+  }
+  return area;
+}
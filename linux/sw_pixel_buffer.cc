@@ -32,7 +32,10 @@ G_DEFINE_TYPE(SwPixelBuffer, sw_pixel_buffer, fl_pixel_buffer_texture_get_type()
 
 static gboolean sw_pixel_buffer_copy_pixels(FlPixelBufferTexture* texture, const uint8_t** dst, uint32_t* width, uint32_t *height, GError** error) {
   SwPixelBuffer* buffer = SW_PIXEL_BUFFER(texture);
-  *dst = buffer->buffer;
+  if (!sw_frame_handoff_acquire(&buffer->handoff)) {
+    buffer->reused_frames.fetch_add(1, std::memory_order_relaxed);
+  }
+  *dst = buffer->frames[buffer->handoff.front];
   *width = buffer->width;
   *height = buffer->height;
   return TRUE;
@@ -41,9 +44,16 @@ static gboolean sw_pixel_buffer_copy_pixels(FlPixelBufferTexture* texture, const
 static void _sw_pixel_buffer_dispose(GObject* object) {
   SwPixelBuffer* buffer = SW_PIXEL_BUFFER(object);
   g_print("Disposing of SwPixelBuffer at %p\n", buffer);
-  if (buffer->buffer != nullptr) {
-    g_free(buffer->buffer);
-    buffer->buffer = nullptr;
+  for (int i = 0; i < SW_PIXEL_BUFFER_FRAME_COUNT; i++) {
+    g_free(buffer->frames[i]);
+    buffer->frames[i] = nullptr;
+  }
+  buffer->buffer = nullptr;
+  g_free(buffer->depth);
+  buffer->depth = nullptr;
+  if (buffer->compositor != nullptr) {
+    sw_compositor_free(buffer->compositor);
+    buffer->compositor = nullptr;
   }
   G_OBJECT_CLASS(sw_pixel_buffer_parent_class)->dispose(object);
 }
@@ -56,14 +66,36 @@ static void sw_pixel_buffer_class_init(SwPixelBufferClass* klass) {
 static void sw_pixel_buffer_init(SwPixelBuffer* buffer) {
   buffer->width = -1;
   buffer->height = -1;
+  for (int i = 0; i < SW_PIXEL_BUFFER_FRAME_COUNT; i++) {
+    buffer->frames[i] = nullptr;
+  }
   buffer->buffer = nullptr;
+  buffer->depth = nullptr;
+  buffer->compositor = nullptr;
+  sw_frame_handoff_init(&buffer->handoff);
+  buffer->latest = 0;
+  buffer->back_stale = FALSE;
+  sw_damage_region_clear(&buffer->damage);
+  for (int i = 0; i < SW_PIXEL_BUFFER_DAMAGE_HISTORY; i++) {
+    sw_damage_region_clear(&buffer->damage_history[i]);
+  }
+  buffer->publish_serial = 0;
+  for (int i = 0; i < SW_PIXEL_BUFFER_FRAME_COUNT; i++) {
+    buffer->frame_serial[i] = 0;
+  }
+  buffer->dropped_frames.store(0);
+  buffer->reused_frames.store(0);
+  buffer->published_frames.store(0);
 }
 
 SwPixelBuffer* sw_pixel_buffer_new(int64_t width, int64_t height) {
   SwPixelBuffer* buffer = SW_PIXEL_BUFFER(g_object_new(sw_pixel_buffer_get_type(), nullptr));
   buffer->width = width;
   buffer->height = height;
-  buffer->buffer = g_new0(uint8_t, width * height * 4);
+  for (int i = 0; i < SW_PIXEL_BUFFER_FRAME_COUNT; i++) {
+    buffer->frames[i] = g_new0(uint8_t, width * height * 4);
+  }
+  buffer->buffer = buffer->frames[buffer->handoff.back];
   return buffer;
 }
 
@@ -72,11 +104,178 @@ void sw_pixel_buffer_dispose(SwPixelBuffer* buffer) {
 }
 
 void sw_pixel_buffer_draw_rect(SwPixelBuffer* buffer, const uint8_t* pixels, int64_t x, int64_t y, int64_t width, int64_t height) {
-  int64_t num_rows = MIN(height, buffer->height - y);
-  int64_t num_cols = MIN(width, buffer->width - x);
-  for (int dy = 0; dy < num_rows; dy++) {
-    uint8_t* dst = buffer->buffer + 4 * ((y + dy) * buffer->width + x);
-    const uint8_t* src = pixels + 4 * (dy * width);
-    memcpy(dst, src, 4 * num_cols);
+  sw_pixel_buffer_draw_rect_strided(buffer, pixels, 4 * width, x, y, width, height);
+}
+
+static void sw_pixel_buffer_copy_region(SwPixelBuffer* buffer, uint8_t* dst, const uint8_t* src, const SwDamageRegion* region) {
+  int64_t row_bytes = 4 * buffer->width;
+  for (int i = 0; i < region->count; i++) {
+    const SwRect& rect = region->rects[i];
+    int64_t offset = rect.y * row_bytes + 4 * rect.x;
+    if (rect.width == buffer->width) {
+      memcpy(dst + offset, src + offset, rect.height * row_bytes);
+      continue;
+    }
+    for (int32_t dy = 0; dy < rect.height; dy++) {
+      memcpy(dst + offset, src + offset, 4 * rect.width);
+      offset += row_bytes;
+    }
+  }
+}
+
+// After a publish the back buffer holds an older frame. Bring it up to date
+// before drawing by copying only what changed since, unless the draw
+// replaces all of it anyway.
+static void sw_pixel_buffer_prepare_back(SwPixelBuffer* buffer, int64_t x, int64_t y, int64_t width, int64_t height) {
+  if (!buffer->back_stale) return;
+  buffer->back_stale = FALSE;
+  if (x <= 0 && y <= 0 && x + width >= buffer->width && y + height >= buffer->height) return;
+
+  const uint8_t* latest = buffer->frames[buffer->latest];
+  uint64_t since = buffer->frame_serial[buffer->handoff.back];
+  if (buffer->publish_serial - since > SW_PIXEL_BUFFER_DAMAGE_HISTORY) {
+    memcpy(buffer->buffer, latest, buffer->width * buffer->height * 4);
+    return;
+  }
+  SwDamageRegion missing;
+  sw_damage_region_clear(&missing);
+  for (uint64_t serial = since + 1; serial <= buffer->publish_serial; serial++) {
+    sw_damage_region_add_region(&missing, &buffer->damage_history[serial % SW_PIXEL_BUFFER_DAMAGE_HISTORY],
+                                buffer->width, buffer->height);
+  }
+  sw_pixel_buffer_copy_region(buffer, buffer->buffer, latest, &missing);
+}
+
+typedef struct {
+  int64_t x, y, width, height;
+  // How far into the source the clipped rect starts
+  int64_t skip_x, skip_y;
+} SwClippedRect;
+
+static bool sw_pixel_buffer_clip(SwPixelBuffer* buffer, int64_t x, int64_t y, int64_t width, int64_t height, SwClippedRect* clipped) {
+  clipped->skip_x = x < 0 ? -x : 0;
+  clipped->skip_y = y < 0 ? -y : 0;
+  clipped->x = x + clipped->skip_x;
+  clipped->y = y + clipped->skip_y;
+  clipped->width = MIN(x + width, buffer->width) - clipped->x;
+  clipped->height = MIN(y + height, buffer->height) - clipped->y;
+  return clipped->width > 0 && clipped->height > 0;
+}
+
+// Readies the back frame for a draw into `rect` and records the damage.
+// Blending reads the destination, so only plain writes may skip bringing
+// the frame up to date.
+static void sw_pixel_buffer_begin_draw(SwPixelBuffer* buffer, const SwClippedRect* rect, bool reads_dst) {
+  if (reads_dst) {
+    sw_pixel_buffer_prepare_back(buffer, 0, 0, 0, 0);
+  } else {
+    sw_pixel_buffer_prepare_back(buffer, rect->x, rect->y, rect->width, rect->height);
   }
+  sw_damage_region_add(&buffer->damage, {(int32_t)rect->x, (int32_t)rect->y, (int32_t)rect->width, (int32_t)rect->height},
+                       buffer->width, buffer->height);
+}
+
+void sw_pixel_buffer_draw_rect_strided(SwPixelBuffer* buffer, const uint8_t* pixels, int64_t stride, int64_t x, int64_t y, int64_t width, int64_t height) {
+  sw_pixel_buffer_draw_rect_mode(buffer, pixels, stride, x, y, width, height, SW_BLIT_COPY);
+}
+
+void sw_pixel_buffer_draw_rect_mode(SwPixelBuffer* buffer, const uint8_t* pixels, int64_t stride, int64_t x, int64_t y, int64_t width, int64_t height, SwBlitMode mode) {
+  SwClippedRect rect;
+  if (!sw_pixel_buffer_clip(buffer, x, y, width, height, &rect)) return;
+  sw_pixel_buffer_begin_draw(buffer, &rect, mode == SW_BLIT_BLEND);
+  pixels += rect.skip_y * stride + 4 * rect.skip_x;
+  uint8_t* dst = buffer->buffer + 4 * (rect.y * buffer->width + rect.x);
+  if (mode == SW_BLIT_COPY && stride == 4 * buffer->width && rect.width == buffer->width) {
+    // Rows are contiguous on both sides, copy the whole block at once
+    memcpy(dst, pixels, 4 * rect.height * rect.width);
+    return;
+  }
+  SwBlitRowFunc row = sw_blit_get_kernels()->rows[mode];
+  for (int64_t dy = 0; dy < rect.height; dy++) {
+    row(dst + 4 * dy * buffer->width, pixels + dy * stride, rect.width);
+  }
+}
+
+void sw_pixel_buffer_draw_scaled(SwPixelBuffer* buffer, const uint8_t* pixels, int64_t stride, int64_t src_width, int64_t src_height, int64_t x, int64_t y, int64_t width, int64_t height, SwBlitMode mode) {
+  // Source coordinates are 16.16 fixed point
+  if (src_width <= 0 || src_height <= 0 || src_width > 0xFFFF || src_height > 0xFFFF) return;
+  SwClippedRect rect;
+  if (!sw_pixel_buffer_clip(buffer, x, y, width, height, &rect)) return;
+  sw_pixel_buffer_begin_draw(buffer, &rect, mode == SW_BLIT_BLEND);
+
+  const SwBlitKernels* kernels = sw_blit_get_kernels();
+  uint32_t step_x = (uint32_t)((src_width << 16) / width);
+  uint32_t step_y = (uint32_t)((src_height << 16) / height);
+  // Sample at pixel centers
+  uint32_t x0 = (uint32_t)(rect.skip_x * step_x + step_x / 2);
+  uint32_t sy = (uint32_t)(rect.skip_y * step_y + step_y / 2);
+  // Anything but a plain copy is resampled into a scratch row first
+  uint8_t* scratch = mode == SW_BLIT_COPY ? nullptr : g_new(uint8_t, 4 * rect.width);
+  for (int64_t dy = 0; dy < rect.height; dy++) {
+    uint8_t* dst = buffer->buffer + 4 * ((rect.y + dy) * buffer->width + rect.x);
+    const uint8_t* src = pixels + (sy >> 16) * stride;
+    if (scratch == nullptr) {
+      kernels->scale(dst, src, rect.width, x0, step_x);
+    } else {
+      kernels->scale(scratch, src, rect.width, x0, step_x);
+      kernels->rows[mode](dst, scratch, rect.width);
+    }
+    sy += step_y;
+  }
+  g_free(scratch);
+}
+
+void sw_pixel_buffer_fill_rect(SwPixelBuffer* buffer, uint32_t color, int64_t x, int64_t y, int64_t width, int64_t height) {
+  SwClippedRect rect;
+  if (!sw_pixel_buffer_clip(buffer, x, y, width, height, &rect)) return;
+  sw_pixel_buffer_begin_draw(buffer, &rect, false);
+  const SwBlitKernels* kernels = sw_blit_get_kernels();
+  uint8_t* dst = buffer->buffer + 4 * (rect.y * buffer->width + rect.x);
+  if (rect.width == buffer->width) {
+    kernels->fill(dst, color, rect.width * rect.height);
+    return;
+  }
+  for (int64_t dy = 0; dy < rect.height; dy++) {
+    kernels->fill(dst + 4 * dy * buffer->width, color, rect.width);
+  }
+}
+
+void sw_pixel_buffer_publish(SwPixelBuffer* buffer) {
+  // Nothing was drawn since the last publish, the raster thread has it already.
+  if (buffer->back_stale) return;
+  if (buffer->damage.count == 0) {
+    sw_damage_region_add(&buffer->damage, {0, 0, (int32_t)buffer->width, (int32_t)buffer->height},
+                         buffer->width, buffer->height);
+  }
+  buffer->publish_serial++;
+  buffer->damage_history[buffer->publish_serial % SW_PIXEL_BUFFER_DAMAGE_HISTORY] = buffer->damage;
+  sw_damage_region_clear(&buffer->damage);
+  buffer->frame_serial[buffer->handoff.back] = buffer->publish_serial;
+
+  buffer->latest = buffer->handoff.back;
+  if (sw_frame_handoff_publish(&buffer->handoff)) {
+    buffer->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+  }
+  buffer->published_frames.fetch_add(1, std::memory_order_relaxed);
+  buffer->buffer = buffer->frames[buffer->handoff.back];
+  buffer->back_stale = TRUE;
+}
+
+void sw_pixel_buffer_add_damage(SwPixelBuffer* buffer, int64_t x, int64_t y, int64_t width, int64_t height) {
+  sw_pixel_buffer_prepare_back(buffer, 0, 0, 0, 0);
+  sw_damage_region_add(&buffer->damage, {(int32_t)x, (int32_t)y, (int32_t)width, (int32_t)height},
+                       buffer->width, buffer->height);
+}
+
+const SwDamageRegion* sw_pixel_buffer_get_damage(SwPixelBuffer* buffer) {
+  return &buffer->damage_history[buffer->publish_serial % SW_PIXEL_BUFFER_DAMAGE_HISTORY];
+}
+
+uint8_t* sw_pixel_buffer_begin_frame(SwPixelBuffer* buffer) {
+  sw_pixel_buffer_prepare_back(buffer, 0, 0, 0, 0);
+  return buffer->buffer;
+}
+
+const uint8_t* sw_pixel_buffer_peek(SwPixelBuffer* buffer) {
+  return buffer->back_stale ? buffer->frames[buffer->latest] : buffer->buffer;
 }
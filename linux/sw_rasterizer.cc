@@ -0,0 +1,484 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#include "include/webgpu_rend/sw_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "include/webgpu_rend/sw_blit.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Edge functions are evaluated four pixels at a time. SSE2 and NEON are part
+// of the x86-64 and AArch64 baselines, so unlike the blit kernels there is
+// nothing to dispatch on at runtime.
+#if defined(__SSE2__)
+typedef __m128 SwF4;
+static inline SwF4 sw_f4_set1(float v) { return _mm_set1_ps(v); }
+static inline SwF4 sw_f4_setr(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline SwF4 sw_f4_add(SwF4 a, SwF4 b) { return _mm_add_ps(a, b); }
+static inline SwF4 sw_f4_mul(SwF4 a, SwF4 b) { return _mm_mul_ps(a, b); }
+static inline SwF4 sw_f4_cmpgt(SwF4 a, SwF4 b) { return _mm_cmpgt_ps(a, b); }
+static inline SwF4 sw_f4_cmpeq(SwF4 a, SwF4 b) { return _mm_cmpeq_ps(a, b); }
+static inline SwF4 sw_f4_and(SwF4 a, SwF4 b) { return _mm_and_ps(a, b); }
+static inline SwF4 sw_f4_or(SwF4 a, SwF4 b) { return _mm_or_ps(a, b); }
+static inline SwF4 sw_f4_mask(bool set) { return _mm_castsi128_ps(_mm_set1_epi32(set ? -1 : 0)); }
+static inline int sw_f4_movemask(SwF4 mask) { return _mm_movemask_ps(mask); }
+static inline void sw_f4_store(float* dst, SwF4 v) { _mm_storeu_ps(dst, v); }
+#elif defined(__ARM_NEON)
+typedef float32x4_t SwF4;
+static inline SwF4 sw_f4_set1(float v) { return vdupq_n_f32(v); }
+static inline SwF4 sw_f4_setr(float a, float b, float c, float d) {
+  const float v[4] = {a, b, c, d};
+  return vld1q_f32(v);
+}
+static inline SwF4 sw_f4_add(SwF4 a, SwF4 b) { return vaddq_f32(a, b); }
+static inline SwF4 sw_f4_mul(SwF4 a, SwF4 b) { return vmulq_f32(a, b); }
+static inline SwF4 sw_f4_cmpgt(SwF4 a, SwF4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+static inline SwF4 sw_f4_cmpeq(SwF4 a, SwF4 b) { return vreinterpretq_f32_u32(vceqq_f32(a, b)); }
+static inline SwF4 sw_f4_and(SwF4 a, SwF4 b) {
+  return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+static inline SwF4 sw_f4_or(SwF4 a, SwF4 b) {
+  return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+static inline SwF4 sw_f4_mask(bool set) { return vreinterpretq_f32_u32(vdupq_n_u32(set ? 0xFFFFFFFFu : 0)); }
+static inline int sw_f4_movemask(SwF4 mask) {
+  uint32x4_t m = vshrq_n_u32(vreinterpretq_u32_f32(mask), 31);
+  return (int)(vgetq_lane_u32(m, 0) | (vgetq_lane_u32(m, 1) << 1) | (vgetq_lane_u32(m, 2) << 2) |
+               (vgetq_lane_u32(m, 3) << 3));
+}
+static inline void sw_f4_store(float* dst, SwF4 v) { vst1q_f32(dst, v); }
+#else
+// Masks are 1.0 or 0.0 per lane
+typedef struct {
+  float v[4];
+} SwF4;
+static inline SwF4 sw_f4_set1(float v) { return {{v, v, v, v}}; }
+static inline SwF4 sw_f4_setr(float a, float b, float c, float d) { return {{a, b, c, d}}; }
+static inline SwF4 sw_f4_add(SwF4 a, SwF4 b) {
+  return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+static inline SwF4 sw_f4_mul(SwF4 a, SwF4 b) {
+  return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+}
+static inline SwF4 sw_f4_cmpgt(SwF4 a, SwF4 b) {
+  SwF4 r;
+  for (int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? 1.0f : 0.0f;
+  return r;
+}
+static inline SwF4 sw_f4_cmpeq(SwF4 a, SwF4 b) {
+  SwF4 r;
+  for (int i = 0; i < 4; i++) r.v[i] = a.v[i] == b.v[i] ? 1.0f : 0.0f;
+  return r;
+}
+static inline SwF4 sw_f4_and(SwF4 a, SwF4 b) { return sw_f4_mul(a, b); }
+static inline SwF4 sw_f4_or(SwF4 a, SwF4 b) {
+  SwF4 r;
+  for (int i = 0; i < 4; i++) r.v[i] = std::max(a.v[i], b.v[i]);
+  return r;
+}
+static inline SwF4 sw_f4_mask(bool set) { return sw_f4_set1(set ? 1.0f : 0.0f); }
+static inline int sw_f4_movemask(SwF4 mask) {
+  int bits = 0;
+  for (int i = 0; i < 4; i++) bits |= (mask.v[i] != 0.0f) << i;
+  return bits;
+}
+static inline void sw_f4_store(float* dst, SwF4 v) { memcpy(dst, v.v, sizeof(v.v)); }
+#endif
+
+// Screen positions are snapped to 1/16 pixel. Together with the guard band
+// below this keeps every edge function coefficient exact in a float and every
+// per-row edge value exact in a double, which is what makes shared edges
+// watertight: two triangles sharing an edge compute exactly negated values.
+#define SW_RASTER_SUBPIXEL 16.0f
+#define SW_RASTER_GUARD_BAND 8192.0f
+// Most vertices one triangle can turn into when clipped against all planes
+#define SW_RASTER_MAX_CLIPPED 9
+
+typedef struct {
+  float x, y, z, w;
+  float light;
+} SwClipVertex;
+
+typedef struct {
+  // Edge i runs from vertex i to vertex (i + 1) % 3, and
+  // E_i(p) = a * (p.x - x) + b * (p.y - y) is positive inside.
+  float x[3], y[3];
+  float a[3], b[3];
+  // Pixels exactly on an edge belong to the triangle only for top-left edges
+  bool top_left[3];
+  // Attributes are linear in the edge functions: f = f0 + f_2 * E_2 + f_0 * E_0
+  float z0, z_e2, z_e0;
+  float l0, l_e2, l_e0;
+  // Inclusive pixel bounds, already clipped to the target
+  int32_t min_x, min_y, max_x, max_y;
+} SwRasterTriangle;
+
+// Triangles set up by one setup task, and which tiles each one overlaps.
+// Tiles walk the bins in task order, so draw order is preserved.
+typedef struct {
+  std::vector<SwRasterTriangle> triangles;
+  std::vector<std::vector<uint32_t>> tiles;
+  int32_t min_x, min_y, max_x, max_y;
+} SwRasterBin;
+
+struct _SwRasterizer {
+  SwThreadPool* pool;
+  std::vector<SwClipVertex> vertices;
+  std::vector<SwRasterBin> bins;
+};
+
+typedef struct {
+  SwRasterizer* rasterizer;
+  const SwRasterTarget* target;
+  const SwMeshDraw* draw;
+  int64_t triangle_count;
+  int64_t triangles_per_task;
+  int32_t tiles_x;
+  uint32_t color;
+  float depth;
+} SwRasterJob;
+
+#define SW_RASTER_VERTICES_PER_TASK 4096
+#define SW_RASTER_TRIANGLES_PER_TASK 1024
+
+static void sw_rasterizer_transform_task(void* data, int64_t task, int /*worker*/) {
+  SwRasterJob* job = (SwRasterJob*)data;
+  const SwMeshDraw* draw = job->draw;
+  const float* m = draw->mvp;
+  int64_t end = std::min((task + 1) * SW_RASTER_VERTICES_PER_TASK, draw->vertex_count);
+  for (int64_t i = task * SW_RASTER_VERTICES_PER_TASK; i < end; i++) {
+    const float* v = draw->vertices + 6 * i;
+    SwClipVertex& out = job->rasterizer->vertices[i];
+    out.x = m[0] * v[0] + m[4] * v[1] + m[8] * v[2] + m[12];
+    out.y = m[1] * v[0] + m[5] * v[1] + m[9] * v[2] + m[13];
+    out.z = m[2] * v[0] + m[6] * v[1] + m[10] * v[2] + m[14];
+    out.w = m[3] * v[0] + m[7] * v[1] + m[11] * v[2] + m[15];
+    float length = std::sqrt(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]);
+    float diffuse = 0.0f;
+    if (length > 0.0f) {
+      diffuse = (v[3] * draw->light_dir[0] + v[4] * draw->light_dir[1] + v[5] * draw->light_dir[2]) / length;
+    }
+    out.light = std::max(diffuse, 0.0f) + draw->ambient;
+  }
+}
+
+// Clips a polygon against plane . (x, y, z, w) + offset >= 0 (Sutherland-Hodgman)
+static int sw_rasterizer_clip(const SwClipVertex* in, int count, SwClipVertex* out, const float plane[5]) {
+  int out_count = 0;
+  for (int i = 0; i < count; i++) {
+    const SwClipVertex& a = in[i];
+    const SwClipVertex& b = in[(i + 1) % count];
+    float da = plane[0] * a.x + plane[1] * a.y + plane[2] * a.z + plane[3] * a.w + plane[4];
+    float db = plane[0] * b.x + plane[1] * b.y + plane[2] * b.z + plane[3] * b.w + plane[4];
+    if (da >= 0) out[out_count++] = a;
+    if ((da >= 0) != (db >= 0)) {
+      float t = da / (da - db);
+      SwClipVertex& v = out[out_count++];
+      v.x = a.x + (b.x - a.x) * t;
+      v.y = a.y + (b.y - a.y) * t;
+      v.z = a.z + (b.z - a.z) * t;
+      v.w = a.w + (b.w - a.w) * t;
+      v.light = a.light + (b.light - a.light) * t;
+    }
+  }
+  return out_count;
+}
+
+typedef struct {
+  float x, y, z, light;
+} SwScreenVertex;
+
+static void sw_rasterizer_setup_triangle(SwRasterJob* job, SwRasterBin* bin, SwScreenVertex v0, SwScreenVertex v1, SwScreenVertex v2) {
+  const SwRasterTarget* target = job->target;
+  // Twice the signed area. Exact, since positions are snapped.
+  double area = ((double)v1.x - v0.x) * ((double)v2.y - v0.y) - ((double)v2.x - v0.x) * ((double)v1.y - v0.y);
+  if (area == 0) return;
+  // Screen y points down, so counter-clockwise in clip space is negative here
+  bool front = area < 0;
+  if ((job->draw->cull_mode == SW_CULL_BACK && !front) || (job->draw->cull_mode == SW_CULL_FRONT && front)) return;
+  if (area < 0) {
+    std::swap(v1, v2);
+    area = -area;
+  }
+
+  SwRasterTriangle tri;
+  float min_x = std::min({v0.x, v1.x, v2.x});
+  float max_x = std::max({v0.x, v1.x, v2.x});
+  float min_y = std::min({v0.y, v1.y, v2.y});
+  float max_y = std::max({v0.y, v1.y, v2.y});
+  // Pixels whose centers may be inside
+  tri.min_x = std::max((int32_t)std::ceil(min_x - 0.5f), 0);
+  tri.min_y = std::max((int32_t)std::ceil(min_y - 0.5f), 0);
+  tri.max_x = std::min((int32_t)std::floor(max_x - 0.5f), target->width - 1);
+  tri.max_y = std::min((int32_t)std::floor(max_y - 0.5f), target->height - 1);
+  if (tri.min_x > tri.max_x || tri.min_y > tri.max_y) return;
+
+  const SwScreenVertex* v[3] = {&v0, &v1, &v2};
+  for (int i = 0; i < 3; i++) {
+    const SwScreenVertex* from = v[i];
+    const SwScreenVertex* to = v[(i + 1) % 3];
+    float dx = to->x - from->x;
+    float dy = to->y - from->y;
+    tri.x[i] = from->x;
+    tri.y[i] = from->y;
+    tri.a[i] = -dy;
+    tri.b[i] = dx;
+    tri.top_left[i] = dy < 0 || (dy == 0 && dx > 0);
+  }
+  // Barycentric weight of v1 is E_2 / area, of v2 is E_0 / area
+  float inv_area = (float)(1.0 / area);
+  tri.z0 = v0.z;
+  tri.z_e2 = (v1.z - v0.z) * inv_area;
+  tri.z_e0 = (v2.z - v0.z) * inv_area;
+  tri.l0 = v0.light;
+  tri.l_e2 = (v1.light - v0.light) * inv_area;
+  tri.l_e0 = (v2.light - v0.light) * inv_area;
+
+  uint32_t index = (uint32_t)bin->triangles.size();
+  bin->triangles.push_back(tri);
+  for (int32_t ty = tri.min_y / SW_RASTER_TILE_SIZE; ty <= tri.max_y / SW_RASTER_TILE_SIZE; ty++) {
+    for (int32_t tx = tri.min_x / SW_RASTER_TILE_SIZE; tx <= tri.max_x / SW_RASTER_TILE_SIZE; tx++) {
+      bin->tiles[ty * job->tiles_x + tx].push_back(index);
+    }
+  }
+  bin->min_x = std::min(bin->min_x, tri.min_x);
+  bin->min_y = std::min(bin->min_y, tri.min_y);
+  bin->max_x = std::max(bin->max_x, tri.max_x);
+  bin->max_y = std::max(bin->max_y, tri.max_y);
+}
+
+static void sw_rasterizer_setup_task(void* data, int64_t task, int /*worker*/) {
+  SwRasterJob* job = (SwRasterJob*)data;
+  const SwMeshDraw* draw = job->draw;
+  const SwRasterTarget* target = job->target;
+  SwRasterBin* bin = &job->rasterizer->bins[task];
+  bin->triangles.clear();
+  for (std::vector<uint32_t>& tile : bin->tiles) tile.clear();
+  bin->min_x = bin->min_y = INT32_MAX;
+  bin->max_x = bin->max_y = -1;
+
+  // Keep screen coordinates within +-SW_RASTER_GUARD_BAND, see above
+  float guard_x = std::max(2.0f * SW_RASTER_GUARD_BAND / target->width - 1.0f, 1.0f);
+  float guard_y = std::max(2.0f * SW_RASTER_GUARD_BAND / target->height - 1.0f, 1.0f);
+  const float planes[6][5] = {
+      {0, 0, 1, 0, 0},         // near: z >= 0
+      {0, 0, 0, 1, -1e-6f},    // w > 0
+      {-1, 0, 0, guard_x, 0},  // x <= guard * w
+      {1, 0, 0, guard_x, 0},
+      {0, -1, 0, guard_y, 0},
+      {0, 1, 0, guard_y, 0},
+  };
+
+  int64_t start = task * job->triangles_per_task;
+  int64_t end = std::min(start + job->triangles_per_task, job->triangle_count);
+  for (int64_t t = start; t < end; t++) {
+    const uint32_t* index = draw->indices + 3 * t;
+    if (index[0] >= draw->vertex_count || index[1] >= draw->vertex_count || index[2] >= draw->vertex_count) continue;
+    SwClipVertex polygon[2][SW_RASTER_MAX_CLIPPED];
+    int count = 3;
+    for (int i = 0; i < 3; i++) polygon[0][i] = job->rasterizer->vertices[index[i]];
+
+    // Only clip against planes some vertex is actually outside of
+    int current = 0;
+    for (const float* plane : planes) {
+      bool outside = false;
+      for (int i = 0; i < count && !outside; i++) {
+        const SwClipVertex& p = polygon[current][i];
+        outside = plane[0] * p.x + plane[1] * p.y + plane[2] * p.z + plane[3] * p.w + plane[4] < 0;
+      }
+      if (!outside) continue;
+      count = sw_rasterizer_clip(polygon[current], count, polygon[1 - current], plane);
+      current = 1 - current;
+      if (count < 3) break;
+    }
+    if (count < 3) continue;
+
+    SwScreenVertex screen[SW_RASTER_MAX_CLIPPED];
+    for (int i = 0; i < count; i++) {
+      const SwClipVertex& p = polygon[current][i];
+      float inv_w = 1.0f / p.w;
+      float sx = (p.x * inv_w * 0.5f + 0.5f) * target->width;
+      float sy = (0.5f - p.y * inv_w * 0.5f) * target->height;
+      screen[i].x = std::round(sx * SW_RASTER_SUBPIXEL) / SW_RASTER_SUBPIXEL;
+      screen[i].y = std::round(sy * SW_RASTER_SUBPIXEL) / SW_RASTER_SUBPIXEL;
+      screen[i].z = p.z * inv_w;
+      screen[i].light = p.light;
+    }
+    for (int i = 1; i + 1 < count; i++) {
+      sw_rasterizer_setup_triangle(job, bin, screen[0], screen[i], screen[i + 1]);
+    }
+  }
+}
+
+static void sw_rasterizer_shade(const SwRasterJob* job, const SwRasterTriangle& tri, int32_t tile_x, int32_t tile_y) {
+  const SwRasterTarget* target = job->target;
+  int32_t x0 = std::max(tri.min_x, tile_x);
+  int32_t y0 = std::max(tri.min_y, tile_y);
+  int32_t x1 = std::min(tri.max_x, tile_x + SW_RASTER_TILE_SIZE - 1);
+  int32_t y1 = std::min(tri.max_y, tile_y + SW_RASTER_TILE_SIZE - 1);
+  if (x0 > x1 || y0 > y1) return;
+
+  // Skip the block if it lies entirely outside one of the edges
+  for (int i = 0; i < 3; i++) {
+    double cx = tri.a[i] > 0 ? x1 + 0.5 : x0 + 0.5;
+    double cy = tri.b[i] > 0 ? y1 + 0.5 : y0 + 0.5;
+    if ((double)tri.a[i] * (cx - tri.x[i]) + (double)tri.b[i] * (cy - tri.y[i]) < 0) return;
+  }
+
+  const uint8_t* rgba = (const uint8_t*)&job->draw->color;
+  const float r = rgba[0], g = rgba[1], b = rgba[2];
+  const SwF4 zero = sw_f4_set1(0.0f);
+  const SwF4 lanes = sw_f4_setr(0.0f, 1.0f, 2.0f, 3.0f);
+  SwF4 a[3], tie[3];
+  for (int i = 0; i < 3; i++) {
+    a[i] = sw_f4_set1(tri.a[i]);
+    tie[i] = sw_f4_mask(tri.top_left[i]);
+  }
+  const SwF4 z0 = sw_f4_set1(tri.z0), z_e2 = sw_f4_set1(tri.z_e2), z_e0 = sw_f4_set1(tri.z_e0);
+  const SwF4 l0 = sw_f4_set1(tri.l0), l_e2 = sw_f4_set1(tri.l_e2), l_e0 = sw_f4_set1(tri.l_e0);
+
+  for (int32_t y = y0; y <= y1; y++) {
+    // Evaluated from the tile origin rather than the triangle bounds, so a
+    // neighbouring triangle evaluates the exact same expression.
+    SwF4 row[3];
+    for (int i = 0; i < 3; i++) {
+      double e = (double)tri.a[i] * (tile_x + 0.5 - tri.x[i]) + (double)tri.b[i] * (y + 0.5 - tri.y[i]);
+      row[i] = sw_f4_set1((float)e);
+    }
+    float* depth_row = target->depth + (int64_t)y * target->width;
+    uint8_t* pixel_row = target->pixels + (int64_t)y * target->stride;
+    for (int32_t x = x0; x <= x1; x += 4) {
+      SwF4 dx = sw_f4_add(sw_f4_set1((float)(x - tile_x)), lanes);
+      SwF4 e[3];
+      SwF4 inside = sw_f4_mask(true);
+      for (int i = 0; i < 3; i++) {
+        e[i] = sw_f4_add(row[i], sw_f4_mul(a[i], dx));
+        inside = sw_f4_and(inside, sw_f4_or(sw_f4_cmpgt(e[i], zero), sw_f4_and(sw_f4_cmpeq(e[i], zero), tie[i])));
+      }
+      int mask = sw_f4_movemask(inside);
+      if (x1 - x < 3) mask &= (1 << (x1 - x + 1)) - 1;
+      if (mask == 0) continue;
+
+      float z[4], light[4];
+      sw_f4_store(z, sw_f4_add(z0, sw_f4_add(sw_f4_mul(z_e2, e[2]), sw_f4_mul(z_e0, e[0]))));
+      sw_f4_store(light, sw_f4_add(l0, sw_f4_add(sw_f4_mul(l_e2, e[2]), sw_f4_mul(l_e0, e[0]))));
+      for (int lane = 0; lane < 4; lane++) {
+        if (!(mask & (1 << lane))) continue;
+        float& depth = depth_row[x + lane];
+        if (!(z[lane] < depth)) continue;
+        depth = z[lane];
+        uint8_t* pixel = pixel_row + 4 * (x + lane);
+        pixel[0] = (uint8_t)std::min(r * light[lane] + 0.5f, 255.0f);
+        pixel[1] = (uint8_t)std::min(g * light[lane] + 0.5f, 255.0f);
+        pixel[2] = (uint8_t)std::min(b * light[lane] + 0.5f, 255.0f);
+        pixel[3] = rgba[3];
+      }
+    }
+  }
+}
+
+static void sw_rasterizer_tile_task(void* data, int64_t task, int /*worker*/) {
+  SwRasterJob* job = (SwRasterJob*)data;
+  int32_t tile_x = (int32_t)(task % job->tiles_x) * SW_RASTER_TILE_SIZE;
+  int32_t tile_y = (int32_t)(task / job->tiles_x) * SW_RASTER_TILE_SIZE;
+  for (const SwRasterBin& bin : job->rasterizer->bins) {
+    for (uint32_t index : bin.tiles[task]) {
+      sw_rasterizer_shade(job, bin.triangles[index], tile_x, tile_y);
+    }
+  }
+}
+
+static void sw_rasterizer_clear_task(void* data, int64_t task, int /*worker*/) {
+  SwRasterJob* job = (SwRasterJob*)data;
+  const SwRasterTarget* target = job->target;
+  int32_t end = std::min((int32_t)(task + 1) * SW_RASTER_TILE_SIZE, target->height);
+  const SwBlitKernels* kernels = sw_blit_get_kernels();
+  for (int32_t y = (int32_t)task * SW_RASTER_TILE_SIZE; y < end; y++) {
+    kernels->fill(target->pixels + (int64_t)y * target->stride, job->color, target->width);
+    float* depth = target->depth + (int64_t)y * target->width;
+    std::fill(depth, depth + target->width, job->depth);
+  }
+}
+
+SwRasterizer* sw_rasterizer_new(SwThreadPool* pool) {
+  SwRasterizer* rasterizer = new SwRasterizer();
+  rasterizer->pool = pool;
+  return rasterizer;
+}
+
+void sw_rasterizer_free(SwRasterizer* rasterizer) {
+  delete rasterizer;
+}
+
+void sw_rasterizer_clear(SwRasterizer* rasterizer, const SwRasterTarget* target, uint32_t color, float depth) {
+  SwRasterJob job = {};
+  job.rasterizer = rasterizer;
+  job.target = target;
+  job.color = color;
+  job.depth = depth;
+  int64_t bands = (target->height + SW_RASTER_TILE_SIZE - 1) / SW_RASTER_TILE_SIZE;
+  sw_thread_pool_run(rasterizer->pool, bands, sw_rasterizer_clear_task, &job);
+}
+
+SwRect sw_rasterizer_draw(SwRasterizer* rasterizer, const SwRasterTarget* target, const SwMeshDraw* draw) {
+  SwRect bounds = {0, 0, 0, 0};
+  if (target->width <= 0 || target->height <= 0 || draw->vertex_count <= 0 || draw->index_count < 3) return bounds;
+
+  SwRasterJob job = {};
+  job.rasterizer = rasterizer;
+  job.target = target;
+  job.draw = draw;
+  job.triangle_count = draw->index_count / 3;
+  job.tiles_x = (target->width + SW_RASTER_TILE_SIZE - 1) / SW_RASTER_TILE_SIZE;
+  int32_t tiles_y = (target->height + SW_RASTER_TILE_SIZE - 1) / SW_RASTER_TILE_SIZE;
+  int64_t tile_count = (int64_t)job.tiles_x * tiles_y;
+
+  rasterizer->vertices.resize(draw->vertex_count);
+  int64_t transform_tasks = (draw->vertex_count + SW_RASTER_VERTICES_PER_TASK - 1) / SW_RASTER_VERTICES_PER_TASK;
+  sw_thread_pool_run(rasterizer->pool, transform_tasks, sw_rasterizer_transform_task, &job);
+
+  // A few setup tasks per worker keeps the load balanced without making
+  // every tile walk too many bins.
+  int64_t setup_tasks = std::min<int64_t>((job.triangle_count + SW_RASTER_TRIANGLES_PER_TASK - 1) / SW_RASTER_TRIANGLES_PER_TASK,
+                                          4 * sw_thread_pool_get_size(rasterizer->pool));
+  job.triangles_per_task = (job.triangle_count + setup_tasks - 1) / setup_tasks;
+  rasterizer->bins.resize(setup_tasks);
+  for (SwRasterBin& bin : rasterizer->bins) bin.tiles.resize(tile_count);
+  sw_thread_pool_run(rasterizer->pool, setup_tasks, sw_rasterizer_setup_task, &job);
+
+  sw_thread_pool_run(rasterizer->pool, tile_count, sw_rasterizer_tile_task, &job);
+
+  int32_t min_x = INT32_MAX, min_y = INT32_MAX, max_x = -1, max_y = -1;
+  for (const SwRasterBin& bin : rasterizer->bins) {
+    min_x = std::min(min_x, bin.min_x);
+    min_y = std::min(min_y, bin.min_y);
+    max_x = std::max(max_x, bin.max_x);
+    max_y = std::max(max_y, bin.max_y);
+  }
+  if (max_x >= min_x && max_y >= min_y) {
+    bounds = {min_x, min_y, max_x - min_x + 1, max_y - min_y + 1};
+  }
+  return bounds;
+}
@@ -0,0 +1,114 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#include "include/webgpu_rend/sw_readback.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "include/webgpu_rend/sw_blit.h"
+
+static int sw_read_format_bytes(SwReadFormat format) {
+  return format == SW_READ_RGB ? 3 : 4;
+}
+
+bool sw_read_region_clip(SwReadRegion* region, int64_t frame_width, int64_t frame_height) {
+  if (region->width <= 0 || region->height <= 0) return false;
+  if (region->dst_width <= 0 || region->dst_height <= 0) return false;
+  if (region->dst_width > region->width || region->dst_height > region->height) return false;
+  if (region->format < 0 || region->format >= SW_READ_FORMAT_COUNT) return false;
+  int64_t x0 = std::max<int64_t>(region->x, 0);
+  int64_t y0 = std::max<int64_t>(region->y, 0);
+  int64_t x1 = std::min<int64_t>((int64_t)region->x + region->width, frame_width);
+  int64_t y1 = std::min<int64_t>((int64_t)region->y + region->height, frame_height);
+  if (x1 <= x0 || y1 <= y0) return false;
+  // Keep the scale factor of whatever survived the clip
+  int64_t dst_width = std::max<int64_t>((x1 - x0) * region->dst_width / region->width, 1);
+  int64_t dst_height = std::max<int64_t>((y1 - y0) * region->dst_height / region->height, 1);
+  region->x = (int32_t)x0;
+  region->y = (int32_t)y0;
+  region->width = (int32_t)(x1 - x0);
+  region->height = (int32_t)(y1 - y0);
+  region->dst_width = (int32_t)dst_width;
+  region->dst_height = (int32_t)dst_height;
+  return true;
+}
+
+size_t sw_read_output_size(const SwReadRegion* region) {
+  return (size_t)region->dst_width * region->dst_height * sw_read_format_bytes(region->format);
+}
+
+static void sw_read_convert_row(const uint8_t* src, uint8_t* dst, int32_t count, SwReadFormat format) {
+  switch (format) {
+    case SW_READ_RGBA:
+      memcpy(dst, src, 4 * (size_t)count);
+      break;
+    case SW_READ_BGRA:
+      sw_blit_get_kernels()->rows[SW_BLIT_SWIZZLE](dst, src, count);
+      break;
+    default:
+      for (int32_t i = 0; i < count; i++) {
+        dst[3 * i] = src[4 * i];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i + 2];
+      }
+      break;
+  }
+}
+
+void sw_read_pixels(const uint8_t* src, int64_t stride, const SwReadRegion* region, uint8_t* out) {
+  int bytes = sw_read_format_bytes(region->format);
+  size_t out_stride = (size_t)region->dst_width * bytes;
+  if (region->dst_width == region->width && region->dst_height == region->height) {
+    for (int32_t y = 0; y < region->height; y++) {
+      sw_read_convert_row(src + y * stride, out + y * out_stride, region->width, region->format);
+    }
+    return;
+  }
+
+  // Box filter. Output pixel x covers source columns [x_start[x], x_start[x + 1]).
+  std::vector<int32_t> x_start(region->dst_width + 1);
+  for (int32_t x = 0; x <= region->dst_width; x++) {
+    x_start[x] = (int32_t)((int64_t)x * region->width / region->dst_width);
+  }
+  std::vector<uint32_t> sums(4 * (size_t)region->dst_width);
+  std::vector<uint8_t> row(4 * (size_t)region->dst_width);
+  for (int32_t y = 0; y < region->dst_height; y++) {
+    int32_t y0 = (int32_t)((int64_t)y * region->height / region->dst_height);
+    int32_t y1 = (int32_t)((int64_t)(y + 1) * region->height / region->dst_height);
+    std::fill(sums.begin(), sums.end(), 0);
+    for (int32_t sy = y0; sy < y1; sy++) {
+      const uint8_t* line = src + sy * stride;
+      for (int32_t x = 0; x < region->dst_width; x++) {
+        uint32_t* sum = &sums[4 * x];
+        for (int32_t sx = x_start[x]; sx < x_start[x + 1]; sx++) {
+          sum[0] += line[4 * sx];
+          sum[1] += line[4 * sx + 1];
+          sum[2] += line[4 * sx + 2];
+          sum[3] += line[4 * sx + 3];
+        }
+      }
+    }
+    for (int32_t x = 0; x < region->dst_width; x++) {
+      uint32_t count = (uint32_t)(x_start[x + 1] - x_start[x]) * (y1 - y0);
+      for (int c = 0; c < 4; c++) {
+        row[4 * x + c] = (uint8_t)((sums[4 * x + c] + count / 2) / count);
+      }
+    }
+    sw_read_convert_row(row.data(), out + y * out_stride, region->dst_width, region->format);
+  }
+}
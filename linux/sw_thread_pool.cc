@@ -0,0 +1,116 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#include "include/webgpu_rend/sw_thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct _SwThreadPool {
+  std::vector<std::thread> threads;
+  // Held for the whole of sw_thread_pool_run
+  std::mutex run_mutex;
+
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  // Bumped for every run, workers wait for it to change
+  uint64_t generation = 0;
+  int busy_workers = 0;
+  bool stopping = false;
+
+  SwThreadPoolTask task = nullptr;
+  void* data = nullptr;
+  int64_t task_count = 0;
+  std::atomic<int64_t> next_task{0};
+};
+
+static void sw_thread_pool_drain(SwThreadPool* pool, int worker) {
+  for (;;) {
+    int64_t i = pool->next_task.fetch_add(1, std::memory_order_relaxed);
+    if (i >= pool->task_count) return;
+    pool->task(pool->data, i, worker);
+  }
+}
+
+static void sw_thread_pool_worker(SwThreadPool* pool, int worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(pool->mutex);
+      pool->start.wait(lock, [&] { return pool->stopping || pool->generation != seen; });
+      if (pool->stopping) return;
+      seen = pool->generation;
+    }
+    sw_thread_pool_drain(pool, worker);
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    if (--pool->busy_workers == 0) pool->done.notify_one();
+  }
+}
+
+SwThreadPool* sw_thread_pool_new(int thread_count) {
+  if (thread_count <= 0) {
+    thread_count = (int)std::thread::hardware_concurrency();
+    if (thread_count <= 0) thread_count = 1;
+  }
+  SwThreadPool* pool = new SwThreadPool();
+  for (int i = 1; i < thread_count; i++) {
+    pool->threads.emplace_back(sw_thread_pool_worker, pool, i);
+  }
+  return pool;
+}
+
+void sw_thread_pool_free(SwThreadPool* pool) {
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->stopping = true;
+  }
+  pool->start.notify_all();
+  for (std::thread& thread : pool->threads) {
+    thread.join();
+  }
+  delete pool;
+}
+
+int sw_thread_pool_get_size(SwThreadPool* pool) {
+  return (int)pool->threads.size() + 1;
+}
+
+void sw_thread_pool_run(SwThreadPool* pool, int64_t task_count, SwThreadPoolTask task, void* data) {
+  if (task_count <= 0) return;
+  std::lock_guard<std::mutex> run_lock(pool->run_mutex);
+  // Not worth waking anyone for a single task
+  if (task_count == 1 || pool->threads.empty()) {
+    for (int64_t i = 0; i < task_count; i++) task(data, i, 0);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->task = task;
+    pool->data = data;
+    pool->task_count = task_count;
+    pool->next_task.store(0, std::memory_order_relaxed);
+    pool->busy_workers = (int)pool->threads.size();
+    pool->generation++;
+  }
+  pool->start.notify_all();
+  sw_thread_pool_drain(pool, 0);
+  std::unique_lock<std::mutex> lock(pool->mutex);
+  pool->done.wait(lock, [&] { return pool->busy_workers == 0; });
+}
@@ -0,0 +1,441 @@
+#include "webgpu_rend_linux_api.h"
+
+#include <dawn/dawn_proc_table.h>
+#include <dawn/native/DawnNative.h>
+#include <dawn/webgpu.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "webgpu_rend_completion.h"
+#include "webgpu_rend_device_setup.h"
+#include "webgpu_rend_handle_table.h"
+#include "webgpu_rend_readback.h"
+#include "webgpu_rend_trace.h"
+
+using namespace webgpu_rend;
+
+// Globals
+static FlTextureRegistrar* g_texture_registrar = nullptr;
+static std::unique_ptr<dawn::native::Instance> g_dawn_instance;
+static wgpu::Device g_wgpu_device;
+static wgpu::Queue g_wgpu_queue;
+// Lookups go through the handle table without locking, g_mutex only guards
+// Dawn calls and the readback state they touch.
+static HandleTable<GpuTextureObject> g_textures;
+static std::mutex g_mutex;
+
+// Guards the readback slots' pending state and what their map callbacks
+// write: presented_serial and the producer side of the pixel buffers. The
+// callbacks fire on whichever thread sees the map finish, so they cannot
+// take g_mutex, which a present holds while it waits on them.
+static std::mutex g_readback_mutex;
+static std::condition_variable g_readback_done;
+// Readbacks waiting on MapAsync, across all textures
+static uint32_t g_pending_readbacks = 0;
+
+// Dawn Error Callback
+void PrintDeviceError(WGPUDevice const* device, WGPUErrorType type, WGPUStringView message, void* userdata1, void* userdata2) {
+    g_warning("Dawn Error (%d): %.*s", type, (int)message.length, message.data);
+    TraceMessage("Dawn Error", std::string(message.data, message.length));
+}
+
+static int AdapterRank(const dawn::native::Adapter& adapter) {
+    wgpu::AdapterInfo info = {};
+    wgpu::Adapter(adapter.Get()).GetInfo(&info);
+    switch (info.adapterType) {
+        case wgpu::AdapterType::DiscreteGPU:
+            return 3;
+        case wgpu::AdapterType::IntegratedGPU:
+            return 2;
+        case wgpu::AdapterType::CPU:
+            // SwiftShader / lavapipe, used on machines without a GPU
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+void InitializeDawn() {
+    if (g_wgpu_device) return;
+
+    g_dawn_instance = CreateInstance();
+
+    WGPURequestAdapterOptions options = {};
+    options.backendType = WGPUBackendType_Vulkan;
+    options.powerPreference = WGPUPowerPreference_HighPerformance;
+
+    std::vector<dawn::native::Adapter> adapters = g_dawn_instance->EnumerateAdapters(&options);
+    if (adapters.empty()) {
+        g_warning("No WebGPU adapters found.");
+        return;
+    }
+
+    dawn::native::Adapter chosenAdapter = adapters[0];
+    int chosenRank = AdapterRank(chosenAdapter);
+    for (const auto& adapter : adapters) {
+        int rank = AdapterRank(adapter);
+        if (rank > chosenRank) {
+            chosenAdapter = adapter;
+            chosenRank = rank;
+        }
+    }
+
+    DeviceSetup setup(chosenAdapter.Get());
+    WGPUDeviceDescriptor& deviceDesc = *setup.Descriptor();
+
+    WGPUUncapturedErrorCallbackInfo errorCallbackInfo = {};
+    errorCallbackInfo.callback = PrintDeviceError;
+    errorCallbackInfo.userdata1 = nullptr;
+    errorCallbackInfo.userdata2 = nullptr;
+    deviceDesc.uncapturedErrorCallbackInfo = errorCallbackInfo;
+
+    WGPUDevice cDevice = chosenAdapter.CreateDevice(&deviceDesc);
+    if (!cDevice) {
+        g_warning("Failed to create WebGPU Device.");
+        return;
+    }
+
+    g_wgpu_device = wgpu::Device::Acquire(cDevice);
+    g_wgpu_queue = g_wgpu_device.GetQueue();
+    StartCompletionThread(g_dawn_instance->Get(), g_wgpu_device.Get());
+    StartReadbackEngine(g_wgpu_device.Get(), g_wgpu_queue.Get());
+}
+
+static void ProcessEvents() {
+    wgpuInstanceProcessEvents(g_dawn_instance->Get());
+}
+
+// Takes g_readback_mutex, wherever Dawn runs it. The slot stays pending
+// until the end, so the texture cannot go away underneath.
+static void OnReadbackMapped(wgpu::MapAsyncStatus status, wgpu::StringView message, ReadbackSlot* slot) {
+    if (slot->map_start_ns != 0) TraceComplete("ReadbackMapAsync", slot->map_start_ns, TraceNowNs());
+    std::lock_guard<std::mutex> lock(g_readback_mutex);
+    GpuTextureObject* tex = slot->owner;
+    if (status == wgpu::MapAsyncStatus::Success) {
+        if (slot->serial > tex->presented_serial) {
+            const uint8_t* data =
+                static_cast<const uint8_t*>(slot->buffer.GetConstMappedRange(0, WGPU_WHOLE_MAP_SIZE));
+            if (data != nullptr) {
+                sw_pixel_buffer_draw_rect_strided(tex->pixel_buffer, data, tex->bytes_per_row, 0, 0, tex->width,
+                                                  tex->height);
+                sw_pixel_buffer_publish(tex->pixel_buffer);
+                tex->presented_serial = slot->serial;
+                fl_texture_registrar_mark_texture_frame_available(tex->texture_registrar,
+                                                                  FL_TEXTURE(tex->pixel_buffer));
+            }
+        }
+        slot->buffer.Unmap();
+    }
+    slot->pending = false;
+    g_pending_readbacks--;
+    g_readback_done.notify_all();
+}
+
+// Work-done callback of PresentImage, lock-free as PresentQueue requires.
+// The readback of the frame completes on its own, this only paces
+// presenting. A swapchain image has been copied out by now, so it is
+// displayed and done with at once.
+static void OnFrameDone(WebgpuRendTexture t, uint64_t frame) {
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex) return;
+    if (tex->swapchain) {
+        tex->swapchain->Completed();
+        tex->swapchain->Latch();
+    }
+    tex->present_queue.Complete(t, frame);
+}
+
+// Blocks until the slot's MapAsync callback ran. g_mutex must be held.
+static void WaitForReadback(ReadbackSlot& slot) {
+    std::unique_lock<std::mutex> lock(g_readback_mutex);
+    if (!slot.pending) return;
+    WEBGPU_REND_TRACE_SCOPE("WaitForReadbackSlot");
+    while (slot.pending) {
+        lock.unlock();
+        WaitForFuture(g_dawn_instance->Get(), slot.map_future);
+        lock.lock();
+        // The future is done, but its callback may still be running on
+        // another thread
+        g_readback_done.wait_for(lock, std::chrono::nanoseconds(kCompletionWaitTimeoutNs),
+                                 [&] { return !slot.pending; });
+    }
+}
+
+GpuTextureObject::GpuTextureObject(int w, int h, FlTextureRegistrar* registrar, wgpu::Device wgpu_dev,
+                                   uint32_t image_count)
+    : width(w), height(h), texture_id(-1), texture_registrar(registrar), pixel_buffer(nullptr) {
+    bytes_per_row = ((uint32_t)width * 4 + 255) & ~255u;
+
+    pixel_buffer = sw_pixel_buffer_new(width, height);
+    if (!fl_texture_registrar_register_texture(texture_registrar, FL_TEXTURE(pixel_buffer))) {
+        sw_pixel_buffer_dispose(pixel_buffer);
+        throw std::runtime_error("Failed to register pixel buffer texture");
+    }
+    texture_id = sw_pixel_buffer_get_id(pixel_buffer);
+
+    // FlPixelBufferTexture consumes RGBA8888
+    wgpu::TextureDescriptor tex_desc{};
+    tex_desc.label = "FlutterPixelBufferTexture";
+    tex_desc.dimension = wgpu::TextureDimension::e2D;
+    tex_desc.size = {(uint32_t)width, (uint32_t)height, 1};
+    tex_desc.format = wgpu::TextureFormat::RGBA8Unorm;
+    tex_desc.usage = wgpu::TextureUsage::RenderAttachment |
+                     wgpu::TextureUsage::TextureBinding |
+                     wgpu::TextureUsage::StorageBinding |
+                     wgpu::TextureUsage::CopySrc |
+                     wgpu::TextureUsage::CopyDst;
+
+    if (image_count > 0) {
+        swapchain = std::make_unique<SwapchainRing>(image_count);
+        tex_desc.label = "FlutterSwapchainImage";
+        for (uint32_t i = 0; i < swapchain->ImageCount(); i++) {
+            images.push_back(wgpu_dev.CreateTexture(&tex_desc));
+            image_views.push_back(images.back().CreateView());
+        }
+        webgpu_texture = images[0];
+        default_view = image_views[0];
+    } else {
+        webgpu_texture = wgpu_dev.CreateTexture(&tex_desc);
+        default_view = webgpu_texture.CreateView();
+    }
+
+    wgpu::BufferDescriptor buf_desc{};
+    buf_desc.label = "FlutterReadbackBuffer";
+    buf_desc.usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst;
+    buf_desc.size = (uint64_t)bytes_per_row * height;
+    for (ReadbackSlot& slot : readback) {
+        slot.owner = this;
+        slot.buffer = wgpu_dev.CreateBuffer(&buf_desc);
+    }
+}
+
+GpuTextureObject::~GpuTextureObject() {
+    // Unmapping aborts any in-flight MapAsync, but the callbacks still
+    // reference this object so they have to be flushed before it goes away.
+    for (ReadbackSlot& slot : readback) {
+        bool pending;
+        {
+            std::lock_guard<std::mutex> lock(g_readback_mutex);
+            pending = slot.pending;
+        }
+        // Outside the lock, the aborted callback may run right away
+        if (pending) slot.buffer.Unmap();
+    }
+    for (ReadbackSlot& slot : readback) WaitForReadback(slot);
+    fl_texture_registrar_unregister_texture(texture_registrar, FL_TEXTURE(pixel_buffer));
+    sw_pixel_buffer_dispose(pixel_buffer);
+}
+
+void webgpu_rend_linux_set_texture_registrar(FlTextureRegistrar* registrar) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_texture_registrar = registrar;
+}
+
+// Copies `image` into the next readback slot. g_mutex must be held.
+static void PresentImage(GpuTextureObject* tex, WebgpuRendTexture t, const wgpu::Texture& image) {
+    // Make sure neither the frame cap nor the slot we are about to reuse
+    // hold us up. This only blocks, on the GPU's futures, when it is
+    // max_frames_in_flight or a full ring behind.
+    tex->present_queue.WaitUntilReady(g_dawn_instance->Get(), t);
+    ReadbackSlot& slot = tex->readback[tex->next_slot];
+    WaitForReadback(slot);
+
+    wgpu::CommandEncoder encoder = g_wgpu_device.CreateCommandEncoder();
+
+    wgpu::TexelCopyTextureInfo src = {};
+    src.texture = image;
+
+    wgpu::TexelCopyBufferInfo dst = {};
+    dst.buffer = slot.buffer;
+    dst.layout.bytesPerRow = tex->bytes_per_row;
+    dst.layout.rowsPerImage = (uint32_t)tex->height;
+
+    wgpu::Extent3D copySize = {(uint32_t)tex->width, (uint32_t)tex->height, 1};
+    encoder.CopyTextureToBuffer(&src, &dst, &copySize);
+
+    wgpu::CommandBuffer cmd = encoder.Finish();
+    g_wgpu_queue.Submit(1, &cmd);
+    uint64_t frame = tex->present_queue.Submit();
+    wgpu::Future done = g_wgpu_queue.OnSubmittedWorkDone(
+        wgpu::CallbackMode::AllowSpontaneous,
+        [t, frame](wgpu::QueueWorkDoneStatus, wgpu::StringView) { OnFrameDone(t, frame); });
+    tex->present_queue.SetWorkDoneFuture(frame, {done.id});
+    WatchFuture({done.id});
+
+    slot.serial = ++tex->submitted_serial;
+    slot.map_start_ns = TraceEnabled() ? TraceNowNs() : 0;
+    {
+        std::lock_guard<std::mutex> lock(g_readback_mutex);
+        slot.pending = true;
+        g_pending_readbacks++;
+    }
+    wgpu::Future mapped = slot.buffer.MapAsync(wgpu::MapMode::Read, 0, WGPU_WHOLE_MAP_SIZE,
+                                               wgpu::CallbackMode::AllowSpontaneous, OnReadbackMapped, &slot);
+    slot.map_future = {mapped.id};
+    // Shows the frame as soon as it is read back, even once the app stops
+    // presenting. Without the thread webgpu_rend_process_events delivers it.
+    WatchFuture(slot.map_future);
+    tex->next_slot = (tex->next_slot + 1) % kReadbackRingSize;
+}
+
+extern "C" {
+
+API_EXPORT void* webgpu_rend_get_proc_address(const char* procName) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    WGPUStringView view;
+    view.data = procName;
+    view.length = std::strlen(procName);
+    return (void*)dawn::native::GetProcs().getProcAddress(view);
+}
+
+API_EXPORT void* webgpu_rend_init(void* registrar) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    InitializeDawn();
+    return g_wgpu_device.Get();
+}
+
+API_EXPORT WebgpuRendTexture webgpu_rend_create_texture(int32_t width, int32_t height) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_wgpu_device || !g_texture_registrar) return nullptr;
+    try {
+        auto tex = std::make_unique<GpuTextureObject>(width, height, g_texture_registrar, g_wgpu_device);
+        uint64_t handle = g_textures.Insert(std::move(tex));
+        if (handle == 0) g_warning("Failed to create texture: handle table is full");
+        return HandleToPointer(handle);
+    } catch (std::exception& e) {
+        g_warning("Failed to create texture: %s", e.what());
+        return nullptr;
+    }
+}
+
+API_EXPORT int64_t webgpu_rend_get_texture_id(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->texture_id : -1;
+}
+
+API_EXPORT void* webgpu_rend_get_wgpu_texture(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->webgpu_texture.Get() : nullptr;
+}
+
+API_EXPORT void* webgpu_rend_get_wgpu_texture_view(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->default_view.Get() : nullptr;
+}
+
+// Dawn owns the texture outright, nothing to synchronize with Flutter
+API_EXPORT void webgpu_rend_texture_begin_access(WebgpuRendTexture t) {}
+API_EXPORT void webgpu_rend_texture_end_access(WebgpuRendTexture t) {}
+
+// Swapchains present through webgpu_rend_swapchain_present_image
+API_EXPORT void webgpu_rend_present_texture(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || tex->swapchain) return;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    PresentImage(tex.get(), t, tex->webgpu_texture);
+}
+
+API_EXPORT void webgpu_rend_dispose_texture(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    // Waits for in-flight lookups, then tears down under the lock because the
+    // destructor pumps Dawn events.
+    std::unique_ptr<GpuTextureObject> tex = g_textures.Remove(HandleFromPointer(t));
+    std::lock_guard<std::mutex> lock(g_mutex);
+    tex.reset();
+}
+
+API_EXPORT void webgpu_rend_set_frame_ready_callback(WebgpuRendFrameReadyCallback callback) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    SetFrameReadyCallback(callback);
+}
+
+API_EXPORT void webgpu_rend_set_max_frames_in_flight(WebgpuRendTexture t, int32_t count) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (tex) tex->present_queue.SetMaxFramesInFlight(count > 0 ? count : 1);
+}
+
+API_EXPORT int32_t webgpu_rend_get_max_frames_in_flight(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->present_queue.MaxFramesInFlight() : 0;
+}
+
+API_EXPORT int32_t webgpu_rend_get_frames_in_flight(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->present_queue.FramesInFlight() : 0;
+}
+
+API_EXPORT int32_t webgpu_rend_process_events() {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_dawn_instance) ProcessEvents();
+    std::lock_guard<std::mutex> readback_lock(g_readback_mutex);
+    return TotalFramesInFlight() + g_pending_readbacks;
+}
+
+API_EXPORT WebgpuRendTexture webgpu_rend_create_swapchain(int32_t width, int32_t height, int32_t count) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_wgpu_device || !g_texture_registrar) return nullptr;
+    try {
+        auto tex = std::make_unique<GpuTextureObject>(width, height, g_texture_registrar, g_wgpu_device,
+                                                      count > 0 ? count : kMinSwapchainImages);
+        uint64_t handle = g_textures.Insert(std::move(tex));
+        if (handle == 0) g_warning("Failed to create swapchain: handle table is full");
+        return HandleToPointer(handle);
+    } catch (std::exception& e) {
+        g_warning("Failed to create swapchain: %s", e.what());
+        return nullptr;
+    }
+}
+
+API_EXPORT int32_t webgpu_rend_swapchain_get_image_count(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex && tex->swapchain ? tex->swapchain->ImageCount() : 0;
+}
+
+API_EXPORT int32_t webgpu_rend_swapchain_acquire_image(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex && tex->swapchain ? tex->swapchain->Acquire() : -1;
+}
+
+API_EXPORT void* webgpu_rend_swapchain_get_wgpu_texture(WebgpuRendTexture t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || image < 0 || image >= (int32_t)tex->images.size()) return nullptr;
+    return tex->images[image].Get();
+}
+
+API_EXPORT void* webgpu_rend_swapchain_get_wgpu_texture_view(WebgpuRendTexture t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || image < 0 || image >= (int32_t)tex->image_views.size()) return nullptr;
+    return tex->image_views[image].Get();
+}
+
+API_EXPORT void webgpu_rend_swapchain_present_image(WebgpuRendTexture t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || !tex->swapchain) return;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!tex->swapchain->Present(image)) return;
+    PresentImage(tex.get(), t, tex->images[image]);
+}
+
+}  // extern C
@@ -0,0 +1,73 @@
+#ifndef FLUTTER_PLUGIN_WEBGPU_REND_LINUX_API_H_
+#define FLUTTER_PLUGIN_WEBGPU_REND_LINUX_API_H_
+
+#include <dawn/webgpu_cpp.h>
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "include/webgpu_rend/sw_pixel_buffer.h"
+#include "webgpu_rend_api.h"
+#include "webgpu_rend_present_queue.h"
+#include "webgpu_rend_swapchain_ring.h"
+
+namespace webgpu_rend {
+
+// Number of readback buffers per texture. Presenting frame N only waits on
+// the GPU if frame N - kReadbackRingSize has not been mapped yet.
+constexpr uint32_t kReadbackRingSize = 3;
+
+struct GpuTextureObject;
+
+struct ReadbackSlot {
+    GpuTextureObject* owner = nullptr;
+    wgpu::Buffer buffer;
+    // While the MapAsync is in flight, guarded by the backend's readback lock
+    bool pending = false;
+    uint64_t serial = 0;
+    // Of the MapAsync while pending
+    WGPUFuture map_future = {};
+    // When the MapAsync was issued, if tracing
+    uint64_t map_start_ns = 0;
+};
+
+// Flutter on Linux has no way to import a GPU image, so Dawn renders into an
+// ordinary texture and every present is copied back into a SwPixelBuffer.
+// Swapchains render into one of image_count textures instead, the copy then
+// frees the image as soon as the GPU is done with it.
+struct GpuTextureObject {
+    GpuTextureObject(int width, int height, FlTextureRegistrar* registrar, wgpu::Device wgpu_device,
+                     uint32_t image_count = 0);
+    ~GpuTextureObject();
+
+    int width, height;
+    uint32_t bytes_per_row;
+    int64_t texture_id;
+    FlTextureRegistrar* texture_registrar;
+    SwPixelBuffer* pixel_buffer;
+
+    wgpu::Texture webgpu_texture;
+    wgpu::TextureView default_view;
+
+    // Swapchains only, webgpu_texture and default_view are image 0
+    std::unique_ptr<SwapchainRing> swapchain;
+    std::vector<wgpu::Texture> images;
+    std::vector<wgpu::TextureView> image_views;
+
+    ReadbackSlot readback[kReadbackRingSize];
+    uint32_t next_slot = 0;
+    uint64_t submitted_serial = 0;
+    uint64_t presented_serial = 0;
+
+    PresentQueue present_queue;
+};
+
+}  // namespace webgpu_rend
+
+// Called by the plugin when it is registered, the FFI entry points have no
+// other way to reach the engine's texture registrar.
+void webgpu_rend_linux_set_texture_registrar(FlTextureRegistrar* registrar);
+
+#endif  // FLUTTER_PLUGIN_WEBGPU_REND_LINUX_API_H_
@@ -0,0 +1,775 @@
+/*
+Copyright 2022 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+ */
+
+#include <flutter_linux/flutter_linux.h>
+#include <glib-object.h>
+#include <glib.h>
+#include <gmodule.h>
+#include <gtk/gtk.h>
+#include <sys/utsname.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "include/webgpu_rend/sw_batch.h"
+#include "include/webgpu_rend/sw_compositor.h"
+#include "include/webgpu_rend/sw_pixel_buffer.h"
+#include "include/webgpu_rend/sw_rasterizer.h"
+#include "include/webgpu_rend/sw_readback.h"
+#include "include/webgpu_rend/webgpu_rend_plugin.h"
+#include "webgpu_rend_linux_api.h"
+#include "webgpu_rend_trace.h"
+
+#define WEBGPU_REND_PLUGIN(obj)                                       \
+    (G_TYPE_CHECK_INSTANCE_CAST((obj), webgpu_rend_plugin_get_type(), \
+                                WebgpuRendPlugin))
+
+struct _WebgpuRendPlugin {
+    GObject parent_instance;
+    GHashTable* textures;
+    FlTextureRegistrar* registrar;
+};
+
+G_DEFINE_TYPE(WebgpuRendPlugin, webgpu_rend_plugin, g_object_get_type())
+
+// The FFI entry points below run on the Dart UI thread rather than the
+// platform thread, so they reach the texture table through this pointer.
+// g_textures_mutex guards the table and every SwPixelBuffer in it: the FFI
+// entry points take it themselves, and webgpu_rend_plugin_handle_method_call
+// holds it around every channel handler, so the two never produce into the
+// same buffer at once.
+static WebgpuRendPlugin* g_plugin = nullptr;
+static GMutex g_textures_mutex;
+
+typedef FlMethodResponse* (*MethodCallback)(WebgpuRendPlugin* plugin, FlValue* arguments);
+// For methods that may answer later. Returning nullptr means the method took
+// a reference to the call and will respond to it itself.
+typedef FlMethodResponse* (*AsyncMethodCallback)(WebgpuRendPlugin* plugin, FlMethodCall* method_call);
+
+static FlMethodResponse* webgpu_rend_plugin_method_init(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    FlValue* ptr = fl_value_lookup_string(arguments, "width");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify width", fl_value_new_null()));
+    }
+    int width = fl_value_get_int(ptr);
+    ptr = fl_value_lookup_string(arguments, "height");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify height", fl_value_new_null()));
+    }
+    int height = fl_value_get_int(ptr);
+    SwPixelBuffer* buffer = sw_pixel_buffer_new(width, height);
+    gboolean success = fl_texture_registrar_register_texture(plugin->registrar, (FlTexture*)(&buffer->parent_instance));
+    if (!success) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Failed to register texture", fl_value_new_null()));
+    }
+    int64_t buffer_id = sw_pixel_buffer_get_id(buffer);
+    g_hash_table_insert(plugin->textures, (gpointer)buffer_id, (gpointer)buffer);
+    g_autoptr(FlValue) result = fl_value_new_int(buffer_id);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* webgpu_rend_plugin_method_dispose(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    FlValue* ptr = fl_value_lookup_string(arguments, "texture");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify texture ID", fl_value_new_null()));
+    }
+    int64_t buffer_id = fl_value_get_int(ptr);
+    SwPixelBuffer* buffer = (SwPixelBuffer*)g_hash_table_lookup(plugin->textures, (gpointer)buffer_id);
+    if (buffer == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Texture ID is not registered", fl_value_new_null()));
+    }
+    // Frames are freed right away, views Dart got from beginFrame() are
+    // dangling from here on
+    g_hash_table_remove(plugin->textures, (gpointer)buffer_id);
+    fl_texture_registrar_unregister_texture(plugin->registrar, (FlTexture*)(&buffer->parent_instance));
+    sw_pixel_buffer_dispose(buffer);
+    g_autoptr(FlValue) result = fl_value_new_null();
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* webgpu_rend_plugin_method_draw(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    FlValue* ptr = fl_value_lookup_string(arguments, "texture");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify texture ID", fl_value_new_null()));
+    }
+    int64_t buffer_id = fl_value_get_int(ptr);
+    SwPixelBuffer* buffer = (SwPixelBuffer*)g_hash_table_lookup(plugin->textures, (gpointer)buffer_id);
+    if (buffer == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Texture ID is not registered", fl_value_new_null()));
+    }
+    ptr = fl_value_lookup_string(arguments, "pixels");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must supply pixel data", fl_value_new_null()));
+    }
+    const uint8_t* pixels = fl_value_get_uint8_list(ptr);
+    size_t pixels_length = fl_value_get_length(ptr);
+    ptr = fl_value_lookup_string(arguments, "x");
+    int64_t x = 0, y = 0, width = buffer->width, height = buffer->height;
+    if (ptr != nullptr) {
+        x = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "y");
+    if (ptr != nullptr) {
+        y = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "width");
+    if (ptr != nullptr) {
+        width = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "height");
+    if (ptr != nullptr) {
+        height = fl_value_get_int(ptr);
+    }
+    // SwBlitMode, defaults to a plain copy
+    SwBlitMode mode = SW_BLIT_COPY;
+    ptr = fl_value_lookup_string(arguments, "mode");
+    if (ptr != nullptr) {
+        int64_t value = fl_value_get_int(ptr);
+        if (value < 0 || value >= SW_BLIT_MODE_COUNT) {
+            return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Unknown blit mode", fl_value_new_null()));
+        }
+        mode = (SwBlitMode)value;
+    }
+    // When the source size differs from the destination rect, the pixels are
+    // stretched to fit
+    int64_t src_width = width, src_height = height;
+    ptr = fl_value_lookup_string(arguments, "src_width");
+    if (ptr != nullptr) {
+        src_width = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "src_height");
+    if (ptr != nullptr) {
+        src_height = fl_value_get_int(ptr);
+    }
+    if (src_width <= 0 || src_height <= 0 || pixels_length < (size_t)(src_width * src_height * 4)) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Pixel data is smaller than the source rect", fl_value_new_null()));
+    }
+    if (src_width == width && src_height == height) {
+        sw_pixel_buffer_draw_rect_mode(buffer, pixels, 4 * src_width, x, y, width, height, mode);
+    } else {
+        sw_pixel_buffer_draw_scaled(buffer, pixels, 4 * src_width, src_width, src_height, x, y, width, height, mode);
+    }
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+}
+
+static FlMethodResponse* webgpu_rend_plugin_method_fill(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    FlValue* ptr = fl_value_lookup_string(arguments, "texture");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify texture ID", fl_value_new_null()));
+    }
+    int64_t buffer_id = fl_value_get_int(ptr);
+    SwPixelBuffer* buffer = (SwPixelBuffer*)g_hash_table_lookup(plugin->textures, (gpointer)buffer_id);
+    if (buffer == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Texture ID is not registered", fl_value_new_null()));
+    }
+    ptr = fl_value_lookup_string(arguments, "color");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must supply a color", fl_value_new_null()));
+    }
+    uint32_t color = sw_blit_argb_to_rgba((uint32_t)fl_value_get_int(ptr));
+    int64_t x = 0, y = 0, width = buffer->width, height = buffer->height;
+    ptr = fl_value_lookup_string(arguments, "x");
+    if (ptr != nullptr) {
+        x = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "y");
+    if (ptr != nullptr) {
+        y = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "width");
+    if (ptr != nullptr) {
+        width = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "height");
+    if (ptr != nullptr) {
+        height = fl_value_get_int(ptr);
+    }
+    sw_pixel_buffer_fill_rect(buffer, color, x, y, width, height);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+}
+
+static FlMethodResponse* webgpu_rend_plugin_method_invalidate(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    FlValue* ptr = fl_value_lookup_string(arguments, "texture");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify texture ID", fl_value_new_null()));
+    }
+    int64_t buffer_id = fl_value_get_int(ptr);
+    SwPixelBuffer* buffer = (SwPixelBuffer*)g_hash_table_lookup(plugin->textures, (gpointer)buffer_id);
+    if (buffer == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Texture ID is not registered", fl_value_new_null()));
+    }
+    // Optional damage as x, y, width, height quadruples. Without it, only what
+    // was drawn through "draw" is known to have changed.
+    FlValue* rects = fl_value_lookup_string(arguments, "rects");
+    if (rects != nullptr && fl_value_get_type(rects) == FL_VALUE_TYPE_INT32_LIST) {
+        const int32_t* values = fl_value_get_int32_list(rects);
+        size_t count = fl_value_get_length(rects) / 4;
+        for (size_t i = 0; i < count; i++) {
+            sw_pixel_buffer_add_damage(buffer, values[4 * i], values[4 * i + 1], values[4 * i + 2], values[4 * i + 3]);
+        }
+    }
+    sw_pixel_buffer_publish(buffer);
+    fl_texture_registrar_mark_texture_frame_available(plugin->registrar, (FlTexture*)(&buffer->parent_instance));
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+}
+
+static SwPixelBuffer* webgpu_rend_plugin_batch_lookup(void* user_data, int64_t texture_id) {
+    WebgpuRendPlugin* plugin = (WebgpuRendPlugin*)user_data;
+    return (SwPixelBuffer*)g_hash_table_lookup(plugin->textures, (gpointer)texture_id);
+}
+
+// Runs a whole sw_batch command stream, see sw_batch.h for the format.
+// Returns the number of records run.
+static FlMethodResponse* webgpu_rend_plugin_method_submit_batch(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    FlValue* ptr = fl_value_lookup_string(arguments, "commands");
+    if (ptr == nullptr || fl_value_get_type(ptr) != FL_VALUE_TYPE_UINT8_LIST) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must supply a command list", fl_value_new_null()));
+    }
+    g_autoptr(GPtrArray) invalidated = g_ptr_array_new();
+    SwBatchResult result;
+    sw_batch_execute(fl_value_get_uint8_list(ptr), fl_value_get_length(ptr), webgpu_rend_plugin_batch_lookup, plugin,
+                     invalidated, &result);
+    // Whatever ran before a bad record is still presented
+    for (guint i = 0; i < invalidated->len; i++) {
+        SwPixelBuffer* buffer = (SwPixelBuffer*)g_ptr_array_index(invalidated, i);
+        sw_pixel_buffer_publish(buffer);
+        fl_texture_registrar_mark_texture_frame_available(plugin->registrar, (FlTexture*)(&buffer->parent_instance));
+    }
+    if (result.error != nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", result.error, fl_value_new_int(result.executed)));
+    }
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_int(result.executed)));
+}
+
+// Reads the optional get_pixels arguments: a source rect ("x", "y", "width",
+// "height", defaulting to the whole frame), an output size ("dst_width",
+// "dst_height", defaulting to no scaling) and a "format" (SwReadFormat).
+static FlMethodResponse* webgpu_rend_plugin_parse_read(SwPixelBuffer* buffer, FlValue* arguments, SwReadRegion* region) {
+    region->x = 0;
+    region->y = 0;
+    region->width = (int32_t)buffer->width;
+    region->height = (int32_t)buffer->height;
+    region->format = SW_READ_RGBA;
+    FlValue* ptr = fl_value_lookup_string(arguments, "x");
+    if (ptr != nullptr) {
+        region->x = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "y");
+    if (ptr != nullptr) {
+        region->y = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "width");
+    if (ptr != nullptr) {
+        region->width = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "height");
+    if (ptr != nullptr) {
+        region->height = fl_value_get_int(ptr);
+    }
+    region->dst_width = region->width;
+    region->dst_height = region->height;
+    ptr = fl_value_lookup_string(arguments, "dst_width");
+    if (ptr != nullptr) {
+        region->dst_width = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "dst_height");
+    if (ptr != nullptr) {
+        region->dst_height = fl_value_get_int(ptr);
+    }
+    ptr = fl_value_lookup_string(arguments, "format");
+    if (ptr != nullptr) {
+        region->format = (SwReadFormat)fl_value_get_int(ptr);
+    }
+    if (!sw_read_region_clip(region, buffer->width, buffer->height)) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Empty rect, upscaling or unknown format", fl_value_new_null()));
+    }
+    return nullptr;
+}
+
+static FlMethodResponse* webgpu_rend_plugin_method_read(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    FlValue* ptr = fl_value_lookup_string(arguments, "texture");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify texture ID", fl_value_new_null()));
+    }
+    int64_t buffer_id = fl_value_get_int(ptr);
+    SwPixelBuffer* buffer = (SwPixelBuffer*)g_hash_table_lookup(plugin->textures, (gpointer)buffer_id);
+    if (buffer == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Texture ID is not registered", fl_value_new_null()));
+    }
+    SwReadRegion region;
+    FlMethodResponse* error = webgpu_rend_plugin_parse_read(buffer, arguments, &region);
+    if (error != nullptr) {
+        return error;
+    }
+    const uint8_t* pixels = sw_pixel_buffer_peek(buffer);
+    if (region.width == buffer->width && region.height == buffer->height && region.dst_width == region.width &&
+        region.dst_height == region.height && region.format == SW_READ_RGBA) {
+        return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_uint8_list(pixels, buffer->width * buffer->height * 4)));
+    }
+    size_t size = sw_read_output_size(&region);
+    uint8_t* out = (uint8_t*)g_malloc(size);
+    sw_read_pixels(pixels + 4 * (region.y * buffer->width + region.x), 4 * buffer->width, &region, out);
+    g_autoptr(GBytes) bytes = g_bytes_new_take(out, size);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_uint8_list_from_bytes(bytes)));
+}
+
+// get_pixels_async: same arguments and result as get_pixels, but cropping,
+// conversion and scaling run on a worker thread. The frame itself is still
+// snapshotted on the platform thread, since it can be drawn into as soon as
+// this handler returns; that is a single memcpy of just the source rect.
+typedef struct {
+    FlMethodCall* method_call;
+    uint8_t* snapshot;
+    SwReadRegion region;
+    GBytes* result;
+} WebgpuRendReadJob;
+
+static GThreadPool* g_read_pool = nullptr;
+
+static gboolean webgpu_rend_plugin_read_job_respond(gpointer user_data) {
+    WebgpuRendReadJob* job = (WebgpuRendReadJob*)user_data;
+    g_autoptr(FlValue) result = fl_value_new_uint8_list_from_bytes(job->result);
+    g_autoptr(GError) error = nullptr;
+    if (!fl_method_call_respond_success(job->method_call, result, &error)) {
+        g_warning("Failed to send get_pixels_async response: %s", error->message);
+    }
+    g_bytes_unref(job->result);
+    g_object_unref(job->method_call);
+    g_free(job);
+    return G_SOURCE_REMOVE;
+}
+
+static void webgpu_rend_plugin_read_job_run(gpointer data, gpointer user_data) {
+    WebgpuRendReadJob* job = (WebgpuRendReadJob*)data;
+    size_t size = sw_read_output_size(&job->region);
+    uint8_t* out = (uint8_t*)g_malloc(size);
+    sw_read_pixels(job->snapshot, 4 * job->region.width, &job->region, out);
+    g_free(job->snapshot);
+    job->snapshot = nullptr;
+    job->result = g_bytes_new_take(out, size);
+    // Method calls can only be answered on the main loop
+    g_idle_add(webgpu_rend_plugin_read_job_respond, job);
+}
+
+static FlMethodResponse* webgpu_rend_plugin_method_read_async(WebgpuRendPlugin* plugin, FlMethodCall* method_call) {
+    FlValue* arguments = fl_method_call_get_args(method_call);
+    FlValue* ptr = fl_value_lookup_string(arguments, "texture");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify texture ID", fl_value_new_null()));
+    }
+    int64_t buffer_id = fl_value_get_int(ptr);
+    SwPixelBuffer* buffer = (SwPixelBuffer*)g_hash_table_lookup(plugin->textures, (gpointer)buffer_id);
+    if (buffer == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Texture ID is not registered", fl_value_new_null()));
+    }
+    WebgpuRendReadJob* job = g_new0(WebgpuRendReadJob, 1);
+    FlMethodResponse* error = webgpu_rend_plugin_parse_read(buffer, arguments, &job->region);
+    if (error != nullptr) {
+        g_free(job);
+        return error;
+    }
+    size_t row_bytes = 4 * (size_t)job->region.width;
+    job->snapshot = (uint8_t*)g_malloc(row_bytes * job->region.height);
+    const uint8_t* pixels = sw_pixel_buffer_peek(buffer) + 4 * (job->region.y * buffer->width + job->region.x);
+    if (job->region.width == buffer->width) {
+        memcpy(job->snapshot, pixels, row_bytes * job->region.height);
+    } else {
+        for (int32_t y = 0; y < job->region.height; y++) {
+            memcpy(job->snapshot + y * row_bytes, pixels + y * 4 * buffer->width, row_bytes);
+        }
+    }
+    // The snapshot starts at the region origin
+    job->region.x = 0;
+    job->region.y = 0;
+    job->method_call = FL_METHOD_CALL(g_object_ref(method_call));
+
+    if (g_read_pool == nullptr) {
+        g_read_pool = g_thread_pool_new(webgpu_rend_plugin_read_job_run, nullptr, 2, FALSE, nullptr);
+    }
+    g_thread_pool_push(g_read_pool, job, nullptr);
+    return nullptr;
+}
+
+static FlMethodResponse* webgpu_rend_plugin_method_get_size(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    FlValue* ptr = fl_value_lookup_string(arguments, "texture");
+    if (ptr == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("MISSING", "Must specify texture ID", fl_value_new_null()));
+    }
+    int64_t buffer_id = fl_value_get_int(ptr);
+    SwPixelBuffer* buffer = (SwPixelBuffer*)g_hash_table_lookup(plugin->textures, (gpointer)buffer_id);
+    if (buffer == nullptr) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID", "Texture ID is not registered", fl_value_new_null()));
+    }
+    int32_t size[2] = {(int32_t)buffer->width, (int32_t)buffer->height};
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_int32_list(size, 2)));
+}
+
+static FlMethodResponse* webgpu_rend_plugin_method_list(WebgpuRendPlugin* plugin, FlValue* arguments) {
+    uint32_t size = g_hash_table_size(plugin->textures);
+    int64_t* textures = g_new(int64_t, size);
+    GHashTableIter iter;
+    gpointer key;
+    g_hash_table_iter_init(&iter, plugin->textures);
+    for (int i = 0; i < size; i++) {
+        g_hash_table_iter_next(&iter, &key, nullptr);
+        textures[i] = (int64_t)key;
+    }
+    FlMethodResponse* response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_int64_list(textures, size)));
+    g_free(textures);
+    return response;
+}
+
+static GHashTable* methods = nullptr;
+static GHashTable* async_methods = nullptr;
+
+// Called when a method call is received from Flutter.
+static void webgpu_rend_plugin_handle_method_call(
+    WebgpuRendPlugin* self,
+    FlMethodCall* method_call) {
+    g_autoptr(FlMethodResponse) response = nullptr;
+
+    const gchar* method = fl_method_call_get_name(method_call);
+
+    AsyncMethodCallback async_func = (AsyncMethodCallback)g_hash_table_lookup(async_methods, method);
+    MethodCallback func = (MethodCallback)g_hash_table_lookup(methods, method);
+    if (async_func != nullptr) {
+        g_mutex_lock(&g_textures_mutex);
+        response = async_func(self, method_call);
+        g_mutex_unlock(&g_textures_mutex);
+        if (response == nullptr) return;
+    } else if (func == nullptr) {
+        response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    } else {
+        FlValue* args = fl_method_call_get_args(method_call);
+        // Handlers look up and write buffers the FFI entry points use too
+        g_mutex_lock(&g_textures_mutex);
+        response = func(self, args);
+        g_mutex_unlock(&g_textures_mutex);
+    }
+
+    fl_method_call_respond(method_call, response, nullptr);
+}
+
+static void webgpu_rend_plugin_dispose(GObject* object) {
+    g_print("Disposing of SW REND plugin\n");
+    WebgpuRendPlugin* plugin = WEBGPU_REND_PLUGIN(object);
+    g_mutex_lock(&g_textures_mutex);
+    if (g_plugin == plugin) {
+        g_plugin = nullptr;
+    }
+    g_mutex_unlock(&g_textures_mutex);
+    GHashTableIter iter;
+    g_hash_table_iter_init(&iter, plugin->textures);
+    gpointer key, value;
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        sw_pixel_buffer_dispose((SwPixelBuffer*)value);
+    }
+    g_hash_table_destroy(plugin->textures);
+    G_OBJECT_CLASS(webgpu_rend_plugin_parent_class)->dispose(object);
+}
+
+static void webgpu_rend_plugin_class_init(WebgpuRendPluginClass* klass) {
+    G_OBJECT_CLASS(klass)->dispose = webgpu_rend_plugin_dispose;
+}
+
+static void webgpu_rend_plugin_init(WebgpuRendPlugin* self) {
+    self->textures = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+    WebgpuRendPlugin* plugin = WEBGPU_REND_PLUGIN(user_data);
+    webgpu_rend_plugin_handle_method_call(plugin, method_call);
+}
+
+void webgpu_rend_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+    // Set up methods
+    if (methods == nullptr) {
+        methods = g_hash_table_new(g_str_hash, g_str_equal);
+        g_hash_table_insert(methods, (gpointer) "init", (gpointer)webgpu_rend_plugin_method_init);
+        g_hash_table_insert(methods, (gpointer) "dispose", (gpointer)webgpu_rend_plugin_method_dispose);
+        g_hash_table_insert(methods, (gpointer) "draw", (gpointer)webgpu_rend_plugin_method_draw);
+        g_hash_table_insert(methods, (gpointer) "fill", (gpointer)webgpu_rend_plugin_method_fill);
+        g_hash_table_insert(methods, (gpointer) "invalidate", (gpointer)webgpu_rend_plugin_method_invalidate);
+        g_hash_table_insert(methods, (gpointer) "submit_batch", (gpointer)webgpu_rend_plugin_method_submit_batch);
+        g_hash_table_insert(methods, (gpointer) "get_pixels", (gpointer)webgpu_rend_plugin_method_read);
+        g_hash_table_insert(methods, (gpointer) "get_size", (gpointer)webgpu_rend_plugin_method_get_size);
+        g_hash_table_insert(methods, (gpointer) "list_textures", (gpointer)webgpu_rend_plugin_method_list);
+    }
+    if (async_methods == nullptr) {
+        async_methods = g_hash_table_new(g_str_hash, g_str_equal);
+        g_hash_table_insert(async_methods, (gpointer) "get_pixels_async", (gpointer)webgpu_rend_plugin_method_read_async);
+    }
+
+    WebgpuRendPlugin* plugin = WEBGPU_REND_PLUGIN(
+        g_object_new(webgpu_rend_plugin_get_type(), nullptr));
+
+    // Get texture registrar
+    plugin->registrar = fl_plugin_registrar_get_texture_registrar(registrar);
+    webgpu_rend_linux_set_texture_registrar(plugin->registrar);
+    g_mutex_lock(&g_textures_mutex);
+    g_plugin = plugin;
+    g_mutex_unlock(&g_textures_mutex);
+
+    g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+    g_autoptr(FlMethodChannel) channel =
+        fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                              "com.funguscow/webgpu_rend",
+                              FL_METHOD_CODEC(codec));
+    fl_method_channel_set_method_call_handler(channel, method_call_cb,
+                                              g_object_ref(plugin),
+                                              g_object_unref);
+
+    g_print("Registering plugin and channel \"com.funguscow/webgpu_rend\"\n");
+
+    g_object_unref(plugin);
+}
+
+// FFI access to software pixel buffers. These skip the method channel codec
+// entirely: Dart writes straight into the frame returned by
+// webgpu_rend_get_pixel_buffer and then calls webgpu_rend_invalidate_texture.
+
+static SwPixelBuffer* webgpu_rend_plugin_lookup_locked(int64_t texture_id) {
+    if (g_plugin == nullptr) return nullptr;
+    return (SwPixelBuffer*)g_hash_table_lookup(g_plugin->textures, (gpointer)texture_id);
+}
+
+extern "C" {
+
+API_EXPORT uint8_t* webgpu_rend_get_pixel_buffer(int64_t texture_id) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    uint8_t* pixels = buffer != nullptr ? sw_pixel_buffer_begin_frame(buffer) : nullptr;
+    g_mutex_unlock(&g_textures_mutex);
+    return pixels;
+}
+
+API_EXPORT void webgpu_rend_invalidate_texture(int64_t texture_id) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    if (buffer != nullptr) {
+        sw_pixel_buffer_publish(buffer);
+        fl_texture_registrar_mark_texture_frame_available(g_plugin->registrar, (FlTexture*)(&buffer->parent_instance));
+    }
+    g_mutex_unlock(&g_textures_mutex);
+}
+
+API_EXPORT void webgpu_rend_invalidate_texture_rects(int64_t texture_id, const int32_t* rects, int32_t count) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    if (buffer != nullptr) {
+        for (int32_t i = 0; i < count; i++) {
+            sw_pixel_buffer_add_damage(buffer, rects[4 * i], rects[4 * i + 1], rects[4 * i + 2], rects[4 * i + 3]);
+        }
+        sw_pixel_buffer_publish(buffer);
+        fl_texture_registrar_mark_texture_frame_available(g_plugin->registrar, (FlTexture*)(&buffer->parent_instance));
+    }
+    g_mutex_unlock(&g_textures_mutex);
+}
+
+API_EXPORT int32_t webgpu_rend_get_texture_damage(int64_t texture_id, int32_t* out_rects, int32_t max_rects) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    int32_t count = 0;
+    if (buffer != nullptr) {
+        const SwDamageRegion* damage = sw_pixel_buffer_get_damage(buffer);
+        for (; count < damage->count && count < max_rects; count++) {
+            const SwRect& rect = damage->rects[count];
+            out_rects[4 * count] = rect.x;
+            out_rects[4 * count + 1] = rect.y;
+            out_rects[4 * count + 2] = rect.width;
+            out_rects[4 * count + 3] = rect.height;
+        }
+    }
+    g_mutex_unlock(&g_textures_mutex);
+    return count;
+}
+
+// Software 3D rendering and layer compositing. One rasterizer, and one worker
+// per core, shared by all textures; calls from Dart are serialized by
+// g_textures_mutex anyway.
+static SwThreadPool* g_raster_pool = nullptr;
+static SwRasterizer* g_rasterizer = nullptr;
+
+static SwThreadPool* webgpu_rend_plugin_raster_pool_locked() {
+    if (g_raster_pool == nullptr) {
+        g_raster_pool = sw_thread_pool_new(0);
+    }
+    return g_raster_pool;
+}
+
+static void webgpu_rend_plugin_raster_target_locked(SwPixelBuffer* buffer, SwRasterTarget* target) {
+    if (g_rasterizer == nullptr) {
+        g_rasterizer = sw_rasterizer_new(webgpu_rend_plugin_raster_pool_locked());
+    }
+    if (buffer->depth == nullptr) {
+        buffer->depth = g_new(float, buffer->width * buffer->height);
+        std::fill(buffer->depth, buffer->depth + buffer->width * buffer->height, 1.0f);
+    }
+    target->pixels = sw_pixel_buffer_begin_frame(buffer);
+    target->stride = 4 * buffer->width;
+    target->depth = buffer->depth;
+    target->width = (int32_t)buffer->width;
+    target->height = (int32_t)buffer->height;
+}
+
+API_EXPORT void webgpu_rend_raster_clear(int64_t texture_id, uint32_t argb, float depth) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    SwRasterTarget target;
+    if (buffer != nullptr) {
+        webgpu_rend_plugin_raster_target_locked(buffer, &target);
+        sw_rasterizer_clear(g_rasterizer, &target, sw_blit_argb_to_rgba(argb), depth);
+        sw_pixel_buffer_add_damage(buffer, 0, 0, buffer->width, buffer->height);
+    }
+    g_mutex_unlock(&g_textures_mutex);
+}
+
+API_EXPORT void webgpu_rend_raster_draw_mesh(int64_t texture_id, const float* vertices, int64_t vertex_count,
+                                             const uint32_t* indices, int64_t index_count, const float* mvp,
+                                             uint32_t argb, int32_t cull_mode) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    SwRasterTarget target;
+    if (buffer != nullptr) {
+        webgpu_rend_plugin_raster_target_locked(buffer, &target);
+        SwMeshDraw draw = {};
+        draw.vertices = vertices;
+        draw.vertex_count = vertex_count;
+        draw.indices = indices;
+        draw.index_count = index_count;
+        memcpy(draw.mvp, mvp, sizeof(draw.mvp));
+        draw.color = sw_blit_argb_to_rgba(argb);
+        // Same light as the lit shader in the example app
+        const float light = 0.57735027f;
+        draw.light_dir[0] = draw.light_dir[1] = draw.light_dir[2] = light;
+        draw.ambient = 0.3f;
+        draw.cull_mode = cull_mode == SW_CULL_FRONT || cull_mode == SW_CULL_BACK ? (SwCullMode)cull_mode : SW_CULL_NONE;
+        SwRect bounds = sw_rasterizer_draw(g_rasterizer, &target, &draw);
+        if (bounds.width > 0) {
+            sw_pixel_buffer_add_damage(buffer, bounds.x, bounds.y, bounds.width, bounds.height);
+        }
+    }
+    g_mutex_unlock(&g_textures_mutex);
+}
+
+// Layers composited into one texture. Layer pixels are written straight from
+// Dart through webgpu_rend_layer_get_pixels, only webgpu_rend_compose touches
+// the texture's frames.
+
+API_EXPORT int32_t webgpu_rend_layer_create(int64_t texture_id, int32_t width, int32_t height) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    int32_t layer = -1;
+    if (buffer != nullptr) {
+        if (buffer->compositor == nullptr) {
+            buffer->compositor = sw_compositor_new(webgpu_rend_plugin_raster_pool_locked(), (int32_t)buffer->width,
+                                                   (int32_t)buffer->height);
+        }
+        layer = sw_compositor_add_layer(buffer->compositor, width, height);
+    }
+    g_mutex_unlock(&g_textures_mutex);
+    return layer;
+}
+
+static SwCompositor* webgpu_rend_plugin_compositor_locked(int64_t texture_id) {
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    return buffer != nullptr ? buffer->compositor : nullptr;
+}
+
+API_EXPORT void webgpu_rend_layer_dispose(int64_t texture_id, int32_t layer) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwCompositor* compositor = webgpu_rend_plugin_compositor_locked(texture_id);
+    if (compositor != nullptr) {
+        sw_compositor_remove_layer(compositor, layer);
+    }
+    g_mutex_unlock(&g_textures_mutex);
+}
+
+API_EXPORT uint8_t* webgpu_rend_layer_get_pixels(int64_t texture_id, int32_t layer) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwCompositor* compositor = webgpu_rend_plugin_compositor_locked(texture_id);
+    uint8_t* pixels = compositor != nullptr ? sw_compositor_get_layer_pixels(compositor, layer) : nullptr;
+    g_mutex_unlock(&g_textures_mutex);
+    return pixels;
+}
+
+API_EXPORT void webgpu_rend_layer_mark_dirty(int64_t texture_id, int32_t layer, int32_t x, int32_t y, int32_t width,
+                                             int32_t height) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwCompositor* compositor = webgpu_rend_plugin_compositor_locked(texture_id);
+    if (compositor != nullptr) {
+        sw_compositor_mark_dirty(compositor, layer, x, y, width, height);
+    }
+    g_mutex_unlock(&g_textures_mutex);
+}
+
+API_EXPORT void webgpu_rend_layer_set_properties(int64_t texture_id, int32_t layer, int32_t x, int32_t y,
+                                                 int32_t opacity, int32_t blend, int32_t visible, int32_t z) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwCompositor* compositor = webgpu_rend_plugin_compositor_locked(texture_id);
+    if (compositor != nullptr) {
+        SwLayerProperties properties;
+        properties.x = x;
+        properties.y = y;
+        properties.opacity = (uint8_t)std::clamp(opacity, 0, 255);
+        properties.blend = (SwLayerBlend)blend;
+        properties.visible = visible != 0;
+        properties.z = z;
+        sw_compositor_set_layer_properties(compositor, layer, &properties);
+    }
+    g_mutex_unlock(&g_textures_mutex);
+}
+
+// Recomposes whatever changed since the last call on top of `background_argb`
+// (straight alpha) and presents it. Returns the number of rects redrawn, 0 if
+// nothing changed, in which case nothing is presented either.
+API_EXPORT int32_t webgpu_rend_compose(int64_t texture_id, uint32_t background_argb) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    g_mutex_lock(&g_textures_mutex);
+    SwPixelBuffer* buffer = webgpu_rend_plugin_lookup_locked(texture_id);
+    int32_t count = 0;
+    if (buffer != nullptr && buffer->compositor != nullptr) {
+        uint32_t background = sw_blit_argb_to_rgba(background_argb);
+        sw_blit_get_kernels()->rows[SW_BLIT_PREMULTIPLY]((uint8_t*)&background, (const uint8_t*)&background, 1);
+        uint8_t* pixels = sw_pixel_buffer_begin_frame(buffer);
+        SwDamageRegion damage = sw_compositor_compose(buffer->compositor, pixels, 4 * buffer->width, background);
+        for (int i = 0; i < damage.count; i++) {
+            const SwRect& rect = damage.rects[i];
+            sw_pixel_buffer_add_damage(buffer, rect.x, rect.y, rect.width, rect.height);
+        }
+        if (damage.count > 0) {
+            sw_pixel_buffer_publish(buffer);
+            fl_texture_registrar_mark_texture_frame_available(g_plugin->registrar, (FlTexture*)(&buffer->parent_instance));
+        }
+        count = damage.count;
+    }
+    g_mutex_unlock(&g_textures_mutex);
+    return count;
+}
+
+}  // extern "C"
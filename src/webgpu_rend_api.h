@@ -5,6 +5,8 @@
 
 #if _WIN32
 #define API_EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define API_EXPORT __attribute__((visibility("default")))
 #else
 #define API_EXPORT
 #endif
@@ -20,6 +22,13 @@ extern "C" {
 // Returns the WGPUDevice pointer
 API_EXPORT void* webgpu_rend_init(void* texture_registrar);
 
+// Persistent pipeline cache
+// Dawn stores compiled shaders and pipelines in `path` and reuses them on the
+// next run. Only takes effect when called before webgpu_rend_init.
+API_EXPORT void webgpu_rend_set_cache_directory(const char* path);
+// Blobs found on disk, blobs Dawn asked for that were missing, blobs written
+API_EXPORT void webgpu_rend_get_blob_cache_stats(int64_t* hits, int64_t* misses, int64_t* stores);
+
 // Helper to look up WebGPU functions
 API_EXPORT void* webgpu_rend_get_proc_address(const char* procName);
 
@@ -31,9 +40,155 @@ API_EXPORT int64_t webgpu_rend_get_texture_id(WebgpuRendTexture handle);
 API_EXPORT void* webgpu_rend_get_wgpu_texture(WebgpuRendTexture handle);
 // Returns a WGPUTextureView pointer (default view)
 API_EXPORT void* webgpu_rend_get_wgpu_texture_view(WebgpuRendTexture handle);
+// Brackets rendering into a texture that Flutter may also be reading.
+// No-ops on backends that do not share memory with the compositor.
+API_EXPORT void webgpu_rend_texture_begin_access(WebgpuRendTexture handle);
+API_EXPORT void webgpu_rend_texture_end_access(WebgpuRendTexture handle);
 API_EXPORT void webgpu_rend_present_texture(WebgpuRendTexture handle);
 API_EXPORT void webgpu_rend_dispose_texture(WebgpuRendTexture handle);
 
+// Frame pacing
+// Presenting only waits for the GPU once max_frames_in_flight frames of that
+// texture (2 by default, at most 8) are still being rendered. The callback
+// runs with the texture and the serial of the frame that finished, on
+// whichever thread saw the GPU finish it (the completion thread if it is
+// running), so Dart passes a NativeCallable.listener. Without the completion
+// thread nothing delivers frames on its own: webgpu_rend_process_events
+// does, and returns how many frames are still in flight over all textures
+// (on Linux, or still being read back).
+typedef void (*WebgpuRendFrameReadyCallback)(WebgpuRendTexture handle, uint64_t serial);
+API_EXPORT void webgpu_rend_set_frame_ready_callback(WebgpuRendFrameReadyCallback callback);
+API_EXPORT void webgpu_rend_set_max_frames_in_flight(WebgpuRendTexture handle, int32_t count);
+API_EXPORT int32_t webgpu_rend_get_max_frames_in_flight(WebgpuRendTexture handle);
+API_EXPORT int32_t webgpu_rend_get_frames_in_flight(WebgpuRendTexture handle);
+API_EXPORT int32_t webgpu_rend_process_events(void);
+
+// Async completion
+// A native thread waits on the WGPUFuture of every watched operation (buffer
+// maps, work-done notifications, async pipeline creation) with
+// Instance::WaitAny, so their callbacks fire as soon as the GPU finishes
+// without Dart ticking the device. The thread only runs when the device has
+// ImplicitDeviceSynchronization; watch returns 0 if it is not running, the
+// caller then has to process events itself.
+API_EXPORT int32_t webgpu_rend_completion_watch(uint64_t future_id);
+API_EXPORT int32_t webgpu_rend_completion_thread_running(void);
+// Futures completed so far and the ones still being waited on
+API_EXPORT void webgpu_rend_get_completion_stats(int64_t* completed, int64_t* pending);
+
+// Texture readback
+// Copies a region of a texture's mip level into a pooled MapRead buffer,
+// submits the copy and maps the buffer. Returns the readback's id, or 0 if
+// the region is out of range or the format cannot be read back; a width or
+// height of 0 reaches to the edge of the level. future_id is the map's
+// future, for webgpu_rend_completion_watch, and row_bytes the tight row size
+// of the result. The callback runs with the id once the map finished (status
+// 1) or failed (0), on whichever thread processed Dawn events. finish then
+// copies the rows into dst, dst_row_bytes apart (0 for tight rows), returning
+// the bytes written or -1, and gives the buffer back to the pool; a null dst
+// drops the result. trim releases the idle buffers.
+typedef void (*WebgpuRendReadbackCallback)(uint64_t id, int32_t status);
+API_EXPORT void webgpu_rend_set_readback_callback(WebgpuRendReadbackCallback callback);
+API_EXPORT uint64_t webgpu_rend_readback_begin(void* texture, uint32_t mip_level, uint32_t x, uint32_t y,
+                                               uint32_t width, uint32_t height, uint64_t* future_id,
+                                               uint32_t* row_bytes);
+API_EXPORT int64_t webgpu_rend_readback_finish(uint64_t id, uint8_t* dst, uint32_t dst_row_bytes);
+API_EXPORT void webgpu_rend_readback_trim(void);
+// Readbacks served from the pool, buffers created, bytes held by idle buffers
+API_EXPORT void webgpu_rend_get_readback_stats(int64_t* reused, int64_t* created, int64_t* pooled_bytes);
+
+// Command streams
+// Runs render pass commands Dart recorded into a buffer of 32-bit words (see
+// CommandOp in webgpu_rend_command_stream.h) on a WGPURenderPassEncoder, one
+// call per pass instead of one per command. Objects in the stream are
+// indices into handles. Returns how many commands ran, or -1 if the stream is
+// malformed, after issuing the commands before the bad one.
+API_EXPORT int64_t webgpu_rend_execute_commands(void* pass, const uint32_t* commands, int64_t word_count,
+                                                void* const* handles, int64_t handle_count);
+
+// Mesh loading
+// Parses a Wavefront OBJ file or buffer on up to `threads` threads (0 for one
+// per core) into interleaved position.xyz, normal.xyz vertices, triangle
+// indices and one group per usemtl run. Always returns a mesh, check
+// webgpu_rend_mesh_get_error before reading it. The vertex, index and string
+// pointers live as long as the mesh; it starts with one reference, released
+// by webgpu_rend_mesh_release.
+API_EXPORT void* webgpu_rend_obj_parse_file(const char* path, int32_t threads);
+API_EXPORT void* webgpu_rend_obj_parse_bytes(const uint8_t* data, int64_t size, int32_t threads);
+// Null unless parsing failed
+API_EXPORT const char* webgpu_rend_mesh_get_error(void* mesh);
+API_EXPORT float* webgpu_rend_mesh_get_vertices(void* mesh, int64_t* float_count);
+API_EXPORT uint32_t* webgpu_rend_mesh_get_indices(void* mesh, int64_t* count);
+API_EXPORT int32_t webgpu_rend_mesh_get_group_count(void* mesh);
+// Returns the group's material name, null if group is out of range
+API_EXPORT const char* webgpu_rend_mesh_get_group(void* mesh, int32_t group, int64_t* index_start,
+                                                 int64_t* index_count);
+// Null if the OBJ names no mtllib
+API_EXPORT const char* webgpu_rend_mesh_get_mtllib(void* mesh);
+API_EXPORT void webgpu_rend_mesh_retain(void* mesh);
+API_EXPORT void webgpu_rend_mesh_release(void* mesh);
+
+// Swapchains
+// A Flutter texture backed by count images (2 to 4), so the next frame can be
+// rendered while the compositor still reads the last one. The handle works
+// with get_texture_id, the frame pacing calls and dispose_texture, but is
+// presented per image: acquire_image hands out an image nobody is using, or
+// -1 while the GPU or compositor still hold all of them (retry once a frame
+// finished or the compositor drew one), and present_image switches Flutter to
+// it once the GPU finished it.
+API_EXPORT WebgpuRendTexture webgpu_rend_create_swapchain(int32_t width, int32_t height, int32_t count);
+API_EXPORT int32_t webgpu_rend_swapchain_get_image_count(WebgpuRendTexture handle);
+API_EXPORT int32_t webgpu_rend_swapchain_acquire_image(WebgpuRendTexture handle);
+API_EXPORT void* webgpu_rend_swapchain_get_wgpu_texture(WebgpuRendTexture handle, int32_t image);
+API_EXPORT void* webgpu_rend_swapchain_get_wgpu_texture_view(WebgpuRendTexture handle, int32_t image);
+API_EXPORT void webgpu_rend_swapchain_present_image(WebgpuRendTexture handle, int32_t image);
+
+// Tracing
+// While capturing, every webgpu_rend_* call and the waits inside them are
+// recorded into per-thread rings (the newest 16384 events per thread are
+// kept). Spans measured in Dart are added with add_span against the clock of
+// webgpu_rend_trace_now_us. dump_json writes Chrome trace_event JSON into out
+// if capacity is large enough and returns its length in bytes either way, so
+// call it with a null buffer first; stop the capture before dumping.
+API_EXPORT void webgpu_rend_trace_start(void);
+API_EXPORT void webgpu_rend_trace_stop(void);
+API_EXPORT int64_t webgpu_rend_trace_now_us(void);
+API_EXPORT void webgpu_rend_trace_add_span(const char* name, int64_t start_us, int64_t duration_us);
+API_EXPORT int64_t webgpu_rend_trace_dump_json(char* out, int64_t capacity);
+
+// Software pixel buffers (Linux)
+// Textures created through the "init" method channel call, addressed by their
+// Flutter texture ID. The returned frame must be re-fetched after every
+// invalidate, since invalidating hands the current frame to the compositor.
+API_EXPORT uint8_t* webgpu_rend_get_pixel_buffer(int64_t texture_id);
+API_EXPORT void webgpu_rend_invalidate_texture(int64_t texture_id);
+// Damage rects are x, y, width, height quadruples. Only the damaged rows are
+// carried over into the next frame, so anything written outside of them
+// through webgpu_rend_get_pixel_buffer may be lost.
+API_EXPORT void webgpu_rend_invalidate_texture_rects(int64_t texture_id, const int32_t* rects, int32_t count);
+// Copies up to max_rects rects of the latest frame's damage, returns how many.
+API_EXPORT int32_t webgpu_rend_get_texture_damage(int64_t texture_id, int32_t* out_rects, int32_t max_rects);
+// CPU rasterizer drawing into the frame being built. Colors are 0xAARRGGBB.
+// Vertices are position.xyz, normal.xyz, mvp is a column-major 4x4 matrix in
+// WebGPU clip space, cull_mode is 0 for none, 1 for front and 2 for back.
+API_EXPORT void webgpu_rend_raster_clear(int64_t texture_id, uint32_t argb, float depth);
+API_EXPORT void webgpu_rend_raster_draw_mesh(int64_t texture_id, const float* vertices, int64_t vertex_count,
+                                             const uint32_t* indices, int64_t index_count, const float* mvp,
+                                             uint32_t argb, int32_t cull_mode);
+// Layers composited into a pixel buffer texture. Layer pixels are
+// premultiplied RGBA and stay valid until the layer is disposed; mark what
+// was written with webgpu_rend_layer_mark_dirty (width or height <= 0 marks
+// the whole layer). opacity is 0-255, blend is 0 for over, 1 for source, 2
+// for add and 3 for multiply. webgpu_rend_compose redraws the dirty parts and
+// presents them, returning how many rects it redrew.
+API_EXPORT int32_t webgpu_rend_layer_create(int64_t texture_id, int32_t width, int32_t height);
+API_EXPORT void webgpu_rend_layer_dispose(int64_t texture_id, int32_t layer);
+API_EXPORT uint8_t* webgpu_rend_layer_get_pixels(int64_t texture_id, int32_t layer);
+API_EXPORT void webgpu_rend_layer_mark_dirty(int64_t texture_id, int32_t layer, int32_t x, int32_t y, int32_t width,
+                                             int32_t height);
+API_EXPORT void webgpu_rend_layer_set_properties(int64_t texture_id, int32_t layer, int32_t x, int32_t y,
+                                                 int32_t opacity, int32_t blend, int32_t visible, int32_t z);
+API_EXPORT int32_t webgpu_rend_compose(int64_t texture_id, uint32_t background_argb);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,152 @@
+#include "webgpu_rend_blob_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "webgpu_rend_api.h"
+#include "webgpu_rend_trace.h"
+
+namespace webgpu_rend {
+
+namespace {
+
+// File layout: magic, key size, key bytes, then the blob
+constexpr uint32_t kBlobMagic = 0x57524243;  // "WRBC"
+
+std::mutex g_cache_mutex;
+std::string g_cache_directory;
+// Never freed, Dawn may still store blobs while the device is torn down
+// during static destruction
+BlobCache* g_blob_cache = nullptr;
+
+uint64_t HashKey(const void* key, size_t key_size) {
+    // FNV-1a
+    const uint8_t* bytes = static_cast<const uint8_t*>(key);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < key_size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+struct FileCloser {
+    void operator()(FILE* file) const { std::fclose(file); }
+};
+using File = std::unique_ptr<FILE, FileCloser>;
+
+}  // namespace
+
+BlobCache::BlobCache(std::string directory) : directory_(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+}
+
+std::string BlobCache::PathFor(const void* key, size_t key_size) const {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(HashKey(key, key_size)));
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+size_t BlobCache::Load(const void* key, size_t key_size, void* value, size_t value_size, void* userdata) {
+    return static_cast<BlobCache*>(userdata)->LoadBlob(key, key_size, value, value_size);
+}
+
+void BlobCache::Store(const void* key, size_t key_size, const void* value, size_t value_size, void* userdata) {
+    static_cast<BlobCache*>(userdata)->StoreBlob(key, key_size, value, value_size);
+}
+
+size_t BlobCache::LoadBlob(const void* key, size_t key_size, void* value, size_t value_size) {
+    WEBGPU_REND_TRACE_SCOPE("BlobCache::Load");
+    std::lock_guard<std::mutex> lock(mutex_);
+    File file(std::fopen(PathFor(key, key_size).c_str(), "rb"));
+    uint32_t header[2] = {};
+    std::vector<uint8_t> stored_key(key_size);
+    bool match = file && std::fread(header, sizeof(header), 1, file.get()) == 1 && header[0] == kBlobMagic &&
+                 header[1] == key_size && std::fread(stored_key.data(), 1, key_size, file.get()) == key_size &&
+                 std::memcmp(stored_key.data(), key, key_size) == 0;
+    long blob_start = match ? std::ftell(file.get()) : -1;
+    if (!match || blob_start < 0 || std::fseek(file.get(), 0, SEEK_END) != 0) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    size_t blob_size = static_cast<size_t>(std::ftell(file.get()) - blob_start);
+    // Dawn asks for the size first, only count the read that follows
+    if (value == nullptr || value_size < blob_size) return blob_size;
+    std::fseek(file.get(), blob_start, SEEK_SET);
+    if (std::fread(value, 1, blob_size, file.get()) != blob_size) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return blob_size;
+}
+
+void BlobCache::StoreBlob(const void* key, size_t key_size, const void* value, size_t value_size) {
+    WEBGPU_REND_TRACE_SCOPE("BlobCache::Store");
+    std::string path = PathFor(key, key_size);
+    std::string temp_path = path + ".tmp" + std::to_string(temp_counter_.fetch_add(1, std::memory_order_relaxed));
+    {
+        File file(std::fopen(temp_path.c_str(), "wb"));
+        if (!file) return;
+        uint32_t header[2] = {kBlobMagic, static_cast<uint32_t>(key_size)};
+        bool written = std::fwrite(header, sizeof(header), 1, file.get()) == 1 &&
+                       std::fwrite(key, 1, key_size, file.get()) == key_size &&
+                       std::fwrite(value, 1, value_size, file.get()) == value_size;
+        if (!written) {
+            file.reset();
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::filesystem::remove(temp_path, error);
+        return;
+    }
+    stores_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SetCacheDirectory(const char* path) {
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    g_cache_directory = path != nullptr ? path : "";
+}
+
+std::string CacheDirectory() {
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    return g_cache_directory;
+}
+
+BlobCache* ActiveBlobCache() {
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    return g_blob_cache;
+}
+
+BlobCache* CreateBlobCache() {
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    if (g_cache_directory.empty()) return nullptr;
+    // The device is created once and keeps pointing at this cache
+    if (g_blob_cache == nullptr) g_blob_cache = new BlobCache(g_cache_directory);
+    return g_blob_cache;
+}
+
+}  // namespace webgpu_rend
+
+extern "C" {
+
+API_EXPORT void webgpu_rend_set_cache_directory(const char* path) {
+    webgpu_rend::SetCacheDirectory(path);
+}
+
+API_EXPORT void webgpu_rend_get_blob_cache_stats(int64_t* hits, int64_t* misses, int64_t* stores) {
+    webgpu_rend::BlobCache* cache = webgpu_rend::ActiveBlobCache();
+    if (hits != nullptr) *hits = cache ? static_cast<int64_t>(cache->Hits()) : 0;
+    if (misses != nullptr) *misses = cache ? static_cast<int64_t>(cache->Misses()) : 0;
+    if (stores != nullptr) *stores = cache ? static_cast<int64_t>(cache->Stores()) : 0;
+}
+
+}  // extern C
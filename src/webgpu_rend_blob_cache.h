@@ -0,0 +1,65 @@
+#ifndef WEBGPU_REND_BLOB_CACHE_H
+#define WEBGPU_REND_BLOB_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace webgpu_rend {
+
+// Persistent store behind Dawn's blob cache, one file per key in a
+// directory. Dawn hands it compiled shaders and pipelines and asks for them
+// back on the next run, which skips Tint and the driver compiler.
+//
+// Keys are hashed into file names and stored in full at the start of each
+// file, so a hash collision reads as a miss rather than the wrong blob.
+// Files are written to a temporary name and renamed, so a crash mid-write
+// leaves no torn entry behind. Dawn may call in from its worker threads.
+class BlobCache {
+   public:
+    explicit BlobCache(std::string directory);
+
+    BlobCache(const BlobCache&) = delete;
+    BlobCache& operator=(const BlobCache&) = delete;
+
+    // Signatures of WGPUDawnLoadCacheDataFunction and
+    // WGPUDawnStoreCacheDataFunction, `userdata` is the BlobCache. Load
+    // returns the size of the blob, copying it into `value` if `value_size`
+    // is large enough, or 0 on a miss.
+    static size_t Load(const void* key, size_t key_size, void* value, size_t value_size, void* userdata);
+    static void Store(const void* key, size_t key_size, const void* value, size_t value_size, void* userdata);
+
+    const std::string& Directory() const { return directory_; }
+    uint64_t Hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t Misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t Stores() const { return stores_.load(std::memory_order_relaxed); }
+
+   private:
+    std::string PathFor(const void* key, size_t key_size) const;
+    size_t LoadBlob(const void* key, size_t key_size, void* value, size_t value_size);
+    void StoreBlob(const void* key, size_t key_size, const void* value, size_t value_size);
+
+    std::string directory_;
+    // Serializes file access, Dawn sizes a blob and then reads it in two calls
+    std::mutex mutex_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> stores_{0};
+    std::atomic<uint64_t> temp_counter_{0};
+};
+
+// Directory set through webgpu_rend_set_cache_directory, empty if none. It
+// only takes effect if set before the device is created.
+void SetCacheDirectory(const char* path);
+std::string CacheDirectory();
+// The cache the device was created with, null if there is none
+BlobCache* ActiveBlobCache();
+// Called by the backends when creating the device. Returns the cache for
+// CacheDirectory(), created on first use, or null if none is set.
+BlobCache* CreateBlobCache();
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_BLOB_CACHE_H
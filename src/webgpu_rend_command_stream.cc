@@ -0,0 +1,117 @@
+#include "webgpu_rend_command_stream.h"
+
+#include <cstring>
+
+#include "webgpu_rend_api.h"
+#include "webgpu_rend_trace.h"
+
+namespace webgpu_rend {
+
+namespace {
+
+// Operands of each opcode, kSetBindGroup adds its offsets on top
+size_t OperandCount(CommandOp op) {
+    switch (op) {
+        case CommandOp::kSetPipeline:
+            return 1;
+        case CommandOp::kSetBindGroup:
+            return 3;
+        case CommandOp::kSetVertexBuffer:
+        case CommandOp::kSetIndexBuffer:
+            return 6;
+        case CommandOp::kDraw:
+        case CommandOp::kSetScissorRect:
+            return 4;
+        case CommandOp::kDrawIndexed:
+            return 5;
+        case CommandOp::kSetViewport:
+            return 6;
+    }
+    return SIZE_MAX;
+}
+
+uint64_t Read64(const uint32_t* words) { return static_cast<uint64_t>(words[0]) | static_cast<uint64_t>(words[1]) << 32; }
+
+float ReadFloat(uint32_t word) {
+    float value;
+    std::memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+}  // namespace
+
+int64_t ExecuteRenderCommands(WGPURenderPassEncoder pass, const uint32_t* words, size_t word_count,
+                              void* const* handles, size_t handle_count) {
+    WEBGPU_REND_TRACE_SCOPE("ExecuteRenderCommands");
+    if (pass == nullptr || (words == nullptr && word_count > 0)) return -1;
+    int64_t executed = 0;
+    size_t pos = 0;
+    while (pos < word_count) {
+        CommandOp op = static_cast<CommandOp>(words[pos++]);
+        size_t operands = OperandCount(op);
+        if (operands > word_count - pos) return -1;
+        const uint32_t* args = words + pos;
+        pos += operands;
+        switch (op) {
+            case CommandOp::kSetPipeline:
+                if (args[0] >= handle_count) return -1;
+                wgpuRenderPassEncoderSetPipeline(pass, static_cast<WGPURenderPipeline>(handles[args[0]]));
+                break;
+            case CommandOp::kSetBindGroup: {
+                uint32_t offset_count = args[2];
+                if (args[1] >= handle_count || offset_count > kMaxCommandDynamicOffsets ||
+                    offset_count > word_count - pos) {
+                    return -1;
+                }
+                const uint32_t* offsets = words + pos;
+                pos += offset_count;
+                wgpuRenderPassEncoderSetBindGroup(pass, args[0], static_cast<WGPUBindGroup>(handles[args[1]]),
+                                                  offset_count, offset_count > 0 ? offsets : nullptr);
+                break;
+            }
+            case CommandOp::kSetVertexBuffer:
+                if (args[1] >= handle_count) return -1;
+                wgpuRenderPassEncoderSetVertexBuffer(pass, args[0], static_cast<WGPUBuffer>(handles[args[1]]),
+                                                     Read64(args + 2), Read64(args + 4));
+                break;
+            case CommandOp::kSetIndexBuffer:
+                if (args[0] >= handle_count) return -1;
+                wgpuRenderPassEncoderSetIndexBuffer(pass, static_cast<WGPUBuffer>(handles[args[0]]),
+                                                    static_cast<WGPUIndexFormat>(args[1]), Read64(args + 2),
+                                                    Read64(args + 4));
+                break;
+            case CommandOp::kDraw:
+                wgpuRenderPassEncoderDraw(pass, args[0], args[1], args[2], args[3]);
+                break;
+            case CommandOp::kDrawIndexed:
+                wgpuRenderPassEncoderDrawIndexed(pass, args[0], args[1], args[2], static_cast<int32_t>(args[3]),
+                                                 args[4]);
+                break;
+            case CommandOp::kSetViewport:
+                wgpuRenderPassEncoderSetViewport(pass, ReadFloat(args[0]), ReadFloat(args[1]), ReadFloat(args[2]),
+                                                 ReadFloat(args[3]), ReadFloat(args[4]), ReadFloat(args[5]));
+                break;
+            case CommandOp::kSetScissorRect:
+                wgpuRenderPassEncoderSetScissorRect(pass, args[0], args[1], args[2], args[3]);
+                break;
+            default:
+                return -1;
+        }
+        executed++;
+    }
+    return executed;
+}
+
+}  // namespace webgpu_rend
+
+extern "C" {
+
+API_EXPORT int64_t webgpu_rend_execute_commands(void* pass, const uint32_t* commands, int64_t word_count,
+                                                void* const* handles, int64_t handle_count) {
+    if (word_count < 0 || handle_count < 0) return -1;
+    return webgpu_rend::ExecuteRenderCommands(static_cast<WGPURenderPassEncoder>(pass), commands,
+                                              static_cast<size_t>(word_count), handles,
+                                              static_cast<size_t>(handle_count));
+}
+
+}  // extern C
@@ -0,0 +1,48 @@
+#ifndef WEBGPU_REND_COMMAND_STREAM_H
+#define WEBGPU_REND_COMMAND_STREAM_H
+
+#include <dawn/webgpu.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace webgpu_rend {
+
+// Render pass commands recorded by GpuCommandList in Dart, keep the two in
+// sync. A command is its opcode followed by its operands, all 32-bit words.
+// Objects are indices into the handle table passed along with the stream,
+// 64-bit offsets and sizes are two words, low first, and floats are stored
+// by their bits.
+enum class CommandOp : uint32_t {
+    // pipeline
+    kSetPipeline = 1,
+    // group index, bind group, offset count, offsets
+    kSetBindGroup = 2,
+    // slot, buffer, offset (2 words), size (2 words)
+    kSetVertexBuffer = 3,
+    // buffer, WGPUIndexFormat, offset (2 words), size (2 words)
+    kSetIndexBuffer = 4,
+    // vertex count, instance count, first vertex, first instance
+    kDraw = 5,
+    // index count, instance count, first index, base vertex, first instance
+    kDrawIndexed = 6,
+    // x, y, width, height, min depth, max depth as floats
+    kSetViewport = 7,
+    // x, y, width, height
+    kSetScissorRect = 8,
+};
+
+// Dynamic offsets one kSetBindGroup may carry, WebGPU allows 8 uniform and
+// 4 storage buffers with dynamic offsets per pipeline layout
+constexpr uint32_t kMaxCommandDynamicOffsets = 12;
+
+// Issues the commands in `words` on `pass`, so a whole pass costs Dart one
+// FFI call instead of one per draw. Returns how many commands ran, or -1 if
+// the stream is malformed: a command is truncated, its opcode unknown or a
+// handle index out of range. Commands before the bad one have been issued.
+int64_t ExecuteRenderCommands(WGPURenderPassEncoder pass, const uint32_t* words, size_t word_count,
+                              void* const* handles, size_t handle_count);
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_COMMAND_STREAM_H
@@ -0,0 +1,138 @@
+#include "webgpu_rend_completion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include "webgpu_rend_api.h"
+#include "webgpu_rend_trace.h"
+
+namespace webgpu_rend {
+
+namespace {
+
+std::mutex g_completion_mutex;
+// Stopped at exit but never freed, like the instance it waits on
+CompletionThread* g_completion_thread = nullptr;
+
+void StopCompletionThreadAtExit() {
+    std::lock_guard<std::mutex> lock(g_completion_mutex);
+    if (g_completion_thread != nullptr) g_completion_thread->Stop();
+}
+
+}  // namespace
+
+CompletionThread::CompletionThread(WGPUInstance instance) : instance_(instance) {
+    thread_ = std::thread(&CompletionThread::Run, this);
+}
+
+CompletionThread::~CompletionThread() { Stop(); }
+
+void CompletionThread::Watch(WGPUFuture future) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        incoming_.push_back({future, false});
+    }
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    wake_.notify_one();
+}
+
+void CompletionThread::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void CompletionThread::Run() {
+    std::vector<WGPUFutureWaitInfo> waiting;
+    // Falls back to polling for good once a timed wait fails
+    bool timed_waits = true;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (waiting.empty()) wake_.wait(lock, [this] { return stopping_ || !incoming_.empty(); });
+            if (stopping_) return;
+            waiting.insert(waiting.end(), incoming_.begin(), incoming_.end());
+            incoming_.clear();
+        }
+
+        bool timed = timed_waits && waiting.size() <= kMaxTimedWaitFutures;
+        WGPUWaitStatus status;
+        {
+            WEBGPU_REND_TRACE_SCOPE("CompletionThread::WaitAny");
+            status = wgpuInstanceWaitAny(instance_, waiting.size(), waiting.data(),
+                                         timed ? kCompletionWaitTimeoutNs : 0);
+        }
+        if (status == WGPUWaitStatus_Success) {
+            size_t before = waiting.size();
+            waiting.erase(std::remove_if(waiting.begin(), waiting.end(),
+                                         [](const WGPUFutureWaitInfo& info) { return info.completed; }),
+                          waiting.end());
+            size_t done = before - waiting.size();
+            completed_.fetch_add(done, std::memory_order_relaxed);
+            pending_.fetch_sub(done, std::memory_order_relaxed);
+            continue;
+        }
+        if (status == WGPUWaitStatus_Error && timed) timed_waits = false;
+        if (!timed) std::this_thread::sleep_for(std::chrono::nanoseconds(kCompletionPollIntervalNs));
+    }
+}
+
+void StartCompletionThread(WGPUInstance instance, WGPUDevice device) {
+    if (!wgpuDeviceHasFeature(device, WGPUFeatureName_ImplicitDeviceSynchronization)) return;
+    std::lock_guard<std::mutex> lock(g_completion_mutex);
+    if (g_completion_thread != nullptr) return;
+    g_completion_thread = new CompletionThread(instance);
+    // Runs before the backends' statics, the instance included, go away
+    std::atexit(StopCompletionThreadAtExit);
+}
+
+CompletionThread* ActiveCompletionThread() {
+    std::lock_guard<std::mutex> lock(g_completion_mutex);
+    return g_completion_thread;
+}
+
+bool WatchFuture(WGPUFuture future) {
+    CompletionThread* thread = ActiveCompletionThread();
+    if (thread == nullptr) return false;
+    thread->Watch(future);
+    return true;
+}
+
+void WaitForFuture(WGPUInstance instance, WGPUFuture future) {
+    WGPUFutureWaitInfo info = {future, false};
+    bool timed = true;
+    while (!info.completed) {
+        WGPUWaitStatus status = wgpuInstanceWaitAny(instance, 1, &info, timed ? kCompletionWaitTimeoutNs : 0);
+        if (status == WGPUWaitStatus_Error && timed) {
+            timed = false;
+        } else if (!timed && !info.completed) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(kCompletionPollIntervalNs));
+        }
+    }
+}
+
+}  // namespace webgpu_rend
+
+extern "C" {
+
+API_EXPORT int32_t webgpu_rend_completion_watch(uint64_t future_id) {
+    if (future_id == 0) return 0;
+    return webgpu_rend::WatchFuture({future_id}) ? 1 : 0;
+}
+
+API_EXPORT int32_t webgpu_rend_completion_thread_running(void) {
+    return webgpu_rend::ActiveCompletionThread() != nullptr ? 1 : 0;
+}
+
+API_EXPORT void webgpu_rend_get_completion_stats(int64_t* completed, int64_t* pending) {
+    webgpu_rend::CompletionThread* thread = webgpu_rend::ActiveCompletionThread();
+    if (completed != nullptr) *completed = thread ? static_cast<int64_t>(thread->Completed()) : 0;
+    if (pending != nullptr) *pending = thread ? static_cast<int64_t>(thread->Pending()) : 0;
+}
+
+}  // extern C
@@ -0,0 +1,80 @@
+#ifndef WEBGPU_REND_COMPLETION_H
+#define WEBGPU_REND_COMPLETION_H
+
+#include <dawn/webgpu.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace webgpu_rend {
+
+// Futures a timed wait covers at once, Dawn's default timedWaitAnyMaxCount
+constexpr size_t kMaxTimedWaitFutures = 64;
+// How long one wait blocks before picking up newly watched futures
+constexpr uint64_t kCompletionWaitTimeoutNs = 2'000'000;
+// Pause between polls when timed waits are unavailable
+constexpr uint64_t kCompletionPollIntervalNs = 100'000;
+
+// Drives the callbacks of asynchronous operations started from Dart: buffer
+// maps, work-done notifications and pipeline creation. Dart hands over the
+// WGPUFuture of each operation and this thread waits on them with
+// Instance::WaitAny, so the callback, a NativeCallable.listener posting to
+// the isolate's port, fires as soon as the GPU is done. The isolate neither
+// polls nor ticks the device.
+//
+// Waits block with a timeout when the instance was created with
+// TimedWaitAny, otherwise the thread polls. With nothing to wait on it
+// sleeps until the next Watch.
+class CompletionThread {
+   public:
+    explicit CompletionThread(WGPUInstance instance);
+    ~CompletionThread();
+
+    CompletionThread(const CompletionThread&) = delete;
+    CompletionThread& operator=(const CompletionThread&) = delete;
+
+    void Watch(WGPUFuture future);
+    void Stop();
+
+    // Futures completed so far and the ones still waited on
+    uint64_t Completed() const { return completed_.load(std::memory_order_relaxed); }
+    uint64_t Pending() const { return pending_.load(std::memory_order_relaxed); }
+
+   private:
+    void Run();
+
+    WGPUInstance instance_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    // Handed over by Watch, moved into the thread's own list on each loop
+    std::vector<WGPUFutureWaitInfo> incoming_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> pending_{0};
+    std::thread thread_;
+};
+
+// Called by the backends once the device exists. Waiting on another thread
+// is only safe when the device was created with ImplicitDeviceSynchronization,
+// without it no thread is started and the callers keep ticking the device
+// themselves. The instance must outlive the thread, it is stopped at exit.
+void StartCompletionThread(WGPUInstance instance, WGPUDevice device);
+// Null until StartCompletionThread started a thread
+CompletionThread* ActiveCompletionThread();
+// Hands `future` to the completion thread. False if none is running, the
+// future then only completes once someone waits on it or processes events.
+bool WatchFuture(WGPUFuture future);
+
+// Blocks the caller until `future` completed, running its callback if it was
+// not delivered elsewhere. Waits in kCompletionWaitTimeoutNs steps, or polls
+// when timed waits are unavailable. Must not be called while holding a lock
+// the callback takes.
+void WaitForFuture(WGPUInstance instance, WGPUFuture future);
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_COMPLETION_H
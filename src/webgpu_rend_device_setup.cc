@@ -0,0 +1,58 @@
+#include "webgpu_rend_device_setup.h"
+
+#include <utility>
+
+#include "webgpu_rend_blob_cache.h"
+
+namespace webgpu_rend {
+
+std::unique_ptr<dawn::native::Instance> CreateInstance() {
+    // Lets the completion thread and presents block in WaitAny instead of
+    // polling
+    WGPUInstanceFeatureName features[] = {WGPUInstanceFeatureName_TimedWaitAny};
+    WGPUInstanceDescriptor descriptor = {};
+    descriptor.requiredFeatureCount = 1;
+    descriptor.requiredFeatures = features;
+    return std::make_unique<dawn::native::Instance>(&descriptor);
+}
+
+DeviceSetup::DeviceSetup(WGPUAdapter adapter, std::vector<WGPUFeatureName> features)
+    : features_(std::move(features)) {
+    // GPU profiling is opt-in per pass, but the feature has to be requested
+    // up front. Dawn rounds timestamps to 100us unless told otherwise.
+    if (wgpuAdapterHasFeature(adapter, WGPUFeatureName_TimestampQuery)) {
+        features_.push_back(WGPUFeatureName_TimestampQuery);
+        toggles_.chain.sType = WGPUSType_DawnTogglesDescriptor;
+        toggles_.disabledToggles = disabled_toggles_;
+        toggles_.disabledToggleCount = 1;
+        Chain(&toggles_.chain);
+    }
+
+    // Without it the completion thread is not started, see
+    // StartCompletionThread
+    if (wgpuAdapterHasFeature(adapter, WGPUFeatureName_ImplicitDeviceSynchronization)) {
+        features_.push_back(WGPUFeatureName_ImplicitDeviceSynchronization);
+    }
+
+    // Compiled shaders and pipelines persist across runs once the app set a
+    // cache directory
+    if (BlobCache* cache = CreateBlobCache()) {
+        cache_.chain.sType = WGPUSType_DawnCacheDeviceDescriptor;
+        cache_.isolationKey = {"webgpu_rend", WGPU_STRLEN};
+        cache_.loadDataFunction = BlobCache::Load;
+        cache_.storeDataFunction = BlobCache::Store;
+        cache_.functionUserdata = cache;
+        Chain(&cache_.chain);
+    }
+
+    descriptor_.nextInChain = chain_;
+    descriptor_.requiredFeatures = features_.data();
+    descriptor_.requiredFeatureCount = features_.size();
+}
+
+void DeviceSetup::Chain(WGPUChainedStruct* chain) {
+    chain->next = chain_;
+    chain_ = chain;
+}
+
+}  // namespace webgpu_rend
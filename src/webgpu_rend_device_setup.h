@@ -0,0 +1,45 @@
+#ifndef WEBGPU_REND_DEVICE_SETUP_H
+#define WEBGPU_REND_DEVICE_SETUP_H
+
+#include <dawn/native/DawnNative.h>
+#include <dawn/webgpu.h>
+
+#include <memory>
+#include <vector>
+
+namespace webgpu_rend {
+
+// The Dawn instance every backend starts from, with TimedWaitAny
+std::unique_ptr<dawn::native::Instance> CreateInstance();
+
+// The device descriptor every backend creates its Dawn device with, so the
+// optional features and the blob cache are configured in one place. Backends
+// add what only they need, such as a platform feature or the error callback,
+// before passing Descriptor() to CreateDevice.
+//
+// The descriptor points into this object, so it must outlive CreateDevice
+// and cannot be copied.
+class DeviceSetup {
+   public:
+    // Requests `features` plus whatever optional ones `adapter` supports
+    DeviceSetup(WGPUAdapter adapter, std::vector<WGPUFeatureName> features = {});
+
+    DeviceSetup(const DeviceSetup&) = delete;
+    DeviceSetup& operator=(const DeviceSetup&) = delete;
+
+    WGPUDeviceDescriptor* Descriptor() { return &descriptor_; }
+
+   private:
+    void Chain(WGPUChainedStruct* chain);
+
+    std::vector<WGPUFeatureName> features_;
+    const char* disabled_toggles_[1] = {"timestamp_quantization"};
+    WGPUDawnTogglesDescriptor toggles_ = {};
+    WGPUDawnCacheDeviceDescriptor cache_ = {};
+    WGPUChainedStruct* chain_ = nullptr;
+    WGPUDeviceDescriptor descriptor_ = {};
+};
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_DEVICE_SETUP_H
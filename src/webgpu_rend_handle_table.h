@@ -0,0 +1,209 @@
+#ifndef WEBGPU_REND_HANDLE_TABLE_H
+#define WEBGPU_REND_HANDLE_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace webgpu_rend {
+
+// Handles pack a slot index and the generation of the object in that slot,
+// so a stale handle (used after dispose, or after its slot was reused) is
+// rejected instead of reaching another object. They travel through the FFI as
+// pointers, so on 32-bit targets both halves shrink to fit.
+constexpr int kHandleIndexBits = sizeof(uintptr_t) >= 8 ? 32 : 20;
+constexpr int kHandleGenerationBits = sizeof(uintptr_t) >= 8 ? 32 : 12;
+constexpr uint64_t kHandleIndexMask = (uint64_t(1) << kHandleIndexBits) - 1;
+constexpr uint64_t kHandleGenerationMask = (uint64_t(1) << kHandleGenerationBits) - 1;
+
+inline void* HandleToPointer(uint64_t handle) {
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(handle));
+}
+
+inline uint64_t HandleFromPointer(const void* pointer) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer));
+}
+
+// Slot map owning objects of type T, addressed by generation-checked handles.
+//
+// Lookups are wait-free: a reader bumps the slot's reader count, checks the
+// generation and is done, no lock and no retry loop. Slots live in chunks
+// that are never moved or freed while the table exists, and released slots
+// go on a lock-free freelist. Only Remove waits, for readers of that one slot
+// to let go, so an object is never destroyed while a Ref to it is alive.
+template <typename T>
+class HandleTable {
+    struct Slot;
+
+   public:
+    // Keeps the object alive while held. Evaluates to false if the handle
+    // was stale.
+    class Ref {
+       public:
+        Ref() = default;
+        Ref(Ref&& other) noexcept : slot_(other.slot_), value_(other.value_) {
+            other.slot_ = nullptr;
+            other.value_ = nullptr;
+        }
+        Ref(const Ref&) = delete;
+        Ref& operator=(const Ref&) = delete;
+        ~Ref() {
+            if (slot_ != nullptr) slot_->readers.fetch_sub(1, std::memory_order_release);
+        }
+
+        T* get() const { return value_; }
+        T* operator->() const { return value_; }
+        T& operator*() const { return *value_; }
+        explicit operator bool() const { return value_ != nullptr; }
+
+       private:
+        friend class HandleTable;
+        Slot* slot_ = nullptr;
+        T* value_ = nullptr;
+    };
+
+    HandleTable() = default;
+    HandleTable(const HandleTable&) = delete;
+    HandleTable& operator=(const HandleTable&) = delete;
+
+    ~HandleTable() {
+        for (std::atomic<Slot*>& chunk : chunks_) {
+            Slot* slots = chunk.load(std::memory_order_acquire);
+            if (slots == nullptr) continue;
+            for (uint32_t i = 0; i < kChunkSize; i++) {
+                if (slots[i].generation.load(std::memory_order_relaxed) & 1) {
+                    delete slots[i].value.load(std::memory_order_relaxed);
+                }
+            }
+            delete[] slots;
+        }
+    }
+
+    // Takes ownership of `value`. Returns 0, which is never a valid handle,
+    // if the table is full.
+    uint64_t Insert(std::unique_ptr<T> value) {
+        uint32_t index;
+        if (!PopFree(&index)) {
+            index = next_unused_.fetch_add(1, std::memory_order_relaxed);
+            if (index >= kMaxSlots || !EnsureChunk(index)) return 0;
+        }
+        Slot& slot = SlotAt(index);
+        slot.value.store(value.release(), std::memory_order_relaxed);
+        // Odd generations are occupied, even ones free
+        uint32_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+        slot.generation.store(generation, std::memory_order_seq_cst);
+        return (uint64_t(generation) & kHandleGenerationMask) << kHandleIndexBits | (uint64_t(index) + 1);
+    }
+
+    Ref Acquire(uint64_t handle) {
+        Ref ref;
+        Slot* slot = Find(handle);
+        if (slot == nullptr) return ref;
+        slot->readers.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t generation = slot->generation.load(std::memory_order_seq_cst);
+        if ((generation & 1) == 0 || (generation & kHandleGenerationMask) != handle >> kHandleIndexBits) {
+            slot->readers.fetch_sub(1, std::memory_order_release);
+            return ref;
+        }
+        ref.slot_ = slot;
+        ref.value_ = slot->value.load(std::memory_order_relaxed);
+        return ref;
+    }
+
+    bool Contains(uint64_t handle) { return static_cast<bool>(Acquire(handle)); }
+
+    // Invalidates the handle and hands the object back once no Ref to it is
+    // left. Returns null for stale handles, so double disposal is harmless.
+    // Must not be called while the calling thread holds a Ref to the object.
+    std::unique_ptr<T> Remove(uint64_t handle) {
+        Slot* slot = Find(handle);
+        if (slot == nullptr) return nullptr;
+        uint32_t generation = slot->generation.load(std::memory_order_relaxed);
+        do {
+            if ((generation & 1) == 0 || (generation & kHandleGenerationMask) != handle >> kHandleIndexBits) {
+                return nullptr;
+            }
+        } while (!slot->generation.compare_exchange_weak(generation, generation + 1, std::memory_order_seq_cst));
+        // New readers now fail the generation check, wait out the ones that
+        // got in before it changed.
+        while (slot->readers.load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+        std::unique_ptr<T> value(slot->value.exchange(nullptr, std::memory_order_acquire));
+        PushFree(static_cast<uint32_t>((handle & kHandleIndexMask) - 1));
+        return value;
+    }
+
+   private:
+    static constexpr uint32_t kChunkSize = 256;
+    static constexpr uint32_t kMaxChunks = 1024;
+    static constexpr uint32_t kMaxSlots =
+        kChunkSize * kMaxChunks < kHandleIndexMask ? kChunkSize * kMaxChunks : uint32_t(kHandleIndexMask);
+
+    struct Slot {
+        std::atomic<uint32_t> generation{0};
+        std::atomic<uint32_t> readers{0};
+        // Freelist link, index + 1 of the next free slot
+        std::atomic<uint32_t> next_free{0};
+        std::atomic<T*> value{nullptr};
+    };
+
+    Slot& SlotAt(uint32_t index) {
+        return chunks_[index / kChunkSize].load(std::memory_order_acquire)[index % kChunkSize];
+    }
+
+    Slot* Find(uint64_t handle) {
+        uint64_t index = handle & kHandleIndexMask;
+        if (index == 0 || index > kMaxSlots) return nullptr;
+        index--;
+        Slot* slots = chunks_[index / kChunkSize].load(std::memory_order_acquire);
+        return slots != nullptr ? &slots[index % kChunkSize] : nullptr;
+    }
+
+    bool EnsureChunk(uint32_t index) {
+        std::atomic<Slot*>& chunk = chunks_[index / kChunkSize];
+        if (chunk.load(std::memory_order_acquire) != nullptr) return true;
+        Slot* slots = new Slot[kChunkSize];
+        Slot* expected = nullptr;
+        if (!chunk.compare_exchange_strong(expected, slots, std::memory_order_acq_rel)) {
+            // Another inserter got there first
+            delete[] slots;
+        }
+        return true;
+    }
+
+    // The freelist head is index + 1 in the low half and a tag bumped on
+    // every change in the high half, so a pop racing with a pop/push pair of
+    // the same slot cannot succeed (ABA).
+    bool PopFree(uint32_t* index) {
+        uint64_t head = free_head_.load(std::memory_order_acquire);
+        for (;;) {
+            uint32_t top = static_cast<uint32_t>(head);
+            if (top == 0) return false;
+            uint32_t next = SlotAt(top - 1).next_free.load(std::memory_order_relaxed);
+            uint64_t tagged = ((head >> 32) + 1) << 32 | next;
+            if (free_head_.compare_exchange_weak(head, tagged, std::memory_order_acq_rel)) {
+                *index = top - 1;
+                return true;
+            }
+        }
+    }
+
+    void PushFree(uint32_t index) {
+        Slot& slot = SlotAt(index);
+        uint64_t head = free_head_.load(std::memory_order_relaxed);
+        do {
+            slot.next_free.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        } while (!free_head_.compare_exchange_weak(head, ((head >> 32) + 1) << 32 | (index + 1),
+                                                   std::memory_order_release));
+    }
+
+    std::atomic<Slot*> chunks_[kMaxChunks] = {};
+    std::atomic<uint32_t> next_unused_{0};
+    std::atomic<uint64_t> free_head_{0};
+};
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_HANDLE_TABLE_H
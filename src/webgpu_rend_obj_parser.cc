@@ -0,0 +1,663 @@
+#include "webgpu_rend_obj_parser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "webgpu_rend_api.h"
+#include "webgpu_rend_trace.h"
+
+namespace webgpu_rend {
+
+namespace {
+
+constexpr uint32_t kNoNormal = UINT32_MAX;
+constexpr uint64_t kEmptyKey = UINT64_MAX;
+
+// Powers of ten a double holds exactly
+constexpr double kPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Line breaks are not spaces, lines are cut on '\n' first
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+const char* SkipSpace(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) p++;
+    return p;
+}
+
+const char* SkipToken(const char* p, const char* end) {
+    while (p < end && !IsSpace(*p)) p++;
+    return p;
+}
+
+// Face index as written, 1-based or negative counting back from the latest
+// element. Returns `p` if there is none.
+const char* ParseIndex(const char* p, const char* end, int64_t* out) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    const char* digits = p;
+    int64_t value = 0;
+    // Anything past 18 digits is out of range anyway
+    while (p < end && IsDigit(*p)) {
+        if (p - digits < 18) value = value * 10 + (*p - '0');
+        p++;
+    }
+    if (p == digits) return start;
+    *out = negative ? -value : value;
+    return p;
+}
+
+// A face corner as parsed. Relative indices are counted from the start of
+// the corner's range and may go negative, into earlier ranges, until the
+// range offsets are known.
+struct Corner {
+    enum : uint8_t { kRelativePosition = 1, kHasNormal = 2, kRelativeNormal = 4 };
+    int64_t position;
+    int64_t normal;
+    uint8_t flags;
+};
+
+// One line range of the input and what was parsed from it
+struct Range {
+    const char* begin;
+    const char* end;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    // Three per triangle
+    std::vector<Corner> corners;
+    // usemtl lines: the corner the material starts at, and its name
+    std::vector<std::pair<size_t, std::string>> materials;
+    std::string mtllib;
+    bool has_mtllib = false;
+    std::string error;
+
+    size_t position_offset = 0;
+    size_t normal_offset = 0;
+    size_t corner_offset = 0;
+    // (position << 32 | normal) of the range's distinct vertices in order of
+    // first use, and each corner's index into them
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> local_indices;
+    // keys index to the mesh's vertex number
+    std::vector<uint32_t> remap;
+};
+
+// Open-addressing map from vertex keys to vertex numbers, linear probing
+class VertexTable {
+   public:
+    explicit VertexTable(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity *= 2;
+        keys_.assign(capacity, kEmptyKey);
+        values_.resize(capacity);
+    }
+
+    // The number stored for `key`, or `value` after storing it
+    uint32_t FindOrInsert(uint64_t key, uint32_t value) {
+        if ((size_ + 1) * 2 > keys_.size()) Grow();
+        size_t mask = keys_.size() - 1;
+        for (size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask) {
+            if (keys_[slot] == key) return values_[slot];
+            if (keys_[slot] == kEmptyKey) {
+                keys_[slot] = key;
+                values_[slot] = value;
+                size_++;
+                return value;
+            }
+        }
+    }
+
+   private:
+    static size_t Hash(uint64_t key) {
+        // Finalizer of MurmurHash3, spreads the position bits into the low ones
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+
+    void Grow() {
+        std::vector<uint64_t> keys(keys_.size() * 2, kEmptyKey);
+        std::vector<uint32_t> values(keys.size());
+        size_t mask = keys.size() - 1;
+        for (size_t i = 0; i < keys_.size(); i++) {
+            if (keys_[i] == kEmptyKey) continue;
+            size_t slot = Hash(keys_[i]) & mask;
+            while (keys[slot] != kEmptyKey) slot = (slot + 1) & mask;
+            keys[slot] = keys_[i];
+            values[slot] = values_[i];
+        }
+        keys_.swap(keys);
+        values_.swap(values);
+    }
+
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> values_;
+    size_t size_ = 0;
+};
+
+// Runs task(0) .. task(count - 1), spread over up to `threads` threads
+template <typename Task>
+void RunParallel(size_t count, uint32_t threads, Task task) {
+    size_t workers = std::min<size_t>(count, threads);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) task(i);
+        return;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t w = 1; w < workers; w++) {
+        pool.emplace_back([&, w] {
+            for (size_t i = w; i < count; i += workers) task(i);
+        });
+    }
+    for (size_t i = 0; i < count; i += workers) task(i);
+    for (std::thread& thread : pool) thread.join();
+}
+
+void ParseFloats(const char* p, const char* end, std::vector<float>* out) {
+    for (int i = 0; i < 3; i++) {
+        p = SkipSpace(p, end);
+        float value = 0.0f;
+        p = ParseObjFloat(p, end, &value);
+        out->push_back(value);
+    }
+}
+
+void ParseFace(const char* p, const char* end, Range* range, std::vector<Corner>* face) {
+    int64_t position_count = static_cast<int64_t>(range->positions.size() / 3);
+    int64_t normal_count = static_cast<int64_t>(range->normals.size() / 3);
+    face->clear();
+    while (true) {
+        p = SkipSpace(p, end);
+        if (p >= end) break;
+        int64_t value = 0;
+        const char* next = ParseIndex(p, end, &value);
+        if (next == p || value == 0) {
+            p = SkipToken(p, end);
+            continue;
+        }
+        Corner corner = {value > 0 ? value - 1 : position_count + value, -1, 0};
+        if (value < 0) corner.flags |= Corner::kRelativePosition;
+        p = next;
+        if (p < end && *p == '/') {
+            // Texture coordinates are not part of the vertex layout
+            int64_t ignored;
+            p = ParseIndex(p + 1, end, &ignored);
+            if (p < end && *p == '/') {
+                next = ParseIndex(p + 1, end, &value);
+                if (next != p + 1 && value != 0) {
+                    corner.normal = value > 0 ? value - 1 : normal_count + value;
+                    corner.flags |= Corner::kHasNormal | (value < 0 ? Corner::kRelativeNormal : 0);
+                }
+                p = next;
+            }
+        }
+        p = SkipToken(p, end);
+        face->push_back(corner);
+    }
+    // Fan triangulation, like the Dart loader did
+    for (size_t i = 1; i + 1 < face->size(); i++) {
+        range->corners.push_back((*face)[0]);
+        range->corners.push_back((*face)[i]);
+        range->corners.push_back((*face)[i + 1]);
+    }
+}
+
+void ParseRange(Range* range) {
+    WEBGPU_REND_TRACE_SCOPE("ParseObj::Range");
+    std::vector<Corner> face;
+    const char* p = range->begin;
+    while (p < range->end) {
+        const char* line_end = static_cast<const char*>(std::memchr(p, '\n', range->end - p));
+        if (line_end == nullptr) line_end = range->end;
+        const char* keyword = SkipSpace(p, line_end);
+        const char* q = SkipToken(keyword, line_end);
+        size_t length = q - keyword;
+        if (length == 1 && keyword[0] == 'v') {
+            ParseFloats(q, line_end, &range->positions);
+        } else if (length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+            ParseFloats(q, line_end, &range->normals);
+        } else if (length == 1 && keyword[0] == 'f') {
+            ParseFace(q, line_end, range, &face);
+        } else if (length == 6 && (std::memcmp(keyword, "usemtl", 6) == 0 || std::memcmp(keyword, "mtllib", 6) == 0)) {
+            const char* name = SkipSpace(q, line_end);
+            std::string value(name, SkipToken(name, line_end));
+            if (keyword[0] == 'u') {
+                range->materials.emplace_back(range->corners.size(), std::move(value));
+            } else {
+                range->mtllib = std::move(value);
+                range->has_mtllib = true;
+            }
+        }
+        p = line_end + 1;
+    }
+}
+
+// Turns the range's corners into global vertex keys and dedups them locally
+void ResolveRange(Range* range, int64_t total_positions, int64_t total_normals) {
+    WEBGPU_REND_TRACE_SCOPE("ParseObj::Resolve");
+    VertexTable table(range->corners.size() / 4);
+    range->local_indices.resize(range->corners.size());
+    for (size_t i = 0; i < range->corners.size(); i++) {
+        const Corner& corner = range->corners[i];
+        int64_t position = corner.position;
+        if (corner.flags & Corner::kRelativePosition) position += static_cast<int64_t>(range->position_offset);
+        if (position < 0 || position >= total_positions) {
+            char message[128];
+            std::snprintf(message, sizeof(message), "Face refers to vertex %lld of %lld",
+                          static_cast<long long>(position + 1), static_cast<long long>(total_positions));
+            range->error = message;
+            return;
+        }
+        uint32_t normal = kNoNormal;
+        if (corner.flags & Corner::kHasNormal) {
+            int64_t index = corner.normal;
+            if (corner.flags & Corner::kRelativeNormal) index += static_cast<int64_t>(range->normal_offset);
+            if (index < 0 || index >= total_normals) {
+                char message[128];
+                std::snprintf(message, sizeof(message), "Face refers to normal %lld of %lld",
+                              static_cast<long long>(index + 1), static_cast<long long>(total_normals));
+                range->error = message;
+                return;
+            }
+            normal = static_cast<uint32_t>(index);
+        }
+        uint64_t key = static_cast<uint64_t>(position) << 32 | normal;
+        uint32_t next = static_cast<uint32_t>(range->keys.size());
+        uint32_t local = table.FindOrInsert(key, next);
+        if (local == next) range->keys.push_back(key);
+        range->local_indices[i] = local;
+    }
+    // Not needed anymore, give the memory back before the output is allocated
+    std::vector<Corner>().swap(range->corners);
+}
+
+// Positions or normals spread over the ranges, looked up by global index
+class Elements {
+   public:
+    Elements(const std::vector<Range>& ranges, bool normals) {
+        for (const Range& range : ranges) {
+            const std::vector<float>& values = normals ? range.normals : range.positions;
+            if (values.empty()) continue;
+            offsets_.push_back(normals ? range.normal_offset : range.position_offset);
+            data_.push_back(values.data());
+        }
+    }
+
+    const float* Get(size_t index) const {
+        size_t i = std::upper_bound(offsets_.begin(), offsets_.end(), index) - offsets_.begin() - 1;
+        return data_[i] + (index - offsets_[i]) * 3;
+    }
+
+   private:
+    std::vector<size_t> offsets_;
+    std::vector<const float*> data_;
+};
+
+// Read-only mapping of a whole file
+class MappedFile {
+   public:
+    explicit MappedFile(const char* path) {
+#ifdef _WIN32
+        int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+        std::wstring wide_path(length > 0 ? length : 1, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path, -1, wide_path.data(), length);
+        file_ = CreateFileW(wide_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size)) return;
+        size_ = static_cast<size_t>(size.QuadPart);
+        if (size_ == 0) {
+            valid_ = true;
+            return;
+        }
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr) return;
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        valid_ = data_ != nullptr;
+#else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            size_ = static_cast<size_t>(info.st_size);
+            if (size_ == 0) {
+                valid_ = true;
+            } else {
+                void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED) {
+                    madvise(data, size_, MADV_SEQUENTIAL);
+                    data_ = static_cast<const char*>(data);
+                    valid_ = true;
+                }
+            }
+        }
+        // The mapping keeps the file alive
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping_ != nullptr) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Valid() const { return valid_; }
+    const char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+   private:
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool valid_ = false;
+};
+
+}  // namespace
+
+const char* ParseObjFloat(const char* p, const char* end, float* out) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    // Up to 19 significant digits fit the mantissa, later ones only scale it
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool any = false;
+    for (; p < end && IsDigit(*p); p++) {
+        any = true;
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0) significant++;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && IsDigit(*p); p++) {
+            any = true;
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0) significant++;
+                exponent--;
+            }
+        }
+    }
+    if (!any) {
+        // inf, nan and the like, rare enough for strtod
+        char buffer[32];
+        size_t length = std::min<size_t>(SkipToken(start, end) - start, sizeof(buffer) - 1);
+        std::memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        char* parsed_end = nullptr;
+        double value = std::strtod(buffer, &parsed_end);
+        if (parsed_end == buffer) return start;
+        *out = static_cast<float>(value);
+        return start + (parsed_end - buffer);
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negative_exponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negative_exponent = *q == '-';
+            q++;
+        }
+        if (q < end && IsDigit(*q)) {
+            int value = 0;
+            for (; q < end && IsDigit(*q); q++) {
+                if (value < 10000) value = value * 10 + (*q - '0');
+            }
+            exponent += negative_exponent ? -value : value;
+            p = q;
+        }
+    }
+    double value = static_cast<double>(mantissa);
+    if (exponent < 0 && exponent >= -22) {
+        value /= kPowersOfTen[-exponent];
+    } else if (exponent > 0 && exponent <= 22) {
+        value *= kPowersOfTen[exponent];
+    } else if (exponent != 0) {
+        value *= std::pow(10.0, exponent);
+    }
+    *out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+bool ParseObj(const char* data, size_t size, uint32_t threads, ObjMesh* mesh) {
+    WEBGPU_REND_TRACE_SCOPE("ParseObj");
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, kMaxObjParserThreads);
+    size_t range_count = std::max<size_t>(1, std::min<size_t>(threads, size / kMinObjBytesPerThread));
+
+    // Cut into ranges of whole lines
+    std::vector<Range> ranges(range_count);
+    const char* end = data + size;
+    const char* begin = data;
+    for (size_t i = 0; i < range_count; i++) {
+        const char* cut = i + 1 == range_count ? end : data + size * (i + 1) / range_count;
+        if (cut < begin) cut = begin;
+        if (cut < end) {
+            const char* newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+            cut = newline != nullptr ? newline + 1 : end;
+        }
+        ranges[i].begin = begin;
+        ranges[i].end = cut;
+        begin = cut;
+    }
+
+    RunParallel(ranges.size(), threads, [&](size_t i) { ParseRange(&ranges[i]); });
+
+    size_t positions = 0, normals = 0, corners = 0;
+    for (Range& range : ranges) {
+        range.position_offset = positions;
+        range.normal_offset = normals;
+        range.corner_offset = corners;
+        positions += range.positions.size() / 3;
+        normals += range.normals.size() / 3;
+        corners += range.corners.size();
+        if (range.has_mtllib) {
+            mesh->mtllib = range.mtllib;
+            mesh->has_mtllib = true;
+        }
+    }
+    if (positions >= kNoNormal || normals >= kNoNormal || corners >= kNoNormal) {
+        mesh->error = "Mesh has more than 2^32 - 1 vertices or indices";
+        return false;
+    }
+
+    RunParallel(ranges.size(), threads, [&](size_t i) {
+        ResolveRange(&ranges[i], static_cast<int64_t>(positions), static_cast<int64_t>(normals));
+    });
+    for (const Range& range : ranges) {
+        if (!range.error.empty()) {
+            mesh->error = range.error;
+            return false;
+        }
+    }
+
+    // Number the vertices in order of first use. A single range's keys
+    // already are.
+    std::vector<uint64_t> unique;
+    if (ranges.size() == 1) {
+        unique.swap(ranges[0].keys);
+    } else {
+        WEBGPU_REND_TRACE_SCOPE("ParseObj::Merge");
+        size_t local_total = 0;
+        for (const Range& range : ranges) local_total += range.keys.size();
+        VertexTable table(local_total);
+        unique.reserve(local_total);
+        for (Range& range : ranges) {
+            range.remap.resize(range.keys.size());
+            for (size_t k = 0; k < range.keys.size(); k++) {
+                uint32_t next = static_cast<uint32_t>(unique.size());
+                uint32_t vertex = table.FindOrInsert(range.keys[k], next);
+                if (vertex == next) unique.push_back(range.keys[k]);
+                range.remap[k] = vertex;
+            }
+            std::vector<uint64_t>().swap(range.keys);
+        }
+    }
+
+    mesh->indices.resize(corners);
+    mesh->vertices.resize(unique.size() * kObjVertexFloats);
+    RunParallel(ranges.size(), threads, [&](size_t i) {
+        const Range& range = ranges[i];
+        uint32_t* out = mesh->indices.data() + range.corner_offset;
+        if (range.remap.empty()) {
+            std::memcpy(out, range.local_indices.data(), range.local_indices.size() * sizeof(uint32_t));
+            return;
+        }
+        for (size_t c = 0; c < range.local_indices.size(); c++) out[c] = range.remap[range.local_indices[c]];
+    });
+
+    Elements position_data(ranges, false);
+    Elements normal_data(ranges, true);
+    size_t slices = std::min<size_t>(threads, std::max<size_t>(1, unique.size() / 65536));
+    RunParallel(slices, threads, [&](size_t slice) {
+        size_t first = unique.size() * slice / slices;
+        size_t last = unique.size() * (slice + 1) / slices;
+        float* out = mesh->vertices.data() + first * kObjVertexFloats;
+        for (size_t v = first; v < last; v++, out += kObjVertexFloats) {
+            uint32_t normal = static_cast<uint32_t>(unique[v]);
+            std::memcpy(out, position_data.Get(static_cast<size_t>(unique[v] >> 32)), 3 * sizeof(float));
+            if (normal == kNoNormal) {
+                out[3] = 0.0f;
+                out[4] = 1.0f;
+                out[5] = 0.0f;
+            } else {
+                std::memcpy(out + 3, normal_data.Get(normal), 3 * sizeof(float));
+            }
+        }
+    });
+
+    // Groups split at every usemtl that follows some faces
+    std::string material = "default";
+    uint64_t group_start = 0;
+    for (Range& range : ranges) {
+        for (auto& [corner, name] : range.materials) {
+            uint64_t index = range.corner_offset + corner;
+            if (index > group_start) mesh->groups.push_back({material, group_start, index - group_start});
+            material = std::move(name);
+            group_start = index;
+        }
+    }
+    if (corners > group_start) mesh->groups.push_back({material, group_start, corners - group_start});
+    return true;
+}
+
+bool ParseObjFile(const char* path, uint32_t threads, ObjMesh* mesh) {
+    MappedFile file(path);
+    if (!file.Valid()) {
+        mesh->error = std::string("Cannot read ") + path;
+        return false;
+    }
+    return ParseObj(file.Data(), file.Size(), threads, mesh);
+}
+
+}  // namespace webgpu_rend
+
+extern "C" {
+
+API_EXPORT void* webgpu_rend_obj_parse_file(const char* path, int32_t threads) {
+    auto* mesh = new webgpu_rend::ObjMesh();
+    if (path == nullptr) {
+        mesh->error = "No path";
+        return mesh;
+    }
+    webgpu_rend::ParseObjFile(path, threads > 0 ? static_cast<uint32_t>(threads) : 0, mesh);
+    return mesh;
+}
+
+API_EXPORT void* webgpu_rend_obj_parse_bytes(const uint8_t* data, int64_t size, int32_t threads) {
+    auto* mesh = new webgpu_rend::ObjMesh();
+    if (data == nullptr || size <= 0) return mesh;
+    webgpu_rend::ParseObj(reinterpret_cast<const char*>(data), static_cast<size_t>(size),
+                          threads > 0 ? static_cast<uint32_t>(threads) : 0, mesh);
+    return mesh;
+}
+
+API_EXPORT const char* webgpu_rend_mesh_get_error(void* mesh) {
+    auto* obj = static_cast<webgpu_rend::ObjMesh*>(mesh);
+    return obj->error.empty() ? nullptr : obj->error.c_str();
+}
+
+API_EXPORT float* webgpu_rend_mesh_get_vertices(void* mesh, int64_t* float_count) {
+    auto* obj = static_cast<webgpu_rend::ObjMesh*>(mesh);
+    if (float_count != nullptr) *float_count = static_cast<int64_t>(obj->vertices.size());
+    return obj->vertices.data();
+}
+
+API_EXPORT uint32_t* webgpu_rend_mesh_get_indices(void* mesh, int64_t* count) {
+    auto* obj = static_cast<webgpu_rend::ObjMesh*>(mesh);
+    if (count != nullptr) *count = static_cast<int64_t>(obj->indices.size());
+    return obj->indices.data();
+}
+
+API_EXPORT int32_t webgpu_rend_mesh_get_group_count(void* mesh) {
+    return static_cast<int32_t>(static_cast<webgpu_rend::ObjMesh*>(mesh)->groups.size());
+}
+
+API_EXPORT const char* webgpu_rend_mesh_get_group(void* mesh, int32_t group, int64_t* index_start,
+                                                 int64_t* index_count) {
+    auto* obj = static_cast<webgpu_rend::ObjMesh*>(mesh);
+    if (group < 0 || static_cast<size_t>(group) >= obj->groups.size()) return nullptr;
+    const webgpu_rend::ObjMesh::Group& entry = obj->groups[group];
+    if (index_start != nullptr) *index_start = static_cast<int64_t>(entry.index_start);
+    if (index_count != nullptr) *index_count = static_cast<int64_t>(entry.index_count);
+    return entry.material.c_str();
+}
+
+API_EXPORT const char* webgpu_rend_mesh_get_mtllib(void* mesh) {
+    auto* obj = static_cast<webgpu_rend::ObjMesh*>(mesh);
+    return obj->has_mtllib ? obj->mtllib.c_str() : nullptr;
+}
+
+API_EXPORT void webgpu_rend_mesh_retain(void* mesh) {
+    static_cast<webgpu_rend::ObjMesh*>(mesh)->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+API_EXPORT void webgpu_rend_mesh_release(void* mesh) {
+    if (mesh == nullptr) return;
+    auto* obj = static_cast<webgpu_rend::ObjMesh*>(mesh);
+    if (obj->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete obj;
+}
+
+}  // extern C
@@ -0,0 +1,59 @@
+#ifndef WEBGPU_REND_OBJ_PARSER_H
+#define WEBGPU_REND_OBJ_PARSER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace webgpu_rend {
+
+// Inputs below this are parsed on the calling thread alone
+constexpr size_t kMinObjBytesPerThread = 1 << 20;
+// Upper bound on parser threads, whatever the core count
+constexpr uint32_t kMaxObjParserThreads = 32;
+// Floats per vertex: position.xyz, normal.xyz
+constexpr uint32_t kObjVertexFloats = 6;
+
+// Mesh in the layout ObjLoader hands to Dart: interleaved vertices, triangle
+// indices and one group per usemtl run. Reference counted, Dart wraps the
+// vertex and index memory in place and releases the mesh from the lists'
+// finalizers.
+struct ObjMesh {
+    struct Group {
+        std::string material;
+        uint64_t index_start;
+        uint64_t index_count;
+    };
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Group> groups;
+    std::string mtllib;
+    bool has_mtllib = false;
+    // Empty unless parsing failed, the rest is then empty too
+    std::string error;
+    std::atomic<int32_t> refs{1};
+};
+
+// Parses Wavefront OBJ text into `mesh`. The input is split into line ranges
+// parsed on up to `threads` threads (0 for one per core), each collecting
+// positions, normals and fan-triangulated faces. The faces are then resolved
+// to global indices, deduplicated on their (position, normal) pair in a hash
+// table per range, merged in file order, and written out in parallel. The
+// result matches parsing front to back: vertices are numbered in order of
+// first use. Texture coordinates are skipped, faces without normals get
+// (0, 1, 0). Returns false with mesh->error set if a face refers to a
+// missing vertex.
+bool ParseObj(const char* data, size_t size, uint32_t threads, ObjMesh* mesh);
+// Maps the file at `path` into memory and parses it like ParseObj
+bool ParseObjFile(const char* path, uint32_t threads, ObjMesh* mesh);
+
+// Parses a decimal float at `p`, not reading past `end`. Returns where it
+// stopped, `p` itself if there is no number there.
+const char* ParseObjFloat(const char* p, const char* end, float* out);
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_OBJ_PARSER_H
@@ -0,0 +1,87 @@
+#include "webgpu_rend_present_queue.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "webgpu_rend_completion.h"
+#include "webgpu_rend_trace.h"
+
+namespace webgpu_rend {
+
+static std::atomic<WebgpuRendFrameReadyCallback> g_frame_ready_callback{nullptr};
+static std::atomic<uint32_t> g_total_frames_in_flight{0};
+
+PresentQueue::PresentQueue(uint32_t max_frames_in_flight) : max_frames_in_flight_(kDefaultMaxFramesInFlight) {
+    SetMaxFramesInFlight(max_frames_in_flight);
+}
+
+PresentQueue::~PresentQueue() {
+    g_total_frames_in_flight.fetch_sub(FramesInFlight(), std::memory_order_relaxed);
+}
+
+void PresentQueue::SetMaxFramesInFlight(uint32_t count) {
+    max_frames_in_flight_.store(std::clamp<uint32_t>(count, 1, kMaxFramesInFlightLimit), std::memory_order_relaxed);
+}
+
+uint32_t PresentQueue::FramesInFlight() const {
+    // Completed first, a Submit in between can only make this larger
+    uint64_t completed = completed_.load(std::memory_order_acquire);
+    return static_cast<uint32_t>(submitted_.load(std::memory_order_acquire) - completed);
+}
+
+uint64_t PresentQueue::Submit() {
+    g_total_frames_in_flight.fetch_add(1, std::memory_order_relaxed);
+    return submitted_.fetch_add(1, std::memory_order_acq_rel) + 1;
+}
+
+void PresentQueue::SetWorkDoneFuture(uint64_t serial, WGPUFuture future) {
+    work_done_[serial % kMaxFramesInFlightLimit] = future;
+}
+
+uint64_t PresentQueue::Complete(WebgpuRendTexture handle, uint64_t serial) {
+    serial = std::min(serial, submitted_.load(std::memory_order_acquire));
+    uint64_t completed = completed_.load(std::memory_order_acquire);
+    do {
+        if (serial <= completed) return completed;
+    } while (!completed_.compare_exchange_weak(completed, serial, std::memory_order_acq_rel,
+                                               std::memory_order_acquire));
+    g_total_frames_in_flight.fetch_sub(static_cast<uint32_t>(serial - completed), std::memory_order_relaxed);
+    {
+        // Pairs with the predicate check in WaitUntilReady, so the wakeup
+        // cannot slip in between it and the wait
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    completed_changed_.notify_all();
+    WebgpuRendFrameReadyCallback callback = g_frame_ready_callback.load(std::memory_order_acquire);
+    if (callback != nullptr) callback(handle, serial);
+    return serial;
+}
+
+void PresentQueue::WaitUntilReady(WGPUInstance instance, WebgpuRendTexture handle) {
+    if (ReadyForNextFrame()) return;
+    WEBGPU_REND_TRACE_SCOPE("WaitForFrameInFlight");
+    while (!ReadyForNextFrame()) {
+        // Frames finish in order, so the oldest one in flight frees the slot
+        uint64_t oldest = completed_.load(std::memory_order_acquire) + 1;
+        WaitForFuture(instance, work_done_[oldest % kMaxFramesInFlightLimit]);
+        // The future is done, but its callback may still be running on
+        // another thread
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            completed_changed_.wait_for(lock, std::chrono::nanoseconds(kCompletionWaitTimeoutNs),
+                                        [&] { return completed_.load(std::memory_order_acquire) >= oldest; });
+        }
+        // No-op if the callback got there first
+        Complete(handle, oldest);
+    }
+}
+
+void SetFrameReadyCallback(WebgpuRendFrameReadyCallback callback) {
+    g_frame_ready_callback.store(callback, std::memory_order_release);
+}
+
+uint32_t TotalFramesInFlight() {
+    return g_total_frames_in_flight.load(std::memory_order_relaxed);
+}
+
+}  // namespace webgpu_rend
@@ -0,0 +1,86 @@
+#ifndef WEBGPU_REND_PRESENT_QUEUE_H
+#define WEBGPU_REND_PRESENT_QUEUE_H
+
+#include <dawn/webgpu.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "webgpu_rend_api.h"
+
+namespace webgpu_rend {
+
+constexpr uint32_t kDefaultMaxFramesInFlight = 2;
+constexpr uint32_t kMaxFramesInFlightLimit = 8;
+
+// Frame pacing for one texture. Presenting records a frame here and the
+// backend completes it from Queue::OnSubmittedWorkDone; once the cap is
+// reached the next present waits for the GPU instead of queueing more work,
+// so latency stays bounded under load. Queue work finishes in submission
+// order, so counting completions is enough to know which frame finished.
+//
+// Counts are atomics so Dart can poll them without the backend's lock and
+// Complete can run on any thread. The work-done callbacks are
+// AllowSpontaneous and usually fire on the completion thread; they must not
+// take the backend's lock either, since a present holds it while it waits in
+// WaitUntilReady. Submit, SetWorkDoneFuture and WaitUntilReady are expected
+// to be serialized by that lock.
+class PresentQueue {
+   public:
+    explicit PresentQueue(uint32_t max_frames_in_flight = kDefaultMaxFramesInFlight);
+    // Frames still in flight when the texture goes away will never complete
+    // here, they are dropped from the global count.
+    ~PresentQueue();
+
+    PresentQueue(const PresentQueue&) = delete;
+    PresentQueue& operator=(const PresentQueue&) = delete;
+
+    // Clamped to 1..kMaxFramesInFlightLimit
+    void SetMaxFramesInFlight(uint32_t count);
+    uint32_t MaxFramesInFlight() const { return max_frames_in_flight_.load(std::memory_order_relaxed); }
+    uint32_t FramesInFlight() const;
+    // False while the cap is reached, the next present would wait on the GPU
+    bool ReadyForNextFrame() const { return FramesInFlight() < MaxFramesInFlight(); }
+
+    // Records a submitted frame, returns its serial starting at 1. Called
+    // before OnSubmittedWorkDone, so the frame is counted even if its
+    // callback fires right away.
+    uint64_t Submit();
+    // The OnSubmittedWorkDone future of frame `serial`, for WaitUntilReady
+    void SetWorkDoneFuture(uint64_t serial, WGPUFuture future);
+    // Records frame `serial`, and every frame before it, as finished and
+    // tells the frame ready callback, if any, that `handle` can take another
+    // frame. A frame already recorded is ignored, so both the work-done
+    // callback and WaitUntilReady may report it.
+    uint64_t Complete(WebgpuRendTexture handle, uint64_t serial);
+
+    // Blocks until another frame fits, waiting on the oldest frame's
+    // work-done future with Instance::WaitAny. Once that future is done the
+    // frame counts as finished even if its callback never reports it, which
+    // happens when the texture is being disposed and the callback can no
+    // longer look it up.
+    void WaitUntilReady(WGPUInstance instance, WebgpuRendTexture handle);
+
+   private:
+    std::atomic<uint32_t> max_frames_in_flight_;
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> completed_{0};
+    // Indexed by serial. The cap keeps at most kMaxFramesInFlightLimit
+    // frames in flight, so a slot is only reused once its frame finished.
+    WGPUFuture work_done_[kMaxFramesInFlightLimit] = {};
+    // Lets WaitUntilReady sleep while another thread runs Complete
+    std::mutex mutex_;
+    std::condition_variable completed_changed_;
+};
+
+// Called after every completed frame, from whichever thread processed Dawn
+// events. Null disables it.
+void SetFrameReadyCallback(WebgpuRendFrameReadyCallback callback);
+// Frames in flight over every texture, lets a pump know when to stop
+uint32_t TotalFramesInFlight();
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_PRESENT_QUEUE_H
@@ -0,0 +1,280 @@
+#include "webgpu_rend_readback.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "webgpu_rend_api.h"
+#include "webgpu_rend_trace.h"
+
+namespace webgpu_rend {
+
+namespace {
+
+std::mutex g_readback_mutex;
+ReadbackEngine* g_readback_engine = nullptr;
+
+}  // namespace
+
+uint64_t ReadbackBucketSize(uint64_t size) {
+    if (size <= kMinReadbackBucketSize) return kMinReadbackBucketSize;
+    // Quarters of the power of two below, so (2^n, 2^(n+1)] has four buckets
+    uint64_t base = 1;
+    while (base * 2 < size) base *= 2;
+    uint64_t step = base / 4;
+    return (size + step - 1) / step * step;
+}
+
+uint32_t ReadbackTexelSize(WGPUTextureFormat format) {
+    switch (format) {
+        case WGPUTextureFormat_R8Unorm:
+        case WGPUTextureFormat_R8Snorm:
+        case WGPUTextureFormat_R8Uint:
+        case WGPUTextureFormat_R8Sint:
+            return 1;
+        case WGPUTextureFormat_R16Uint:
+        case WGPUTextureFormat_R16Sint:
+        case WGPUTextureFormat_R16Float:
+        case WGPUTextureFormat_RG8Unorm:
+        case WGPUTextureFormat_RG8Snorm:
+        case WGPUTextureFormat_RG8Uint:
+        case WGPUTextureFormat_RG8Sint:
+            return 2;
+        case WGPUTextureFormat_R32Float:
+        case WGPUTextureFormat_R32Uint:
+        case WGPUTextureFormat_R32Sint:
+        case WGPUTextureFormat_RG16Uint:
+        case WGPUTextureFormat_RG16Sint:
+        case WGPUTextureFormat_RG16Float:
+        case WGPUTextureFormat_RGBA8Unorm:
+        case WGPUTextureFormat_RGBA8UnormSrgb:
+        case WGPUTextureFormat_RGBA8Snorm:
+        case WGPUTextureFormat_RGBA8Uint:
+        case WGPUTextureFormat_RGBA8Sint:
+        case WGPUTextureFormat_BGRA8Unorm:
+        case WGPUTextureFormat_BGRA8UnormSrgb:
+        case WGPUTextureFormat_RGB10A2Uint:
+        case WGPUTextureFormat_RGB10A2Unorm:
+        case WGPUTextureFormat_RG11B10Ufloat:
+        case WGPUTextureFormat_RGB9E5Ufloat:
+            return 4;
+        case WGPUTextureFormat_RG32Float:
+        case WGPUTextureFormat_RG32Uint:
+        case WGPUTextureFormat_RG32Sint:
+        case WGPUTextureFormat_RGBA16Uint:
+        case WGPUTextureFormat_RGBA16Sint:
+        case WGPUTextureFormat_RGBA16Float:
+            return 8;
+        case WGPUTextureFormat_RGBA32Float:
+        case WGPUTextureFormat_RGBA32Uint:
+        case WGPUTextureFormat_RGBA32Sint:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+ReadbackEngine::ReadbackEngine(WGPUDevice device, WGPUQueue queue) : device_(device), queue_(queue) {}
+
+uint64_t ReadbackEngine::Begin(WGPUTexture texture, uint32_t mip_level, uint32_t x, uint32_t y, uint32_t width,
+                               uint32_t height, WGPUFuture* future, uint32_t* row_bytes) {
+    WEBGPU_REND_TRACE_SCOPE("ReadbackEngine::Begin");
+    if (texture == nullptr || mip_level >= wgpuTextureGetMipLevelCount(texture)) return 0;
+    if ((wgpuTextureGetUsage(texture) & WGPUTextureUsage_CopySrc) == 0) return 0;
+    uint32_t texel_size = ReadbackTexelSize(wgpuTextureGetFormat(texture));
+    if (texel_size == 0) return 0;
+
+    uint32_t level_width = std::max(1u, wgpuTextureGetWidth(texture) >> mip_level);
+    uint32_t level_height = std::max(1u, wgpuTextureGetHeight(texture) >> mip_level);
+    if (x >= level_width || y >= level_height) return 0;
+    if (width == 0) width = level_width - x;
+    if (height == 0) height = level_height - y;
+    if (width > level_width - x || height > level_height - y) return 0;
+
+    Readback readback = {};
+    readback.row_bytes = width * texel_size;
+    readback.padded_row_bytes = (readback.row_bytes + kReadbackRowAlignment - 1) & ~(kReadbackRowAlignment - 1);
+    readback.rows = height;
+    readback.state = State::kMapping;
+    uint64_t size = static_cast<uint64_t>(readback.padded_row_bytes) * height;
+    readback.bucket = ReadbackBucketSize(size);
+
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        readback.buffer = Acquire(readback.bucket);
+        if (readback.buffer == nullptr) return 0;
+        id = next_id_++;
+        readbacks_.emplace(id, readback);
+    }
+
+    WGPUTexelCopyTextureInfo source = {};
+    source.texture = texture;
+    source.mipLevel = mip_level;
+    source.origin = {x, y, 0};
+    source.aspect = WGPUTextureAspect_All;
+    WGPUTexelCopyBufferInfo destination = {};
+    destination.buffer = readback.buffer;
+    destination.layout.offset = 0;
+    destination.layout.bytesPerRow = readback.padded_row_bytes;
+    destination.layout.rowsPerImage = height;
+    WGPUExtent3D copy_size = {width, height, 1};
+
+    WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device_, nullptr);
+    wgpuCommandEncoderCopyTextureToBuffer(encoder, &source, &destination, &copy_size);
+    WGPUCommandBuffer commands = wgpuCommandEncoderFinish(encoder, nullptr);
+    wgpuQueueSubmit(queue_, 1, &commands);
+    wgpuCommandBufferRelease(commands);
+    wgpuCommandEncoderRelease(encoder);
+
+    WGPUBufferMapCallbackInfo callback_info = {};
+    callback_info.mode = WGPUCallbackMode_AllowSpontaneous;
+    callback_info.callback = &ReadbackEngine::OnMapped;
+    callback_info.userdata1 = this;
+    callback_info.userdata2 = reinterpret_cast<void*>(static_cast<uintptr_t>(id));
+    WGPUFuture map_future = wgpuBufferMapAsync(readback.buffer, WGPUMapMode_Read, 0, size, callback_info);
+    if (future != nullptr) *future = map_future;
+    if (row_bytes != nullptr) *row_bytes = readback.row_bytes;
+    return id;
+}
+
+void ReadbackEngine::OnMapped(WGPUMapAsyncStatus status, WGPUStringView message, void* userdata1,
+                              void* userdata2) {
+    ReadbackEngine* engine = static_cast<ReadbackEngine*>(userdata1);
+    uint64_t id = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(userdata2));
+    bool mapped = status == WGPUMapAsyncStatus_Success;
+    {
+        std::lock_guard<std::mutex> lock(engine->mutex_);
+        auto it = engine->readbacks_.find(id);
+        if (it == engine->readbacks_.end()) return;
+        it->second.state = mapped ? State::kMapped : State::kFailed;
+    }
+    ReadbackCallback callback = engine->callback_.load(std::memory_order_acquire);
+    if (callback != nullptr) callback(id, mapped ? 1 : 0);
+}
+
+int64_t ReadbackEngine::Finish(uint64_t id, uint8_t* dst, uint32_t dst_row_bytes) {
+    WEBGPU_REND_TRACE_SCOPE("ReadbackEngine::Finish");
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = readbacks_.find(id);
+    if (it == readbacks_.end() || it->second.state == State::kMapping) return -1;
+    Readback readback = it->second;
+    readbacks_.erase(it);
+
+    if (readback.state == State::kFailed) {
+        // Whatever failed the map may have taken the buffer with it
+        wgpuBufferRelease(readback.buffer);
+        return -1;
+    }
+
+    int64_t written = 0;
+    if (dst != nullptr) {
+        if (dst_row_bytes == 0) dst_row_bytes = readback.row_bytes;
+        uint64_t size = static_cast<uint64_t>(readback.padded_row_bytes) * readback.rows;
+        const uint8_t* src = static_cast<const uint8_t*>(wgpuBufferGetConstMappedRange(readback.buffer, 0, size));
+        if (src == nullptr || dst_row_bytes < readback.row_bytes) {
+            written = -1;
+        } else if (dst_row_bytes == readback.padded_row_bytes && readback.row_bytes == readback.padded_row_bytes) {
+            std::memcpy(dst, src, size);
+            written = static_cast<int64_t>(size);
+        } else {
+            for (uint32_t row = 0; row < readback.rows; row++) {
+                std::memcpy(dst + static_cast<uint64_t>(row) * dst_row_bytes,
+                            src + static_cast<uint64_t>(row) * readback.padded_row_bytes, readback.row_bytes);
+            }
+            written = static_cast<int64_t>(readback.row_bytes) * readback.rows;
+        }
+    }
+    wgpuBufferUnmap(readback.buffer);
+    Recycle(readback.buffer, readback.bucket);
+    return written;
+}
+
+WGPUBuffer ReadbackEngine::Acquire(uint64_t bucket) {
+    auto it = free_.find(bucket);
+    if (it != free_.end() && !it->second.empty()) {
+        WGPUBuffer buffer = it->second.back();
+        it->second.pop_back();
+        pooled_bytes_ -= bucket;
+        reused_.fetch_add(1, std::memory_order_relaxed);
+        return buffer;
+    }
+    WGPUBufferDescriptor desc = {};
+    desc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    desc.size = bucket;
+    desc.mappedAtCreation = false;
+    WGPUBuffer buffer = wgpuDeviceCreateBuffer(device_, &desc);
+    if (buffer != nullptr) created_.fetch_add(1, std::memory_order_relaxed);
+    return buffer;
+}
+
+void ReadbackEngine::Recycle(WGPUBuffer buffer, uint64_t bucket) {
+    if (pooled_bytes_ + bucket > kMaxPooledReadbackBytes) {
+        wgpuBufferRelease(buffer);
+        return;
+    }
+    free_[bucket].push_back(buffer);
+    pooled_bytes_ += bucket;
+}
+
+void ReadbackEngine::Trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [bucket, buffers] : free_) {
+        for (WGPUBuffer buffer : buffers) wgpuBufferRelease(buffer);
+    }
+    free_.clear();
+    pooled_bytes_ = 0;
+}
+
+uint64_t ReadbackEngine::PooledBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pooled_bytes_;
+}
+
+void StartReadbackEngine(WGPUDevice device, WGPUQueue queue) {
+    std::lock_guard<std::mutex> lock(g_readback_mutex);
+    if (g_readback_engine == nullptr) g_readback_engine = new ReadbackEngine(device, queue);
+}
+
+ReadbackEngine* ActiveReadbackEngine() {
+    std::lock_guard<std::mutex> lock(g_readback_mutex);
+    return g_readback_engine;
+}
+
+}  // namespace webgpu_rend
+
+extern "C" {
+
+API_EXPORT void webgpu_rend_set_readback_callback(WebgpuRendReadbackCallback callback) {
+    webgpu_rend::ReadbackEngine* engine = webgpu_rend::ActiveReadbackEngine();
+    if (engine != nullptr) engine->SetCallback(callback);
+}
+
+API_EXPORT uint64_t webgpu_rend_readback_begin(void* texture, uint32_t mip_level, uint32_t x, uint32_t y,
+                                               uint32_t width, uint32_t height, uint64_t* future_id,
+                                               uint32_t* row_bytes) {
+    webgpu_rend::ReadbackEngine* engine = webgpu_rend::ActiveReadbackEngine();
+    if (engine == nullptr) return 0;
+    WGPUFuture future = {};
+    uint64_t id = engine->Begin(static_cast<WGPUTexture>(texture), mip_level, x, y, width, height, &future, row_bytes);
+    if (future_id != nullptr) *future_id = future.id;
+    return id;
+}
+
+API_EXPORT int64_t webgpu_rend_readback_finish(uint64_t id, uint8_t* dst, uint32_t dst_row_bytes) {
+    webgpu_rend::ReadbackEngine* engine = webgpu_rend::ActiveReadbackEngine();
+    return engine != nullptr ? engine->Finish(id, dst, dst_row_bytes) : -1;
+}
+
+API_EXPORT void webgpu_rend_readback_trim(void) {
+    webgpu_rend::ReadbackEngine* engine = webgpu_rend::ActiveReadbackEngine();
+    if (engine != nullptr) engine->Trim();
+}
+
+API_EXPORT void webgpu_rend_get_readback_stats(int64_t* reused, int64_t* created, int64_t* pooled_bytes) {
+    webgpu_rend::ReadbackEngine* engine = webgpu_rend::ActiveReadbackEngine();
+    if (reused != nullptr) *reused = engine ? static_cast<int64_t>(engine->Reused()) : 0;
+    if (created != nullptr) *created = engine ? static_cast<int64_t>(engine->Created()) : 0;
+    if (pooled_bytes != nullptr) *pooled_bytes = engine ? static_cast<int64_t>(engine->PooledBytes()) : 0;
+}
+
+}  // extern C
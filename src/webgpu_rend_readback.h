@@ -0,0 +1,110 @@
+#ifndef WEBGPU_REND_READBACK_H
+#define WEBGPU_REND_READBACK_H
+
+#include <dawn/webgpu.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace webgpu_rend {
+
+// Row pitch Dawn requires for texture to buffer copies
+constexpr uint32_t kReadbackRowAlignment = 256;
+// Smallest pooled buffer, smaller readbacks share this bucket
+constexpr uint64_t kMinReadbackBucketSize = 64 * 1024;
+// Idle buffers kept over all buckets, further ones are released
+constexpr uint64_t kMaxPooledReadbackBytes = 256ull * 1024 * 1024;
+
+// Runs with the id of a readback once its buffer is mapped (status 1) or
+// the map failed (status 0), on whichever thread processed Dawn events.
+typedef void (*ReadbackCallback)(uint64_t id, int32_t status);
+
+// Copies texture regions back to the CPU through a pool of MapRead buffers.
+// Sizes are rounded up to buckets, four per power of two, so repeated
+// screenshots or inference readbacks of one size keep reusing the same
+// buffer and waste at most a quarter of it.
+//
+// Begin records the copy into a pooled buffer, submits it and maps the
+// buffer; its future goes to the completion thread like any other map.
+// Finish then copies the rows into memory the caller owns, dropping the
+// 256-byte row padding with a memcpy per row, or a single one when the rows
+// were tight, and hands the buffer back to the pool.
+//
+// Begin and Finish come from the Dart thread, map callbacks from the
+// completion thread, so everything is behind one lock.
+class ReadbackEngine {
+   public:
+    ReadbackEngine(WGPUDevice device, WGPUQueue queue);
+
+    ReadbackEngine(const ReadbackEngine&) = delete;
+    ReadbackEngine& operator=(const ReadbackEngine&) = delete;
+
+    void SetCallback(ReadbackCallback callback) { callback_.store(callback, std::memory_order_release); }
+
+    // Reads `width` x `height` texels at x, y of `mip_level`, a width or
+    // height of 0 reaching to the edge of the level. Returns the readback's
+    // id and sets the map's future and the tight row size of the result, or
+    // returns 0 if the region lies outside the level, the texture cannot be
+    // copied from or its format has no fixed texel size.
+    uint64_t Begin(WGPUTexture texture, uint32_t mip_level, uint32_t x, uint32_t y, uint32_t width,
+                   uint32_t height, WGPUFuture* future, uint32_t* row_bytes);
+    // Copies a mapped readback into `dst`, rows `dst_row_bytes` apart (0 for
+    // tight rows), and ends it. A null `dst` drops the result. Returns the
+    // bytes written, or -1 if the id is unknown, still mapping or the map
+    // failed; the readback is ended in every case but the first two.
+    int64_t Finish(uint64_t id, uint8_t* dst, uint32_t dst_row_bytes);
+    // Releases every idle buffer
+    void Trim();
+
+    uint64_t Reused() const { return reused_.load(std::memory_order_relaxed); }
+    uint64_t Created() const { return created_.load(std::memory_order_relaxed); }
+    uint64_t PooledBytes() const;
+
+   private:
+    enum class State : uint8_t { kMapping, kMapped, kFailed };
+
+    struct Readback {
+        WGPUBuffer buffer;
+        uint64_t bucket;
+        uint32_t row_bytes;
+        uint32_t padded_row_bytes;
+        uint32_t rows;
+        State state;
+    };
+
+    static void OnMapped(WGPUMapAsyncStatus status, WGPUStringView message, void* userdata1, void* userdata2);
+
+    // Both expect mutex_ to be held
+    WGPUBuffer Acquire(uint64_t bucket);
+    void Recycle(WGPUBuffer buffer, uint64_t bucket);
+
+    WGPUDevice device_;
+    WGPUQueue queue_;
+    std::atomic<ReadbackCallback> callback_{nullptr};
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Readback> readbacks_;
+    // Idle buffers by bucket size
+    std::unordered_map<uint64_t, std::vector<WGPUBuffer>> free_;
+    uint64_t pooled_bytes_ = 0;
+    uint64_t next_id_ = 1;
+    std::atomic<uint64_t> reused_{0};
+    std::atomic<uint64_t> created_{0};
+};
+
+// Bucket a readback of `size` bytes is served from
+uint64_t ReadbackBucketSize(uint64_t size);
+// Bytes per texel of the color formats that can be read back, 0 for others
+uint32_t ReadbackTexelSize(WGPUTextureFormat format);
+
+// Called by the backends once the device exists. Never freed, map callbacks
+// may still arrive while the device is torn down.
+void StartReadbackEngine(WGPUDevice device, WGPUQueue queue);
+// Null until StartReadbackEngine
+ReadbackEngine* ActiveReadbackEngine();
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_READBACK_H
@@ -0,0 +1,65 @@
+#include "webgpu_rend_swapchain_ring.h"
+
+#include <algorithm>
+
+namespace webgpu_rend {
+
+SwapchainRing::SwapchainRing(uint32_t count)
+    : states_(std::clamp(count, kMinSwapchainImages, kMaxSwapchainImages), State::kFree) {
+    for (int32_t i = 0; i < static_cast<int32_t>(states_.size()); i++) free_.push_back(i);
+}
+
+int32_t SwapchainRing::Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) return -1;
+    // Oldest first, so an image the compositor only just let go of gets as
+    // much time as possible to drain from its queue
+    int32_t image = free_.front();
+    free_.erase(free_.begin());
+    states_[image] = State::kAcquired;
+    return image;
+}
+
+bool SwapchainRing::Present(int32_t image) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (image < 0 || image >= static_cast<int32_t>(states_.size()) || states_[image] != State::kAcquired) {
+        return false;
+    }
+    states_[image] = State::kPending;
+    pending_.push_back(image);
+    return true;
+}
+
+int32_t SwapchainRing::Completed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.empty()) return -1;
+    int32_t image = pending_.front();
+    pending_.erase(pending_.begin());
+    // Skipped, the compositor never asked for it
+    if (displayed_ >= 0 && displayed_ != latched_) Release(displayed_);
+    states_[image] = State::kDisplayed;
+    displayed_ = image;
+    return image;
+}
+
+int32_t SwapchainRing::Latch() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (displayed_ != latched_) {
+        if (latched_ >= 0) Release(latched_);
+        latched_ = displayed_;
+        states_[latched_] = State::kLatched;
+    }
+    return latched_;
+}
+
+int32_t SwapchainRing::Latched() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latched_;
+}
+
+void SwapchainRing::Release(int32_t image) {
+    states_[image] = State::kFree;
+    free_.push_back(image);
+}
+
+}  // namespace webgpu_rend
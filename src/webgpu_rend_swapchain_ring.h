@@ -0,0 +1,65 @@
+#ifndef WEBGPU_REND_SWAPCHAIN_RING_H
+#define WEBGPU_REND_SWAPCHAIN_RING_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace webgpu_rend {
+
+constexpr uint32_t kMinSwapchainImages = 2;
+constexpr uint32_t kMaxSwapchainImages = 4;
+
+// Image bookkeeping for a swapchain of images behind one Flutter texture ID,
+// so the app can render frame N+1 while the compositor still reads frame N.
+// The backend owns the images themselves; this only decides which one may be
+// written, which one Flutter should show and when an image can be reused.
+//
+// An image goes Free -> Acquired (app renders) -> Pending (presented, GPU
+// busy) -> Displayed (newest finished frame) -> Latched (the compositor took
+// it) -> Free once the compositor latches a newer one. A displayed frame the
+// compositor never latched is freed as soon as a newer one finishes.
+//
+// Called from the Dart thread, Dawn callbacks and the compositor, so every
+// method locks.
+class SwapchainRing {
+   public:
+    // Clamped to kMinSwapchainImages..kMaxSwapchainImages
+    explicit SwapchainRing(uint32_t count);
+
+    uint32_t ImageCount() const { return static_cast<uint32_t>(states_.size()); }
+
+    // Hands out a free image, oldest released first, or -1 if every image
+    // is in use. Then either the GPU or the compositor is behind, the caller
+    // should retry once a frame finished or the compositor latched one.
+    int32_t Acquire();
+    // Acquired -> Pending. False if `image` was not acquired.
+    bool Present(int32_t image);
+    // The oldest pending image goes Pending -> Displayed, for when the GPU
+    // finished a present. Frames finish in order, so the backend does not
+    // need to track which one it was. Returns it, or -1 if none was pending.
+    int32_t Completed();
+    // Returns the image the compositor should sample, -1 before the first
+    // frame. Latching the newest frame frees the one latched before.
+    int32_t Latch();
+    // The image the compositor last latched, without latching
+    int32_t Latched() const;
+
+   private:
+    enum class State : uint8_t { kFree, kAcquired, kPending, kDisplayed, kLatched };
+
+    void Release(int32_t image);
+
+    mutable std::mutex mutex_;
+    std::vector<State> states_;
+    // Free images in the order they were released
+    std::vector<int32_t> free_;
+    // Presented images, oldest first
+    std::vector<int32_t> pending_;
+    int32_t displayed_ = -1;
+    int32_t latched_ = -1;
+};
+
+}  // namespace webgpu_rend
+
+#endif  // WEBGPU_REND_SWAPCHAIN_RING_H
@@ -0,0 +1,251 @@
+#include "webgpu_rend_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "webgpu_rend_api.h"
+
+namespace webgpu_rend {
+
+std::atomic<bool> g_trace_enabled{false};
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+};
+
+// Written only by its thread, read by dumps. A thread that exits hands its
+// ring to the next new thread, so short-lived threads do not pile up rings.
+struct ThreadTrace {
+    uint32_t tid = 0;
+    bool in_use = false;
+    std::atomic<uint64_t> written{0};
+    TraceEvent events[kTraceEventsPerThread];
+
+    void Record(const char* name, uint64_t start_ns, uint64_t duration_ns) {
+        uint64_t n = written.load(std::memory_order_relaxed);
+        events[n % kTraceEventsPerThread] = {name, start_ns, duration_ns};
+        written.store(n + 1, std::memory_order_release);
+    }
+};
+
+struct TraceMessageEvent {
+    const char* name;
+    uint64_t time_ns;
+    uint32_t tid;
+    std::string message;
+};
+
+constexpr uint32_t kDartTid = 0;
+
+std::mutex g_registry_mutex;
+std::vector<std::unique_ptr<ThreadTrace>> g_threads;
+uint32_t g_next_tid = 1;
+std::atomic<uint64_t> g_capture_start_ns{0};
+
+std::mutex g_messages_mutex;
+std::vector<TraceMessageEvent> g_messages;
+
+// Dart spans arrive from whichever thread runs the isolate, so they get a
+// track of their own guarded by a lock, and names copied into a set.
+std::mutex g_dart_mutex;
+ThreadTrace g_dart_trace;
+std::unordered_set<std::string> g_dart_names;
+
+struct ThreadTraceOwner {
+    ThreadTrace* trace = nullptr;
+    ~ThreadTraceOwner() {
+        if (trace == nullptr) return;
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        trace->in_use = false;
+    }
+};
+
+thread_local ThreadTraceOwner t_trace;
+
+ThreadTrace* CurrentThreadTrace() {
+    if (t_trace.trace != nullptr) return t_trace.trace;
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    for (auto& trace : g_threads) {
+        if (!trace->in_use) {
+            trace->in_use = true;
+            t_trace.trace = trace.get();
+            return t_trace.trace;
+        }
+    }
+    auto trace = std::make_unique<ThreadTrace>();
+    trace->tid = g_next_tid++;
+    trace->in_use = true;
+    t_trace.trace = trace.get();
+    g_threads.push_back(std::move(trace));
+    return t_trace.trace;
+}
+
+void AppendEscaped(std::string& out, const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+}
+
+void AppendTime(std::string& out, const char* key, uint64_t ns) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), ",\"%s\":%.3f", key, ns / 1000.0);
+    out += buffer;
+}
+
+void AppendThreadName(std::string& out, uint32_t tid, const char* name) {
+    out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+    out += std::to_string(tid);
+    out += ",\"args\":{\"name\":\"";
+    out += name;
+    out += "\"}},\n";
+}
+
+void AppendEvents(std::string& out, const ThreadTrace& trace, uint64_t capture_start, const char* category) {
+    uint64_t written = trace.written.load(std::memory_order_acquire);
+    uint64_t count = std::min<uint64_t>(written, kTraceEventsPerThread);
+    for (uint64_t i = written - count; i < written; i++) {
+        const TraceEvent& event = trace.events[i % kTraceEventsPerThread];
+        if (event.name == nullptr || event.start_ns < capture_start) continue;
+        out += "{\"name\":\"";
+        AppendEscaped(out, event.name, std::strlen(event.name));
+        out += "\",\"cat\":\"";
+        out += category;
+        out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+        out += std::to_string(trace.tid);
+        AppendTime(out, "ts", event.start_ns - capture_start);
+        AppendTime(out, "dur", event.duration_ns);
+        out += "},\n";
+    }
+}
+
+}  // namespace
+
+uint64_t TraceNowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+void TraceComplete(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    CurrentThreadTrace()->Record(name, start_ns, end_ns > start_ns ? end_ns - start_ns : 0);
+}
+
+void TraceMessage(const char* name, const std::string& message) {
+    if (!TraceEnabled()) return;
+    uint32_t tid = CurrentThreadTrace()->tid;
+    std::lock_guard<std::mutex> lock(g_messages_mutex);
+    if (g_messages.size() >= kMaxTraceMessages) return;
+    g_messages.push_back({name, TraceNowNs(), tid, message});
+}
+
+void StartTrace() {
+    {
+        std::lock_guard<std::mutex> lock(g_messages_mutex);
+        g_messages.clear();
+    }
+    // Rings are not cleared, their writers may be running. Anything older
+    // than the capture is skipped when dumping instead.
+    g_capture_start_ns.store(TraceNowNs(), std::memory_order_relaxed);
+    g_trace_enabled.store(true, std::memory_order_release);
+}
+
+void StopTrace() { g_trace_enabled.store(false, std::memory_order_release); }
+
+void TraceExternalSpan(const char* name, uint64_t start_ns, uint64_t duration_ns) {
+    if (!TraceEnabled()) return;
+    std::lock_guard<std::mutex> lock(g_dart_mutex);
+    const char* interned = g_dart_names.insert(name).first->c_str();
+    g_dart_trace.Record(interned, start_ns, duration_ns);
+}
+
+std::string DumpTraceJson() {
+    uint64_t capture_start = g_capture_start_ns.load(std::memory_order_relaxed);
+    std::string out = "{\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"webgpu_rend\"}},\n";
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        for (const auto& trace : g_threads) {
+            std::string name = "Thread " + std::to_string(trace->tid);
+            AppendThreadName(out, trace->tid, name.c_str());
+            AppendEvents(out, *trace, capture_start, "native");
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_dart_mutex);
+        AppendThreadName(out, kDartTid, "Dart");
+        AppendEvents(out, g_dart_trace, capture_start, "dart");
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_messages_mutex);
+        for (const TraceMessageEvent& message : g_messages) {
+            out += "{\"name\":\"";
+            AppendEscaped(out, message.name, std::strlen(message.name));
+            out += "\",\"cat\":\"native\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":";
+            out += std::to_string(message.tid);
+            AppendTime(out, "ts", message.time_ns > capture_start ? message.time_ns - capture_start : 0);
+            out += ",\"args\":{\"message\":\"";
+            AppendEscaped(out, message.message.data(), message.message.size());
+            out += "\"}},\n";
+        }
+    }
+    // Every event ends in a comma, the trailing metadata entry absorbs it
+    out += "{\"name\":\"trace_end\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{}}\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out;
+}
+
+}  // namespace webgpu_rend
+
+extern "C" {
+
+API_EXPORT void webgpu_rend_trace_start() { webgpu_rend::StartTrace(); }
+
+API_EXPORT void webgpu_rend_trace_stop() { webgpu_rend::StopTrace(); }
+
+API_EXPORT int64_t webgpu_rend_trace_now_us() { return static_cast<int64_t>(webgpu_rend::TraceNowNs() / 1000); }
+
+API_EXPORT void webgpu_rend_trace_add_span(const char* name, int64_t start_us, int64_t duration_us) {
+    if (name == nullptr || start_us < 0 || duration_us < 0) return;
+    webgpu_rend::TraceExternalSpan(name, static_cast<uint64_t>(start_us) * 1000, static_cast<uint64_t>(duration_us) * 1000);
+}
+
+API_EXPORT int64_t webgpu_rend_trace_dump_json(char* out, int64_t capacity) {
+    std::string json = webgpu_rend::DumpTraceJson();
+    if (out != nullptr && capacity >= static_cast<int64_t>(json.size())) {
+        std::memcpy(out, json.data(), json.size());
+    }
+    return static_cast<int64_t>(json.size());
+}
+
+}  // extern C
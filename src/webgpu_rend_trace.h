@@ -0,0 +1,69 @@
+#ifndef WEBGPU_REND_TRACE_H
+#define WEBGPU_REND_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace webgpu_rend {
+
+// Events each thread keeps while capturing, older ones are overwritten
+constexpr uint32_t kTraceEventsPerThread = 16384;
+// Messages kept per capture, further ones are dropped
+constexpr uint32_t kMaxTraceMessages = 1024;
+
+extern std::atomic<bool> g_trace_enabled;
+
+inline bool TraceEnabled() { return g_trace_enabled.load(std::memory_order_relaxed); }
+
+// Monotonic clock shared by native and Dart events
+uint64_t TraceNowNs();
+
+// Records a finished span on the calling thread's ring. `name` must outlive
+// the capture, string literals and __func__ do.
+void TraceComplete(const char* name, uint64_t start_ns, uint64_t end_ns);
+// Records an instant event carrying `message`, for errors and warnings.
+void TraceMessage(const char* name, const std::string& message);
+
+// Times the enclosing scope while capturing. When not capturing this costs
+// one relaxed load and a branch.
+class TraceScope {
+   public:
+    explicit TraceScope(const char* name) {
+        if (TraceEnabled()) {
+            name_ = name;
+            start_ns_ = TraceNowNs();
+        }
+    }
+    ~TraceScope() {
+        if (name_ != nullptr) TraceComplete(name_, start_ns_, TraceNowNs());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+   private:
+    const char* name_ = nullptr;
+    uint64_t start_ns_ = 0;
+};
+
+// Capture control behind the webgpu_rend_trace_* entry points. Starting
+// drops whatever an earlier capture recorded.
+void StartTrace();
+void StopTrace();
+// Chrome trace_event JSON of the current or last capture, loadable in
+// chrome://tracing and Perfetto. Events a thread records while this runs
+// may be missing, stop the capture first for a complete dump.
+std::string DumpTraceJson();
+// Records a span measured elsewhere, on a separate "Dart" track.
+void TraceExternalSpan(const char* name, uint64_t start_ns, uint64_t duration_ns);
+
+}  // namespace webgpu_rend
+
+#define WEBGPU_REND_TRACE_CONCAT_(a, b) a##b
+#define WEBGPU_REND_TRACE_CONCAT(a, b) WEBGPU_REND_TRACE_CONCAT_(a, b)
+#define WEBGPU_REND_TRACE_SCOPE(name) \
+    ::webgpu_rend::TraceScope WEBGPU_REND_TRACE_CONCAT(webgpu_rend_trace_scope_, __LINE__)(name)
+#define WEBGPU_REND_TRACE_FUNCTION() WEBGPU_REND_TRACE_SCOPE(__func__)
+
+#endif  // WEBGPU_REND_TRACE_H
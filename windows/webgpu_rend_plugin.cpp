@@ -6,10 +6,15 @@
 
 #include <cstring>
 #include <iostream>
-#include <map>
 #include <mutex>
 #include <vector>
 
+#include "../src/webgpu_rend_completion.h"
+#include "../src/webgpu_rend_device_setup.h"
+#include "../src/webgpu_rend_handle_table.h"
+#include "../src/webgpu_rend_readback.h"
+#include "../src/webgpu_rend_trace.h"
+
 using namespace webgpu_rend;
 using Microsoft::WRL::ComPtr;
 
@@ -19,7 +24,9 @@ static flutter::TextureRegistrar* g_texture_registrar = nullptr;
 static std::unique_ptr<dawn::native::Instance> g_dawn_instance;
 static wgpu::Device g_wgpu_device;
 static wgpu::Queue g_wgpu_queue;
-static std::map<WebgpuRendTexture, std::unique_ptr<GpuTextureObject>> g_textures;
+// Lookups go through the handle table without locking, g_mutex only
+// serializes the Dawn and D3D calls.
+static HandleTable<GpuTextureObject> g_textures;
 static std::mutex g_mutex;
 
 // D3D11 Helper
@@ -35,12 +42,13 @@ bool InitializeD3D11() {
 // Dawn Error Callback
 void PrintDeviceError(WGPUDevice const* device, WGPUErrorType type, WGPUStringView message, void* userdata1, void* userdata2) {
     std::cerr << "Dawn Error (" << type << "): " << std::string(message.data, message.length) << std::endl;
+    TraceMessage("Dawn Error", std::string(message.data, message.length));
 }
 
 void InitializeDawn() {
     if (g_wgpu_device) return;
 
-    g_dawn_instance = std::make_unique<dawn::native::Instance>();
+    g_dawn_instance = CreateInstance();
 
     WGPURequestAdapterOptions options = {};
     options.powerPreference = WGPUPowerPreference_HighPerformance;
@@ -61,12 +69,8 @@ void InitializeDawn() {
         }
     }
 
-    WGPUDeviceDescriptor deviceDesc = {};
-
-    WGPUFeatureName requiredFeatures[] = {
-        WGPUFeatureName_SharedTextureMemoryDXGISharedHandle};
-    deviceDesc.requiredFeatures = requiredFeatures;
-    deviceDesc.requiredFeatureCount = 1;
+    DeviceSetup setup(chosenAdapter.Get(), {WGPUFeatureName_SharedTextureMemoryDXGISharedHandle});
+    WGPUDeviceDescriptor& deviceDesc = *setup.Descriptor();
 
     WGPUUncapturedErrorCallbackInfo errorCallbackInfo = {};
     errorCallbackInfo.callback = PrintDeviceError;
@@ -82,10 +86,26 @@ void InitializeDawn() {
 
     g_wgpu_device = wgpu::Device::Acquire(cDevice);
     g_wgpu_queue = g_wgpu_device.GetQueue();
+    StartCompletionThread(g_dawn_instance->Get(), g_wgpu_device.Get());
+    StartReadbackEngine(g_wgpu_device.Get(), g_wgpu_queue.Get());
 }
 
-GpuTextureObject::GpuTextureObject(int w, int h, flutter::TextureRegistrar& registrar, ComPtr<ID3D11Device> device, wgpu::Device wgpu_dev)
-    : width(w), height(h), texture_registrar(registrar), d3d_device(device), texture_id(-1) {
+static void ProcessEvents() {
+    wgpuInstanceProcessEvents(g_dawn_instance->Get());
+}
+
+// Work-done callback of SubmitFrame, lock-free as PresentQueue requires;
+// marking a texture frame available is thread-safe. Flutter only hears about
+// the frame once the GPU has finished it.
+static void OnFrameDone(WebgpuRendTexture t, uint64_t frame) {
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex) return;
+    if (tex->swapchain) tex->swapchain->Completed();
+    tex->texture_registrar.MarkTextureFrameAvailable(tex->texture_id);
+    tex->present_queue.Complete(t, frame);
+}
+
+SharedImage::SharedImage(int width, int height, ComPtr<ID3D11Device> device, wgpu::Device wgpu_dev) {
     D3D11_TEXTURE2D_DESC d3d_desc = {};
     d3d_desc.Width = width;
     d3d_desc.Height = height;
@@ -97,7 +117,7 @@ GpuTextureObject::GpuTextureObject(int w, int h, flutter::TextureRegistrar& regi
     d3d_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
     d3d_desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
 
-    if (FAILED(d3d_device->CreateTexture2D(&d3d_desc, nullptr, &d3d_texture))) {
+    if (FAILED(device->CreateTexture2D(&d3d_desc, nullptr, &d3d_texture))) {
         throw std::runtime_error("Failed to create D3D11 texture");
     }
 
@@ -106,20 +126,13 @@ GpuTextureObject::GpuTextureObject(int w, int h, flutter::TextureRegistrar& regi
     HANDLE shared_handle;
     dxgi_resource->GetSharedHandle(&shared_handle);
 
-    surface_descriptor = std::make_unique<FlutterDesktopGpuSurfaceDescriptor>();
-    surface_descriptor->struct_size = sizeof(FlutterDesktopGpuSurfaceDescriptor);
-    surface_descriptor->handle = shared_handle;
-    surface_descriptor->width = width;
-    surface_descriptor->height = height;
-    surface_descriptor->visible_width = width;
-    surface_descriptor->visible_height = height;
-    surface_descriptor->format = kFlutterDesktopPixelFormatBGRA8888;
-
-    texture_variant = std::make_unique<flutter::TextureVariant>(flutter::GpuSurfaceTexture(
-        kFlutterDesktopGpuSurfaceTypeDxgiSharedHandle,
-        [this](auto, auto) { return this->surface_descriptor.get(); }));
-
-    texture_id = texture_registrar.RegisterTexture(texture_variant.get());
+    surface_descriptor.struct_size = sizeof(FlutterDesktopGpuSurfaceDescriptor);
+    surface_descriptor.handle = shared_handle;
+    surface_descriptor.width = width;
+    surface_descriptor.height = height;
+    surface_descriptor.visible_width = width;
+    surface_descriptor.visible_height = height;
+    surface_descriptor.format = kFlutterDesktopPixelFormatBGRA8888;
 
     wgpu::SharedTextureMemoryDXGISharedHandleDescriptor handle_desc{};
     handle_desc.handle = shared_handle;
@@ -140,7 +153,44 @@ GpuTextureObject::GpuTextureObject(int w, int h, flutter::TextureRegistrar& regi
                      wgpu::TextureUsage::CopySrc;
 
     webgpu_texture = shared_memory->CreateTexture(&tex_desc);
-    default_view = webgpu_texture.CreateView();
+    view = webgpu_texture.CreateView();
+}
+
+GpuTextureObject::GpuTextureObject(int w, int h, flutter::TextureRegistrar& registrar, ComPtr<ID3D11Device> device, wgpu::Device wgpu_dev, uint32_t image_count)
+    : width(w), height(h), texture_registrar(registrar), d3d_device(device), texture_id(-1) {
+    if (image_count > 0) swapchain = std::make_unique<SwapchainRing>(image_count);
+    uint32_t count = swapchain ? swapchain->ImageCount() : 1;
+    for (uint32_t i = 0; i < count; i++) {
+        images.push_back(std::make_unique<SharedImage>(width, height, d3d_device, wgpu_dev));
+    }
+    webgpu_texture = images[0]->webgpu_texture;
+    default_view = images[0]->view;
+
+    // Runs on the raster thread whenever Flutter draws the texture
+    texture_variant = std::make_unique<flutter::TextureVariant>(flutter::GpuSurfaceTexture(
+        kFlutterDesktopGpuSurfaceTypeDxgiSharedHandle,
+        [this](auto, auto) {
+            int32_t image = this->swapchain ? this->swapchain->Latch() : 0;
+            return &this->images[image >= 0 ? image : 0]->surface_descriptor;
+        }));
+
+    texture_id = texture_registrar.RegisterTexture(texture_variant.get());
+}
+
+// Flushes the frame and has OnFrameDone hand it to Flutter. g_mutex must be
+// held.
+static void SubmitFrame(GpuTextureObject* tex, WebgpuRendTexture t) {
+    // Only blocks, on the oldest frame's future, if the GPU is a full
+    // max_frames_in_flight behind
+    tex->present_queue.WaitUntilReady(g_dawn_instance->Get(), t);
+
+    g_wgpu_queue.Submit(0, nullptr);
+    uint64_t frame = tex->present_queue.Submit();
+    wgpu::Future done = g_wgpu_queue.OnSubmittedWorkDone(
+        wgpu::CallbackMode::AllowSpontaneous,
+        [t, frame](wgpu::QueueWorkDoneStatus, wgpu::StringView) { OnFrameDone(t, frame); });
+    tex->present_queue.SetWorkDoneFuture(frame, {done.id});
+    WatchFuture({done.id});
 }
 
 GpuTextureObject::~GpuTextureObject() {
@@ -155,6 +205,7 @@ void WebgpuRendPlugin::RegisterWithRegistrar(flutter::PluginRegistrarWindows* re
 extern "C" {
 
 API_EXPORT void* webgpu_rend_get_proc_address(const char* procName) {
+    WEBGPU_REND_TRACE_FUNCTION();
     WGPUStringView view;
     view.data = procName;
     view.length = std::strlen(procName);
@@ -162,70 +213,171 @@ API_EXPORT void* webgpu_rend_get_proc_address(const char* procName) {
 }
 
 API_EXPORT void* webgpu_rend_init(void* registrar) {
+    WEBGPU_REND_TRACE_FUNCTION();
     InitializeDawn();
     return g_wgpu_device.Get();
 }
 
 API_EXPORT WebgpuRendTexture webgpu_rend_create_texture(int32_t width, int32_t height) {
+    WEBGPU_REND_TRACE_FUNCTION();
     std::lock_guard<std::mutex> lock(g_mutex);
     if (!g_wgpu_device) return nullptr;
     try {
         auto tex = std::make_unique<GpuTextureObject>(width, height, *g_texture_registrar, g_d3d_device, g_wgpu_device);
-        WebgpuRendTexture handle = tex.get();
-        g_textures[handle] = std::move(tex);
-        return handle;
+        return HandleToPointer(g_textures.Insert(std::move(tex)));
     } catch (...) {
         return nullptr;
     }
 }
 
 API_EXPORT int64_t webgpu_rend_get_texture_id(WebgpuRendTexture t) {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    return g_textures.count(t) ? g_textures.at(t)->texture_id : -1;
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->texture_id : -1;
 }
 
 API_EXPORT void* webgpu_rend_get_wgpu_texture(WebgpuRendTexture t) {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    return g_textures.count(t) ? g_textures.at(t)->webgpu_texture.Get() : nullptr;
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->webgpu_texture.Get() : nullptr;
 }
 
 API_EXPORT void* webgpu_rend_get_wgpu_texture_view(WebgpuRendTexture t) {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    return g_textures.count(t) ? g_textures.at(t)->default_view.Get() : nullptr;
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->default_view.Get() : nullptr;
 }
 
+// Swapchain images are bracketed by acquire and present instead
 API_EXPORT void webgpu_rend_texture_begin_access(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || tex->swapchain) return;
     std::lock_guard<std::mutex> lock(g_mutex);
-    if (!g_textures.count(t)) return;
-    auto& tex = g_textures.at(t);
 
     wgpu::SharedTextureMemoryBeginAccessDescriptor desc = {};
     desc.initialized = true;
     desc.fenceCount = 0;
 
-    tex->shared_memory->BeginAccess(tex->webgpu_texture, &desc);
+    tex->images[0]->shared_memory->BeginAccess(tex->webgpu_texture, &desc);
 }
 
 API_EXPORT void webgpu_rend_texture_end_access(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || tex->swapchain) return;
     std::lock_guard<std::mutex> lock(g_mutex);
-    if (!g_textures.count(t)) return;
-    auto& tex = g_textures.at(t);
 
     wgpu::SharedTextureMemoryEndAccessState state = {};
-    tex->shared_memory->EndAccess(tex->webgpu_texture, &state);
+    tex->images[0]->shared_memory->EndAccess(tex->webgpu_texture, &state);
 }
 
+// Swapchains present through webgpu_rend_swapchain_present_image
 API_EXPORT void webgpu_rend_present_texture(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || tex->swapchain) return;
     std::lock_guard<std::mutex> lock(g_mutex);
-    if (!g_textures.count(t)) return;
-
-    g_wgpu_queue.Submit(0, nullptr);
-    g_textures.at(t)->texture_registrar.MarkTextureFrameAvailable(g_textures.at(t)->texture_id);
+    SubmitFrame(tex.get(), t);
 }
 
 API_EXPORT void webgpu_rend_dispose_texture(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::unique_ptr<GpuTextureObject> tex = g_textures.Remove(HandleFromPointer(t));
     std::lock_guard<std::mutex> lock(g_mutex);
-    g_textures.erase(t);
+    tex.reset();
+}
+
+API_EXPORT void webgpu_rend_set_frame_ready_callback(WebgpuRendFrameReadyCallback callback) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    SetFrameReadyCallback(callback);
+}
+
+API_EXPORT void webgpu_rend_set_max_frames_in_flight(WebgpuRendTexture t, int32_t count) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (tex) tex->present_queue.SetMaxFramesInFlight(count > 0 ? count : 1);
+}
+
+API_EXPORT int32_t webgpu_rend_get_max_frames_in_flight(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->present_queue.MaxFramesInFlight() : 0;
+}
+
+API_EXPORT int32_t webgpu_rend_get_frames_in_flight(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex ? tex->present_queue.FramesInFlight() : 0;
+}
+
+API_EXPORT int32_t webgpu_rend_process_events() {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_dawn_instance) ProcessEvents();
+    return TotalFramesInFlight();
+}
+
+API_EXPORT WebgpuRendTexture webgpu_rend_create_swapchain(int32_t width, int32_t height, int32_t count) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_wgpu_device) return nullptr;
+    try {
+        auto tex = std::make_unique<GpuTextureObject>(width, height, *g_texture_registrar, g_d3d_device, g_wgpu_device,
+                                                      count > 0 ? count : kMinSwapchainImages);
+        return HandleToPointer(g_textures.Insert(std::move(tex)));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+API_EXPORT int32_t webgpu_rend_swapchain_get_image_count(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    return tex && tex->swapchain ? tex->swapchain->ImageCount() : 0;
+}
+
+API_EXPORT int32_t webgpu_rend_swapchain_acquire_image(WebgpuRendTexture t) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || !tex->swapchain) return -1;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    int32_t image = tex->swapchain->Acquire();
+    if (image < 0) return -1;
+
+    wgpu::SharedTextureMemoryBeginAccessDescriptor desc = {};
+    desc.initialized = true;
+    desc.fenceCount = 0;
+    SharedImage& shared = *tex->images[image];
+    shared.shared_memory->BeginAccess(shared.webgpu_texture, &desc);
+    return image;
+}
+
+API_EXPORT void* webgpu_rend_swapchain_get_wgpu_texture(WebgpuRendTexture t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || !tex->swapchain || image < 0 || image >= (int32_t)tex->images.size()) return nullptr;
+    return tex->images[image]->webgpu_texture.Get();
+}
+
+API_EXPORT void* webgpu_rend_swapchain_get_wgpu_texture_view(WebgpuRendTexture t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || !tex->swapchain || image < 0 || image >= (int32_t)tex->images.size()) return nullptr;
+    return tex->images[image]->view.Get();
+}
+
+API_EXPORT void webgpu_rend_swapchain_present_image(WebgpuRendTexture t, int32_t image) {
+    WEBGPU_REND_TRACE_FUNCTION();
+    auto tex = g_textures.Acquire(HandleFromPointer(t));
+    if (!tex || !tex->swapchain) return;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!tex->swapchain->Present(image)) return;
+
+    wgpu::SharedTextureMemoryEndAccessState state = {};
+    SharedImage& shared = *tex->images[image];
+    shared.shared_memory->EndAccess(shared.webgpu_texture, &state);
+    SubmitFrame(tex.get(), t);
 }
 
 }  // extern C
\ No newline at end of file
@@ -8,13 +8,31 @@
 #include <wrl/client.h>
 
 #include <memory>
+#include <vector>
 
 #include "../src/webgpu_rend_api.h"
+#include "../src/webgpu_rend_present_queue.h"
+#include "../src/webgpu_rend_swapchain_ring.h"
 
 namespace webgpu_rend {
 
+// One D3D11 texture Dawn renders into and Flutter samples through its DXGI
+// shared handle.
+struct SharedImage {
+    SharedImage(int width, int height, Microsoft::WRL::ComPtr<ID3D11Device> device, wgpu::Device wgpu_device);
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> d3d_texture;
+    FlutterDesktopGpuSurfaceDescriptor surface_descriptor = {};
+
+    std::unique_ptr<wgpu::SharedTextureMemory> shared_memory;
+    wgpu::Texture webgpu_texture;
+    wgpu::TextureView view;
+};
+
+// A plain texture has a single image. A swapchain has image_count of them
+// and Flutter is shown whichever image the SwapchainRing latched last.
 struct GpuTextureObject {
-    GpuTextureObject(int width, int height, flutter::TextureRegistrar& registrar, Microsoft::WRL::ComPtr<ID3D11Device> device, wgpu::Device wgpu_device);
+    GpuTextureObject(int width, int height, flutter::TextureRegistrar& registrar, Microsoft::WRL::ComPtr<ID3D11Device> device, wgpu::Device wgpu_device, uint32_t image_count = 0);
     ~GpuTextureObject();
 
     int width, height;
@@ -22,13 +40,17 @@ struct GpuTextureObject {
     flutter::TextureRegistrar& texture_registrar;
 
     Microsoft::WRL::ComPtr<ID3D11Device> d3d_device;
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> d3d_texture;
     std::unique_ptr<flutter::TextureVariant> texture_variant;
-    std::unique_ptr<FlutterDesktopGpuSurfaceDescriptor> surface_descriptor;
 
-    std::unique_ptr<wgpu::SharedTextureMemory> shared_memory;
+    // Heap allocated, Flutter keeps pointers to the surface descriptors
+    std::vector<std::unique_ptr<SharedImage>> images;
+    std::unique_ptr<SwapchainRing> swapchain;
+
+    // Image 0
     wgpu::Texture webgpu_texture;
     wgpu::TextureView default_view;
+
+    PresentQueue present_queue;
 };
 
 class WebgpuRendPlugin {